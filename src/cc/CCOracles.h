@@ -30,5 +30,9 @@ UniValue OracleDataSample(uint256 reforacletxid,uint256 txid);
 UniValue OracleDataSamples(uint256 reforacletxid,char* batonaddr,int32_t num);
 UniValue OracleInfo(uint256 origtxid);
 UniValue OraclesList();
+// oracles index
+bool GetOracleSample(const CTransaction &tx,int32_t height,int32_t txindex,COracleSampleKey &key,std::vector<uint8_t> &data);
+void OracleSamplesConnected(const std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > > &samples);
+void OracleSamplesDisconnected(const std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > > &samples);
 
 #endif
@@ -441,6 +441,13 @@ uint8_t DecodeTokenCreateOpRet(const CScript &scriptPubKey, std::vector<uint8_t>
 /// @returns funcid ('c' if creation tx or 't' if token transfer tx) or NULL if errors
 uint8_t DecodeTokenOpRet(const CScript scriptPubKey, uint8_t &evalCodeTokens, uint256 &tokenid, std::vector<CPubKey> &voutPubkeys, std::vector<std::pair<uint8_t, vscript_t>>  &oprets);
 
+/// Returns the tokenid a transaction's outputs belong to, as used by the token index: the txid of a token creation tx or the tokenid from a token transfer opret.
+/// Transactions without a tokens opreturn are rejected without being decoded, so this is cheap to call for every transaction of a block.
+/// @param tx transaction to check
+/// @param[out] tokenid id of token
+/// @returns true if tx is a token creation or transfer transaction
+bool GetTxTokenId(const CTransaction &tx, uint256 &tokenid);
+
 /// @private
 int64_t AddCClibtxfee(struct CCcontract_info *cp, CMutableTransaction &mtx, CPubKey pk);
 
@@ -836,6 +843,13 @@ UniValue FinalizeCCTxExt(bool remote, uint64_t skipmask, struct CCcontract_info
 /// @param CCflag if true the function searches for cc outputs, otherwise for normal outputs
 void SetCCunspents(std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,char *coinaddr,bool CCflag = true);
 
+/// SetCCtokenunspents returns the cc unspent outputs on an address, filtered by tokenid if the token index is enabled
+/// @param[out] unspentOutputs vector of pairs of address key and amount
+/// @param coinaddr address where unspent outputs are searched
+/// @param tokenid id of token
+/// @returns true if the outputs were read from the token index and all hold tokenid, false if all cc outputs of the address were returned
+bool SetCCtokenunspents(std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,char *coinaddr,uint256 tokenid);
+
 /// SetCCtxids returns a vector of all outputs on an address
 /// @param[out] addressIndex vector of pairs of address index key and amount
 /// @param coinaddr address where the unspent outputs are searched
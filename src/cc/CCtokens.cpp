@@ -628,7 +628,7 @@ int64_t AddTokenCCInputs(struct CCcontract_info *cp, CMutableTransaction &mtx, C
         cp->additionalTokensEvalcode2 = vopretNonfungible.begin()[0];
 
 	GetTokensCCaddress(cp, tokenaddr, pk);
-	SetCCunspents(unspentOutputs, tokenaddr,true);
+	SetCCtokenunspents(unspentOutputs, tokenaddr, tokenid);
 
 
     if (unspentOutputs.empty()) {
@@ -277,6 +277,23 @@ uint8_t DecodeTokenOpRet(const CScript scriptPubKey, uint8_t &evalCodeTokens, ui
 }
 
 
+bool GetTxTokenId(const CTransaction &tx, uint256 &tokenid)
+{
+    vscript_t vopret;
+    uint8_t evalCode, funcId;
+    std::vector<CPubKey> voutPubkeys;
+    std::vector<std::pair<uint8_t, vscript_t>> oprets;
+
+    if (tx.vout.size() < 2)
+        return false;
+    GetOpReturnData(tx.vout.back().scriptPubKey, vopret);
+    if (vopret.size() <= 2 || vopret[0] != EVAL_TOKENS)
+        return false;
+    if ((funcId = DecodeTokenOpRet(tx.vout.back().scriptPubKey, evalCode, tokenid, voutPubkeys, oprets)) == 'c')
+        tokenid = tx.GetHash();
+    return funcId != 0 && !tokenid.IsNull();
+}
+
 // make three-eval (token+evalcode+evalcode2) 1of2 cryptocondition:
 CC *MakeTokensCCcond1of2(uint8_t evalcode, uint8_t evalcode2, CPubKey pk1, CPubKey pk2)
 {
@@ -418,6 +418,25 @@ void SetCCunspents(std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValu
     }
 }
 
+bool SetCCtokenunspents(std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,char *coinaddr,uint256 tokenid)
+{
+    int32_t type=0; uint160 hashBytes; std::vector<std::pair<CTokenUnspentKey, CAddressUnspentValue> > tokenOutputs;
+    if ( KOMODO_NSPV_SUPERLITE || !fTokenIndex )
+    {
+        SetCCunspents(unspentOutputs,coinaddr,true);
+        return false;
+    }
+    CBitcoinAddress address(coinaddr);
+    if ( address.GetIndexKey(hashBytes, type, true) == 0 )
+        return true;
+    if ( GetTokenUnspent(tokenid, hashBytes, type, tokenOutputs) == 0 )
+        return true;
+    unspentOutputs.reserve(unspentOutputs.size() + tokenOutputs.size());
+    for (std::vector<std::pair<CTokenUnspentKey, CAddressUnspentValue> >::const_iterator it=tokenOutputs.begin(); it!=tokenOutputs.end(); it++)
+        unspentOutputs.push_back(std::make_pair(CAddressUnspentKey(it->first.type, it->first.hashBytes, it->first.txhash, it->first.index), it->second));
+    return true;
+}
+
 void SetCCtxids(std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,char *coinaddr,bool ccflag)
 {
     int32_t type=0,i,n; char *ptr; std::string addrstr; uint160 hashBytes; std::vector<std::pair<uint160, int> > addresses;
@@ -442,6 +461,31 @@ void SetCCtxids(std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex
     }
 }
 
+/// SetCCtxidsIndexed is the filtered SetCCtxids through the cc index. Only the address index rows at the heights
+/// of the indexed candidates are read, so the result keeps the order of the full address scan, without the txids
+/// that cannot match. Creation txs have no reference txid, filtertxid itself is always a candidate.
+static bool SetCCtxidsIndexed(std::vector<uint256> &txids,uint160 hashBytes,int32_t type,uint8_t evalcode,uint256 filtertxid,uint8_t func)
+{
+    std::vector<CEvalIndexKey> keys; std::map<int32_t,std::set<uint256> > candidates; CTransaction tx; uint256 hashBlock;
+    if ( GetCCEvalIndex(evalcode,func,filtertxid,keys) == 0 )
+        return false;
+    for (std::vector<CEvalIndexKey>::const_iterator it=keys.begin(); it!=keys.end(); it++)
+        candidates[it->blockHeight].insert(it->txhash);
+    if ( filtertxid != zeroid && myGetTransaction(filtertxid,tx,hashBlock) != 0 && !hashBlock.IsNull() )
+        candidates[komodo_blockheight(hashBlock)].insert(filtertxid);
+    for (std::map<int32_t,std::set<uint256> >::const_iterator it=candidates.begin(); it!=candidates.end(); it++)
+    {
+        std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+        if ( it->first <= 0 || GetAddressIndex(hashBytes,type,addressIndex,it->first,it->first) == 0 )
+            continue;
+        for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it1=addressIndex.begin(); it1!=addressIndex.end(); it1++)
+        {
+            if (it1->second>=0 && it->second.count(it1->first.txhash) != 0) txids.push_back(it1->first.txhash);
+        }
+    }
+    return true;
+}
+
 void SetCCtxids(std::vector<uint256> &txids,char *coinaddr,bool ccflag, uint8_t evalcode, uint256 filtertxid, uint8_t func)
 {
     int32_t type=0,i,n; char *ptr; std::string addrstr; uint160 hashBytes; std::vector<std::pair<uint160, int> > addresses;
@@ -459,6 +503,8 @@ void SetCCtxids(std::vector<uint256> &txids,char *coinaddr,bool ccflag, uint8_t
     CBitcoinAddress address(addrstr);
     if ( address.GetIndexKey(hashBytes, type, ccflag) == 0 )
         return;
+    if ( fCCIndex && evalcode != 0 && (func != 0 || filtertxid != zeroid) && SetCCtxidsIndexed(txids,hashBytes,type,evalcode,filtertxid,func) )
+        return;
     addresses.push_back(std::make_pair(hashBytes,type));
     for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++)
     {
@@ -561,7 +607,13 @@ int64_t CCtoken_balance(char *coinaddr,uint256 reftokenid)
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
 	uint8_t evalCode;
 
-    SetCCunspents(unspentOutputs,coinaddr,true);
+    if ( SetCCtokenunspents(unspentOutputs,coinaddr,reftokenid) )
+    {
+        // the token index already filtered the outputs by tokenid
+        for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
+            sum += it->second.satoshis;
+        return(sum);
+    }
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
     {
         txid = it->first.txhash;
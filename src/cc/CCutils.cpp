@@ -631,6 +631,25 @@ int32_t myGet_mempool_txs(std::vector<CTransaction> &txs,uint8_t evalcode,uint8_
         }
         return (NSPV_mempoolresult.numtxids);
     }
+    if ( fCCIndex && evalcode != 0 )
+    {
+        // only the txs the mempool cc index has under evalcode and funcid. A tx can have several
+        // index keys, so they are collected in a set and returned in ascending txid order, not
+        // in the unordered iteration order of mapTx the scan below uses
+        std::vector<CEvalIndexKey> keys; std::set<uint256> txids; CTransaction tx;
+        mempool.getEvalIndex(evalcode,funcid,zeroid,keys);
+        for (std::vector<CEvalIndexKey>::const_iterator it=keys.begin(); it!=keys.end(); it++)
+            txids.insert(it->txhash);
+        for (std::set<uint256>::const_iterator it=txids.begin(); it!=txids.end(); it++)
+        {
+            if ( mempool.lookup(*it,tx) )
+            {
+                txs.push_back(tx);
+                i++;
+            }
+        }
+        return(i);
+    }
     BOOST_FOREACH(const CTxMemPoolEntry &e,mempool.mapTx)
     {
         txs.push_back(e.GetTx());
@@ -15,6 +15,7 @@
 
 #include "CCOracles.h"
 #include <secp256k1.h>
+#include <deque>
 
 /*
  An oracles CC has the purpose of converting offchain data into onchain data
@@ -1035,6 +1036,100 @@ UniValue OracleFormat(uint8_t *data,int32_t datalen,char *format,int32_t formatl
     return(obj);
 }
 
+// The newest samples of recently queried feeds are kept in memory in front of the oracles index,
+// price consumers poll the same few feeds for their latest values over and over
+#define ORACLES_SAMPLE_RING_SIZE 256
+#define ORACLES_MAX_SAMPLE_RINGS 1024
+
+struct oraclesample_ring
+{
+    std::deque<std::pair<COracleSampleKey, std::vector<uint8_t> > > samples; // newest first
+    bool complete; // holds all samples of the feed
+};
+
+static CCriticalSection cs_oraclesamples;
+static std::map<std::pair<uint256,uint160>,struct oraclesample_ring> oraclesample_rings;
+
+bool GetOracleSample(const CTransaction &tx,int32_t height,int32_t txindex,COracleSampleKey &key,std::vector<uint8_t> &data)
+{
+    std::vector<uint8_t> vopret; uint256 oracletxid,btxid; CPubKey pk; char batonaddr[64]; uint160 batonhash; int32_t numvouts,type;
+    if ( (numvouts= tx.vout.size()) < 3 || tx.vout[1].nValue != CC_MARKER_VALUE )
+        return(false);
+    GetOpReturnData(tx.vout[numvouts-1].scriptPubKey,vopret);
+    if ( vopret.size() <= 2 || vopret[0] != EVAL_ORACLES || vopret[1] != 'D' )
+        return(false);
+    if ( DecodeOraclesData(tx.vout[numvouts-1].scriptPubKey,oracletxid,btxid,pk,data) != 'D' )
+        return(false);
+    if ( Getscriptaddress(batonaddr,tx.vout[1].scriptPubKey) == 0 || CBitcoinAddress(batonaddr).GetIndexKey(batonhash,type,true) == 0 )
+        return(false);
+    key = COracleSampleKey(oracletxid,batonhash,height,txindex,tx.GetHash());
+    return(true);
+}
+
+void OracleSamplesConnected(const std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > > &samples)
+{
+    LOCK(cs_oraclesamples);
+    for (std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > >::const_iterator it=samples.begin(); it!=samples.end(); it++)
+    {
+        std::map<std::pair<uint256,uint160>,struct oraclesample_ring>::iterator ri = oraclesample_rings.find(std::make_pair(it->first.oracletxid,it->first.batonHash));
+        if ( ri == oraclesample_rings.end() )
+            continue;
+        ri->second.samples.push_front(*it);
+        if ( ri->second.samples.size() > ORACLES_SAMPLE_RING_SIZE )
+        {
+            ri->second.samples.pop_back();
+            ri->second.complete = false;
+        }
+    }
+}
+
+void OracleSamplesDisconnected(const std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > > &samples)
+{
+    // rare, just reload the affected feeds on their next query
+    LOCK(cs_oraclesamples);
+    for (std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > >::const_iterator it=samples.begin(); it!=samples.end(); it++)
+        oraclesample_rings.erase(std::make_pair(it->first.oracletxid,it->first.batonHash));
+}
+
+static bool OracleSamplesFromRing(uint256 oracletxid,uint160 batonhash,int32_t num,std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > > &samples)
+{
+    AssertLockHeld(cs_oraclesamples);
+    std::map<std::pair<uint256,uint160>,struct oraclesample_ring>::const_iterator ri = oraclesample_rings.find(std::make_pair(oracletxid,batonhash));
+    if ( ri == oraclesample_rings.end() )
+        return(false);
+    const struct oraclesample_ring &ring = ri->second;
+    if ( !ring.complete && (num == 0 || num > (int32_t)ring.samples.size()) )
+        return(false);
+    samples.assign(ring.samples.begin(),(num == 0 || num >= (int32_t)ring.samples.size()) ? ring.samples.end() : ring.samples.begin()+num);
+    return(true);
+}
+
+static bool OracleSamplesIndexed(uint256 oracletxid,uint160 batonhash,int32_t num,std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > > &samples)
+{
+    {
+        LOCK(cs_oraclesamples);
+        if ( OracleSamplesFromRing(oracletxid,batonhash,num,samples) )
+            return(true);
+    }
+    // cs_main keeps blocks from being connected between reading the index and filling the ring
+    LOCK(cs_main);
+    if ( num != 0 && num <= ORACLES_SAMPLE_RING_SIZE )
+    {
+        struct oraclesample_ring ring;
+        std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > > newest;
+        if ( !GetOracleSamples(oracletxid,batonhash,ORACLES_SAMPLE_RING_SIZE,newest) )
+            return(false);
+        ring.samples.assign(newest.begin(),newest.end());
+        ring.complete = newest.size() < ORACLES_SAMPLE_RING_SIZE;
+        LOCK(cs_oraclesamples);
+        if ( oraclesample_rings.size() >= ORACLES_MAX_SAMPLE_RINGS )
+            oraclesample_rings.clear();
+        oraclesample_rings[std::make_pair(oracletxid,batonhash)] = ring;
+        return(OracleSamplesFromRing(oracletxid,batonhash,num,samples));
+    }
+    return(GetOracleSamples(oracletxid,batonhash,num,samples));
+}
+
 UniValue OracleDataSample(uint256 reforacletxid,uint256 txid)
 {
     UniValue result(UniValue::VOBJ); CTransaction tx,oracletx; uint256 hashBlock,btxid,oracletxid;  std::string error;
@@ -1101,10 +1196,28 @@ UniValue OracleDataSamples(uint256 reforacletxid,char* batonaddr,int32_t num)
                     }
                 }
             }
+            if ( fOraclesIndex && !KOMODO_NSPV_SUPERLITE )
+            {
+                std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > > samples; uint160 batonhash; int32_t type;
+                if ( CBitcoinAddress(batonaddr).GetIndexKey(batonhash,type,true) != 0 && OracleSamplesIndexed(reforacletxid,batonhash,num != 0 ? num-n : 0,samples) )
+                {
+                    if ( (formatstr= (char *)format.c_str()) == 0 )
+                        formatstr = (char *)"";
+                    for (std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > >::const_iterator it=samples.begin(); it!=samples.end(); it++)
+                    {
+                        UniValue a(UniValue::VOBJ);
+                        a.push_back(Pair("txid",it->first.txhash.GetHex()));
+                        a.push_back(Pair("data",OracleFormat((uint8_t *)it->second.data(),(int32_t)it->second.size(),formatstr,(int32_t)format.size())));
+                        b.push_back(a);
+                    }
+                }
+                result.push_back(Pair("samples",b));
+                return(result);
+            }
             SetCCtxids(txids,batonaddr,true,EVAL_ORACLES,reforacletxid,'D');
             if (txids.size()>0)
             {
-                for (std::vector<uint256>::const_iterator it=txids.end()-1; it!=txids.begin(); it--)
+                for (std::vector<uint256>::const_reverse_iterator it=txids.rbegin(); it!=txids.rend(); it++)
                 {
                     txid=*it;
                     if (myGetTransaction(txid,tx,hashBlock) != 0 && (numvouts=tx.vout.size()) > 0 )
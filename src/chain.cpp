@@ -20,6 +20,14 @@
 
 #include "chain.h"
 
+#include "main.h"
+#include "sync.h"
+#include "txdb.h"
+
+#include <list>
+#include <map>
+#include <stdexcept>
+
 using namespace std;
 
 /**
@@ -177,3 +185,67 @@ void CBlockIndex::BuildSkip()
     if (pprev)
         pskip = pprev->GetAncestor(GetSkipHeight(GetHeight()));
 }
+
+/**
+ * Guards nSolution and fSolutionTrimmed of every entry, which are trimmed under
+ * cs_main but read without it, and the solutions read back recently, most
+ * recent first.
+ */
+static const size_t SOLUTION_CACHE_SIZE = 1024;
+static CCriticalSection cs_solutions;
+static std::list<std::pair<uint256, std::vector<unsigned char> > > lruSolutions;
+static std::map<uint256, std::list<std::pair<uint256, std::vector<unsigned char> > >::iterator> mapSolutions;
+
+void CBlockIndex::TrimSolution()
+{
+    LOCK(cs_solutions);
+    // swap rather than clear, which would keep the allocation
+    std::vector<unsigned char>().swap(nSolution);
+    fSolutionTrimmed = true;
+}
+
+std::vector<unsigned char> CBlockIndex::GetSolution() const
+{
+    uint256 hash = GetBlockHash();
+    {
+        LOCK(cs_solutions);
+        if (!fSolutionTrimmed)
+            return nSolution;
+        auto it = mapSolutions.find(hash);
+        if (it != mapSolutions.end()) {
+            lruSolutions.splice(lruSolutions.begin(), lruSolutions, it->second);
+            return it->second->second;
+        }
+    }
+
+    CDiskBlockIndex diskindex;
+    if (!pblocktree->ReadDiskBlockIndex(hash, diskindex)) {
+        LogPrintf("%s: failed to read block index entry of %s\n", __func__, hash.ToString());
+        throw std::runtime_error("CBlockIndex::GetSolution(): failed to read block index entry");
+    }
+
+    LOCK(cs_solutions);
+    if (mapSolutions.count(hash) == 0) {
+        lruSolutions.emplace_front(hash, diskindex.nSolution);
+        mapSolutions[hash] = lruSolutions.begin();
+        if (lruSolutions.size() > SOLUTION_CACHE_SIZE) {
+            mapSolutions.erase(lruSolutions.back().first);
+            lruSolutions.pop_back();
+        }
+    }
+    return diskindex.nSolution;
+}
+
+CBlockIndex CBlockIndex::CopyWithSolution() const
+{
+    CBlockIndex copy;
+    {
+        LOCK(cs_solutions);
+        copy = *this;
+    }
+    if (copy.fSolutionTrimmed) {
+        copy.nSolution = GetSolution();
+        copy.fSolutionTrimmed = false;
+    }
+    return copy;
+}
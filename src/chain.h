@@ -305,8 +305,13 @@ public:
     unsigned int nTime;
     unsigned int nBits;
     uint256 nNonce;
+    //! Dropped once the entry is in the block tree db, use GetSolution()
     std::vector<unsigned char> nSolution;
 
+    //! (memory only) Whether nSolution was dropped by TrimSolution(), both are
+    //! only accessed through the members below once the entry is in mapBlockIndex
+    bool fSolutionTrimmed;
+
     //! (memory only) Sequential id assigned to distinguish order in which blocks are received.
     uint32_t nSequenceId;
     
@@ -341,6 +346,7 @@ public:
         nBits          = 0;
         nNonce         = uint256();
         nSolution.clear();
+        fSolutionTrimmed = false;
     }
 
     CBlockIndex()
@@ -389,6 +395,18 @@ public:
         return ret;
     }
 
+    /**
+     * Drops the solution from memory, it is read back from the block tree db
+     * when needed. Only call once the entry has been written there.
+     */
+    void TrimSolution();
+
+    //! The solution, read back through a small cache if it was trimmed
+    std::vector<unsigned char> GetSolution() const;
+
+    //! A copy that is safe against a concurrent TrimSolution(), with the solution in memory
+    CBlockIndex CopyWithSolution() const;
+
     CBlockHeader GetBlockHeader() const
     {
         CBlockHeader block;
@@ -400,7 +418,7 @@ public:
         block.nTime          = nTime;
         block.nBits          = nBits;
         block.nNonce         = nNonce;
-        block.nSolution      = nSolution;
+        block.nSolution      = GetSolution();
         return block;
     }
 
@@ -491,7 +509,7 @@ public:
         hashPrev = uint256();
     }
 
-    explicit CDiskBlockIndex(const CBlockIndex* pindex) : CBlockIndex(*pindex) {
+    explicit CDiskBlockIndex(const CBlockIndex* pindex) : CBlockIndex(pindex->CopyWithSolution()) {
         hashPrev = (pprev ? pprev->GetBlockHash() : uint256());
     }
 
@@ -5,6 +5,13 @@
 #include "dbwrapper.h"
 
 #include "util.h"
+#include "utilstrencodings.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <vector>
 
 #include <boost/filesystem.hpp>
 
@@ -14,14 +21,16 @@
 #include <memenv.h>
 #include <stdint.h>
 
-static leveldb::Options GetOptions(size_t nCacheSize, bool compression, int maxOpenFiles)
+static leveldb::Options GetOptions(size_t nCacheSize, const CDBOptions& dbOptions)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = compression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
-    options.max_open_files = maxOpenFiles;
+    options.block_cache = leveldb::NewLRUCache(nCacheSize * dbOptions.nCacheShare / 100);
+    options.write_buffer_size = nCacheSize * dbOptions.nWriteBufferShare / 100; // up to two write buffers may be held in memory simultaneously
+    options.block_size = dbOptions.nBlockSize;
+    if (dbOptions.nBloomBits > 0)
+        options.filter_policy = leveldb::NewBloomFilterPolicy(dbOptions.nBloomBits);
+    options.compression = dbOptions.fCompression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
+    options.max_open_files = dbOptions.nMaxOpenFiles;
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
         // on corruption in later versions.
@@ -30,14 +39,119 @@ static leveldb::Options GetOptions(size_t nCacheSize, bool compression, int maxO
     return options;
 }
 
-CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles)
+CDBOptions GetDBProfile(const std::string& strName)
+{
+    CDBOptions options;
+    options.strName = strName;
+    if (strName == "chainstate") {
+        // Validation looks up every input. The checksums are still verified
+        // by compactions (paranoid_checks) and by iterators.
+        options.fVerifyChecksums = false;
+    } else if (strName == "blockindex") {
+        // Index scans read runs of neighbouring keys
+        options.nBlockSize = 16 * 1024;
+        options.fCompression = true;
+        options.nMaxOpenFiles = 1000;
+    }
+    return options;
+}
+
+bool ParseDBOptions(CDBOptions& options, std::string& strError)
+{
+    for (const std::string& strArg : mapMultiArgs["-dboptions"]) {
+        // <name>:<option>=<value>
+        size_t nColon = strArg.find(':');
+        size_t nEquals = strArg.find('=', nColon);
+        if (nColon == std::string::npos || nEquals == std::string::npos) {
+            strError = strprintf("Invalid -dboptions setting '%s', expected <database>:<option>=<value>", strArg);
+            return false;
+        }
+        std::string strName = strArg.substr(0, nColon);
+        std::string strOption = strArg.substr(nColon + 1, nEquals - nColon - 1);
+        std::string strValue = strArg.substr(nEquals + 1);
+        if (strName != "blockindex" && strName != "chainstate" && strName != "notarisations") {
+            strError = strprintf("Unknown database '%s' in -dboptions", strName);
+            return false;
+        }
+        if (strName != options.strName)
+            continue;
+
+        int64_t nValue = atoi64(strValue);
+        if (strOption == "blocksize" && nValue >= 1024 && nValue <= (1 << 20))
+            options.nBlockSize = nValue;
+        else if (strOption == "cacheshare" && nValue >= 0 && nValue <= 100)
+            options.nCacheShare = nValue;
+        else if (strOption == "writebuffershare" && nValue >= 1 && nValue <= 50)
+            options.nWriteBufferShare = nValue;
+        else if (strOption == "compression" && (strValue == "0" || strValue == "1"))
+            options.fCompression = nValue;
+        else if (strOption == "bloombits" && nValue >= 0 && nValue <= 64)
+            options.nBloomBits = nValue;
+        else if (strOption == "checksums" && (strValue == "0" || strValue == "1"))
+            options.fVerifyChecksums = nValue;
+        else if (strOption == "iteratorchecksums" && (strValue == "0" || strValue == "1"))
+            options.fVerifyIteratorChecksums = nValue;
+        else if (strOption == "maxopenfiles" && nValue >= 16)
+            options.nMaxOpenFiles = nValue;
+        else {
+            strError = strprintf("Invalid -dboptions setting '%s'", strArg);
+            return false;
+        }
+    }
+    if (options.nCacheShare + 2 * options.nWriteBufferShare > 100) {
+        strError = strprintf("The block cache and write buffers of the %s database use more than its cache size", options.strName);
+        return false;
+    }
+    return true;
+}
+
+//! Protects vDBWrappers and mapDBWrapperUsers
+static std::mutex cs_dbwrappers;
+static std::condition_variable condDBWrapperUsers;
+//! The open databases, in the order they were opened
+static std::vector<CDBWrapper*> vDBWrappers;
+//! Number of ForEachDBWrapper calls using each database
+static std::map<const CDBWrapper*, int> mapDBWrapperUsers;
+
+static void ReleaseDBWrapper(const CDBWrapper* pdbw)
+{
+    std::lock_guard<std::mutex> lock(cs_dbwrappers);
+    if (--mapDBWrapperUsers[pdbw] == 0) {
+        mapDBWrapperUsers.erase(pdbw);
+        condDBWrapperUsers.notify_all();
+    }
+}
+
+void ForEachDBWrapper(const std::function<void (CDBWrapper&)>& func)
+{
+    std::vector<CDBWrapper*> vDBs;
+    {
+        std::lock_guard<std::mutex> lock(cs_dbwrappers);
+        vDBs = vDBWrappers;
+        for (CDBWrapper* pdbw : vDBs)
+            mapDBWrapperUsers[pdbw]++;
+    }
+    // func may take long, e.g. compacting, so the others can be opened and closed meanwhile
+    for (size_t i = 0; i < vDBs.size(); i++) {
+        try {
+            func(*vDBs[i]);
+        } catch (...) {
+            for (; i < vDBs.size(); i++)
+                ReleaseDBWrapper(vDBs[i]);
+            throw;
+        }
+        ReleaseDBWrapper(vDBs[i]);
+    }
+}
+
+CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, const CDBOptions& dbOptionsIn) : dbOptions(dbOptionsIn)
 {
     penv = NULL;
-    readoptions.verify_checksums = true;
-    iteroptions.verify_checksums = true;
+    readoptions.verify_checksums = dbOptions.fVerifyChecksums;
+    iteroptions.verify_checksums = dbOptions.fVerifyIteratorChecksums;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize, compression, maxOpenFiles);
+    options = GetOptions(nCacheSize, dbOptions);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -54,10 +168,26 @@ CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, b
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
     LogPrintf("Opened LevelDB successfully\n");
+    if (!dbOptions.strName.empty()) {
+        LogPrintf("* %s: block size %u, block cache %.1fMiB, write buffer %.1fMiB, bloom filter %d bits, compression %s, checksums %s\n",
+            dbOptions.strName, dbOptions.nBlockSize, nCacheSize * dbOptions.nCacheShare / 100 * (1.0 / 1024 / 1024),
+            options.write_buffer_size * (1.0 / 1024 / 1024), dbOptions.nBloomBits, dbOptions.fCompression ? "on" : "off",
+            dbOptions.fVerifyChecksums ? "on" : "iterators only");
+    }
+
+    if (!dbOptions.fScratch) {
+        std::lock_guard<std::mutex> lock(cs_dbwrappers);
+        vDBWrappers.push_back(this);
+    }
 }
 
 CDBWrapper::~CDBWrapper()
 {
+    {
+        std::unique_lock<std::mutex> lock(cs_dbwrappers);
+        vDBWrappers.erase(std::remove(vDBWrappers.begin(), vDBWrappers.end(), this), vDBWrappers.end());
+        condDBWrapperUsers.wait(lock, [this]() { return mapDBWrapperUsers.count(this) == 0; });
+    }
     delete pdb;
     pdb = NULL;
     delete options.filter_policy;
@@ -75,6 +205,25 @@ bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
     return true;
 }
 
+bool CDBWrapper::GetProperty(const std::string& strProperty, std::string& strValue) const
+{
+    return pdb->GetProperty(strProperty, &strValue);
+}
+
+uint64_t CDBWrapper::GetApproximateSize() const
+{
+    // Every key starts with a one byte prefix
+    leveldb::Range range(leveldb::Slice("\x00", 1), leveldb::Slice("\xff\xff", 2));
+    uint64_t nSize = 0;
+    pdb->GetApproximateSizes(&range, 1, &nSize);
+    return nSize;
+}
+
+void CDBWrapper::Compact()
+{
+    pdb->CompactRange(NULL, NULL);
+}
+
 bool CDBWrapper::IsEmpty()
 {
     boost::scoped_ptr<CDBIterator> it(NewIterator());
@@ -11,6 +11,8 @@
 #include "util.h"
 #include "version.h"
 
+#include <functional>
+
 #include <boost/filesystem/path.hpp>
 
 #include <leveldb/db.h>
@@ -27,6 +29,50 @@ public:
 
 class CDBWrapper;
 
+/**
+ * LevelDB tuning of one database. The databases are read very differently:
+ * the chain state by random point lookups during validation, the block index
+ * by the address, spent and timestamp index range scans of the RPCs.
+ */
+struct CDBOptions
+{
+    //! Profile name, see GetDBProfile
+    std::string strName;
+    //! Approximate size of the user data packed per block, in bytes
+    size_t nBlockSize;
+    //! Percentage of the cache size used for the block cache
+    int nCacheShare;
+    //! Percentage of the cache size used for each of the (up to two) write
+    //! buffers. Larger buffers write fewer level 0 files, and so trigger
+    //! fewer compactions, this LevelDB has no other compaction setting.
+    int nWriteBufferShare;
+    bool fCompression;
+    //! Bits per key of the bloom filter, 0 disables it
+    int nBloomBits;
+    //! Verify the checksums of the blocks read by lookups
+    bool fVerifyChecksums;
+    //! Verify the checksums of the blocks read by iterators
+    bool fVerifyIteratorChecksums;
+    int nMaxOpenFiles;
+    //! Throwaway database, e.g. of a benchmark, left out of ForEachDBWrapper
+    bool fScratch;
+
+    CDBOptions() : nBlockSize(4096), nCacheShare(50), nWriteBufferShare(25), fCompression(false),
+        nBloomBits(10), fVerifyChecksums(true), fVerifyIteratorChecksums(true), nMaxOpenFiles(64), fScratch(false) {}
+};
+
+/** Default options of the "blockindex", "chainstate" and "notarisations" databases */
+CDBOptions GetDBProfile(const std::string& strName);
+
+/** Apply the -dboptions=<name>:<option>=<value> settings of this database, false with strError on a bad setting */
+bool ParseDBOptions(CDBOptions& options, std::string& strError);
+
+/**
+ * Call func on every open database but the scratch ones, without holding the
+ * list of them locked. A database closed meanwhile waits until func is done with it.
+ */
+void ForEachDBWrapper(const std::function<void (CDBWrapper&)>& func);
+
 /** These should be considered an implementation detail of the specific database.
  */
 namespace dbwrapper_private {
@@ -52,6 +98,11 @@ public:
      */
     CDBBatch(const CDBWrapper &_parent) : parent(_parent) { };
 
+    void Clear()
+    {
+        batch.Clear();
+    }
+
     template <typename K, typename V>
     void Write(const K& key, const V& value)
     {
@@ -163,6 +214,9 @@ private:
     //! database options used
     leveldb::Options options;
 
+    //! the tuning the options were built from
+    CDBOptions dbOptions;
+
     //! options used when reading from the database
     leveldb::ReadOptions readoptions;
 
@@ -184,10 +238,22 @@ public:
      * @param[in] nCacheSize  Configures various leveldb cache settings.
      * @param[in] fMemory     If true, use leveldb's memory environment.
      * @param[in] fWipe       If true, remove all existing data.
+     * @param[in] dbOptionsIn LevelDB tuning of this database.
      */
-    CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool compression = false, int maxOpenFiles = 64);
+    CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, const CDBOptions& dbOptionsIn = CDBOptions());
     ~CDBWrapper();
 
+    const CDBOptions& GetDBOptions() const { return dbOptions; }
+
+    /** Read a LevelDB property such as "leveldb.stats", false if unknown */
+    bool GetProperty(const std::string& strProperty, std::string& strValue) const;
+
+    /** Approximate size of the database on disk, in bytes */
+    uint64_t GetApproximateSize() const;
+
+    /** Compact the whole database, this may take a long time */
+    void Compact();
+
     template <typename K, typename V>
     bool Read(const K& key, V& value) const
     {
@@ -0,0 +1,123 @@
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_EVALINDEX_H
+#define BITCOIN_EVALINDEX_H
+
+#include "serialize.h"
+#include "uint256.h"
+
+/**
+ * CC transaction, keyed by the evalcode and funcid of its opreturn and the
+ * txid following them, which by convention references the creation tx of the
+ * module instance (null for creation txs). Module data carried in a token
+ * opreturn is indexed under its own evalcode as well. Height and position in
+ * the block are stored big-endian so that a scan returns a range in chain
+ * order.
+ */
+struct CEvalIndexKey {
+    uint8_t evalcode;
+    uint8_t funcid;
+    uint256 reftxid;
+    int blockHeight;
+    unsigned int txindex;
+    uint256 txhash;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 74;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, evalcode);
+        ser_writedata8(s, funcid);
+        reftxid.Serialize(s);
+        // Heights are stored big-endian for key sorting in LevelDB
+        ser_writedata32be(s, blockHeight);
+        ser_writedata32be(s, txindex);
+        txhash.Serialize(s);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        evalcode = ser_readdata8(s);
+        funcid = ser_readdata8(s);
+        reftxid.Unserialize(s);
+        blockHeight = ser_readdata32be(s);
+        txindex = ser_readdata32be(s);
+        txhash.Unserialize(s);
+    }
+
+    CEvalIndexKey(uint8_t evalcodeIn, uint8_t funcidIn, uint256 reftxidIn, int height, unsigned int blockindex, uint256 txid) {
+        evalcode = evalcodeIn;
+        funcid = funcidIn;
+        reftxid = reftxidIn;
+        blockHeight = height;
+        txindex = blockindex;
+        txhash = txid;
+    }
+
+    CEvalIndexKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        evalcode = 0;
+        funcid = 0;
+        reftxid.SetNull();
+        blockHeight = 0;
+        txindex = 0;
+        txhash.SetNull();
+    }
+};
+
+/** Seek prefix: the evalcode, then the funcid if not 0, then the reftxid if not null */
+struct CEvalIndexIteratorKey {
+    uint8_t evalcode;
+    uint8_t funcid;
+    uint256 reftxid;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        if (funcid == 0)
+            return 1;
+        return reftxid.IsNull() ? 2 : 34;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, evalcode);
+        if (funcid != 0) {
+            ser_writedata8(s, funcid);
+            if (!reftxid.IsNull())
+                reftxid.Serialize(s);
+        }
+    }
+
+    CEvalIndexIteratorKey(uint8_t evalcodeIn, uint8_t funcidIn, uint256 reftxidIn) {
+        evalcode = evalcodeIn;
+        funcid = funcidIn;
+        reftxid = reftxidIn;
+    }
+
+    CEvalIndexIteratorKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        evalcode = 0;
+        funcid = 0;
+        reftxid.SetNull();
+    }
+};
+
+struct CEvalIndexKeyCompare
+{
+    bool operator()(const CEvalIndexKey& a, const CEvalIndexKey& b) const {
+        if (a.evalcode != b.evalcode)
+            return a.evalcode < b.evalcode;
+        if (a.funcid != b.funcid)
+            return a.funcid < b.funcid;
+        if (a.reftxid != b.reftxid)
+            return a.reftxid < b.reftxid;
+        return a.txhash < b.txhash;
+    }
+};
+
+#endif // BITCOIN_EVALINDEX_H
@@ -1075,9 +1075,9 @@ TEST(CheckTransaction, HeartwoodAcceptsShieldedCoinbase) {
         libzcash::SaplingSpendingKey::random().default_address(), CAmount(123456), libzcash::Zip212Enabled::BeforeZip212);
     auto output = OutputDescriptionInfo(ovk, note, {{0xF6}});
 
-    auto ctx = librustzcash_sapling_proving_ctx_init();
+    auto ctx = librustzcash_sapling_partial_proving_ctx_init();
     auto odesc = output.Build(ctx).get();
-    librustzcash_sapling_proving_ctx_free(ctx);
+    librustzcash_sapling_partial_proving_ctx_free(ctx);
 
     CMutableTransaction mtx = GetValidTransaction();
     mtx.fOverwintered = true;
@@ -1181,9 +1181,9 @@ TEST(CheckTransaction, HeartwoodEnforcesSaplingRulesOnShieldedCoinbase) {
     }
 
     // Add a Sapling output.
-    auto ctx = librustzcash_sapling_proving_ctx_init();
+    auto ctx = librustzcash_sapling_partial_proving_ctx_init();
     auto odesc = output.Build(ctx).get();
-    librustzcash_sapling_proving_ctx_free(ctx);
+    librustzcash_sapling_partial_proving_ctx_free(ctx);
     mtx.vShieldedOutput.push_back(odesc);
 
     // Coinbase transaction should fail non-contextual checks with valueBalance
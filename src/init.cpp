@@ -36,6 +36,7 @@
 #include "notarisationdb.h"
 #include "params.h"
 #include "komodo_notary.h"
+#include "komodo_kv.h"
 
 #ifdef ENABLE_MINING
 #include "key_io.h"
@@ -50,6 +51,7 @@
 #include "scheduler.h"
 #include "txdb.h"
 #include "torcontrol.h"
+#include "transaction_builder.h"
 #include "ui_interface.h"
 #include "util.h"
 #include "utilmoneystr.h"
@@ -84,6 +86,7 @@
 
 #if ENABLE_ZMQ
 #include "zmq/zmqnotificationinterface.h"
+#include "zmq/zmqpublishnotifier.h"
 #endif
 
 #if ENABLE_PROTON
@@ -91,6 +94,7 @@
 #endif
 
 #include "librustzcash.h"
+#include "rust/metrics.h"
 
 using namespace std;
 
@@ -229,6 +233,11 @@ void Shutdown()
     RenameThread(shutoffstr);
     mempool.AddTransactionsUpdated(1);
 
+    // The scheduler thread is gone, drop the notifications it did not deliver
+    // and release whoever waits for them. The wallet catches up on the next
+    // start from its best block locator.
+    UnregisterBackgroundSignalScheduler();
+
     StopHTTPRPC();
     StopREST();
     StopRPC();
@@ -390,17 +399,22 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-datadir=<dir>", _("Specify data directory"));
     strUsage += HelpMessageOpt("-exportdir=<dir>", _("Specify directory to be used when exporting data"));
     strUsage += HelpMessageOpt("-dbcache=<n>", strprintf(_("Set database cache size in megabytes (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultDbCache));
+    strUsage += HelpMessageOpt("-dboptions=<db>:<option>=<value>", _("Tune the LevelDB options of the blockindex, chainstate or notarisations database: "
+        "blocksize, cacheshare and writebuffershare (percent of its cache), compression, bloombits, checksums, iteratorchecksums, maxopenfiles (can be specified multiple times)"));
     strUsage += HelpMessageOpt("-loadblock=<file>", _("Imports blocks from external blk000??.dat file") + " " + _("on startup"));
     strUsage += HelpMessageOpt("-maxorphantx=<n>", strprintf(_("Keep at most <n> unconnectable transactions in memory (default: %u)"), DEFAULT_MAX_ORPHAN_TRANSACTIONS));
     strUsage += HelpMessageOpt("-mempooltxinputlimit=<n>", _("[DEPRECATED FROM OVERWINTER] Set the maximum number of transparent inputs in a transaction that the mempool will accept (default: 0 = no limit applied)"));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -(int)boost::thread::hardware_concurrency(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-prefetchblocks=<n>", strprintf(_("Read up to <n> blocks ahead when connecting blocks already on disk, as during reindex and initial download (0 = disabled, default: %d)"), DEFAULT_PREFETCH_BLOCKS));
+    strUsage += HelpMessageOpt("-prefetchmem=<n>", strprintf(_("Keep at most <n> megabytes of blocks read ahead in memory (default: %d)"), DEFAULT_PREFETCH_MEMORY));
 #ifndef _WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), "komodod.pid"));
 #endif
-    // strUsage += HelpMessageOpt("-prune=<n>", strprintf(_("Reduce storage requirements by pruning (deleting) old blocks. This mode disables wallet support and is incompatible with -txindex. "
-    //         "Warning: Reverting this setting requires re-downloading the entire blockchain. "
-    //         "(default: 0 = disable pruning blocks, >%u = target size in MiB to use for block files)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
+    strUsage += HelpMessageOpt("-prune=<n>", strprintf(_("Reduce storage requirements by pruning (deleting) old blocks, keeping those above the last notarised height. "
+            "This mode disables wallet support and is incompatible with -addressindex, -spentindex, -timestampindex and with chains whose consensus rules look up old transactions (CC, staking and the KMD chain). "
+            "Warning: Reverting this setting requires re-downloading the entire blockchain. "
+            "(default: 0 = disable pruning blocks, >%u = target size in MiB to use for block files)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
     strUsage += HelpMessageOpt("-bootstrap", _("Download and install bootstrap on startup (1 to show GUI prompt, 2 to force download when using CLI)"));
     strUsage += HelpMessageOpt("-reindex", _("Rebuild block chain index from current blk000??.dat files on startup"));
 #if !defined(WIN32)
@@ -410,6 +424,10 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
     strUsage += HelpMessageOpt("-timestampindex", strprintf(_("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)"), DEFAULT_TIMESTAMPINDEX));
     strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain a full spent index, used to query the spending txid and input index for an outpoint (default: %u)"), DEFAULT_SPENTINDEX));
+    strUsage += HelpMessageOpt("-oraclesindex", strprintf(_("Maintain an index of oracles data samples per oracle and publisher, used by oraclessamples (default: %u)"), DEFAULT_ORACLESINDEX));
+    strUsage += HelpMessageOpt("-tokenindex", strprintf(_("Maintain an index of unspent token outputs by tokenid and address, used for token balances and token input selection (default: %u)"), DEFAULT_TOKENINDEX));
+    strUsage += HelpMessageOpt("-ccindex", strprintf(_("Maintain an index of CC transactions by evalcode, funcid and reference txid, used by the CC modules to find their transactions (default: %u)"), DEFAULT_CCINDEX));
+    strUsage += HelpMessageOpt("-txcache=<n>", strprintf(_("Keep up to <n> megabytes of recently looked up confirmed transactions in memory (0 = disable, default: %u)"), DEFAULT_TXCACHE_SIZE));
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open"));
     strUsage += HelpMessageOpt("-asmap=<file>", strprintf("Specify asn mapping used for bucketing of the peers (default: %s). Relative paths will be prefixed by the net-specific datadir location.", DEFAULT_ASMAP_FILENAME));
@@ -463,6 +481,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-sweep", _("Enable auto Sapling note sweep, automatically move all funds to a sigle address periodocally."));
     strUsage += HelpMessageOpt("-sweepsaplingaddress=<zaddr>", _("Specify Sapling Address to Sweep funds to. (default: all)"));
     strUsage += HelpMessageOpt("-sweeptxfee", strprintf(_("Fee amount in Satoshis used send sweep transactions. (default %i)"), DEFAULT_SWEEP_FEE));
+    strUsage += HelpMessageOpt("-saplingbuildthreads=<n>", strprintf(_("Number of threads building consolidation and sweep transactions, those beyond the number of transactions prove the spends and outputs of each one in parallel, 0 = one per core (default: %d)"), DEFAULT_SAPLING_BUILD_THREADS));
     strUsage += HelpMessageOpt("-deletetx", _("Enable Old Transaction Deletion"));
     strUsage += HelpMessageOpt("-deleteinterval", strprintf(_("Delete transaction every <n> blocks during inital block download (default: %i)"), DEFAULT_TX_DELETE_INTERVAL));
     strUsage += HelpMessageOpt("-keeptxnum", strprintf(_("Keep the last <n> transactions (default: %i)"), DEFAULT_TX_RETENTION_LASTTX));
@@ -496,6 +515,8 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-zmqpubhashtx=<address>", _("Enable publish hash transaction in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawblock=<address>", _("Enable publish raw block in <address>"));
     strUsage += HelpMessageOpt("-zmqpubrawtx=<address>", _("Enable publish raw transaction in <address>"));
+    strUsage += HelpMessageOpt("-zmqpubsequence=<address>", _("Enable publish hash of block connected or disconnected in <address>"));
+    strUsage += HelpMessageOpt("-zmqqueuesize=<n>", strprintf(_("Drop notifications when more than <n> are waiting to be published (default: %u)"), DEFAULT_ZMQ_QUEUE_SIZE));
 #endif
 
 #if ENABLE_PROTON
@@ -592,6 +613,11 @@ std::string HelpMessage(HelpMessageMode mode)
     // Disabled until we can lock notes and also tune performance of libsnark which by default uses multiple threads
     //strUsage += HelpMessageOpt("-rpcasyncthreads=<n>", strprintf(_("Set the number of threads to service Async RPC calls (default: %d)"), 1));
 
+    strUsage += HelpMessageGroup(_("Monitoring Options:"));
+    strUsage += HelpMessageOpt("-prometheusport=<port>", _("Expose node metrics in the Prometheus exposition format. An HTTP listener will be started on <port>, which responds to GET requests on any request path. Use -metricsallowip and -metricsbind to control access."));
+    strUsage += HelpMessageOpt("-metricsallowip=<ip>", _("Allow metrics connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4/32) or a network/CIDR (e.g. 1.2.3.4/24). Localhost is always allowed. This option can be specified multiple times."));
+    strUsage += HelpMessageOpt("-metricsbind=<addr>", _("Bind to given IP address to listen for metrics connections. This option is ignored unless -metricsallowip is also passed. (default: bind to all interfaces)"));
+
     if (mode == HMM_BITCOIND) {
         strUsage += HelpMessageGroup(_("Metrics Options (only if -daemon and -printtoconsole are not set):"));
         strUsage += HelpMessageOpt("-showmetrics", _("Show metrics on stdout (default: 1 if running in a console, 0 otherwise)"));
@@ -632,6 +658,11 @@ std::string HelpMessage(HelpMessageMode mode)
     return strUsage;
 }
 
+static void RecordLockContention(const char* pszName, int64_t nWaitMicros)
+{
+    MetricsHistogram("eskenas.lock.wait.seconds", nWaitMicros * 0.000001, "lock", pszName);
+}
+
 static void BlockNotifyCallback(bool initialSync, const CBlockIndex *pBlockIndex)
 {
     if (initialSync || !pBlockIndex)
@@ -1124,20 +1155,27 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
         nMaxConnections=0;
     }        
     fprintf(stderr,"nMaxConnections %d\n",nMaxConnections);
-    // if using block pruning, then disable txindex
-    // also disable the wallet (for now, until SPV support is implemented in wallet)
-//     if (GetArg("-prune", 0)) {
-//         if (GetBoolArg("-txindex", true))
-//             return InitError(_("Prune mode is incompatible with -txindex."));
-// #ifdef ENABLE_WALLET
-//         if (!GetBoolArg("-disablewallet", false)) {
-//             if (SoftSetBoolArg("-disablewallet", true))
-//                 LogPrintf("%s : parameter interaction: -prune -> setting -disablewallet=1\n", __func__);
-//             else
-//                 return InitError(_("Can't run with a wallet in prune mode."));
-//         }
-// #endif
-//     }
+    // if using block pruning, refuse the indexes and chains that need the old blocks,
+    // and disable the wallet (for now, until SPV support is implemented in wallet).
+    // The transaction index is kept, lookups of pruned transactions fail.
+    if (GetArg("-prune", 0)) {
+        if (GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) || GetBoolArg("-spentindex", DEFAULT_SPENTINDEX) ||
+            GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX))
+            return InitError(_("Prune mode is incompatible with -addressindex, -spentindex and -timestampindex."));
+        // CC validation and the daily snapshot read the transactions spent by a block, staking
+        // reads the staked transaction and the KMD chain the notary proof input, all through
+        // the transaction index, so they need every block.
+        if (ASSETCHAINS_CC != 0 || ASSETCHAINS_STAKED != 0 || ASSETCHAINS_SYMBOL[0] == 0)
+            return InitError(_("Prune mode is not supported on CC, staking and KMD chains."));
+#ifdef ENABLE_WALLET
+        if (!GetBoolArg("-disablewallet", false)) {
+            if (SoftSetBoolArg("-disablewallet", true))
+                LogPrintf("%s : parameter interaction: -prune -> setting -disablewallet=1\n", __func__);
+            else
+                return InitError(_("Can't run with a wallet in prune mode."));
+        }
+#endif
+    }
 
     // ********************************************************* Step 3: parameter-to-internal-flags
 
@@ -1186,21 +1224,24 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
 
+    nPrefetchBlocks = std::max(0, (int)GetArg("-prefetchblocks", DEFAULT_PREFETCH_BLOCKS));
+    SetBlockPrefetchMemory(std::max((int64_t)1, GetArg("-prefetchmem", DEFAULT_PREFETCH_MEMORY)) << 20);
+
     fServer = GetBoolArg("-server", false);
 
     // block pruning; get the amount of disk space (in MB) to allot for block & undo files
-    // int64_t nSignedPruneTarget = GetArg("-prune", 0) * 1024 * 1024;
-    // if (nSignedPruneTarget < 0) {
-    //     return InitError(_("Prune cannot be configured with a negative value."));
-    // }
-    // nPruneTarget = (uint64_t) nSignedPruneTarget;
-    // if (nPruneTarget) {
-    //     if (nPruneTarget < MIN_DISK_SPACE_FOR_BLOCK_FILES) {
-    //         return InitError(strprintf(_("Prune configured below the minimum of %d MB.  Please use a higher number."), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
-    //     }
-    //     LogPrintf("Prune configured to target %uMiB on disk for block and undo files.\n", nPruneTarget / 1024 / 1024);
-    //     fPruneMode = true;
-    // }
+    int64_t nSignedPruneTarget = GetArg("-prune", 0) * 1024 * 1024;
+    if (nSignedPruneTarget < 0) {
+        return InitError(_("Prune cannot be configured with a negative value."));
+    }
+    nPruneTarget = (uint64_t) nSignedPruneTarget;
+    if (nPruneTarget) {
+        if (nPruneTarget < MIN_DISK_SPACE_FOR_BLOCK_FILES) {
+            return InitError(strprintf(_("Prune configured below the minimum of %d MB.  Please use a higher number."), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
+        }
+        LogPrintf("Prune configured to target %uMiB on disk for block and undo files.\n", nPruneTarget / 1024 / 1024);
+        fPruneMode = true;
+    }
 
     RegisterAllCoreRPCCommands(tableRPC);
 #ifdef ENABLE_WALLET
@@ -1425,15 +1466,56 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+        for (int i=0; i<nScriptCheckThreads-1; i++)
+            threadGroup.create_thread(&ThreadHeaderCheck);
+    }
+
+    if (nPrefetchBlocks > 0) {
+        LogPrintf("Reading up to %d blocks ahead using %d threads\n", nPrefetchBlocks, PREFETCH_THREADS);
+        for (int i = 0; i < PREFETCH_THREADS; i++)
+            threadGroup.create_thread(&ThreadBlockPrefetch);
     }
 
     // Start the lightweight task scheduler thread
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
 
+    // Deliver the wallet and notification callbacks off the block connection path
+    RegisterBackgroundSignalScheduler(scheduler);
+
     // Count uptime
     MarkStartTime();
 
+    // Start the Prometheus exporter, if requested
+    if (mapArgs.count("-prometheusport")) {
+        int prometheusPort = GetArg("-prometheusport", 0);
+        if (prometheusPort < 1 || prometheusPort > 65535) {
+            return InitError(strprintf(_("Invalid port \'%s\' specified in -prometheusport"), mapArgs["-prometheusport"]));
+        }
+
+        // Convert the allow list into something the Rust side can read
+        std::vector<std::string> vAllowIps;
+        if (mapMultiArgs.count("-metricsallowip")) {
+            vAllowIps = mapMultiArgs["-metricsallowip"];
+        }
+        std::vector<const char*> vAllowIpPtrs;
+        for (const std::string& strAllowIp : vAllowIps) {
+            vAllowIpPtrs.push_back(strAllowIp.c_str());
+        }
+
+        // Only pass the bind address through if -metricsallowip is also set
+        const char* pszBind = nullptr;
+        if (!vAllowIps.empty() && mapArgs.count("-metricsbind")) {
+            pszBind = mapArgs["-metricsbind"].c_str();
+        }
+
+        if (!metrics_run(pszBind, vAllowIpPtrs.data(), vAllowIpPtrs.size(), prometheusPort)) {
+            return InitError(_("Failed to start Prometheus metrics exporter"));
+        }
+        SetLockContentionHook(RecordLockContention);
+        LogPrintf("Prometheus metrics exporter listening on port %d\n", prometheusPort);
+    }
+
     if ((chainparams.NetworkIDString() != "regtest") &&
             GetBoolArg("-showmetrics", 0) &&
             !fPrintToConsole && !GetBoolArg("-daemon", false)) {
@@ -1752,6 +1834,18 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("* Using %d max open files\n", dbMaxOpenFiles);
     LogPrintf("* Compression is %s\n", dbCompression ? "enabled" : "disabled");
 
+    CDBOptions blockTreeDBOptions = GetDBProfile("blockindex");
+    blockTreeDBOptions.nMaxOpenFiles = dbMaxOpenFiles;
+    blockTreeDBOptions.fCompression = dbCompression;
+    CDBOptions coinsDBOptions = GetDBProfile("chainstate");
+    CDBOptions notarisationsDBOptions = GetDBProfile("notarisations");
+    {
+        std::string strError;
+        if (!ParseDBOptions(blockTreeDBOptions, strError) || !ParseDBOptions(coinsDBOptions, strError) ||
+            !ParseDBOptions(notarisationsDBOptions, strError))
+            return InitError(strError);
+    }
+
     // cache size calculations
     int64_t nTotalCache = (GetArg("-dbcache", nDefaultDbCache) << 20);
     nTotalCache = std::max(nTotalCache, nMinDbCache << 20); // total cache cannot be less than nMinDbCache
@@ -1775,11 +1869,14 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set\n", nCoinCacheUsage * (1.0 / 1024 / 1024));
+    int64_t nTxCacheSize = std::max((int64_t)0, GetArg("-txcache", DEFAULT_TXCACHE_SIZE) << 20);
+    txCache.SetMaxUsage(nTxCacheSize);
+    LogPrintf("* Using %.1fMiB for confirmed transaction cache\n", nTxCacheSize * (1.0 / 1024 / 1024));
 
     if ( fReindex == 0 )
     {
-        bool checkval,fAddressIndex,fSpentIndex;
-        pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex, dbCompression, dbMaxOpenFiles);
+        bool checkval,fAddressIndex,fSpentIndex,fTokenIndex,fOraclesIndex,fCCIndex;
+        pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex, blockTreeDBOptions);
         fAddressIndex = GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
         pblocktree->ReadFlag("addressindex", checkval);
         if ( checkval != fAddressIndex && fAddressIndex != 0 )
@@ -1796,6 +1893,30 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
             fprintf(stderr,"set spentindex, will reindex. could take a while.\n");
             fReindex = true;
         }
+        fTokenIndex = GetBoolArg("-tokenindex", DEFAULT_TOKENINDEX);
+        pblocktree->ReadFlag("tokenindex", checkval);
+        if ( checkval != fTokenIndex && fTokenIndex != 0 )
+        {
+            pblocktree->WriteFlag("tokenindex", fTokenIndex);
+            fprintf(stderr,"set tokenindex, will reindex. could take a while.\n");
+            fReindex = true;
+        }
+        fOraclesIndex = GetBoolArg("-oraclesindex", DEFAULT_ORACLESINDEX);
+        pblocktree->ReadFlag("oraclesindex", checkval);
+        if ( checkval != fOraclesIndex && fOraclesIndex != 0 )
+        {
+            pblocktree->WriteFlag("oraclesindex", fOraclesIndex);
+            fprintf(stderr,"set oraclesindex, will reindex. could take a while.\n");
+            fReindex = true;
+        }
+        fCCIndex = GetBoolArg("-ccindex", DEFAULT_CCINDEX);
+        pblocktree->ReadFlag("ccindex", checkval);
+        if ( checkval != fCCIndex && fCCIndex != 0 )
+        {
+            pblocktree->WriteFlag("ccindex", fCCIndex);
+            fprintf(stderr,"set ccindex, will reindex. could take a while.\n");
+            fReindex = true;
+        }
         //One time reindex to enable transaction archiving.
         pblocktree->ReadFlag("archiverule", checkval);
         if (checkval != fArchive)
@@ -1825,11 +1946,11 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                 delete pblocktree;
                 delete pnotarisations;
 
-                pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex, dbCompression, dbMaxOpenFiles);
-                pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex);
+                pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReindex, blockTreeDBOptions);
+                pcoinsdbview = new CCoinsViewDB(nCoinDBCache, false, fReindex, coinsDBOptions);
                 pcoinscatcher = new CCoinsViewErrorCatcher(pcoinsdbview);
                 pcoinsTip = new CCoinsViewCache(pcoinscatcher);
-                pnotarisations = new NotarisationDB(100*1024*1024, false, fReindex);
+                pnotarisations = new NotarisationDB(100*1024*1024, false, fReindex, notarisationsDBOptions);
 
 
                 if (fReindex) {
@@ -1850,6 +1971,7 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
                 // (we're likely using a testnet datadir, or the other way around).
                 if (!mapBlockIndex.empty() && mapBlockIndex.count(chainparams.GetConsensus().hashGenesisBlock) == 0)
                     return InitError(_("Incorrect or no genesis block found. Wrong datadir for network?"));
+                komodo_kvinit();
                 komodo_init(1);
                 // Initialize the block index (no-op if non-empty database was already loaded)
                 if (!InitBlockIndex()) {
@@ -2464,8 +2586,12 @@ bool AppInit2(boost::thread_group& threadGroup, CScheduler& scheduler)
     // if pruning, unset the service bit and perform the initial blockstore prune
     // after any wallet rescanning has taken place.
     if (fPruneMode) {
-        LogPrintf("Unsetting NODE_NETWORK on prune mode\n");
+        LogPrintf("Unsetting NODE_NETWORK on prune mode, setting NODE_NETWORK_LIMITED\n");
         nLocalServices &= ~NODE_NETWORK;
+        nLocalServices |= NODE_NETWORK_LIMITED;
+        uint256 notarized_hash,notarized_desttxid; int32_t prevMoMheight;
+        if (komodo_notarized_height(&prevMoMheight,&notarized_hash,&notarized_desttxid) <= (int32_t)NOTARISED_BLOCKS_TO_KEEP)
+            LogPrintf("Prune: the chain is not notarised yet, no blocks are pruned until it is. A chain that is never notarised is never pruned.\n");
         if (!fReindex) {
             uiInterface.InitMessage(_("Pruning blockstore..."));
             PruneAndFlush();
@@ -204,7 +204,6 @@ void komodo_stateupdate(int32_t height,uint8_t notarypubs[][33],uint8_t numnotar
 
     if ( didinit == 0 )
     {
-        portable_mutex_init(&KOMODO_KV_mutex);
         portable_mutex_init(&KOMODO_CC_mutex);
         didinit = 1;
     }
@@ -404,8 +403,7 @@ int32_t komodo_voutupdate(bool fJustCheck,int32_t *isratificationp,int32_t notar
         {
             if ( scriptbuf[len] == 'K' )
             {
-                //fprintf(stderr,"i.%d j.%d KV OPRET len.%d %.8f\n",i,j,opretlen,dstr(value));
-                komodo_stateupdate(height,0,0,0,txhash,0,0,0,0,0,0,value,&scriptbuf[len],opretlen,j,zero,0);
+                // applied by komodo_connectblock, see komodo_kvoprets
                 return(-1);
             }
             if ( strcmp(ASSETCHAINS_SYMBOL,(char *)&scriptbuf[len+32*2+4]) == 0 )
@@ -596,6 +594,47 @@ int32_t komodo_notarycmp(uint8_t *scriptPubKey,int32_t scriptlen,uint8_t pubkeys
     return(-1);
 }
 
+void komodo_kvoprets(const CBlock &block,std::vector<std::pair<int32_t,int32_t> > &kvoprets)
+{
+    int32_t i,j,len;
+    if ( ASSETCHAINS_SYMBOL[0] == 0 )
+        return;
+    for (i=0; i<block.vtx.size(); i++)
+    {
+        for (j=0; j<block.vtx[i].vout.size(); j++)
+        {
+            const CScript &scriptPubKey = block.vtx[i].vout[j].scriptPubKey;
+            // same framing as komodo_voutupdate
+            if ( (len= scriptPubKey.size()) < sizeof(uint32_t) || len > 10001 || scriptPubKey[0] != 0x6a )
+                continue;
+            len = (scriptPubKey[1] == 0x4c) ? 3 : (scriptPubKey[1] == 0x4d ? 4 : 2);
+            if ( len < scriptPubKey.size() && scriptPubKey[len] == 'K' )
+                kvoprets.push_back(std::make_pair(i,j));
+        }
+    }
+}
+
+static void komodo_connectkv(int32_t height,const CBlock &block)
+{
+    static uint256 zero; uint8_t scriptbuf[10001]; int32_t len,opretlen,offset; std::vector<std::pair<int32_t,int32_t> > kvoprets;
+    komodo_kvoprets(block,kvoprets);
+    for (std::vector<std::pair<int32_t,int32_t> >::const_iterator it=kvoprets.begin(); it!=kvoprets.end(); it++)
+    {
+        const CTxOut &vout = block.vtx[it->first].vout[it->second];
+        len = vout.scriptPubKey.size();
+        memcpy(scriptbuf,(uint8_t *)&vout.scriptPubKey[0],len);
+        offset = 1;
+        if ( (opretlen= scriptbuf[offset++]) == 0x4c )
+            opretlen = scriptbuf[offset++];
+        else if ( opretlen == 0x4d )
+        {
+            opretlen = scriptbuf[offset++];
+            opretlen += (scriptbuf[offset++] << 8);
+        }
+        komodo_stateupdate(height,0,0,0,block.vtx[it->first].GetHash(),0,0,0,0,0,0,(uint64_t)vout.nValue,&scriptbuf[offset],opretlen,it->second,zero,0);
+    }
+}
+
 // int32_t (!!!)
 /*
     read blackjok3rtt comments in main.cpp 
@@ -658,6 +697,9 @@ int32_t komodo_connectblock(bool fJustCheck, CBlockIndex *pindex,CBlock& block)
     if ( pindex != 0 )
     {
         height = pindex->GetHeight();
+        // kv updates of every tx, once per block as the kv store keeps undo data, the notary pay break below only concerns notarisations
+        if ( !fJustCheck && !((is_STAKED(ASSETCHAINS_SYMBOL) != 0 && staked_era == 0) || is_STAKED(ASSETCHAINS_SYMBOL) == 255) )
+            komodo_connectkv(height,block);
         txn_count = block.vtx.size();
         for (i=0; i<txn_count; i++)
         {
@@ -32,6 +32,7 @@
 
 int32_t gettxout_scriptPubKey(uint8_t *scriptPubkey,int32_t maxsize,uint256 txid,int32_t n);
 void komodo_event_rewind(struct komodo_state *sp,char *symbol,int32_t height);
+
 int32_t komodo_connectblock(bool fJustCheck, CBlockIndex *pindex,CBlock& block);
 bool check_pprevnotarizedht();
 
@@ -83,4 +84,7 @@ int32_t komodo_notarycmp(uint8_t *scriptPubKey,int32_t scriptlen,uint8_t pubkeys
 /*
     read blackjok3rtt comments in main.cpp 
 */
+/** (tx index, vout index) of every KV opreturn in the block, in block order */
+void komodo_kvoprets(const CBlock &block,std::vector<std::pair<int32_t,int32_t> > &kvoprets);
+
 int32_t komodo_connectblock(bool fJustCheck, CBlockIndex *pindex,CBlock& block);
@@ -86,9 +86,7 @@ extern uint64_t ASSETCHAINS_CBOPRET;
 
 extern std::mutex komodo_mutex;
 extern std::vector<uint8_t> Mineropret;
-extern pthread_mutex_t KOMODO_KV_mutex;
 extern pthread_mutex_t KOMODO_CC_mutex;
-extern komodo_kv *KOMODO_KV;
 extern pax_transaction *PAX;
 extern knotaries_entry *Pubkeys;
 extern komodo_state KOMODO_STATES[34];
@@ -17,6 +17,11 @@
 #include "komodo_utils.h" // komodo_stateptrget
 #include "komodo_bitcoind.h" // komodo_checkcommission
 
+#include <algorithm>
+
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
 struct komodo_extremeprice
 {
     uint256 blockhash;
@@ -28,12 +33,32 @@ struct komodo_extremeprice
 uint32_t PriceCache[KOMODO_LOCALPRICE_CACHESIZE][KOMODO_MAXPRICES];//4+sizeof(Cryptos)/sizeof(*Cryptos)+sizeof(Forex)/sizeof(*Forex)];
 int64_t PriceMult[KOMODO_MAXPRICES];
 
+#define KOMODO_PRICES_MAPROWS 4096
+
+// the prices files are memory mapped, rawprices has a row of all the feeds per height and each feed
+// file a row of PRICES_MAXDATAPOINTS values per height
 struct komodo_priceinfo
 {
-    FILE *fp;
+    boost::interprocess::file_mapping *mapping;
+    boost::interprocess::mapped_region *region;
+    uint8_t *data;
+    size_t mapsize;
+    size_t datasize; // bytes up to the last row written, the file is grown ahead of it
+    std::string fname;
+    struct komodo_pricewindow window;
     char symbol[64];
 } PRICES[KOMODO_MAXPRICES];
 
+void komodo_pricesunmap(struct komodo_priceinfo *pp)
+{
+    delete pp->region;
+    delete pp->mapping;
+    pp->region = 0;
+    pp->mapping = 0;
+    pp->data = 0;
+    pp->mapsize = 0;
+}
+
 const char *Cryptos[] = { "KMD", "ETH" }; // must be on binance (for now)
 // "LTC", "BCHABC", "XMR", "IOTA", "ZEC", "WAVES",  "LSK", "DCR", "RVN", "DASH", "XEM", "BTS", "ICX", "HOT", "STEEM", "ENJ", "STRAT"
 const char *Forex[] =
@@ -841,7 +866,7 @@ const char *komodo_opreturn(int32_t height,uint64_t value,uint8_t *opretbuf,int3
     tokomodo = (komodo_is_issuer() == 0);
     if ( opretbuf[0] == 'K' && opretlen != 40 )
     {
-        komodo_kvupdate(opretbuf,opretlen,value);
+        komodo_kvupdate(opretbuf,opretlen,value,height);
         return("kv");
     }
     else if ( ASSETCHAINS_SYMBOL[0] == 0 && KOMODO_PAX == 0 )
@@ -2577,10 +2602,186 @@ int64_t komodo_priceave(int64_t *buf,int64_t *correlated,int32_t cskip)
     return((price*7 + halfave*5 + thirdave*3 + fourthave*2 + decayprice + buf[PRICES_DAYWINDOW-1]) / 19);
 }
 
+// maps the whole prices file, growing it first when it is shorter than size bytes. Files grow by
+// KOMODO_PRICES_MAPROWS rows at a time so that the mapping is not redone every block
+uint8_t *komodo_pricesmap(struct komodo_priceinfo *pp,size_t size,size_t rowsize)
+{
+    size_t filesize;
+    if ( pp->data != 0 && size <= pp->mapsize )
+        return(pp->data);
+    komodo_pricesunmap(pp);
+    try
+    {
+        filesize = (size_t)boost::filesystem::file_size(pp->fname);
+        if ( size > filesize )
+        {
+            filesize = size + KOMODO_PRICES_MAPROWS * rowsize;
+            boost::filesystem::resize_file(pp->fname,filesize);
+        }
+        if ( filesize == 0 )
+            return(0);
+        pp->mapping = new boost::interprocess::file_mapping(pp->fname.c_str(),boost::interprocess::read_write);
+        pp->region = new boost::interprocess::mapped_region(*pp->mapping,boost::interprocess::read_write,0,filesize);
+        pp->data = (uint8_t *)pp->region->get_address();
+        pp->mapsize = filesize;
+    }
+    catch (const std::exception &e)
+    {
+        fprintf(stderr,"error mapping %s: %s\n",pp->fname.c_str(),e.what());
+        komodo_pricesunmap(pp);
+    }
+    return(pp->data);
+}
+
+// bytes up to the last row that is not all zero, every row written has a price or a timestamp
+size_t komodo_priceswritten(struct komodo_priceinfo *pp,size_t rowsize)
+{
+    size_t size,i;
+    if ( pp->data == 0 || rowsize == 0 )
+        return(0);
+    for (size=pp->mapsize - pp->mapsize % rowsize; size>=rowsize; size-=rowsize)
+    {
+        for (i=size-rowsize; i<size; i++)
+            if ( pp->data[i] != 0 )
+                return(size);
+    }
+    return(0);
+}
+
+// hands the rows written for a block to the OS, like the fflush after each fwrite used to
+void komodo_pricesflush(struct komodo_priceinfo *pp,size_t offset,size_t len)
+{
+    if ( pp->region != 0 && pp->region->flush(offset,len,true) == 0 )
+        fprintf(stderr,"error flushing %s\n",pp->fname.c_str());
+}
+
+// slides the raw price window of feed ind to end at height, rebuilding it from the rawprices file
+// after a gap or a reorg
+void komodo_pricewindow_raw(struct komodo_pricewindow *wp,uint32_t *rawprices,int32_t numprices,int32_t ind,int32_t height)
+{
+    int32_t h,i; uint32_t price;
+    if ( wp->rawheight != height-1 || wp->raw.size() != PRICES_DAYWINDOW )
+    {
+        wp->raw.assign(PRICES_DAYWINDOW,0);
+        wp->sorted.clear();
+        wp->numzero = 0;
+        for (h=height-PRICES_DAYWINDOW+1; h<=height; h++)
+        {
+            price = rawprices[h*numprices + ind];
+            wp->raw[h % PRICES_DAYWINDOW] = price;
+            wp->sorted.push_back(price);
+            if ( price == 0 )
+                wp->numzero++;
+        }
+        std::sort(wp->sorted.begin(),wp->sorted.end());
+    }
+    else
+    {
+        i = height % PRICES_DAYWINDOW;
+        price = wp->raw[i];
+        wp->sorted.erase(std::lower_bound(wp->sorted.begin(),wp->sorted.end(),price));
+        if ( price == 0 )
+            wp->numzero--;
+        price = rawprices[height*numprices + ind];
+        wp->raw[i] = price;
+        wp->sorted.insert(std::upper_bound(wp->sorted.begin(),wp->sorted.end(),price),price);
+        if ( price == 0 )
+            wp->numzero++;
+    }
+    wp->rawheight = height;
+}
+
+// same as komodo_pricecorrelated over the window ending at height, but the prices within the band
+// of a candidate are counted with two binary searches of the sorted window instead of a scan
+int64_t komodo_pricewindow_correlated(struct komodo_pricewindow *wp,uint64_t seed,int32_t ind,int32_t height)
+{
+    int32_t i,iter,correlation,maxcorrelation=0; int64_t mult,refprice,lowprice,highprice; std::vector<uint32_t> prices;
+    if ( PRICES_DAYWINDOW < 2 || ind >= KOMODO_MAXPRICES )
+        return(-1);
+    if ( wp->numzero != 0 ) // the scan gives up on null prices depending on where it meets them
+    {
+        prices.resize(PRICES_DAYWINDOW);
+        for (i=0; i<PRICES_DAYWINDOW; i++)
+            prices[i] = wp->raw[(height - i) % PRICES_DAYWINDOW];
+        return(komodo_pricecorrelated(seed,ind,prices.data(),1,0,PRICES_SMOOTHWIDTH));
+    }
+    mult = komodo_pricemult(ind);
+    for (iter=0; iter<PRICES_DAYWINDOW; iter++)
+    {
+        i = (iter + seed) % PRICES_DAYWINDOW;
+        refprice = wp->raw[(height - i) % PRICES_DAYWINDOW];
+        highprice = (refprice * (COIN + PRICES_ERRORRATE*5)) / COIN;
+        lowprice = (refprice * (COIN - PRICES_ERRORRATE*5)) / COIN;
+        if ( highprice == refprice )
+            highprice++;
+        if ( lowprice == refprice )
+            lowprice--;
+        correlation = (int32_t)(std::upper_bound(wp->sorted.begin(),wp->sorted.end(),highprice) - std::lower_bound(wp->sorted.begin(),wp->sorted.end(),lowprice));
+        if ( correlation > (PRICES_DAYWINDOW>>1) )
+            return(refprice * mult);
+        if ( correlation > maxcorrelation )
+            maxcorrelation = correlation;
+    }
+    fprintf(stderr,"ind.%d iter.%d maxcorrelation.%d ref.%llu high.%llu low.%llu\n",ind,iter,maxcorrelation,(long long)refprice,(long long)highprice,(long long)lowprice);
+    return(0);
+}
+
+// slides the correlated price window of a feed to end at height, rebuilding it from the feed file
+// after a gap or a reorg. The sum is kept for the 24hr average
+void komodo_pricewindow_correlatedadd(struct komodo_pricewindow *wp,int64_t *rows,int32_t height)
+{
+    int32_t h,i; int64_t price;
+    if ( wp->correlatedheight != height-1 || wp->correlated.size() != PRICES_DAYWINDOW )
+    {
+        wp->correlated.assign(PRICES_DAYWINDOW,0);
+        wp->correlatedsum = 0;
+        wp->numzerocorrelated = 0;
+        for (h=height-PRICES_DAYWINDOW+1; h<=height; h++)
+        {
+            price = rows[h*PRICES_MAXDATAPOINTS + 1];
+            wp->correlated[h % PRICES_DAYWINDOW] = price;
+            wp->correlatedsum += price;
+            if ( price == 0 )
+                wp->numzerocorrelated++;
+        }
+    }
+    else
+    {
+        i = height % PRICES_DAYWINDOW;
+        price = wp->correlated[i];
+        wp->correlatedsum -= price;
+        if ( price == 0 )
+            wp->numzerocorrelated--;
+        price = rows[height*PRICES_MAXDATAPOINTS + 1];
+        wp->correlated[i] = price;
+        wp->correlatedsum += price;
+        if ( price == 0 )
+            wp->numzerocorrelated++;
+    }
+    wp->correlatedheight = height;
+}
+
+// same as komodo_priceave over the window ending at height. Without gaps that is the plain average
+int64_t komodo_pricewindow_smoothed(struct komodo_pricewindow *wp,int32_t height)
+{
+    int32_t i; std::vector<int64_t> correlated,tmpbuf;
+    if ( PRICES_DAYWINDOW < 2 )
+        return(0);
+    if ( wp->numzerocorrelated != 0 ) // gaps are filled from the neighbouring prices
+    {
+        correlated.resize(PRICES_DAYWINDOW);
+        tmpbuf.resize(2*PRICES_DAYWINDOW);
+        for (i=0; i<PRICES_DAYWINDOW; i++)
+            correlated[i] = wp->correlated[(height - i) % PRICES_DAYWINDOW];
+        return(komodo_priceave(tmpbuf.data(),correlated.data(),1));
+    }
+    return(wp->correlatedsum / PRICES_DAYWINDOW);
+}
+
 int32_t komodo_pricesinit()
 {
     static int32_t didinit;
-    int32_t i,num=0,createflag = 0;
+    int32_t i,num=0,createflag = 0; FILE *fp;
     if ( didinit != 0 )
         return(-1);
     didinit = 1;
@@ -2596,27 +2797,20 @@ int32_t komodo_pricesinit()
         if ( i == 0 )
             strcpy(PRICES[i].symbol,"rawprices");
         pricefname = pricesdir / PRICES[i].symbol;
-        if ( createflag != 0 )
-            PRICES[i].fp = fopen(pricefname.string().c_str(),"wb+");
-        else if ( (PRICES[i].fp= fopen(pricefname.string().c_str(),"rb+")) == 0 )
-            PRICES[i].fp = fopen(pricefname.string().c_str(),"wb+");
-        if ( PRICES[i].fp != 0 )
+        PRICES[i].fname = pricefname.string();
+        if ( createflag != 0 || !boost::filesystem::exists(pricefname) )
+        {
+            if ( (fp= fopen(PRICES[i].fname.c_str(),"wb")) != 0 )
+                fclose(fp);
+        }
+        if ( boost::filesystem::exists(pricefname) )
         {
             num++;
-            if ( createflag != 0 )
-            {
-                fseek(PRICES[i].fp,(2*PRICES_DAYWINDOW+PRICES_SMOOTHWIDTH) * sizeof(int64_t) * PRICES_MAXDATAPOINTS,SEEK_SET);
-                fputc(0,PRICES[i].fp);
-                fflush(PRICES[i].fp);
-            }
+            komodo_pricesmap(&PRICES[i],0,0);
+            // files written before they were mapped end at their last row, later ones are grown ahead
+            PRICES[i].datasize = komodo_priceswritten(&PRICES[i],i == 0 ? komodo_cbopretsize(ASSETCHAINS_CBOPRET) : PRICES_MAXDATAPOINTS * sizeof(int64_t));
         } else fprintf(stderr,"error opening %s createflag.%d\n",pricefname.string().c_str(), createflag);
     }
-    if ( i > 0 && PRICES[0].fp != 0 && createflag != 0 )
-    {
-        fseek(PRICES[0].fp,(2*PRICES_DAYWINDOW+PRICES_SMOOTHWIDTH) * sizeof(uint32_t) * i,SEEK_SET);
-        fputc(0,PRICES[0].fp);
-        fflush(PRICES[0].fp);
-    }
     fprintf(stderr,"pricesinit done i.%d num.%d numprices.%d\n",i,num,(int32_t)(komodo_cbopretsize(ASSETCHAINS_CBOPRET)/sizeof(uint32_t)));
     if ( i != num || i != komodo_cbopretsize(ASSETCHAINS_CBOPRET)/sizeof(uint32_t) )
     {
@@ -2626,7 +2820,7 @@ int32_t komodo_pricesinit()
     return(0);
 }
 
-pthread_mutex_t pricemutex;
+pthread_mutex_t pricemutex = PTHREAD_MUTEX_INITIALIZER;
 
 // PRICES file layouts
 // [0] rawprice32 / timestamp
@@ -2636,88 +2830,78 @@ pthread_mutex_t pricemutex;
 
 void komodo_pricesupdate(int32_t height,CBlock *pblock)
 {
-    static int numprices; static uint32_t *ptr32; static int64_t *ptr64,*tmpbuf;
-    int32_t ind,offset,width; int64_t correlated,smoothed; uint64_t seed,rngval; uint32_t rawprices[KOMODO_MAXPRICES],buf[PRICES_MAXDATAPOINTS*2];
+    static int numprices;
+    int32_t ind,width; int64_t correlated,smoothed,*rows; uint64_t seed,rngval; uint32_t rawprices[KOMODO_MAXPRICES],buf[PRICES_MAXDATAPOINTS*2],*raw; struct komodo_priceinfo *pp;
     width = PRICES_DAYWINDOW;//(2*PRICES_DAYWINDOW + PRICES_SMOOTHWIDTH);
     if ( numprices == 0 )
     {
-        pthread_mutex_init(&pricemutex,0);
         numprices = (int32_t)(komodo_cbopretsize(ASSETCHAINS_CBOPRET) / sizeof(uint32_t));
-        ptr32 = (uint32_t *)calloc(sizeof(uint32_t),numprices * width);
-        ptr64 = (int64_t *)calloc(sizeof(int64_t),PRICES_DAYWINDOW*PRICES_MAXDATAPOINTS);
-        tmpbuf = (int64_t *)calloc(sizeof(int64_t),2*PRICES_DAYWINDOW);
-        fprintf(stderr,"prices update: numprices.%d %p %p\n",numprices,ptr32,ptr64);
+        fprintf(stderr,"prices update: numprices.%d\n",numprices);
     }
     if ( _komodo_heightpricebits(&seed,rawprices,pblock) == numprices )
     {
         //for (ind=0; ind<numprices; ind++)
         //    fprintf(stderr,"%u ",rawprices[ind]);
         //fprintf(stderr,"numprices.%d\n",numprices);
-        if ( PRICES[0].fp != 0 )
+        pthread_mutex_lock(&pricemutex);
+        if ( (raw= (uint32_t *)komodo_pricesmap(&PRICES[0],(height+1) * numprices * sizeof(uint32_t),numprices * sizeof(uint32_t))) != 0 )
         {
-            pthread_mutex_lock(&pricemutex);
-            fseek(PRICES[0].fp,height * numprices * sizeof(uint32_t),SEEK_SET);
-            if ( fwrite(rawprices,sizeof(uint32_t),numprices,PRICES[0].fp) != numprices )
-                fprintf(stderr,"error writing rawprices for ht.%d\n",height);
-            else fflush(PRICES[0].fp);
+            memcpy(&raw[height * numprices],rawprices,numprices * sizeof(uint32_t));
+            PRICES[0].datasize = std::max(PRICES[0].datasize,(size_t)(height+1) * numprices * sizeof(uint32_t));
+            komodo_pricesflush(&PRICES[0],height * numprices * sizeof(uint32_t),numprices * sizeof(uint32_t));
             if ( height > PRICES_DAYWINDOW )
             {
-                fseek(PRICES[0].fp,(height-width+1) * numprices * sizeof(uint32_t),SEEK_SET);
-                if ( fread(ptr32,sizeof(uint32_t),width*numprices,PRICES[0].fp) == width*numprices )
+                rngval = seed;
+                for (ind=1; ind<numprices; ind++)
                 {
-                    rngval = seed;
-                    for (ind=1; ind<numprices; ind++)
+                    pp = &PRICES[ind];
+                    if ( (rows= (int64_t *)komodo_pricesmap(pp,(height+1) * PRICES_MAXDATAPOINTS * sizeof(int64_t),PRICES_MAXDATAPOINTS * sizeof(int64_t))) == 0 )
                     {
-                        if ( PRICES[ind].fp == 0 )
-                        {
-                            fprintf(stderr,"PRICES[%d].fp is null\n",ind);
-                            continue;
-                        }
-                        offset = (width-1)*numprices + ind;
-                        rngval = (rngval*11109 + 13849);
-                        if ( (correlated= komodo_pricecorrelated(rngval,ind,&ptr32[offset],-numprices,0,PRICES_SMOOTHWIDTH)) > 0 )
-                        {
-                            fseek(PRICES[ind].fp,height * sizeof(int64_t) * PRICES_MAXDATAPOINTS,SEEK_SET);
-                            memset(buf,0,sizeof(buf));
-                            buf[0] = rawprices[ind];
-                            buf[1] = rawprices[0]; // timestamp
-                            memcpy(&buf[2],&correlated,sizeof(correlated));
-                            if ( fwrite(buf,1,sizeof(buf),PRICES[ind].fp) != sizeof(buf) )
-                                fprintf(stderr,"error fwrite buf for ht.%d ind.%d\n",height,ind);
-                            else if ( height > PRICES_DAYWINDOW*2 )
-                            {
-                                fseek(PRICES[ind].fp,(height-PRICES_DAYWINDOW+1) * PRICES_MAXDATAPOINTS * sizeof(int64_t),SEEK_SET);
-                                if ( fread(ptr64,sizeof(int64_t),PRICES_DAYWINDOW*PRICES_MAXDATAPOINTS,PRICES[ind].fp) == PRICES_DAYWINDOW*PRICES_MAXDATAPOINTS )
-                                {
-                                    if ( (smoothed= komodo_priceave(tmpbuf,&ptr64[(PRICES_DAYWINDOW-1)*PRICES_MAXDATAPOINTS+1],-PRICES_MAXDATAPOINTS)) > 0 )
-                                    {
-                                        fseek(PRICES[ind].fp,(height * PRICES_MAXDATAPOINTS + 2) * sizeof(int64_t),SEEK_SET);
-                                        if ( fwrite(&smoothed,1,sizeof(smoothed),PRICES[ind].fp) != sizeof(smoothed) )
-                                            fprintf(stderr,"error fwrite smoothed for ht.%d ind.%d\n",height,ind);
-                                        else fflush(PRICES[ind].fp);
-                                    } else fprintf(stderr,"error price_smoothed ht.%d ind.%d\n",height,ind);
-                                } else fprintf(stderr,"error fread ptr64 for ht.%d ind.%d\n",height,ind);
-                            }
-                        } else fprintf(stderr,"error komodo_pricecorrelated for ht.%d ind.%d\n",height,ind);
+                        fprintf(stderr,"PRICES[%d] is not mapped\n",ind);
+                        pp->window.rawheight = pp->window.correlatedheight = 0;
+                        continue;
                     }
-                    fprintf(stderr,"height.%d\n",height);
-                } else fprintf(stderr,"error reading rawprices for ht.%d\n",height);
+                    rngval = (rngval*11109 + 13849);
+                    komodo_pricewindow_raw(&pp->window,raw,numprices,ind,height);
+                    if ( (correlated= komodo_pricewindow_correlated(&pp->window,rngval,ind,height)) > 0 )
+                    {
+                        memset(buf,0,sizeof(buf));
+                        buf[0] = rawprices[ind];
+                        buf[1] = rawprices[0]; // timestamp
+                        memcpy(&buf[2],&correlated,sizeof(correlated));
+                        memcpy(&rows[height * PRICES_MAXDATAPOINTS],buf,sizeof(buf));
+                        pp->datasize = std::max(pp->datasize,(size_t)(height+1) * PRICES_MAXDATAPOINTS * sizeof(int64_t));
+                    } else fprintf(stderr,"error komodo_pricecorrelated for ht.%d ind.%d\n",height,ind);
+                    // rows that could not be updated still count towards the average, as they are
+                    komodo_pricewindow_correlatedadd(&pp->window,rows,height);
+                    if ( correlated > 0 && height > PRICES_DAYWINDOW*2 )
+                    {
+                        if ( (smoothed= komodo_pricewindow_smoothed(&pp->window,height)) > 0 )
+                            rows[height * PRICES_MAXDATAPOINTS + 2] = smoothed;
+                        else fprintf(stderr,"error price_smoothed ht.%d ind.%d\n",height,ind);
+                    }
+                    komodo_pricesflush(pp,height * PRICES_MAXDATAPOINTS * sizeof(int64_t),PRICES_MAXDATAPOINTS * sizeof(int64_t));
+                }
+                fprintf(stderr,"height.%d\n",height);
             } else fprintf(stderr,"height.%d <= width.%d\n",height,width);
-            pthread_mutex_unlock(&pricemutex);
-        } else fprintf(stderr,"null PRICES[0].fp\n");
+        } else fprintf(stderr,"error mapping rawprices for ht.%d\n",height);
+        pthread_mutex_unlock(&pricemutex);
     } else fprintf(stderr,"numprices mismatch, height.%d\n",height);
 }
 
 int32_t komodo_priceget(int64_t *buf64,int32_t ind,int32_t height,int32_t numblocks)
 {
-    FILE *fp; int32_t retval = PRICES_MAXDATAPOINTS;
+    int32_t retval = PRICES_MAXDATAPOINTS; size_t offset,size;
     pthread_mutex_lock(&pricemutex);
-    if ( ind < KOMODO_MAXPRICES && (fp= PRICES[ind].fp) != 0 )
+    if ( ind < KOMODO_MAXPRICES && PRICES[ind].data != 0 )
     {
-        fseek(fp,height * PRICES_MAXDATAPOINTS * sizeof(int64_t),SEEK_SET);
-        if ( fread(buf64,sizeof(int64_t),numblocks*PRICES_MAXDATAPOINTS,fp) != numblocks*PRICES_MAXDATAPOINTS )
+        offset = (size_t)height * PRICES_MAXDATAPOINTS * sizeof(int64_t);
+        size = (size_t)numblocks * PRICES_MAXDATAPOINTS * sizeof(int64_t);
+        // heights past the last row written fail like the short fread of the unmapped file did
+        if ( height < 0 || numblocks < 0 || offset + size > PRICES[ind].datasize || offset + size > PRICES[ind].mapsize )
             retval = -1;
-    }
+        else memcpy(buf64,&PRICES[ind].data[offset],size);
+    } else retval = -1;
     pthread_mutex_unlock(&pricemutex);
     return(retval);
 }
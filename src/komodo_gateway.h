@@ -227,6 +227,26 @@ static void revsort64(int64_t *l, int32_t llen)
 
 int64_t komodo_priceave(int64_t *buf,int64_t *correlated,int32_t cskip);
 
+// sliding windows over the last PRICES_DAYWINDOW heights of a feed, so that each block only adds and
+// removes one sample instead of rescanning the whole day
+struct komodo_pricewindow
+{
+    int32_t rawheight,correlatedheight; // last height in each window, anything else means rebuild
+    std::vector<uint32_t> raw,sorted; // raw prices at height % PRICES_DAYWINDOW, and the same in order
+    std::vector<int64_t> correlated; // correlated prices at height % PRICES_DAYWINDOW
+    int64_t correlatedsum;
+    int32_t numzero,numzerocorrelated;
+};
+
+// the window versions of komodo_pricecorrelated and komodo_priceave, which they must match exactly
+void komodo_pricewindow_raw(struct komodo_pricewindow *wp,uint32_t *rawprices,int32_t numprices,int32_t ind,int32_t height);
+
+int64_t komodo_pricewindow_correlated(struct komodo_pricewindow *wp,uint64_t seed,int32_t ind,int32_t height);
+
+void komodo_pricewindow_correlatedadd(struct komodo_pricewindow *wp,int64_t *rows,int32_t height);
+
+int64_t komodo_pricewindow_smoothed(struct komodo_pricewindow *wp,int32_t height);
+
 int32_t komodo_pricesinit();
 
 // PRICES file layouts
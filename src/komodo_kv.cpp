@@ -14,8 +14,27 @@
  ******************************************************************************/
 #include "komodo_kv.h"
 #include "komodo_extern_globals.h"
-#include "komodo_utils.h" // portable_mutex_lock
+#include "komodo_utils.h" // is_hexstr
 #include "komodo_curve25519.h" // komodo_kvsigverify
+#include "kvindex.h"
+#include "main.h"
+#include "txdb.h"
+#include "txmempool.h"
+
+#include <boost/thread/shared_mutex.hpp>
+
+/**
+ * The kv table lives in the block tree db and is kept in step with the chain
+ * by komodo_kvconnect() and komodo_kvdisconnect(), so it survives restarts
+ * without replaying the komodostate opreturns. Updates parsed while a block is
+ * connected are held in mapKVPending until the block is written. Readers only
+ * take cs_kv shared, the db itself is safe for concurrent reads.
+ */
+static boost::shared_mutex cs_kv;
+static std::map<std::vector<uint8_t>,CKVEntry> mapKVPending;
+static std::map<int32_t,CKVUndo> mapKVPendingUndo;
+static int32_t nKVBestHeight;
+static uint256 hashKVBest;
 
 int32_t komodo_kvcmp(uint8_t *refvalue,uint16_t refvaluesize,uint8_t *value,uint16_t valuesize)
 {
@@ -52,56 +71,70 @@ uint64_t komodo_kvfee(uint32_t flags,int32_t opretlen,int32_t keylen)
     return(fee);
 }
 
+static int32_t komodo_kvexpiry(const CKVEntry &entry)
+{
+    int64_t expiry = (int64_t)entry.height + komodo_kvduration(entry.flags);
+    if ( expiry < 0 )
+        return(0);
+    else if ( expiry > std::numeric_limits<int32_t>::max() )
+        return(std::numeric_limits<int32_t>::max());
+    return((int32_t)expiry);
+}
+
+// cs_kv must be held
+static int32_t komodo_kvread(const std::vector<uint8_t> &key,CKVEntry &entry)
+{
+    std::map<std::vector<uint8_t>,CKVEntry>::const_iterator it = mapKVPending.find(key);
+    if ( it != mapKVPending.end() )
+    {
+        entry = it->second;
+        return(!entry.IsNull());
+    }
+    return(pblocktree != 0 && pblocktree->ReadKVIndex(key,entry));
+}
+
+// expired entries are only swept from the db well below the tip, see komodo_kvconnect
+static int32_t komodo_kvfind(const std::vector<uint8_t> &key,int32_t current_height,CKVEntry &entry)
+{
+    if ( komodo_kvread(key,entry) == 0 )
+        return(0);
+    if ( current_height > (int64_t)entry.height + komodo_kvduration(entry.flags) )
+        return(0);
+    return(1);
+}
+
 int32_t komodo_kvsearch(uint256 *pubkeyp,int32_t current_height,uint32_t *flagsp,int32_t *heightp,uint8_t value[IGUANA_MAXSCRIPTSIZE],uint8_t *key,int32_t keylen)
 {
-    struct komodo_kv *ptr; int32_t duration,retval = -1;
+    CKVEntry entry; int32_t found,retval = -1; std::vector<uint8_t> vkey(key,key+keylen);
     *heightp = -1;
     *flagsp = 0;
     memset(pubkeyp,0,sizeof(*pubkeyp));
-    portable_mutex_lock(&KOMODO_KV_mutex);
-    HASH_FIND(hh,KOMODO_KV,key,keylen,ptr);
-    if ( ptr != 0 )
-    {
-        duration = komodo_kvduration(ptr->flags);
-        //fprintf(stderr,"duration.%d flags.%d current.%d ht.%d keylen.%d valuesize.%d\n",duration,ptr->flags,current_height,ptr->height,ptr->keylen,ptr->valuesize);
-        if ( current_height > (ptr->height + duration) )
-        {
-            HASH_DELETE(hh,KOMODO_KV,ptr);
-            if ( ptr->value != 0 )
-                free(ptr->value);
-            if ( ptr->key != 0 )
-                free(ptr->key);
-            free(ptr);
-        }
-        else
-        {
-            *heightp = ptr->height;
-            *flagsp = ptr->flags;
-            int32_t i; for (i=0; i<32; i++)
-            {
-                //printf("%02x",((uint8_t *)&ptr->pubkey)[31-i]);
-                ((uint8_t *)pubkeyp)[i] = ((uint8_t *)&ptr->pubkey)[31-i];
-            }
-            //printf(" ptr->pubkey\n");
-            memcpy(pubkeyp,&ptr->pubkey,sizeof(*pubkeyp));
-            if ( (retval= ptr->valuesize) > 0 )
-                memcpy(value,ptr->value,retval);
-        }
-    } //else fprintf(stderr,"couldnt find (%s)\n",(char *)key);
-    portable_mutex_unlock(&KOMODO_KV_mutex);
-    if ( retval < 0 )
     {
-        // search rawmempool
+        boost::shared_lock<boost::shared_mutex> lock(cs_kv);
+        found = komodo_kvfind(vkey,current_height,entry);
     }
+    // not under cs_kv, the mempool calls back into the kv table with its own lock held
+    if ( found == 0 && mempool.getKVIndex(vkey,entry) != 0 && current_height <= (int64_t)entry.height + komodo_kvduration(entry.flags) )
+        found = 1;
+    if ( found != 0 )
+    {
+        *heightp = entry.height;
+        *flagsp = entry.flags;
+        memcpy(pubkeyp,&entry.pubkey,sizeof(*pubkeyp));
+        if ( (retval= (int32_t)entry.value.size()) > 0 )
+            memcpy(value,entry.value.data(),retval);
+    } //else fprintf(stderr,"couldnt find (%s)\n",(char *)key);
     return(retval);
 }
 
-void komodo_kvupdate(uint8_t *opretbuf,int32_t opretlen,uint64_t value)
+/**
+ * Parse a 'K' opreturn and compute the value its key gets, cs_kv must be held.
+ * Returns 0 if the update is rejected.
+ */
+static int32_t komodo_kvparse(uint8_t *opretbuf,int32_t opretlen,uint64_t value,std::vector<uint8_t> &vkey,CKVEntry &entry)
 {
     static uint256 zeroes;
-    uint32_t flags; uint256 pubkey,refpubkey,sig; int32_t i,refvaluesize,hassig,coresize,haspubkey,height,kvheight; uint16_t keylen,valuesize,newflag = 0; uint8_t *key,*valueptr,keyvalue[IGUANA_MAXSCRIPTSIZE*8]; struct komodo_kv *ptr; char *transferpubstr,*tstr; uint64_t fee;
-    if ( ASSETCHAINS_SYMBOL[0] == 0 ) // disable KV for KMD
-        return;
+    uint32_t flags; uint256 pubkey,sig; int32_t i,hassig,coresize,haspubkey,height,found; uint16_t keylen,valuesize; uint8_t *key,*valueptr,keyvalue[IGUANA_MAXSCRIPTSIZE*8]; CKVEntry prev; char *transferpubstr,*tstr; uint64_t fee;
     iguana_rwnum(0,&opretbuf[1],sizeof(keylen),&keylen);
     iguana_rwnum(0,&opretbuf[3],sizeof(valuesize),&valuesize);
     iguana_rwnum(0,&opretbuf[5],sizeof(height),&height);
@@ -112,87 +145,220 @@ void komodo_kvupdate(uint8_t *opretbuf,int32_t opretlen,uint64_t value)
         static uint32_t counter;
         if ( ++counter < 1 )
             fprintf(stderr,"komodo_kvupdate: keylen.%d + 13 > opretlen.%d, this can be ignored\n",keylen,opretlen);
-        return;
+        return(0);
     }
     valueptr = &key[keylen];
     fee = komodo_kvfee(flags,opretlen,keylen);
     //fprintf(stderr,"fee %.8f vs %.8f flags.%d keylen.%d valuesize.%d height.%d (%02x %02x %02x) (%02x %02x %02x)\n",(double)fee/COIN,(double)value/COIN,flags,keylen,valuesize,height,key[0],key[1],key[2],valueptr[0],valueptr[1],valueptr[2]);
-    if ( value >= fee )
+    if ( value < fee )
+    {
+        fprintf(stderr,"not enough fee\n");
+        return(0);
+    }
+    coresize = (int32_t)(sizeof(flags)+sizeof(height)+sizeof(keylen)+sizeof(valuesize)+keylen+valuesize+1);
+    if ( opretlen != coresize && opretlen != coresize+sizeof(uint256) && opretlen != coresize+2*sizeof(uint256) )
+    {
+        fprintf(stderr,"KV update size mismatch %d vs %d\n",opretlen,coresize);
+        return(0);
+    }
+    memset(&pubkey,0,sizeof(pubkey));
+    memset(&sig,0,sizeof(sig));
+    if ( (haspubkey= (opretlen >= coresize+sizeof(uint256))) != 0 )
     {
-        coresize = (int32_t)(sizeof(flags)+sizeof(height)+sizeof(keylen)+sizeof(valuesize)+keylen+valuesize+1);
-        if ( opretlen == coresize || opretlen == coresize+sizeof(uint256) || opretlen == coresize+2*sizeof(uint256) )
+        for (i=0; i<32; i++)
+            ((uint8_t *)&pubkey)[i] = opretbuf[coresize+i];
+    }
+    if ( (hassig= (opretlen == coresize+sizeof(uint256)*2)) != 0 )
+    {
+        for (i=0; i<32; i++)
+            ((uint8_t *)&sig)[i] = opretbuf[coresize+sizeof(uint256)+i];
+    }
+    vkey.assign(key,key+keylen);
+    // as before, a live key keeps its flags and a new one starts without any
+    flags = 0;
+    if ( (found= komodo_kvfind(vkey,height,prev)) != 0 )
+    {
+        flags = prev.flags;
+        memcpy(keyvalue,key,keylen);
+        if ( prev.value.size() > 0 )
+            memcpy(&keyvalue[keylen],prev.value.data(),prev.value.size());
+        if ( memcmp(&zeroes,&prev.pubkey,sizeof(prev.pubkey)) != 0 )
         {
-            memset(&pubkey,0,sizeof(pubkey));
-            memset(&sig,0,sizeof(sig));
-            if ( (haspubkey= (opretlen >= coresize+sizeof(uint256))) != 0 )
-            {
-                for (i=0; i<32; i++)
-                    ((uint8_t *)&pubkey)[i] = opretbuf[coresize+i];
-            }
-            if ( (hassig= (opretlen == coresize+sizeof(uint256)*2)) != 0 )
-            {
-                for (i=0; i<32; i++)
-                    ((uint8_t *)&sig)[i] = opretbuf[coresize+sizeof(uint256)+i];
-            }
-            memcpy(keyvalue,key,keylen);
-            if ( (refvaluesize= komodo_kvsearch((uint256 *)&refpubkey,height,&flags,&kvheight,&keyvalue[keylen],key,keylen)) >= 0 )
-            {
-                if ( memcmp(&zeroes,&refpubkey,sizeof(refpubkey)) != 0 )
-                {
-                    if ( komodo_kvsigverify(keyvalue,keylen+refvaluesize,refpubkey,sig) < 0 )
-                    {
-                        //fprintf(stderr,"komodo_kvsigverify error [%d]\n",coresize-13);
-                        return;
-                    }
-                }
-            }
-            portable_mutex_lock(&KOMODO_KV_mutex);
-            HASH_FIND(hh,KOMODO_KV,key,keylen,ptr);
-            if ( ptr != 0 )
-            {
-                //fprintf(stderr,"(%s) already there\n",(char *)key);
-                //if ( (ptr->flags & KOMODO_KVPROTECTED) != 0 )
-                {
-                    tstr = (char *)"transfer:";
-                    transferpubstr = (char *)&valueptr[strlen(tstr)];
-                    if ( strncmp(tstr,(char *)valueptr,strlen(tstr)) == 0 && is_hexstr(transferpubstr,0) == 64 )
-                    {
-                        printf("transfer.(%s) to [%s]? ishex.%d\n",key,transferpubstr,is_hexstr(transferpubstr,0));
-                        for (i=0; i<32; i++)
-                            ((uint8_t *)&pubkey)[31-i] = _decode_hex(&transferpubstr[i*2]);
-                    }
-                }
-            }
-            else if ( ptr == 0 )
+            if ( komodo_kvsigverify(keyvalue,keylen+(int32_t)prev.value.size(),prev.pubkey,sig) < 0 )
             {
-                ptr = (struct komodo_kv *)calloc(1,sizeof(*ptr));
-                ptr->key = (uint8_t *)calloc(1,keylen);
-                ptr->keylen = keylen;
-                memcpy(ptr->key,key,keylen);
-                newflag = 1;
-                HASH_ADD_KEYPTR(hh,KOMODO_KV,ptr->key,ptr->keylen,ptr);
-                //fprintf(stderr,"KV add.(%s) (%s)\n",ptr->key,valueptr);
+                //fprintf(stderr,"komodo_kvsigverify error [%d]\n",coresize-13);
+                return(0);
             }
-            if ( newflag != 0 || (ptr->flags & KOMODO_KVPROTECTED) == 0 )
-            {
-                if ( ptr->value != 0 )
-                    free(ptr->value), ptr->value = 0;
-                if ( (ptr->valuesize= valuesize) != 0 )
-                {
-                    ptr->value = (uint8_t *)calloc(1,valuesize);
-                    memcpy(ptr->value,valueptr,valuesize);
-                }
-            } else fprintf(stderr,"newflag.%d zero or protected %d\n",newflag,(ptr->flags & KOMODO_KVPROTECTED));
-            /*for (i=0; i<32; i++)
-                printf("%02x",((uint8_t *)&ptr->pubkey)[i]);
-            printf(" <- ");
+        }
+        tstr = (char *)"transfer:";
+        transferpubstr = (char *)&valueptr[strlen(tstr)];
+        if ( strncmp(tstr,(char *)valueptr,strlen(tstr)) == 0 && is_hexstr(transferpubstr,0) == 64 )
+        {
+            printf("transfer.(%s) to [%s]? ishex.%d\n",key,transferpubstr,is_hexstr(transferpubstr,0));
             for (i=0; i<32; i++)
-                printf("%02x",((uint8_t *)&pubkey)[i]);
-            printf(" new pubkey\n");*/
-            memcpy(&ptr->pubkey,&pubkey,sizeof(ptr->pubkey));
-            ptr->height = height;
-            ptr->flags = flags; // jl777 used to or in KVPROTECTED
-            portable_mutex_unlock(&KOMODO_KV_mutex);
-        } else fprintf(stderr,"KV update size mismatch %d vs %d\n",opretlen,coresize);
-    } else fprintf(stderr,"not enough fee\n");
+                ((uint8_t *)&pubkey)[31-i] = _decode_hex(&transferpubstr[i*2]);
+        }
+    }
+    if ( found == 0 || (prev.flags & KOMODO_KVPROTECTED) == 0 )
+        entry.value.assign(valueptr,valueptr+valuesize);
+    else
+    {
+        fprintf(stderr,"newflag.%d zero or protected %d\n",found == 0,(prev.flags & KOMODO_KVPROTECTED));
+        entry.value = prev.value;
+    }
+    entry.pubkey = pubkey;
+    entry.height = height;
+    entry.flags = flags; // jl777 used to or in KVPROTECTED
+    return(1);
+}
+
+void komodo_kvupdate(uint8_t *opretbuf,int32_t opretlen,uint64_t value,int32_t blockheight)
+{
+    std::vector<uint8_t> vkey; CKVEntry entry,prev; int32_t i;
+    if ( ASSETCHAINS_SYMBOL[0] == 0 ) // disable KV for KMD
+        return;
+    boost::unique_lock<boost::shared_mutex> lock(cs_kv);
+    // already in the db, komodostate is replayed at startup
+    if ( blockheight <= nKVBestHeight )
+        return;
+    if ( komodo_kvparse(opretbuf,opretlen,value,vkey,entry) == 0 )
+        return;
+    CKVUndo &undo = mapKVPendingUndo[blockheight];
+    for (i=0; i<undo.size(); i++)
+        if ( undo[i].first == vkey )
+            break;
+    if ( i == undo.size() )
+    {
+        if ( komodo_kvread(vkey,prev) == 0 )
+            prev.SetNull();
+        undo.push_back(std::make_pair(vkey,prev));
+    }
+    mapKVPending[vkey] = entry;
+}
+
+void GetKVIndexEntries(const CTransaction &tx,std::vector<std::pair<std::vector<uint8_t>,CKVEntry> > &vect)
+{
+    std::vector<uint8_t> opret,vkey; CKVEntry entry; opcodetype opcode;
+    if ( ASSETCHAINS_SYMBOL[0] == 0 )
+        return;
+    boost::shared_lock<boost::shared_mutex> lock(cs_kv);
+    for (int32_t j=0; j<tx.vout.size(); j++)
+    {
+        const CScript &script = tx.vout[j].scriptPubKey;
+        CScript::const_iterator pc = script.begin();
+        if ( script.GetOp(pc,opcode) == 0 || opcode != OP_RETURN || script.GetOp(pc,opcode,opret) == 0 )
+            continue;
+        // same selection as komodo_voutupdate and komodo_opreturn
+        if ( opret.size() < 13 || opret[0] != 'K' || opret.size() == 40 )
+            continue;
+        if ( komodo_kvparse(opret.data(),(int32_t)opret.size(),(uint64_t)tx.vout[j].nValue,vkey,entry) != 0 )
+            vect.push_back(std::make_pair(vkey,entry));
+    }
+}
+
+bool komodo_kvconnect(const CBlockIndex *pindex)
+{
+    CKVBatch batch; CKVEntry prev; std::vector<CKVExpiryKey> expired; int32_t height;
+    if ( ASSETCHAINS_SYMBOL[0] == 0 || pblocktree == 0 )
+        return(true);
+    height = pindex->GetHeight();
+    boost::unique_lock<boost::shared_mutex> lock(cs_kv);
+    if ( height <= nKVBestHeight )
+        return(true);
+    for (std::map<std::vector<uint8_t>,CKVEntry>::const_iterator it=mapKVPending.begin(); it!=mapKVPending.end(); it++)
+    {
+        if ( pblocktree->ReadKVIndex(it->first,prev) )
+            batch.vExpiryErase.push_back(CKVExpiryKey(komodo_kvexpiry(prev),it->first));
+        batch.vEntries.push_back(*it);
+        if ( !it->second.IsNull() )
+            batch.vExpiryWrite.push_back(CKVExpiryKey(komodo_kvexpiry(it->second),it->first));
+    }
+    // undo data only has to reach as deep as a reorg or -checkblocks can
+    for (std::map<int32_t,CKVUndo>::const_iterator it=mapKVPendingUndo.begin(); it!=mapKVPendingUndo.end(); it++)
+        if ( it->first > height - KOMODO_KVUNDODEPTH )
+            batch.mapUndo.insert(*it);
+    if ( height > KOMODO_KVUNDODEPTH && batch.mapUndo.count(height - KOMODO_KVUNDODEPTH) == 0 )
+        batch.mapUndo[height - KOMODO_KVUNDODEPTH] = CKVUndo();
+    // below that depth nothing can bring an expired key back
+    pblocktree->ReadKVExpired(height - KOMODO_KVUNDODEPTH,expired);
+    for (std::vector<CKVExpiryKey>::const_iterator it=expired.begin(); it!=expired.end(); it++)
+    {
+        if ( mapKVPending.count(it->key) != 0 )
+            continue;
+        batch.vExpiryErase.push_back(*it);
+        batch.vEntries.push_back(std::make_pair(it->key,CKVEntry()));
+    }
+    batch.nBestHeight = height;
+    batch.hashBestBlock = pindex->GetBlockHash();
+    if ( !pblocktree->WriteKVBatch(batch) )
+        return(false);
+    mapKVPending.clear();
+    mapKVPendingUndo.clear();
+    nKVBestHeight = height;
+    hashKVBest = batch.hashBestBlock;
+    return(true);
+}
+
+bool komodo_kvdisconnect(const CBlockIndex *pindex)
+{
+    CKVBatch batch; CKVUndo undo; CKVEntry current; int32_t height;
+    if ( ASSETCHAINS_SYMBOL[0] == 0 || pblocktree == 0 )
+        return(true);
+    height = pindex->GetHeight();
+    boost::unique_lock<boost::shared_mutex> lock(cs_kv);
+    if ( height > nKVBestHeight )
+    {
+        // replayed from komodostate and not written yet
+        std::map<int32_t,CKVUndo>::iterator it = mapKVPendingUndo.find(height);
+        if ( it != mapKVPendingUndo.end() )
+        {
+            for (CKVUndo::const_iterator uit=it->second.begin(); uit!=it->second.end(); uit++)
+                mapKVPending[uit->first] = uit->second;
+            mapKVPendingUndo.erase(it);
+        }
+        return(true);
+    }
+    if ( height != nKVBestHeight )
+        return error("komodo_kvdisconnect: kv store is at height %d, cannot disconnect %d",nKVBestHeight,height);
+    if ( !pblocktree->ReadKVUndo(height,undo) )
+        undo.clear();
+    for (CKVUndo::const_iterator it=undo.begin(); it!=undo.end(); it++)
+    {
+        if ( pblocktree->ReadKVIndex(it->first,current) )
+            batch.vExpiryErase.push_back(CKVExpiryKey(komodo_kvexpiry(current),it->first));
+        batch.vEntries.push_back(*it);
+        if ( !it->second.IsNull() )
+            batch.vExpiryWrite.push_back(CKVExpiryKey(komodo_kvexpiry(it->second),it->first));
+    }
+    batch.mapUndo[height] = CKVUndo();
+    batch.nBestHeight = height - 1;
+    batch.hashBestBlock = pindex->pprev != 0 ? pindex->pprev->GetBlockHash() : uint256();
+    if ( !pblocktree->WriteKVBatch(batch) )
+        return(false);
+    nKVBestHeight = batch.nBestHeight;
+    hashKVBest = batch.hashBestBlock;
+    return(true);
+}
+
+void komodo_kvinit()
+{
+    int32_t height; uint256 hash;
+    if ( ASSETCHAINS_SYMBOL[0] == 0 || pblocktree == 0 )
+        return;
+    boost::unique_lock<boost::shared_mutex> lock(cs_kv);
+    nKVBestHeight = 0;
+    hashKVBest.SetNull();
+    if ( !pblocktree->ReadKVBestBlock(height,hash) )
+        return;
+    BlockMap::const_iterator it = mapBlockIndex.find(hash);
+    if ( it != mapBlockIndex.end() && chainActive.Contains(it->second) )
+    {
+        nKVBestHeight = height;
+        hashKVBest = hash;
+        LogPrintf("komodo_kvinit: kv store loaded at height %d\n",height);
+        return;
+    }
+    // written past the last chainstate flush, start over from komodostate
+    LogPrintf("komodo_kvinit: kv store at height %d is not on the active chain, rebuilding it\n",height);
+    pblocktree->WipeKVIndex();
 }
@@ -17,6 +17,11 @@
 #include "komodo_defs.h"
 #include "hex.h"
 
+class CBlockIndex;
+
+/** Blocks below the tip the kv undo data is kept for, and past which expired keys are swept */
+#define KOMODO_KVUNDODEPTH 288
+
 int32_t komodo_kvcmp(uint8_t *refvalue,uint16_t refvaluesize,uint8_t *value,uint16_t valuesize);
 
 int32_t komodo_kvnumdays(uint32_t flags);
@@ -27,4 +32,10 @@ uint64_t komodo_kvfee(uint32_t flags,int32_t opretlen,int32_t keylen);
 
 int32_t komodo_kvsearch(uint256 *pubkeyp,int32_t current_height,uint32_t *flagsp,int32_t *heightp,uint8_t value[IGUANA_MAXSCRIPTSIZE],uint8_t *key,int32_t keylen);
 
-void komodo_kvupdate(uint8_t *opretbuf,int32_t opretlen,uint64_t value);
+void komodo_kvupdate(uint8_t *opretbuf,int32_t opretlen,uint64_t value,int32_t blockheight);
+
+bool komodo_kvconnect(const CBlockIndex *pindex);
+
+bool komodo_kvdisconnect(const CBlockIndex *pindex);
+
+void komodo_kvinit();
@@ -24,6 +24,13 @@
 #define NSPV_AUTOLOGOUT 777
 #define NSPV_BRANCHID 0x76b809bb
 
+// NSPV_UTXOS and NSPV_TXIDS requests can be paged: after isCC, skipcount and filter they then carry
+// sinceheight, and the txid, vout and height of the last entry of the previous page (null txid for the
+// first page). skipcount is ignored. For TXIDS a spending entry is passed with vout -1-vin. A page
+// shorter than NSPV_PAGESIZE is the last one.
+#define NSPV_PAGESIZE 1000
+#define NSPV_PAGEDREQLEN (1 + 4 + 4 + 4 + 32 + 4 + 4)
+
 // nSPV defines and struct definitions with serialization and purge functions
 
 #define NSPV_INFO 0x00
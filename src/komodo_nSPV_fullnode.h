@@ -123,7 +123,8 @@ int32_t NSPV_setequihdr(struct NSPV_equihdr *hdr,int32_t height)
         hdr->nTime = pindex->nTime;
         hdr->nBits = pindex->nBits;
         hdr->nNonce = pindex->nNonce;
-        memcpy(hdr->nSolution,&pindex->nSolution[0],sizeof(hdr->nSolution));
+        std::vector<unsigned char> solution = pindex->GetSolution();
+        memcpy(hdr->nSolution,&solution[0],sizeof(hdr->nSolution));
         return(sizeof(*hdr));
     }
     return(-1);
@@ -213,6 +214,99 @@ int32_t NSPV_getaddressutxos(struct NSPV_utxosresp *ptr,char *coinaddr,bool isCC
     return(0);
 }
 
+int32_t NSPV_addressindexkey(uint160 &hashBytes,int32_t &type,char *coinaddr,bool isCC)
+{
+    CBitcoinAddress address(coinaddr);
+    return(address.GetIndexKey(hashBytes,type,isCC) != 0);
+}
+
+// paged NSPV_UTXOS. Without sinceheight the unspent index is walked in txid order from the cursor on, with it
+// the address index from sinceheight on, keeping the outputs that are still unspent. Either way the index is
+// read a page at a time, never the whole history of the address
+int32_t NSPV_getaddressutxospage(struct NSPV_utxosresp *ptr,char *coinaddr,bool isCC,uint32_t filter,int32_t sinceheight,uint256 cursortxid,int32_t cursorvout,int32_t cursorheight)
+{
+    int64_t total = 0,interest = 0; uint32_t locktime,limit; int32_t type,tipheight,txheight,len; uint160 hashBytes; struct NSPV_utxoresp U; std::vector<struct NSPV_utxoresp> utxos;
+    if ( NSPV_addressindexkey(hashBytes,type,coinaddr,isCC) == 0 )
+        return(0);
+    tipheight = chainActive.LastTip()->GetHeight();
+    if ( sinceheight <= 0 )
+    {
+        CAddressUnspentKey cursor(type,hashBytes,cursortxid,cursorvout);
+        while ( utxos.size() < NSPV_PAGESIZE )
+        {
+            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+            limit = NSPV_PAGESIZE - (uint32_t)utxos.size();
+            if ( GetAddressUnspentPage(hashBytes,type,cursor,limit,unspentOutputs) == 0 )
+                return(0);
+            for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
+            {
+                cursor = it->first;
+                if ( myIsutxo_spentinmempool(ignoretxid,ignorevin,it->first.txhash,(int32_t)it->first.index) != 0 )
+                    continue;
+                memset(&U,0,sizeof(U));
+                U.txid = it->first.txhash;
+                U.vout = (int32_t)it->first.index;
+                U.satoshis = it->second.satoshis;
+                U.height = it->second.blockHeight;
+                utxos.push_back(U);
+            }
+            if ( unspentOutputs.size() < limit )
+                break;
+        }
+    }
+    else
+    {
+        CAddressIndexKey cursor(type,hashBytes,cursortxid.IsNull() ? sinceheight : std::max(sinceheight,cursorheight),0,cursortxid,cursorvout,false);
+        while ( utxos.size() < NSPV_PAGESIZE )
+        {
+            std::vector<std::pair<CAddressIndexKey, CAmount> > rows; CAddressUnspentValue value;
+            limit = NSPV_PAGESIZE - (uint32_t)utxos.size();
+            if ( GetAddressIndexPage(hashBytes,type,cursor,limit,rows) == 0 )
+                return(0);
+            for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=rows.begin(); it!=rows.end(); it++)
+            {
+                cursor = it->first;
+                if ( it->first.spending != 0 || GetAddressUnspentValue(CAddressUnspentKey(type,hashBytes,it->first.txhash,it->first.index),value) == 0 )
+                    continue;
+                if ( myIsutxo_spentinmempool(ignoretxid,ignorevin,it->first.txhash,(int32_t)it->first.index) != 0 )
+                    continue;
+                memset(&U,0,sizeof(U));
+                U.txid = it->first.txhash;
+                U.vout = (int32_t)it->first.index;
+                U.satoshis = value.satoshis;
+                U.height = value.blockHeight;
+                utxos.push_back(U);
+            }
+            if ( rows.size() < limit )
+                break;
+        }
+    }
+    strncpy(ptr->coinaddr,coinaddr,sizeof(ptr->coinaddr)-1);
+    ptr->CCflag = isCC;
+    ptr->filter = filter;
+    ptr->nodeheight = tipheight;
+    ptr->skipcount = 0;
+    ptr->numutxos = (uint16_t)utxos.size();
+    if ( ptr->numutxos > 0 )
+    {
+        ptr->utxos = (struct NSPV_utxoresp *)calloc(ptr->numutxos,sizeof(*ptr->utxos));
+        memcpy(ptr->utxos,utxos.data(),ptr->numutxos * sizeof(*ptr->utxos));
+    }
+    for (int32_t i=0; i<ptr->numutxos; i++)
+    {
+        if ( ASSETCHAINS_SYMBOL[0] == 0 && ptr->utxos[i].satoshis >= 10*COIN )
+        {
+            ptr->utxos[i].extradata = komodo_accrued_interest(&txheight,&locktime,ptr->utxos[i].txid,ptr->utxos[i].vout,ptr->utxos[i].height,ptr->utxos[i].satoshis,tipheight);
+            interest += ptr->utxos[i].extradata;
+        }
+        total += ptr->utxos[i].satoshis;
+    }
+    ptr->total = total;
+    ptr->interest = interest;
+    len = (int32_t)(sizeof(*ptr) + sizeof(*ptr->utxos)*ptr->numutxos - sizeof(ptr->utxos));
+    return(len);
+}
+
 class BaseCCChecker {
 public:
     /// base check function
@@ -483,6 +577,33 @@ int32_t NSPV_getaddresstxids(struct NSPV_txidsresp *ptr,char *coinaddr,bool isCC
     return(0);
 }
 
+// paged NSPV_TXIDS, the address index rows from sinceheight or the cursor on
+int32_t NSPV_getaddresstxidspage(struct NSPV_txidsresp *ptr,char *coinaddr,bool isCC,uint32_t filter,int32_t sinceheight,uint256 cursortxid,int32_t cursorvout,int32_t cursorheight)
+{
+    int32_t type,ind = 0; uint160 hashBytes; std::vector<std::pair<CAddressIndexKey, CAmount> > rows;
+    if ( NSPV_addressindexkey(hashBytes,type,coinaddr,isCC) == 0 )
+        return(0);
+    CAddressIndexKey cursor(type,hashBytes,cursortxid.IsNull() ? std::max(sinceheight,0) : std::max(sinceheight,cursorheight),0,cursortxid,cursorvout < 0 ? -1-cursorvout : cursorvout,cursorvout < 0);
+    if ( GetAddressIndexPage(hashBytes,type,cursor,NSPV_PAGESIZE,rows) == 0 )
+        return(0);
+    strncpy(ptr->coinaddr,coinaddr,sizeof(ptr->coinaddr)-1);
+    ptr->CCflag = isCC;
+    ptr->filter = filter;
+    ptr->nodeheight = chainActive.LastTip()->GetHeight();
+    ptr->skipcount = 0;
+    ptr->numtxids = (uint16_t)rows.size();
+    if ( ptr->numtxids > 0 )
+        ptr->txids = (struct NSPV_txidresp *)calloc(ptr->numtxids,sizeof(*ptr->txids));
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=rows.begin(); it!=rows.end(); it++,ind++)
+    {
+        ptr->txids[ind].txid = it->first.txhash;
+        ptr->txids[ind].vout = (int32_t)it->first.index;
+        ptr->txids[ind].satoshis = (int64_t)it->second;
+        ptr->txids[ind].height = (int64_t)it->first.blockHeight;
+    }
+    return((int32_t)(sizeof(*ptr) + sizeof(*ptr->txids)*ptr->numtxids - sizeof(ptr->txids)));
+}
+
 int32_t NSPV_mempoolfuncs(bits256 *satoshisp,int32_t *vindexp,std::vector<uint256> &txids,char *coinaddr,bool isCC,uint8_t funcid,uint256 txid,int32_t vout)
 {
     int32_t num = 0,vini = 0,vouti = 0; uint8_t evalcode=0,func=0;  std::vector<uint8_t> vopret; char destaddr[64];
@@ -758,9 +879,129 @@ int32_t NSPV_sendrawtransaction(struct NSPV_broadcastresp *ptr,uint8_t *data,int
     return(sizeof(*ptr));
 }
 
+// light wallets keep asking for proofs of the same recent txs and notarisation brackets
+#define NSPV_MERKLECACHE_BLOCKS 64
+#define NSPV_NTZSPROOFCACHE_SIZE (32 * 1024 * 1024)
+
+/** The full merkle tree of a block recently asked for tx proofs, all proofs of the block are cut from it */
+struct NSPV_merkletree
+{
+    CBlockHeader header;
+    std::vector<std::vector<uint256> > levels;
+    std::map<uint256,uint32_t> txpos;
+};
+
+/** A serialized NSPV_NTZSPROOFRESP and the blocks it was built from, by height */
+struct NSPV_ntzsproofentry
+{
+    std::vector<uint8_t> response;
+    std::vector<std::pair<int32_t,uint256> > blocks;
+};
+
+typedef std::list<std::pair<uint256,std::shared_ptr<const NSPV_merkletree> > > NSPV_merklelist;
+typedef std::list<std::pair<std::pair<uint256,uint256>,NSPV_ntzsproofentry> > NSPV_ntzsprooflist;
+
+static CCriticalSection cs_NSPV_cache;
+// most recently used first. Trees are keyed by block hash, a reorged block is never asked for again and ages out
+static NSPV_merklelist NSPV_merklelru;
+static std::map<uint256,NSPV_merklelist::iterator> NSPV_merklecache;
+static NSPV_ntzsprooflist NSPV_ntzsprooflru;
+static std::map<std::pair<uint256,uint256>,NSPV_ntzsprooflist::iterator> NSPV_ntzsproofcache;
+static size_t NSPV_ntzsproofcachesize;
+
+std::shared_ptr<const NSPV_merkletree> NSPV_getmerkletree(CBlockIndex *pindex)
+{
+    CBlock block; std::vector<uint256> vTxid; uint256 hash = pindex->GetBlockHash();
+    {
+        LOCK(cs_NSPV_cache);
+        std::map<uint256,NSPV_merklelist::iterator>::iterator it = NSPV_merklecache.find(hash);
+        if ( it != NSPV_merklecache.end() )
+        {
+            NSPV_merklelru.splice(NSPV_merklelru.begin(),NSPV_merklelru,it->second);
+            return(it->second->second);
+        }
+    }
+    if ( komodo_blockload(block,pindex) != 0 )
+        return(nullptr);
+    std::shared_ptr<NSPV_merkletree> tree = std::make_shared<NSPV_merkletree>();
+    tree->header = block.GetBlockHeader();
+    vTxid.reserve(block.vtx.size());
+    for (uint32_t i=0; i<block.vtx.size(); i++)
+    {
+        vTxid.push_back(block.vtx[i].GetHash());
+        tree->txpos[vTxid.back()] = i;
+    }
+    tree->levels = BuildMerkleLevels(vTxid);
+    LOCK(cs_NSPV_cache);
+    if ( NSPV_merklecache.count(hash) == 0 )
+    {
+        NSPV_merklelru.push_front(std::make_pair(hash,tree));
+        NSPV_merklecache[hash] = NSPV_merklelru.begin();
+        while ( NSPV_merklelru.size() > NSPV_MERKLECACHE_BLOCKS )
+        {
+            NSPV_merklecache.erase(NSPV_merklelru.back().first);
+            NSPV_merklelru.pop_back();
+        }
+    }
+    return(tree);
+}
+
+// a cached bundle is only served while all the blocks it was built from are still in the active chain
+int32_t NSPV_ntzsproofcached(std::vector<uint8_t> &response,uint256 prevntztxid,uint256 nextntztxid)
+{
+    CBlockIndex *pindex; int32_t i;
+    LOCK(cs_NSPV_cache);
+    std::map<std::pair<uint256,uint256>,NSPV_ntzsprooflist::iterator>::iterator it = NSPV_ntzsproofcache.find(std::make_pair(prevntztxid,nextntztxid));
+    if ( it == NSPV_ntzsproofcache.end() )
+        return(0);
+    const NSPV_ntzsproofentry &entry = it->second->second;
+    for (i=0; i<entry.blocks.size(); i++)
+    {
+        if ( (pindex= komodo_chainactive(entry.blocks[i].first)) == 0 || pindex->GetBlockHash() != entry.blocks[i].second )
+        {
+            NSPV_ntzsproofcachesize -= entry.response.size();
+            NSPV_ntzsprooflru.erase(it->second);
+            NSPV_ntzsproofcache.erase(it);
+            return(0);
+        }
+    }
+    NSPV_ntzsprooflru.splice(NSPV_ntzsprooflru.begin(),NSPV_ntzsprooflru,it->second);
+    response = entry.response;
+    return(1);
+}
+
+void NSPV_ntzsproofcacheadd(const std::vector<uint8_t> &response,const struct NSPV_ntzsproofresp *ptr)
+{
+    NSPV_ntzsproofentry entry; CBlockIndex *pindex; int32_t i,heights[4];
+    std::pair<uint256,uint256> key = std::make_pair(ptr->prevtxid,ptr->nexttxid);
+    if ( response.size() > NSPV_NTZSPROOFCACHE_SIZE/16 )
+        return;
+    // the headers of prevht..nextht are chained, so their last block stands for all of them
+    heights[0] = ptr->common.prevht, heights[1] = ptr->common.nextht, heights[2] = ptr->prevtxidht, heights[3] = ptr->nexttxidht;
+    for (i=0; i<4; i++)
+    {
+        if ( (pindex= komodo_chainactive(heights[i])) == 0 )
+            return;
+        entry.blocks.push_back(std::make_pair(heights[i],pindex->GetBlockHash()));
+    }
+    entry.response = response;
+    LOCK(cs_NSPV_cache);
+    if ( NSPV_ntzsproofcache.count(key) != 0 )
+        return;
+    NSPV_ntzsprooflru.push_front(std::make_pair(key,entry));
+    NSPV_ntzsproofcache[key] = NSPV_ntzsprooflru.begin();
+    NSPV_ntzsproofcachesize += response.size();
+    while ( NSPV_ntzsproofcachesize > NSPV_NTZSPROOFCACHE_SIZE )
+    {
+        NSPV_ntzsproofcachesize -= NSPV_ntzsprooflru.back().second.response.size();
+        NSPV_ntzsproofcache.erase(NSPV_ntzsprooflru.back().first);
+        NSPV_ntzsprooflru.pop_back();
+    }
+}
+
 int32_t NSPV_gettxproof(struct NSPV_txproof *ptr,int32_t vout,uint256 txid,int32_t height)
 {
-    int32_t flag = 0,len = 0; CTransaction _tx; uint256 hashBlock; CBlock block; CBlockIndex *pindex;
+    int32_t len = 0; CTransaction _tx; uint256 hashBlock; CBlockIndex *pindex; std::shared_ptr<const NSPV_merkletree> tree;
     ptr->height = -1;
     if ( (ptr->tx= NSPV_getrawtx(_tx,hashBlock,&ptr->txlen,txid)) != 0 )
     {
@@ -772,22 +1013,13 @@ int32_t NSPV_gettxproof(struct NSPV_txproof *ptr,int32_t vout,uint256 txid,int32
         else
         {
             ptr->height = height;
-            if ( (pindex= komodo_chainactive(height)) != 0 && komodo_blockload(block,pindex) == 0 )
+            if ( (pindex= komodo_chainactive(height)) != 0 && (tree= NSPV_getmerkletree(pindex)) != 0 )
             {
-                BOOST_FOREACH(const CTransaction&tx, block.vtx)
+                std::map<uint256,uint32_t>::const_iterator it = tree->txpos.find(txid);
+                if ( it != tree->txpos.end() )
                 {
-                    if ( tx.GetHash() == txid )
-                    {
-                        flag = 1;
-                        break;
-                    }
-                }
-                if ( flag != 0 )
-                {
-                    set<uint256> setTxids;
                     CDataStream ssMB(SER_NETWORK, PROTOCOL_VERSION);
-                    setTxids.insert(txid);
-                    CMerkleBlock mb(block, setTxids);
+                    CMerkleBlock mb(tree->header,CPartialMerkleTree(tree->levels,it->second));
                     ssMB << mb;
                     std::vector<uint8_t> proof(ssMB.begin(), ssMB.end());
                     ptr->txprooflen = (int32_t)proof.size();
@@ -911,28 +1143,43 @@ void komodo_nSPVreq(CNode *pfrom,std::vector<uint8_t> request) // received a req
             if ( timestamp > pfrom->prevtimes[ind] )
             {
                 struct NSPV_utxosresp U;
-                if ( len < 64+5 && (request[1] == len-3 || request[1] == len-7 || request[1] == len-11) )
+                if ( (len < 64+5 && (request[1] == len-3 || request[1] == len-7 || request[1] == len-11)) || (len < 64+2+NSPV_PAGEDREQLEN && request[1] == len-2-NSPV_PAGEDREQLEN) )
                 {
-                    int32_t skipcount = 0; char coinaddr[64]; uint8_t filter; uint8_t isCC = 0;
+                    int32_t skipcount = 0,sinceheight = 0,cursorvout = 0,cursorheight = 0; char coinaddr[64]; uint8_t filter; uint8_t isCC = 0; uint256 cursortxid;
                     memcpy(coinaddr,&request[2],request[1]);
                     coinaddr[request[1]] = 0;
-                    if ( request[1] == len-3 )
-                        isCC = (request[len-1] != 0);
-                    else if ( request[1] == len-7 )
+                    if ( request[1] == len-2-NSPV_PAGEDREQLEN )
                     {
-                        isCC = (request[len-5] != 0);
-                        iguana_rwnum(0,&request[len-4],sizeof(skipcount),&skipcount);
+                        isCC = (request[len-53] != 0);
+                        iguana_rwnum(0,&request[len-48],sizeof(filter),&filter);
+                        iguana_rwnum(0,&request[len-44],sizeof(sinceheight),&sinceheight);
+                        iguana_rwbignum(0,&request[len-40],sizeof(cursortxid),(uint8_t *)&cursortxid);
+                        iguana_rwnum(0,&request[len-8],sizeof(cursorvout),&cursorvout);
+                        iguana_rwnum(0,&request[len-4],sizeof(cursorheight),&cursorheight);
+                        memset(&U,0,sizeof(U));
+                        slen = NSPV_getaddressutxospage(&U,coinaddr,isCC,filter,sinceheight,cursortxid,cursorvout,cursorheight);
                     }
                     else
                     {
-                        isCC = (request[len-9] != 0);
-                        iguana_rwnum(0,&request[len-8],sizeof(skipcount),&skipcount);
-                        iguana_rwnum(0,&request[len-4],sizeof(filter),&filter);
+                        if ( request[1] == len-3 )
+                            isCC = (request[len-1] != 0);
+                        else if ( request[1] == len-7 )
+                        {
+                            isCC = (request[len-5] != 0);
+                            iguana_rwnum(0,&request[len-4],sizeof(skipcount),&skipcount);
+                        }
+                        else
+                        {
+                            isCC = (request[len-9] != 0);
+                            iguana_rwnum(0,&request[len-8],sizeof(skipcount),&skipcount);
+                            iguana_rwnum(0,&request[len-4],sizeof(filter),&filter);
+                        }
+                        if ( 0 && isCC != 0 )
+                            fprintf(stderr,"utxos %s isCC.%d skipcount.%d filter.%x\n",coinaddr,isCC,skipcount,filter);
+                        memset(&U,0,sizeof(U));
+                        slen = NSPV_getaddressutxos(&U,coinaddr,isCC,skipcount,filter);
                     }
-                    if ( 0 && isCC != 0 )
-                        fprintf(stderr,"utxos %s isCC.%d skipcount.%d filter.%x\n",coinaddr,isCC,skipcount,filter);
-                    memset(&U,0,sizeof(U));
-                    if ( (slen= NSPV_getaddressutxos(&U,coinaddr,isCC,skipcount,filter)) > 0 )
+                    if ( slen > 0 )
                     {
                         response.resize(1 + slen);
                         response[0] = NSPV_UTXOSRESP;
@@ -951,28 +1198,43 @@ void komodo_nSPVreq(CNode *pfrom,std::vector<uint8_t> request) // received a req
             if ( timestamp > pfrom->prevtimes[ind] )
             {
                 struct NSPV_txidsresp T;
-                if ( len < 64+5 && (request[1] == len-3 || request[1] == len-7 || request[1] == len-11) )
+                if ( (len < 64+5 && (request[1] == len-3 || request[1] == len-7 || request[1] == len-11)) || (len < 64+2+NSPV_PAGEDREQLEN && request[1] == len-2-NSPV_PAGEDREQLEN) )
                 {
-                    int32_t skipcount = 0; char coinaddr[64]; uint32_t filter; uint8_t isCC = 0;
+                    int32_t skipcount = 0,sinceheight = 0,cursorvout = 0,cursorheight = 0; char coinaddr[64]; uint32_t filter; uint8_t isCC = 0; uint256 cursortxid;
                     memcpy(coinaddr,&request[2],request[1]);
                     coinaddr[request[1]] = 0;
-                    if ( request[1] == len-3 )
-                        isCC = (request[len-1] != 0);
-                    else if ( request[1] == len-7 )
+                    if ( request[1] == len-2-NSPV_PAGEDREQLEN )
                     {
-                        isCC = (request[len-5] != 0);
-                        iguana_rwnum(0,&request[len-4],sizeof(skipcount),&skipcount);
+                        isCC = (request[len-53] != 0);
+                        iguana_rwnum(0,&request[len-48],sizeof(filter),&filter);
+                        iguana_rwnum(0,&request[len-44],sizeof(sinceheight),&sinceheight);
+                        iguana_rwbignum(0,&request[len-40],sizeof(cursortxid),(uint8_t *)&cursortxid);
+                        iguana_rwnum(0,&request[len-8],sizeof(cursorvout),&cursorvout);
+                        iguana_rwnum(0,&request[len-4],sizeof(cursorheight),&cursorheight);
+                        memset(&T,0,sizeof(T));
+                        slen = NSPV_getaddresstxidspage(&T,coinaddr,isCC,filter,sinceheight,cursortxid,cursorvout,cursorheight);
                     }
                     else
                     {
-                        isCC = (request[len-9] != 0);
-                        iguana_rwnum(0,&request[len-8],sizeof(skipcount),&skipcount);
-                        iguana_rwnum(0,&request[len-4],sizeof(filter),&filter);
+                        if ( request[1] == len-3 )
+                            isCC = (request[len-1] != 0);
+                        else if ( request[1] == len-7 )
+                        {
+                            isCC = (request[len-5] != 0);
+                            iguana_rwnum(0,&request[len-4],sizeof(skipcount),&skipcount);
+                        }
+                        else
+                        {
+                            isCC = (request[len-9] != 0);
+                            iguana_rwnum(0,&request[len-8],sizeof(skipcount),&skipcount);
+                            iguana_rwnum(0,&request[len-4],sizeof(filter),&filter);
+                        }
+                        if ( 0 && isCC != 0 )
+                            fprintf(stderr,"txids %s isCC.%d skipcount.%d filter.%d\n",coinaddr,isCC,skipcount,filter);
+                        memset(&T,0,sizeof(T));
+                        slen = NSPV_getaddresstxids(&T,coinaddr,isCC,skipcount,filter);
                     }
-                    if ( 0 && isCC != 0 )
-                        fprintf(stderr,"txids %s isCC.%d skipcount.%d filter.%d\n",coinaddr,isCC,skipcount,filter);
-                    memset(&T,0,sizeof(T));
-                    if ( (slen= NSPV_getaddresstxids(&T,coinaddr,isCC,skipcount,filter)) > 0 )
+                    if ( slen > 0 )
                     {
 //fprintf(stderr,"slen.%d\n",slen);
                         response.resize(1 + slen);
@@ -1057,13 +1319,19 @@ void komodo_nSPVreq(CNode *pfrom,std::vector<uint8_t> request) // received a req
                     iguana_rwbignum(0,&request[1],sizeof(prevntz),(uint8_t *)&prevntz);
                     iguana_rwbignum(0,&request[1+sizeof(prevntz)],sizeof(nextntz),(uint8_t *)&nextntz);
                     memset(&P,0,sizeof(P));
-                    if ( (slen= NSPV_getntzsproofresp(&P,prevntz,nextntz)) > 0 )
+                    if ( NSPV_ntzsproofcached(response,prevntz,nextntz) != 0 )
+                    {
+                        pfrom->PushMessage("nSPV",response);
+                        pfrom->prevtimes[ind] = timestamp;
+                    }
+                    else if ( (slen= NSPV_getntzsproofresp(&P,prevntz,nextntz)) > 0 )
                     {
                         // fprintf(stderr,"slen.%d msg prev.%s next.%s\n",slen,prevntz.GetHex().c_str(),nextntz.GetHex().c_str());
                         response.resize(1 + slen);
                         response[0] = NSPV_NTZSPROOFRESP;
                         if ( NSPV_rwntzsproofresp(1,&response[1],&P) == slen )
                         {
+                            NSPV_ntzsproofcacheadd(response,&P);
                             pfrom->PushMessage("nSPV",response);
                             pfrom->prevtimes[ind] = timestamp;
                         }
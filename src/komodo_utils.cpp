@@ -15,20 +15,20 @@
 #include "komodo_utils.h"
 #include "komodo_extern_globals.h"
 #include "komodo_notary.h"
+#include "hash.h"
 
+// routed through CSHA256 so the transform picked by SHA256AutoDetect() is used
 void vcalc_sha256(char deprecated[(256 >> 3) * 2 + 1],uint8_t hash[256 >> 3],uint8_t *src,int32_t len)
 {
-    struct sha256_vstate md;
-    sha256_vinit(&md);
-    sha256_vprocess(&md,src,len);
-    sha256_vdone(&md,hash);
+    CSHA256().Write(src,len).Finalize(hash);
 }
 
 bits256 bits256_doublesha256(char *deprecated,uint8_t *data,int32_t datalen)
 {
     bits256 hash,hash2; int32_t i;
-    vcalc_sha256(0,hash.bytes,data,datalen);
-    vcalc_sha256(0,hash2.bytes,hash.bytes,sizeof(hash));
+    if ( datalen == 64 )
+        SHA256D64(hash2.bytes,data,1);
+    else CHash256().Write(data,datalen).Finalize(hash2.bytes);
     for (i=0; i<sizeof(hash); i++)
         hash.bytes[i] = hash2.bytes[sizeof(hash) - 1 - i];
     return(hash);
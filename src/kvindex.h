@@ -0,0 +1,103 @@
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_KVINDEX_H
+#define BITCOIN_KVINDEX_H
+
+#include "serialize.h"
+#include "uint256.h"
+
+#include <map>
+#include <vector>
+
+class CTransaction;
+
+/** Current value of a komodo_kv key, as set by the last 'K' opreturn */
+struct CKVEntry {
+    uint256 pubkey;
+    uint32_t flags;
+    int32_t height;
+    std::vector<uint8_t> value;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(pubkey);
+        READWRITE(flags);
+        READWRITE(height);
+        READWRITE(value);
+    }
+
+    CKVEntry() {
+        SetNull();
+    }
+
+    /** A null entry stands for a key without value, in undo records and pending updates */
+    void SetNull() {
+        pubkey.SetNull();
+        flags = 0;
+        height = -1;
+        value.clear();
+    }
+
+    bool IsNull() const {
+        return height == -1;
+    }
+};
+
+/**
+ * Expiry bucket of a key. The expiry height is stored big-endian so that the
+ * keys expiring up to a height can be swept with a single scan.
+ */
+struct CKVExpiryKey {
+    int expiryHeight;
+    std::vector<uint8_t> key;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 4 + ::GetSerializeSize(key, nType, nVersion);
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata32be(s, expiryHeight);
+        ::Serialize(s, key);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        expiryHeight = ser_readdata32be(s);
+        ::Unserialize(s, key);
+    }
+
+    CKVExpiryKey() {
+        expiryHeight = 0;
+    }
+
+    CKVExpiryKey(int expiryHeightIn, const std::vector<uint8_t> &keyIn) {
+        expiryHeight = expiryHeightIn;
+        key = keyIn;
+    }
+};
+
+/** Values the keys updated by a block had before it, null if they had none */
+typedef std::vector<std::pair<std::vector<uint8_t>, CKVEntry> > CKVUndo;
+
+/** Changes to the kv table written to the block tree db in one batch */
+struct CKVBatch {
+    //! A null entry erases the key
+    std::vector<std::pair<std::vector<uint8_t>, CKVEntry> > vEntries;
+    std::vector<CKVExpiryKey> vExpiryErase;
+    std::vector<CKVExpiryKey> vExpiryWrite;
+    //! An empty record erases the undo data of that height
+    std::map<int, CKVUndo> mapUndo;
+    int nBestHeight;
+    uint256 hashBestBlock;
+
+    CKVBatch() {
+        nBestHeight = 0;
+    }
+};
+
+/** The kv updates a mempool transaction would make, see komodo_kv.cpp */
+void GetKVIndexEntries(const CTransaction &tx, std::vector<std::pair<std::vector<uint8_t>, CKVEntry> > &vect);
+
+#endif // BITCOIN_KVINDEX_H
@@ -32,6 +32,7 @@
 #include "checkqueue.h"
 #include "consensus/upgrades.h"
 #include "consensus/validation.h"
+#include "core_memusage.h"
 #include "deprecation.h"
 #include "init.h"
 #include "merkleblock.h"
@@ -58,9 +59,15 @@
 #include <atomic>
 #include <sstream>
 #include <map>
+#include <memory>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
+#ifndef WIN32
+#include <fcntl.h>
+#endif
+
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/fstream.hpp>
@@ -75,6 +82,7 @@ using namespace std;
 #endif
 
 #include "librustzcash.h"
+#include "rust/metrics.h"
 
 /**
  * Global state
@@ -107,6 +115,9 @@ bool fArchive = true;
 bool fAddressIndex = false;
 bool fTimestampIndex = false;
 bool fSpentIndex = false;
+bool fTokenIndex = false;
+bool fOraclesIndex = false;
+bool fCCIndex = false;
 bool fHavePruned = false;
 bool fPruneMode = false;
 bool fIsBareMultisigStd = true;
@@ -115,6 +126,7 @@ bool fCheckpointsEnabled = true;
 bool fCoinbaseEnforcedProtectionEnabled = true;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
+int nPrefetchBlocks = DEFAULT_PREFETCH_BLOCKS;
 bool fAlerts = DEFAULT_ALERTS;
 /* If the tip is older than this (in seconds), the node is considered to be in initial block download.
  */
@@ -127,6 +139,7 @@ CFeeRate minRelayTxFee = CFeeRate(DEFAULT_MIN_RELAY_TX_FEE);
 
 CTxMemPool mempool(::minRelayTxFee);
 CTxMemPool tmpmempool(::minRelayTxFee);
+CTxCache txCache(DEFAULT_TXCACHE_SIZE << 20);
 
 struct COrphanTx {
     CTransaction tx;
@@ -1173,6 +1186,62 @@ bool ContextualCheckCoinbaseTransaction(int32_t slowflag,const CBlock *block,CBl
     return(true);
 }
 
+/** Check the Sapling spend and output proofs and the binding signature of a transaction */
+static bool CheckSaplingBundle(const CTransaction& tx, const uint256& dataToBeSigned, CValidationState &state)
+{
+    auto ctx = librustzcash_sapling_verification_ctx_init();
+
+    for (const SpendDescription &spend : tx.vShieldedSpend) {
+        if (!librustzcash_sapling_check_spend(
+            ctx,
+            spend.cv.begin(),
+            spend.anchor.begin(),
+            spend.nullifier.begin(),
+            spend.rk.begin(),
+            spend.zkproof.begin(),
+            spend.spendAuthSig.begin(),
+            dataToBeSigned.begin()
+        ))
+        {
+            librustzcash_sapling_verification_ctx_free(ctx);
+            return state.DoS(100, error("ContextualCheckTransaction(): Sapling spend description invalid"),
+                                  REJECT_INVALID, "bad-txns-sapling-spend-description-invalid");
+        }
+    }
+
+    for (const OutputDescription &output : tx.vShieldedOutput) {
+        if (!librustzcash_sapling_check_output(
+            ctx,
+            output.cv.begin(),
+            output.cmu.begin(),
+            output.ephemeralKey.begin(),
+            output.zkproof.begin()
+        ))
+        {
+            librustzcash_sapling_verification_ctx_free(ctx);
+            return state.DoS(100, error("ContextualCheckTransaction(): Sapling output description invalid"),
+                                  REJECT_INVALID, "bad-txns-sapling-output-description-invalid");
+        }
+    }
+
+    if (!librustzcash_sapling_final_check(
+        ctx,
+        tx.valueBalance,
+        tx.bindingSig.begin(),
+        dataToBeSigned.begin()
+    ))
+    {
+        librustzcash_sapling_verification_ctx_free(ctx);
+        return state.DoS(100, error("ContextualCheckTransaction(): Sapling binding signature invalid"),
+                              REJECT_INVALID, "bad-txns-sapling-binding-signature-invalid");
+    }
+
+    librustzcash_sapling_verification_ctx_free(ctx);
+    MetricsCounter("eskenas.proofs.verified", tx.vShieldedSpend.size(), "type", "sapling_spend");
+    MetricsCounter("eskenas.proofs.verified", tx.vShieldedOutput.size(), "type", "sapling_output");
+    return true;
+}
+
 /**
  * Check a transaction contextually against a set of consensus rules valid at a given block height.
  *
@@ -1187,7 +1256,8 @@ bool ContextualCheckTransaction(int32_t slowflag,const CBlock *block, CBlockInde
         CValidationState &state,
         const int nHeight,
         const int dosLevel,
-        bool (*isInitBlockDownload)(),int32_t validateprices)
+        bool (*isInitBlockDownload)(),int32_t validateprices,
+        std::vector<CBlockCheck> *pvChecks)
 {
     bool overwinterActive = NetworkUpgradeActive(nHeight, Params().GetConsensus(), Consensus::UPGRADE_OVERWINTER);
     bool saplingActive = NetworkUpgradeActive(nHeight, Params().GetConsensus(), Consensus::UPGRADE_SAPLING);
@@ -1331,54 +1401,16 @@ bool ContextualCheckTransaction(int32_t slowflag,const CBlock *block, CBlockInde
     if (!tx.vShieldedSpend.empty() ||
         !tx.vShieldedOutput.empty())
     {
-        auto ctx = librustzcash_sapling_verification_ctx_init();
-
-        for (const SpendDescription &spend : tx.vShieldedSpend) {
-            if (!librustzcash_sapling_check_spend(
-                ctx,
-                spend.cv.begin(),
-                spend.anchor.begin(),
-                spend.nullifier.begin(),
-                spend.rk.begin(),
-                spend.zkproof.begin(),
-                spend.spendAuthSig.begin(),
-                dataToBeSigned.begin()
-            ))
-            {
-                librustzcash_sapling_verification_ctx_free(ctx);
-                return state.DoS(100, error("ContextualCheckTransaction(): Sapling spend description invalid"),
-                                      REJECT_INVALID, "bad-txns-sapling-spend-description-invalid");
-            }
-        }
-
-        for (const OutputDescription &output : tx.vShieldedOutput) {
-            if (!librustzcash_sapling_check_output(
-                ctx,
-                output.cv.begin(),
-                output.cmu.begin(),
-                output.ephemeralKey.begin(),
-                output.zkproof.begin()
-            ))
-            {
-                librustzcash_sapling_verification_ctx_free(ctx);
-                return state.DoS(100, error("ContextualCheckTransaction(): Sapling output description invalid"),
-                                      REJECT_INVALID, "bad-txns-sapling-output-description-invalid");
-            }
-        }
-
-        if (!librustzcash_sapling_final_check(
-            ctx,
-            tx.valueBalance,
-            tx.bindingSig.begin(),
-            dataToBeSigned.begin()
-        ))
-        {
-            librustzcash_sapling_verification_ctx_free(ctx);
-            return state.DoS(100, error("ContextualCheckTransaction(): Sapling binding signature invalid"),
-                                  REJECT_INVALID, "bad-txns-sapling-binding-signature-invalid");
+        if (pvChecks) {
+            // Verified on the check queue along with the rest of the block
+            const CTransaction *ptx = &tx;
+            pvChecks->push_back(CBlockCheck([ptx, dataToBeSigned]() {
+                CValidationState stateDummy;
+                return CheckSaplingBundle(*ptx, dataToBeSigned, stateDummy);
+            }));
+        } else if (!CheckSaplingBundle(tx, dataToBeSigned, state)) {
+            return false;
         }
-
-        librustzcash_sapling_verification_ctx_free(ctx);
     }
     return true;
 }
@@ -1431,6 +1463,7 @@ bool CheckTransaction(uint32_t tiptime,const CTransaction& tx, CValidationState
                 return state.DoS(100, error("CheckTransaction(): joinsplit does not verify"),
                                  REJECT_INVALID, "bad-txns-joinsplit-verification-failed");
             }
+            MetricsIncrementCounter("eskenas.proofs.verified", "type", "sprout_joinsplit");
         }
         return true;
     }
@@ -2125,6 +2158,14 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
                 if (fSpentIndex) {
                     pool.addSpentIndex(entry, view);
                 }
+
+                // Add memory cc index
+                if (fCCIndex) {
+                    pool.addEvalIndex(entry);
+                }
+
+                // Add memory kv updates
+                pool.addKVIndex(entry);
             }
         }
     }
@@ -2192,6 +2233,92 @@ bool GetAddressUnspent(uint160 addressHash, int type,
     return true;
 }
 
+bool GetAddressIndexPage(uint160 addressHash, int type, const CAddressIndexKey &cursor, unsigned int nLimit,
+                         std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressIndex(addressHash, type, cursor, nLimit, addressIndex))
+        return error("unable to get txids for address");
+
+    return true;
+}
+
+bool GetAddressUnspentPage(uint160 addressHash, int type, const CAddressUnspentKey &cursor, unsigned int nLimit,
+                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, cursor, nLimit, unspentOutputs))
+        return error("unable to get txids for address");
+
+    return true;
+}
+
+bool GetAddressUnspentValue(const CAddressUnspentKey &key, CAddressUnspentValue &value)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    return pblocktree->ReadAddressUnspentValue(key, value);
+}
+
+bool GetOracleSamples(uint256 oracletxid, uint160 batonHash, int32_t num,
+                      std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > > &samples)
+{
+    if (!fOraclesIndex)
+        return error("oracles index not enabled");
+
+    if (!pblocktree->ReadOracleSampleIndex(oracletxid, batonHash, num, samples))
+        return error("unable to get samples for oracle");
+
+    return true;
+}
+
+bool GetCCEvalIndex(uint8_t evalcode, uint8_t funcid, uint256 reftxid, std::vector<CEvalIndexKey> &keys)
+{
+    if (!fCCIndex)
+        return error("cc index not enabled");
+
+    size_t first = keys.size();
+    if (!pblocktree->ReadEvalIndex(evalcode, funcid, reftxid, keys))
+        return error("unable to get txids for evalcode");
+
+    // only a full prefix scan is in chain order already
+    if (funcid == 0 || reftxid.IsNull())
+        std::sort(keys.begin() + first, keys.end(), [](const CEvalIndexKey &a, const CEvalIndexKey &b) {
+            return a.blockHeight != b.blockHeight ? a.blockHeight < b.blockHeight : a.txindex < b.txindex;
+        });
+
+    return true;
+}
+
+bool GetTokenUnspent(uint256 tokenid,
+                     std::vector<std::pair<CTokenUnspentKey, CAddressUnspentValue> > &unspentOutputs)
+{
+    if (!fTokenIndex)
+        return error("token index not enabled");
+
+    if (!pblocktree->ReadTokenUnspentIndex(tokenid, unspentOutputs))
+        return error("unable to get unspent outputs for token");
+
+    return true;
+}
+
+bool GetTokenUnspent(uint256 tokenid, uint160 addressHash, int type,
+                     std::vector<std::pair<CTokenUnspentKey, CAddressUnspentValue> > &unspentOutputs)
+{
+    if (!fTokenIndex)
+        return error("token index not enabled");
+
+    if (!pblocktree->ReadTokenUnspentIndex(tokenid, addressHash, type, unspentOutputs))
+        return error("unable to get unspent outputs for token and address");
+
+    return true;
+}
+
 struct CompareBlocksByHeightMain
 {
     bool operator()(const CBlockIndex* a, const CBlockIndex* b) const
@@ -2234,6 +2361,101 @@ bool myAddtomempool(CTransaction &tx, CValidationState *pstate, bool fSkipExpiry
     else return(true);
 }
 
+#ifndef WIN32
+/**
+ * Read-only descriptors of recently used block files. Transaction lookups
+ * share them through pread() instead of opening and seeking a fresh FILE*
+ * on every call.
+ */
+class CBlockFileDescriptorPool
+{
+public:
+    struct CFileDescriptor {
+        int fd;
+        CFileDescriptor(int fdIn) : fd(fdIn) {}
+        ~CFileDescriptor() { close(fd); }
+    };
+
+private:
+    static const size_t MAX_OPEN_FILES = 32;
+
+    CCriticalSection cs;
+    //! nFile -> (descriptor, last use)
+    std::map<int, std::pair<std::shared_ptr<CFileDescriptor>, uint64_t>> mapFiles;
+    uint64_t nUseCounter = 0;
+
+public:
+    /** Returns the open descriptor of block file nFile, or null. The handle keeps it open while in use. */
+    std::shared_ptr<CFileDescriptor> Get(int nFile)
+    {
+        LOCK(cs);
+        auto it = mapFiles.find(nFile);
+        if (it != mapFiles.end()) {
+            it->second.second = ++nUseCounter;
+            return it->second.first;
+        }
+
+        boost::filesystem::path path = GetBlockPosFilename(CDiskBlockPos(nFile, 0), "blk");
+        int fd = open(path.string().c_str(), O_RDONLY);
+        if (fd < 0)
+            return nullptr;
+
+        if (mapFiles.size() >= MAX_OPEN_FILES) {
+            auto itOldest = mapFiles.begin();
+            for (auto itFile = mapFiles.begin(); itFile != mapFiles.end(); ++itFile) {
+                if (itFile->second.second < itOldest->second.second)
+                    itOldest = itFile;
+            }
+            mapFiles.erase(itOldest);
+        }
+        std::shared_ptr<CFileDescriptor> file = std::make_shared<CFileDescriptor>(fd);
+        mapFiles[nFile] = std::make_pair(file, ++nUseCounter);
+        return file;
+    }
+
+    void Remove(int nFile)
+    {
+        LOCK(cs);
+        mapFiles.erase(nFile);
+    }
+};
+
+static CBlockFileDescriptorPool blockFileDescriptors;
+#endif
+
+/** Read the transaction at postx, and the hash of the block it is in, from the block files */
+static bool ReadTransactionFromDisk(const CDiskTxPos& postx, CTransaction& txOut, uint256& hashBlock)
+{
+    CBlockHeader header;
+#ifndef WIN32
+    auto blockFile = blockFileDescriptors.Get(postx.nFile);
+    if (blockFile) {
+        CPreadFile filein(blockFile->fd, postx.nPos, 8192, SER_DISK, CLIENT_VERSION);
+        try {
+            filein >> header;
+            filein.ignore(postx.nTxOffset);
+            filein >> txOut;
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        }
+        hashBlock = header.GetHash();
+        return true;
+    }
+#endif
+    CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
+    if (file.IsNull())
+        return error("%s: OpenBlockFile failed", __func__);
+    try {
+        file >> header;
+        fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
+        file >> txOut;
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+    }
+    hashBlock = header.GetHash();
+    return true;
+}
+
 bool myGetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock)
 {
     memset(&hashBlock,0,sizeof(hashBlock));
@@ -2261,25 +2483,16 @@ bool myGetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlo
     //fprintf(stderr,"check disk %s\n",hash.GetHex().c_str());
 
     if (fTxIndex) {
+        if (txCache.Get(hash, txOut, hashBlock))
+            return true;
         CDiskTxPos postx;
         //fprintf(stderr,"ReadTxIndex\n");
         if (pblocktree->ReadTxIndex(hash, postx)) {
-            //fprintf(stderr,"OpenBlockFile\n");
-            CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-            if (file.IsNull())
-                return error("%s: OpenBlockFile failed", __func__);
-            CBlockHeader header;
-            //fprintf(stderr,"seek and read\n");
-            try {
-                file >> header;
-                fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
-                file >> txOut;
-            } catch (const std::exception& e) {
-                return error("%s: Deserialize or I/O error - %s", __func__, e.what());
-            }
-            hashBlock = header.GetHash();
+            if (!ReadTransactionFromDisk(postx, txOut, hashBlock))
+                return false;
             if (txOut.GetHash() != hash)
                 return error("%s: txid mismatch", __func__);
+            txCache.Add(txOut, hashBlock);
             //fprintf(stderr,"found on disk %s\n",hash.GetHex().c_str());
             return true;
         }
@@ -2320,22 +2533,15 @@ bool GetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock
     }
 
     if (fTxIndex) {
+        if (txCache.Get(hash, txOut, hashBlock))
+            return true;
         CDiskTxPos postx;
         if (pblocktree->ReadTxIndex(hash, postx)) {
-            CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-            if (file.IsNull())
-                return error("%s: OpenBlockFile failed", __func__);
-            CBlockHeader header;
-            try {
-                file >> header;
-                fseek(file.Get(), postx.nTxOffset, SEEK_CUR);
-                file >> txOut;
-            } catch (const std::exception& e) {
-                return error("%s: Deserialize or I/O error - %s", __func__, e.what());
-            }
-            hashBlock = header.GetHash();
+            if (!ReadTransactionFromDisk(postx, txOut, hashBlock))
+                return false;
             if (txOut.GetHash() != hash)
                 return error("%s: txid mismatch", __func__);
+            txCache.Add(txOut, hashBlock);
             return true;
         }
     }
@@ -2458,6 +2664,189 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex,bool checkPOW)
     return true;
 }
 
+/**
+ * Reads the blocks ActivateBestChain is about to connect on background
+ * threads, so that the disk works while the blocks before them are being
+ * validated instead of the other way round. Blocks are read in connect
+ * order and kept until ConnectTip takes them, within a memory limit.
+ */
+class CBlockPrefetcher
+{
+private:
+    struct CRequest {
+        uint256 hash;
+        CDiskBlockPos pos;
+        int nHeight;
+        //! Set once read, until taken
+        std::shared_ptr<CBlock> block;
+        size_t nUsage = 0;
+        bool fReading = false;
+        bool fFailed = false;
+        //! No longer wanted, the result of a read in progress is thrown away
+        bool fDropped = false;
+    };
+
+    boost::mutex cs;
+    boost::condition_variable condWorker;
+    boost::condition_variable condRead;
+    //! The blocks to connect next, in connect order
+    std::deque<std::shared_ptr<CRequest>> queue;
+    //! Memory used by the blocks read and not taken yet
+    size_t nUsage = 0;
+    size_t nMaxUsage = 0;
+    int nThreads = 0;
+
+    //! The first request no worker took yet, if the memory limit allows reading it
+    std::shared_ptr<CRequest> NextRequest()
+    {
+        if (nUsage >= nMaxUsage)
+            return nullptr;
+        for (const std::shared_ptr<CRequest>& req : queue) {
+            if (!req->block && !req->fReading && !req->fFailed)
+                return req;
+        }
+        return nullptr;
+    }
+
+    static bool Read(const CRequest& req, CBlock& block)
+    {
+#ifndef WIN32
+        auto blockFile = blockFileDescriptors.Get(req.pos.nFile);
+        if (blockFile && req.pos.nPos >= 4) {
+            try {
+                // The size precedes the block, so the whole block can be read with one pread()
+                unsigned int nSize = 0;
+                {
+                    CPreadFile sizein(blockFile->fd, req.pos.nPos - 4, 4, SER_DISK, CLIENT_VERSION);
+                    sizein >> nSize;
+                }
+                // Leave a bad size to ReadBlockFromDisk, which ConnectTip falls back to
+                if (nSize < 80 || nSize > (unsigned int)MAX_BLOCK_SIZE(req.nHeight))
+                    return error("%s: bad block size %u at %s", __func__, nSize, req.pos.ToString());
+                CPreadFile filein(blockFile->fd, req.pos.nPos, nSize, SER_DISK, CLIENT_VERSION);
+                filein >> block;
+            } catch (const std::exception& e) {
+                return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), req.pos.ToString());
+            }
+        } else
+#endif
+        if (!ReadBlockFromDisk(req.nHeight, block, req.pos, false))
+            return false;
+        return block.GetHash() == req.hash;
+    }
+
+public:
+    void SetMaxUsage(size_t nMaxUsageIn)
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        nMaxUsage = nMaxUsageIn;
+    }
+
+    /** Read these blocks, in this order, forgetting the ones requested before and not listed */
+    void Prefetch(const std::vector<CBlockIndex*>& vpindex)
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        if (nThreads == 0)
+            return;
+        std::map<uint256, std::shared_ptr<CRequest>> mapOld;
+        for (const std::shared_ptr<CRequest>& req : queue)
+            mapOld[req->hash] = req;
+        queue.clear();
+        for (CBlockIndex* pindex : vpindex) {
+            if (!(pindex->nStatus & BLOCK_HAVE_DATA))
+                break;
+            auto it = mapOld.find(pindex->GetBlockHash());
+            if (it != mapOld.end()) {
+                queue.push_back(it->second);
+                mapOld.erase(it);
+                continue;
+            }
+            std::shared_ptr<CRequest> req = std::make_shared<CRequest>();
+            req->hash = pindex->GetBlockHash();
+            req->pos = pindex->GetBlockPos();
+            req->nHeight = pindex->GetHeight();
+            queue.push_back(req);
+        }
+        for (auto& item : mapOld) {
+            item.second->fDropped = true;
+            nUsage -= item.second->nUsage;
+        }
+        condWorker.notify_all();
+    }
+
+    /** Move the block of pindex into block if it was requested, waiting for a read in progress */
+    bool Take(const CBlockIndex* pindex, CBlock& block)
+    {
+        boost::unique_lock<boost::mutex> lock(cs);
+        auto it = queue.begin();
+        while (it != queue.end() && (*it)->hash != pindex->GetBlockHash())
+            ++it;
+        if (it == queue.end())
+            return false;
+        std::shared_ptr<CRequest> req = *it;
+        while (req->fReading)
+            condRead.wait(lock);
+        // The blocks before it in connect order are not needed anymore either
+        for (auto itDrop = queue.begin(); itDrop != it; ++itDrop) {
+            (*itDrop)->fDropped = true;
+            nUsage -= (*itDrop)->nUsage;
+        }
+        queue.erase(queue.begin(), it + 1);
+        req->fDropped = true;
+        nUsage -= req->nUsage;
+        condWorker.notify_all();
+        if (!req->block)
+            return false;
+        block = std::move(*req->block);
+        return true;
+    }
+
+    void Thread()
+    {
+        {
+            boost::unique_lock<boost::mutex> lock(cs);
+            nThreads++;
+        }
+        while (true) {
+            std::shared_ptr<CRequest> req;
+            {
+                boost::unique_lock<boost::mutex> lock(cs);
+                while (!(req = NextRequest()))
+                    condWorker.wait(lock);
+                req->fReading = true;
+            }
+
+            std::shared_ptr<CBlock> block = std::make_shared<CBlock>();
+            bool fRead = Read(*req, *block);
+            size_t nBlockUsage = fRead ? RecursiveDynamicUsage(*block) : 0;
+
+            boost::unique_lock<boost::mutex> lock(cs);
+            req->fReading = false;
+            if (!fRead) {
+                req->fFailed = true;
+            } else if (!req->fDropped) {
+                req->block = block;
+                req->nUsage = nBlockUsage;
+                nUsage += nBlockUsage;
+            }
+            condRead.notify_all();
+        }
+    }
+};
+
+static CBlockPrefetcher blockPrefetcher;
+
+void ThreadBlockPrefetch()
+{
+    RenameThread("komodo-prefetch");
+    blockPrefetcher.Thread();
+}
+
+void SetBlockPrefetchMemory(size_t nMaxUsage)
+{
+    blockPrefetcher.SetMaxUsage(nMaxUsage);
+}
+
 //uint64_t komodo_moneysupply(int32_t height);
 extern char ASSETCHAINS_SYMBOL[KOMODO_ASSETCHAIN_MAXLEN];
 extern uint64_t ASSETCHAINS_ENDSUBSIDY[ASSETCHAINS_MAX_ERAS+1], ASSETCHAINS_REWARD[ASSETCHAINS_MAX_ERAS+1], ASSETCHAINS_HALVING[ASSETCHAINS_MAX_ERAS+1];
@@ -3176,6 +3565,73 @@ int8_t GetAddressType(const CScript &scriptPubKey, CTxDestination &vDest, txnout
     return keyType;
 }
 
+bool GetOracleSample(const CTransaction &tx,int32_t height,int32_t txindex,COracleSampleKey &key,std::vector<uint8_t> &data);
+void OracleSamplesConnected(const std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > > &samples);
+void OracleSamplesDisconnected(const std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > > &samples);
+
+/** Adds the token index entries of a CC output, a null value erases them */
+static void AddTokenUnspentIndex(std::vector<std::pair<CTokenUnspentKey, CAddressUnspentValue> > &tokenUnspentIndex, const uint256 &tokenid,
+                                 const COutPoint &outpoint, const CTxOut &out, const CAddressUnspentValue &value)
+{
+    vector<vector<unsigned char>> vSols;
+    CTxDestination vDest;
+    txnouttype txType = TX_PUBKEYHASH;
+    // tokens only live on CC outputs, this also keeps the keys in line with the CC address index
+    if (GetAddressType(out.scriptPubKey, vDest, txType, vSols) != 3)
+        return;
+    for (auto addr : vSols)
+    {
+        uint160 addrHash = addr.size() == 20 ? uint160(addr) : Hash160(addr);
+        tokenUnspentIndex.push_back(make_pair(CTokenUnspentKey(tokenid, 3, addrHash, outpoint.hash, outpoint.n), value));
+    }
+}
+
+/** CC index key of a module opreturn, laid out as evalcode, funcid, reference txid, ... */
+static CEvalIndexKey EvalIndexKeyFromOpRet(const std::vector<uint8_t> &vopret, int height, unsigned int txindex, const uint256 &txhash)
+{
+    uint256 reftxid;
+    if (vopret.size() >= 34)
+        memcpy(reftxid.begin(), &vopret[2], 32);
+    return CEvalIndexKey(vopret[0], vopret[1], reftxid, height, txindex, txhash);
+}
+
+#define EVAL_GENERATE_MATCH(L,I) if (evalcode == I) return true;
+static bool IsIndexedEvalCode(uint8_t evalcode)
+{
+    if (evalcode >= EVAL_FIRSTUSER && evalcode <= EVAL_LASTUSER)
+        return true;
+    FOREACH_EVAL(EVAL_GENERATE_MATCH);
+    return false;
+}
+#undef EVAL_GENERATE_MATCH
+
+void GetCCEvalIndexKeys(const CTransaction &tx, int height, unsigned int txindex, std::vector<CEvalIndexKey> &keys)
+{
+    std::vector<uint8_t> vopret;
+    // module creation txs often have no CC vins or vouts, only a marker, so go by the opreturn
+    if (tx.vout.size() < 2 || !tx.vout.back().scriptPubKey.IsOpReturn())
+        return;
+    GetOpReturnData(tx.vout.back().scriptPubKey, vopret);
+    if (vopret.size() < 2 || !IsIndexedEvalCode(vopret[0]))
+        return;
+    if (vopret[0] == EVAL_TOKENS)
+    {
+        uint8_t evalCodeTokens, funcid; uint256 tokenid; std::vector<CPubKey> voutPubkeys; std::vector<std::pair<uint8_t, vscript_t>> oprets;
+        if ((funcid = DecodeTokenOpRet(tx.vout.back().scriptPubKey, evalCodeTokens, tokenid, voutPubkeys, oprets)) == 0)
+            return;
+        keys.push_back(CEvalIndexKey(EVAL_TOKENS, funcid, funcid == 'c' ? uint256() : tokenid, height, txindex, tx.GetHash()));
+        // module data carried by token transfers, creation oprets only carry token metadata
+        if (funcid == 't')
+        {
+            for (auto opret : oprets)
+                if (opret.second.size() >= 2 && IsIndexedEvalCode(opret.second[0]))
+                    keys.push_back(EvalIndexKeyFromOpRet(opret.second, height, txindex, tx.GetHash()));
+        }
+        return;
+    }
+    keys.push_back(EvalIndexKeyFromOpRet(vopret, height, txindex, tx.GetHash()));
+}
+
 bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex, CCoinsViewCache& view, bool* pfClean)
 {
     assert(pindex->GetBlockHash() == view.GetBestBlock());
@@ -3197,11 +3653,33 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
     std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+    std::vector<std::pair<CTokenUnspentKey, CAddressUnspentValue> > tokenUnspentIndex;
+    std::vector<std::pair<COutPoint, uint256> > tokenOutputIndex;
+    std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > > oracleSampleIndex;
+    std::vector<CEvalIndexKey> evalIndex;
 
     // undo transactions in reverse order
     for (int i = block.vtx.size() - 1; i >= 0; i--) {
         const CTransaction &tx = block.vtx[i];
         uint256 hash = tx.GetHash();
+        txCache.Erase(hash);
+        if (fOraclesIndex) {
+            COracleSampleKey sampleKey;
+            std::vector<uint8_t> sampleData;
+            if (GetOracleSample(tx, pindex->GetHeight(), i, sampleKey, sampleData))
+                oracleSampleIndex.push_back(make_pair(sampleKey, sampleData));
+        }
+        if (fCCIndex)
+            GetCCEvalIndexKeys(tx, pindex->GetHeight(), i, evalIndex);
+        uint256 tokenid;
+        if (fTokenIndex && GetTxTokenId(tx, tokenid)) {
+            for (unsigned int k = 0; k < tx.vout.size(); k++) {
+                if (!tx.vout[k].scriptPubKey.IsPayToCryptoCondition())
+                    continue;
+                AddTokenUnspentIndex(tokenUnspentIndex, tokenid, COutPoint(hash, k), tx.vout[k], CAddressUnspentValue());
+                tokenOutputIndex.push_back(make_pair(COutPoint(hash, k), uint256()));
+            }
+        }
         if (fAddressIndex) {
 
             for (unsigned int k = tx.vout.size(); k-- > 0;) {
@@ -3284,6 +3762,15 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
                         }
                     }
                 }
+
+                if (fTokenIndex) {
+                    const CTxOut &prevout = view.GetOutputFor(tx.vin[j]);
+                    uint256 prevTokenid;
+                    if (prevout.scriptPubKey.IsPayToCryptoCondition() && pblocktree->ReadTokenOutputIndex(input.prevout, prevTokenid)) {
+                        // restore token unspent index
+                        AddTokenUnspentIndex(tokenUnspentIndex, prevTokenid, input.prevout, prevout, CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undo.nHeight));
+                    }
+                }
             }
         }
         else if (tx.IsCoinImport() || tx.IsPegsImport())
@@ -3323,6 +3810,28 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
         }
     }
 
+    if (fTokenIndex) {
+        if (!pblocktree->UpdateTokenIndex(tokenUnspentIndex, tokenOutputIndex)) {
+            return AbortNode(state, "Failed to write token index");
+        }
+    }
+
+    if (fOraclesIndex) {
+        if (!pblocktree->EraseOracleSampleIndex(oracleSampleIndex)) {
+            return AbortNode(state, "Failed to delete oracles index");
+        }
+        OracleSamplesDisconnected(oracleSampleIndex);
+    }
+
+    if (fCCIndex) {
+        if (!pblocktree->EraseEvalIndex(evalIndex)) {
+            return AbortNode(state, "Failed to delete cc index");
+        }
+    }
+
+    if (!komodo_kvdisconnect(pindex))
+        return AbortNode(state, "Failed to undo kv store");
+
     return fClean;
 }
 
@@ -3351,13 +3860,20 @@ void static FlushBlockFile(bool fFinalize = false)
 
 bool FindUndoPos(CValidationState &state, int nFile, CDiskBlockPos &pos, unsigned int nAddSize);
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+static CCheckQueue<CBlockCheck> scriptcheckqueue(128);
 
 void ThreadScriptCheck() {
     RenameThread("zcash-scriptch");
     scriptcheckqueue.Thread();
 }
 
+static CCheckQueue<CBlockCheck> headercheckqueue(16);
+
+void ThreadHeaderCheck() {
+    RenameThread("zcash-headerch");
+    headercheckqueue.Thread();
+}
+
 //
 // Called periodically asynchronously; alerts if it smells like
 // we're being fed a bad chain (blocks being generated much
@@ -3567,7 +4083,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             sleep(1);
         }
     }
-    CCheckQueueControl<CScriptCheck> control(fExpensiveChecks && nScriptCheckThreads ? &scriptcheckqueue : NULL);
+    CCheckQueueControl<CBlockCheck> control(fExpensiveChecks && nScriptCheckThreads ? &scriptcheckqueue : NULL);
 
     int64_t nTimeStart = GetTimeMicros();
     CAmount nFees = 0;
@@ -3582,6 +4098,12 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
     std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+    std::vector<std::pair<CTokenUnspentKey, CAddressUnspentValue> > tokenUnspentIndex;
+    std::vector<std::pair<COutPoint, uint256> > tokenOutputIndex;
+    // token outputs created earlier in this block, not in the database yet
+    std::map<COutPoint, uint256> mapBlockTokenOutputs;
+    std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > > oracleSampleIndex;
+    std::vector<CEvalIndexKey> evalIndex;
     // Construct the incremental merkle tree at the current
     // block position,
     auto old_sprout_tree_root = view.GetBestAnchor(SPROUT);
@@ -3666,6 +4188,24 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
                     }
                 }
             }
+            if (fTokenIndex)
+            {
+                for (size_t j = 0; j < tx.vin.size(); j++)
+                {
+                    if (tx.IsPegsImport() && j==0) continue;
+                    const CTxOut &prevout = view.GetOutputFor(tx.vin[j]);
+                    if (!prevout.scriptPubKey.IsPayToCryptoCondition())
+                        continue;
+                    uint256 prevTokenid;
+                    std::map<COutPoint, uint256>::const_iterator mi = mapBlockTokenOutputs.find(tx.vin[j].prevout);
+                    if (mi != mapBlockTokenOutputs.end())
+                        prevTokenid = mi->second;
+                    else if (!pblocktree->ReadTokenOutputIndex(tx.vin[j].prevout, prevTokenid))
+                        continue;
+                    // remove from token unspent index
+                    AddTokenUnspentIndex(tokenUnspentIndex, prevTokenid, tx.vin[j].prevout, prevout, CAddressUnspentValue());
+                }
+            }
             // Add in sigops done by pay-to-script-hash inputs;
             // this is to prevent a "rogue miner" from creating
             // an incredibly-expensive-to-validate block.
@@ -3699,9 +4239,13 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             sum += interest;
             //fprintf(stderr, "tx.%s nFees.%li interest.%li\n", tx.GetHash().ToString().c_str(), stakeTxValue, interest);
 
-            std::vector<CScriptCheck> vChecks;
-            if (!ContextualCheckInputs(tx, state, view, fExpensiveChecks, flags, false, txdata[i], chainparams.GetConsensus(), consensusBranchId, nScriptCheckThreads ? &vChecks : NULL))
+            std::vector<CScriptCheck> vScriptChecks;
+            if (!ContextualCheckInputs(tx, state, view, fExpensiveChecks, flags, false, txdata[i], chainparams.GetConsensus(), consensusBranchId, nScriptCheckThreads ? &vScriptChecks : NULL))
                 return false;
+            std::vector<CBlockCheck> vChecks;
+            vChecks.reserve(vScriptChecks.size());
+            for (CScriptCheck& check : vScriptChecks)
+                vChecks.emplace_back(check);
             control.Add(vChecks);
         }
 
@@ -3730,6 +4274,29 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             }
         }
 
+        uint256 tokenid;
+        if (fTokenIndex && GetTxTokenId(tx, tokenid)) {
+            for (unsigned int k = 0; k < tx.vout.size(); k++) {
+                const CTxOut &out = tx.vout[k];
+                if (!out.scriptPubKey.IsPayToCryptoCondition())
+                    continue;
+                COutPoint outpoint(txhash, k);
+                AddTokenUnspentIndex(tokenUnspentIndex, tokenid, outpoint, out, CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->GetHeight()));
+                tokenOutputIndex.push_back(make_pair(outpoint, tokenid));
+                mapBlockTokenOutputs[outpoint] = tokenid;
+            }
+        }
+
+        if (fOraclesIndex) {
+            COracleSampleKey sampleKey;
+            std::vector<uint8_t> sampleData;
+            if (GetOracleSample(tx, pindex->GetHeight(), i, sampleKey, sampleData))
+                oracleSampleIndex.push_back(make_pair(sampleKey, sampleData));
+        }
+
+        if (fCCIndex)
+            GetCCEvalIndexKeys(tx, pindex->GetHeight(), i, evalIndex);
+
         //if ( ASSETCHAINS_SYMBOL[0] == 0 )
         //    komodo_earned_interest(pindex->GetHeight(),sum);
         CTxUndo undoDummy;
@@ -3776,6 +4343,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         }
     }
     int64_t nTime1 = GetTimeMicros(); nTimeConnect += nTime1 - nTimeStart;
+    MetricsHistogram("eskenas.block.connect.seconds", (nTime1 - nTimeStart) * 0.000001, "phase", "transactions");
     LogPrint("bench", "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs]\n", (unsigned)block.vtx.size(), 0.001 * (nTime1 - nTimeStart), 0.001 * (nTime1 - nTimeStart) / block.vtx.size(), nInputs <= 1 ? 0 : 0.001 * (nTime1 - nTimeStart) / (nInputs-1), nTimeConnect * 0.000001);
 
     blockReward += nFees + sum;
@@ -3814,6 +4382,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     if (!control.Wait())
         return state.DoS(100, false);
     int64_t nTime2 = GetTimeMicros(); nTimeVerify += nTime2 - nTimeStart;
+    MetricsHistogram("eskenas.block.connect.seconds", (nTime2 - nTime1) * 0.000001, "phase", "verify");
     LogPrint("bench", "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs]\n", nInputs - 1, 0.001 * (nTime2 - nTimeStart), nInputs <= 1 ? 0 : 0.001 * (nTime2 - nTimeStart) / (nInputs-1), nTimeVerify * 0.000001);
 
     if (fJustCheck)
@@ -3854,9 +4423,13 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
     ConnectNotarisations(block, pindex->GetHeight()); // MoMoM notarisation DB.
 
-    if (fTxIndex)
+    if (fTxIndex) {
         if (!pblocktree->WriteTxIndex(vPos))
             return AbortNode(state, "Failed to write transaction index");
+        // A cached copy may still point at a block this one replaced in a reorg
+        for (const CTransaction& tx : block.vtx)
+            txCache.Erase(tx.GetHash());
+    }
     if (fAddressIndex) {
         if (!pblocktree->WriteAddressIndex(addressIndex)) {
             return AbortNode(state, "Failed to write address index");
@@ -3871,6 +4444,20 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
         if (!pblocktree->UpdateSpentIndex(spentIndex))
             return AbortNode(state, "Failed to write transaction index");
 
+    if (fTokenIndex)
+        if (!pblocktree->UpdateTokenIndex(tokenUnspentIndex, tokenOutputIndex))
+            return AbortNode(state, "Failed to write token index");
+
+    if (fOraclesIndex) {
+        if (!pblocktree->WriteOracleSampleIndex(oracleSampleIndex))
+            return AbortNode(state, "Failed to write oracles index");
+        OracleSamplesConnected(oracleSampleIndex);
+    }
+
+    if (fCCIndex)
+        if (!pblocktree->WriteEvalIndex(evalIndex))
+            return AbortNode(state, "Failed to write cc index");
+
     if (fTimestampIndex)
     {
         unsigned int logicalTS = pindex->nTime;
@@ -3897,6 +4484,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     view.SetBestBlock(pindex->GetBlockHash());
 
     int64_t nTime3 = GetTimeMicros(); nTimeIndex += nTime3 - nTime2;
+    MetricsHistogram("eskenas.block.connect.seconds", (nTime3 - nTime2) * 0.000001, "phase", "index");
     LogPrint("bench", "    - Index writing: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2), nTimeIndex * 0.000001);
 
     // Watch for changes to the previous coinbase transaction.
@@ -3905,10 +4493,13 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     hashPrevBestCoinBase = block.vtx[0].GetHash();
 
     int64_t nTime4 = GetTimeMicros(); nTimeCallbacks += nTime4 - nTime3;
+    MetricsHistogram("eskenas.block.connect.seconds", (nTime4 - nTime3) * 0.000001, "phase", "callbacks");
     LogPrint("bench", "    - Callbacks: %.2fms [%.2fs]\n", 0.001 * (nTime4 - nTime3), nTimeCallbacks * 0.000001);
 
     //FlushStateToDisk();
     komodo_connectblock(false,pindex,*(CBlock *)&block);  // dPoW state update.
+    if (!komodo_kvconnect(pindex))
+        return AbortNode(state, "Failed to write kv store");
     if ( ASSETCHAINS_NOTARY_PAY[0] != 0 )
     {
       // Update the notary pay with the latest payment.
@@ -3989,14 +4580,22 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
                     setDirtyFileInfo.erase(it++);
                 }
                 std::vector<const CBlockIndex*> vBlocks;
+                std::vector<CBlockIndex*> vTrim;
                 vBlocks.reserve(setDirtyBlockIndex.size());
+                vTrim.reserve(setDirtyBlockIndex.size());
                 for (set<CBlockIndex*>::iterator it = setDirtyBlockIndex.begin(); it != setDirtyBlockIndex.end(); ) {
                     vBlocks.push_back(*it);
+                    vTrim.push_back(*it);
                     setDirtyBlockIndex.erase(it++);
                 }
+                int64_t nWriteStart = GetTimeMicros();
                 if (!pblocktree->WriteBatchSync(vFiles, nLastBlockFile, vBlocks)) {
                     return AbortNode(state, "Files to write to block index database");
                 }
+                // The solutions can be read back from the block index database from now on
+                for (CBlockIndex* pindex : vTrim)
+                    pindex->TrimSolution();
+                MetricsHistogram("eskenas.db.flush.seconds", (GetTimeMicros() - nWriteStart) * 0.000001, "db", "blockindex");
             }
             // Finally remove any pruned files
             if (fFlushForPrune)
@@ -4013,8 +4612,10 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode) {
             if (!CheckDiskSpace(128 * 2 * 2 * pcoinsTip->GetCacheSize()))
                 return state.Error("out of disk space");
             // Flush the chainstate (which may refer to block index entries).
+            int64_t nFlushStart = GetTimeMicros();
             if (!pcoinsTip->Flush())
                 return AbortNode(state, "Failed to write to coin database");
+            MetricsHistogram("eskenas.db.flush.seconds", (GetTimeMicros() - nFlushStart) * 0.000001, "db", "chainstate");
             nLastFlush = nNow;
         }
     } catch (const std::runtime_error& e) {
@@ -4169,10 +4770,10 @@ bool static DisconnectTip(CValidationState &state, bool fBare = false) {
     UpdateTip(pindexDelete->pprev);
 
     // Get the current commitment tree
-    SproutMerkleTree newSproutTree;
-    SaplingMerkleTree newSaplingTree;
-    assert(pcoinsTip->GetSproutAnchorAt(pcoinsTip->GetBestAnchor(SPROUT), newSproutTree));
-    assert(pcoinsTip->GetSaplingAnchorAt(pcoinsTip->GetBestAnchor(SAPLING), newSaplingTree));
+    auto newSproutTree = std::make_shared<SproutMerkleTree>();
+    auto newSaplingTree = std::make_shared<SaplingMerkleTree>();
+    assert(pcoinsTip->GetSproutAnchorAt(pcoinsTip->GetBestAnchor(SPROUT), *newSproutTree));
+    assert(pcoinsTip->GetSaplingAnchorAt(pcoinsTip->GetBestAnchor(SAPLING), *newSaplingTree));
     // Let wallets know transactions went from 1-confirmed to
     // 0-confirmed or conflicted:
     std::vector<uint256> TxToRemove;
@@ -4184,13 +4785,14 @@ bool static DisconnectTip(CValidationState &state, bool fBare = false) {
         {
 #ifdef ENABLE_WALLET
              // new staking tx cannot be accepted to mempool and expires in 1 block, so no need for this! :D
+             // queued behind the earlier notifications about the transaction
              if ( !GetBoolArg("-disablewallet", false) && KOMODO_NSPV_FULLNODE )
-                 pwalletMain->EraseFromWallet(tx.GetHash());
+                 EraseFromWallets(tx.GetHash());
 #endif
         } else SyncWithWallets(tx, NULL, pindexDelete->GetHeight());
     }
     // Update cached incremental witnesses
-    GetMainSignals().ChainTip(pindexDelete, &block, newSproutTree, newSaplingTree, false);
+    GetMainSignals().ChainTip(pindexDelete, std::make_shared<const CBlock>(std::move(block)), newSproutTree, newSaplingTree, false);
     return true;
 }
 
@@ -4339,22 +4941,28 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *
     int64_t nTime1 = GetTimeMicros();
     CBlock block;
     if (!pblock) {
-        if (!ReadBlockFromDisk(block, pindexNew,1))
-            return AbortNode(state, "Failed to read block");
+        if (blockPrefetcher.Take(pindexNew, block)) {
+            MetricsIncrementCounter("eskenas.block.prefetch", "result", "hit");
+        } else {
+            MetricsIncrementCounter("eskenas.block.prefetch", "result", "miss");
+            if (!ReadBlockFromDisk(block, pindexNew,1))
+                return AbortNode(state, "Failed to read block");
+        }
         pblock = &block;
     }
     KOMODO_CONNECTING = (int32_t)pindexNew->GetHeight();
     //fprintf(stderr,"%s connecting ht.%d maxsize.%d vs %d\n",ASSETCHAINS_SYMBOL,(int32_t)pindexNew->GetHeight(),MAX_BLOCK_SIZE(pindexNew->GetHeight()),(int32_t)::GetSerializeSize(*pblock, SER_NETWORK, PROTOCOL_VERSION));
-    // Get the current commitment tree
-    SproutMerkleTree oldSproutTree;
-    SaplingMerkleTree oldSaplingTree;
+    // Get the current commitment tree, shared with the ChainTip listeners
+    auto oldSproutTree = std::make_shared<SproutMerkleTree>();
+    auto oldSaplingTree = std::make_shared<SaplingMerkleTree>();
     if ( KOMODO_NSPV_FULLNODE )
     {
-        assert(pcoinsTip->GetSproutAnchorAt(pcoinsTip->GetBestAnchor(SPROUT), oldSproutTree));
-        assert(pcoinsTip->GetSaplingAnchorAt(pcoinsTip->GetBestAnchor(SAPLING), oldSaplingTree));
+        assert(pcoinsTip->GetSproutAnchorAt(pcoinsTip->GetBestAnchor(SPROUT), *oldSproutTree));
+        assert(pcoinsTip->GetSaplingAnchorAt(pcoinsTip->GetBestAnchor(SAPLING), *oldSaplingTree));
     }
     // Apply the block atomically to the chain state.
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
+    MetricsHistogram("eskenas.block.connect.seconds", (nTime2 - nTime1) * 0.000001, "phase", "read");
     int64_t nTime3;
     LogPrint("bench", "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
     {
@@ -4381,6 +4989,8 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *
             assert(view.Flush());
     }
     int64_t nTime4 = GetTimeMicros(); nTimeFlush += nTime4 - nTime3;
+    MetricsHistogram("eskenas.block.connect.seconds", (nTime3 - nTime2) * 0.000001, "phase", "connect");
+    MetricsHistogram("eskenas.block.connect.seconds", (nTime4 - nTime3) * 0.000001, "phase", "flush");
     LogPrint("bench", "  - Flush: %.2fms [%.2fs]\n", (nTime4 - nTime3) * 0.001, nTimeFlush * 0.000001);
     // Write the chain state to disk, if necessary.
     if ( KOMODO_NSPV_FULLNODE )
@@ -4389,6 +4999,7 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *
             return false;
     }
     int64_t nTime5 = GetTimeMicros(); nTimeChainState += nTime5 - nTime4;
+    MetricsHistogram("eskenas.block.connect.seconds", (nTime5 - nTime4) * 0.000001, "phase", "chainstate");
     LogPrint("bench", "  - Writing chainstate: %.2fms [%.2fs]\n", (nTime5 - nTime4) * 0.001, nTimeChainState * 0.000001);
     // Remove conflicting transactions from the mempool.
     list<CTransaction> txConflicted;
@@ -4399,6 +5010,8 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *
 
     // Update chainActive & related variables.
     UpdateTip(pindexNew);
+    // The listeners are notified off this thread, they share one copy of the block
+    std::shared_ptr<const CBlock> pblockShared = std::make_shared<const CBlock>(*pblock);
     if ( KOMODO_NSPV_FULLNODE )
     {
         // Tell wallet about transactions that went from mempool
@@ -4407,16 +5020,16 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *
             SyncWithWallets(tx, NULL, pindexNew->GetHeight());
         }
         // ... and about transactions that got confirmed:
-        BOOST_FOREACH(const CTransaction &tx, pblock->vtx) {
-            SyncWithWallets(tx, pblock, pindexNew->GetHeight());
-        }
+        SyncBlockWithWallets(pblockShared, pindexNew->GetHeight());
     }
     // Update cached incremental witnesses
-    GetMainSignals().ChainTip(pindexNew, pblock, oldSproutTree, oldSaplingTree, true);
+    GetMainSignals().ChainTip(pindexNew, pblockShared, oldSproutTree, oldSaplingTree, true);
 
     EnforceNodeDeprecation(pindexNew->GetHeight());
 
     int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
+    MetricsHistogram("eskenas.block.connect.seconds", (nTime6 - nTime5) * 0.000001, "phase", "postprocess");
+    MetricsHistogram("eskenas.block.connect.seconds", (nTime6 - nTime1) * 0.000001, "phase", "total");
     LogPrint("bench", "  - Connect postprocess: %.2fms [%.2fs]\n", (nTime6 - nTime5) * 0.001, nTimePostConnect * 0.000001);
     LogPrint("bench", "- Connect block: %.2fms [%.2fs]\n", (nTime6 - nTime1) * 0.001, nTimeTotal * 0.000001);
     if ( KOMODO_LONGESTCHAIN != 0 && (pindexNew->GetHeight() == KOMODO_LONGESTCHAIN || pindexNew->GetHeight() == KOMODO_LONGESTCHAIN+1) )
@@ -4626,6 +5239,20 @@ static bool ActivateBestChainStep(bool fSkipdpow, CValidationState &state, CBloc
     std::vector<CBlockIndex*> vpindexToConnect;
     bool fContinue = true;
     int nHeight = pindexFork ? pindexFork->GetHeight() : -1;
+
+    // Have the next blocks read while the first ones are connected, when
+    // catching up with blocks already on disk
+    if (nPrefetchBlocks > 0 && pindexMostWork->GetHeight() > nHeight + 1) {
+        std::vector<CBlockIndex*> vpindexPrefetch;
+        int nPrefetchHeight = std::min(nHeight + nPrefetchBlocks, pindexMostWork->GetHeight());
+        for (CBlockIndex *pindexIter = pindexMostWork->GetAncestor(nPrefetchHeight);
+             pindexIter && pindexIter->GetHeight() != nHeight; pindexIter = pindexIter->pprev) {
+            if (pindexIter != pindexMostWork || !pblock)
+                vpindexPrefetch.push_back(pindexIter);
+        }
+        std::reverse(vpindexPrefetch.begin(), vpindexPrefetch.end());
+        blockPrefetcher.Prefetch(vpindexPrefetch);
+    }
     while (fContinue && nHeight != pindexMostWork->GetHeight()) {
         // Don't iterate the entire list of potential improvements toward the best tip, as we likely only need
         // a few blocks along the way.
@@ -4717,6 +5344,11 @@ bool ActivateBestChain(bool fSkipdpow, CValidationState &state, CBlock *pblock)
         if (ShutdownRequested())
             break;
 
+        // Let the listeners catch up rather than queue up copies of every block. The only
+        // caller holding cs_main is InitBlockIndex, which never gets near the limit.
+        if (GetValidationInterfaceQueueSize() > MAX_PENDING_VALIDATION_NOTIFICATIONS)
+            SyncWithValidationInterfaceQueue();
+
         const CBlockIndex *pindexFork;
 
         bool fInitialDownload;
@@ -5540,14 +6172,19 @@ bool ContextualCheckBlock(int32_t slowflag,const CBlock& block, CValidationState
     const Consensus::Params& consensusParams = Params().GetConsensus();
     bool sapling = NetworkUpgradeActive(nHeight, consensusParams, Consensus::UPGRADE_SAPLING);
 
+    // The Sapling proofs of the transactions are verified on the script check threads
+    CCheckQueueControl<CBlockCheck> control(nScriptCheckThreads ? &scriptcheckqueue : NULL);
+
     // Check that all transactions are finalized
     for (uint32_t i = 0; i < block.vtx.size(); i++) {
         const CTransaction& tx = block.vtx[i];
 
         // Check transaction contextually against consensus rules at block height
-        if (!ContextualCheckTransaction(slowflag,&block,pindexPrev,tx, state, nHeight, 100)) {
+        std::vector<CBlockCheck> vChecks;
+        if (!ContextualCheckTransaction(slowflag,&block,pindexPrev,tx, state, nHeight, 100, IsInitialBlockDownload, 1, nScriptCheckThreads ? &vChecks : NULL)) {
             return false; // Failure reason has been set in validation state object
         }
+        control.Add(vChecks);
 
         int nLockTimeFlags = 0;
         int64_t nLockTimeCutoff = (nLockTimeFlags & LOCKTIME_MEDIAN_TIME_PAST)
@@ -5558,6 +6195,15 @@ bool ContextualCheckBlock(int32_t slowflag,const CBlock& block, CValidationState
         }
     }
 
+    if (!control.Wait()) {
+        // Check the transactions again one by one to report the failure reason
+        for (uint32_t i = 0; i < block.vtx.size(); i++) {
+            if (!ContextualCheckTransaction(slowflag,&block,pindexPrev,block.vtx[i], state, nHeight, 100))
+                return false;
+        }
+        return state.DoS(100, error("%s: Sapling proof verification failed", __func__), REJECT_INVALID, "bad-txns-sapling-verification-failed");
+    }
+
     // Enforce BIP 34 rule that the coinbase starts with serialized block height.
     // In Zcash this has been enforced since launch, except that the genesis
     // block didn't include the height in the coinbase (see Zcash protocol spec
@@ -6058,6 +6704,9 @@ void UnlinkPrunedFiles(std::set<int>& setFilesToPrune)
 {
     for (set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         CDiskBlockPos pos(*it, 0);
+#ifndef WIN32
+        blockFileDescriptors.Remove(*it);
+#endif
         boost::filesystem::remove(GetBlockPosFilename(pos, "blk"));
         boost::filesystem::remove(GetBlockPosFilename(pos, "rev"));
         LogPrintf("Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
@@ -6074,7 +6723,23 @@ void FindFilesToPrune(std::set<int>& setFilesToPrune)
     if (chainActive.Tip()->GetHeight() <= Params().PruneAfterHeight()) {
         return;
     }
-    unsigned int nLastBlockWeCanPrune = chainActive.Tip()->GetHeight() - MIN_BLOCKS_TO_KEEP;
+    // Reorgs can go back to the last notarised height and disconnecting needs the
+    // undo data, so keep a margin below it as well. Nothing is pruned before the
+    // chain is notarised.
+    uint256 notarized_hash,notarized_desttxid; int32_t prevMoMheight,notarized_height;
+    notarized_height = komodo_notarized_height(&prevMoMheight,&notarized_hash,&notarized_desttxid);
+    if (notarized_height <= (int32_t)NOTARISED_BLOCKS_TO_KEEP) {
+        // Not only in the prune category, a chain that is never notarised is never pruned
+        static bool fLogged = false;
+        if (!fLogged && CalculateCurrentUsage() + BLOCKFILE_CHUNK_SIZE + UNDOFILE_CHUNK_SIZE >= nPruneTarget) {
+            LogPrintf("Prune: over the target of %dMiB, but nothing is pruned until the chain is notarised\n", nPruneTarget/1024/1024);
+            fLogged = true;
+        }
+        LogPrint("prune", "Prune: waiting for a notarisation, notarised height %d\n", notarized_height);
+        return;
+    }
+    unsigned int nLastBlockWeCanPrune = std::min(chainActive.Tip()->GetHeight() - MIN_BLOCKS_TO_KEEP,
+                                                 (unsigned int)notarized_height - NOTARISED_BLOCKS_TO_KEEP);
     uint64_t nCurrentUsage = CalculateCurrentUsage();
     // We don't check to prune until after we've allocated new space for files
     // So we should leave a buffer under our target to account for another allocation
@@ -6215,11 +6880,13 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
 bool static LoadBlockIndexDB()
 {
     const CChainParams& chainparams = Params();
+    int64_t nStart = GetTimeMillis();
     LogPrintf("%s: start loading guts\n", __func__);
     if (!pblocktree->LoadBlockIndexGuts())
         return false;
-    LogPrintf("%s: loaded guts\n", __func__);
+    LogPrintf("%s: loaded guts in %dms\n", __func__, GetTimeMillis() - nStart);
     boost::this_thread::interruption_point();
+    nStart = GetTimeMillis();
 
     // Calculate chainPower
     vector<pair<int, CBlockIndex*> > vSortedByHeight;
@@ -6234,13 +6901,39 @@ bool static LoadBlockIndexDB()
     sort(vSortedByHeight.begin(), vSortedByHeight.end());
     //fprintf(stderr,"load blockindexDB sorted %u\n",(uint32_t)time(NULL));
 
+    // The proof of a block does not depend on its ancestors, so it is computed
+    // up front on all cores and only summed up along the chain below
+    std::vector<CChainPower> vBlockProof(vSortedByHeight.size());
+    {
+        const size_t nChunk = 1024;
+        int nThreads = std::max(1, std::min(GetNumCores(), (int)(vSortedByHeight.size() / nChunk)));
+        std::atomic<size_t> nNext(0);
+        auto worker = [&]() {
+            for (size_t i = nChunk * nNext++; i < vSortedByHeight.size(); i = nChunk * nNext++) {
+                for (size_t j = i; j < std::min(i + nChunk, vSortedByHeight.size()); j++)
+                    vBlockProof[j] = GetBlockProof(*vSortedByHeight[j].second);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (int i = 1; i < nThreads; i++) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+    LogPrintf("%s: sorted and computed block proofs in %dms\n", __func__, GetTimeMillis() - nStart);
+    nStart = GetTimeMillis();
+
     uiInterface.ShowProgress(_("Loading block index DB..."), 0, false);
-    int cur_height_num = 0;
+    int cur_height_num = 0, percentageDone = 0;
 
     BOOST_FOREACH(const PAIRTYPE(int, CBlockIndex*)& item, vSortedByHeight)
     {
         CBlockIndex* pindex = item.second;
-        pindex->chainPower = (pindex->pprev ? CChainPower(pindex) + pindex->pprev->chainPower : CChainPower(pindex)) + GetBlockProof(*pindex);
+        pindex->chainPower = (pindex->pprev ? CChainPower(pindex) + pindex->pprev->chainPower : CChainPower(pindex)) + vBlockProof[cur_height_num];
         // We can link the chain of blocks for which we've received transactions at some point.
         // Pruned nodes may have deleted the block.
         if (pindex->nTx > 0) {
@@ -6291,11 +6984,16 @@ bool static LoadBlockIndexDB()
         if (pindex->IsValid(BLOCK_VALID_TREE) && (pindexBestHeader == NULL || CBlockIndexWorkComparator()(pindexBestHeader, pindex)))
             pindexBestHeader = pindex;
         //komodo_pindex_init(pindex,(int32_t)pindex->GetHeight());
-        uiInterface.ShowProgress(_("Loading block index DB..."), (int)((double)(cur_height_num*100)/(double)(vSortedByHeight.size())), false);
+        if ((int)((double)(cur_height_num*100)/(double)(vSortedByHeight.size())) > percentageDone) {
+            percentageDone = (int)((double)(cur_height_num*100)/(double)(vSortedByHeight.size()));
+            uiInterface.ShowProgress(_("Loading block index DB..."), percentageDone, false);
+        }
         cur_height_num++;
     }
 
     uiInterface.ShowProgress("", 100, false);
+    LogPrintf("%s: linked block index in %dms\n", __func__, GetTimeMillis() - nStart);
+    nStart = GetTimeMillis();
     //fprintf(stderr,"load blockindexDB chained %u\n",(uint32_t)time(NULL));
 
     // Load block file info
@@ -6347,6 +7045,7 @@ bool static LoadBlockIndexDB()
     }
     LogPrintf("[%s].\n", "DONE");
     uiInterface.ShowProgress("", 100, false);
+    LogPrintf("%s: read block file info and checked blk files in %dms\n", __func__, GetTimeMillis() - nStart);
 
     // Check whether we have ever pruned block & undo files
     pblocktree->ReadFlag("prunedblockfiles", fHavePruned);
@@ -6373,6 +7072,18 @@ bool static LoadBlockIndexDB()
     pblocktree->ReadFlag("spentindex", fSpentIndex);
     LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
 
+    // Check whether we have a token index
+    pblocktree->ReadFlag("tokenindex", fTokenIndex);
+    LogPrintf("%s: token index %s\n", __func__, fTokenIndex ? "enabled" : "disabled");
+
+    // Check whether we have an oracles index
+    pblocktree->ReadFlag("oraclesindex", fOraclesIndex);
+    LogPrintf("%s: oracles index %s\n", __func__, fOraclesIndex ? "enabled" : "disabled");
+
+    // Check whether we have a cc index
+    pblocktree->ReadFlag("ccindex", fCCIndex);
+    LogPrintf("%s: cc index %s\n", __func__, fCCIndex ? "enabled" : "disabled");
+
     // Fill in-memory data
     BOOST_FOREACH(const PAIRTYPE(uint256, CBlockIndex*)& item, mapBlockIndex)
     {
@@ -6744,6 +7455,15 @@ bool InitBlockIndex() {
 
         fSpentIndex = GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
         pblocktree->WriteFlag("spentindex", fSpentIndex);
+
+        fTokenIndex = GetBoolArg("-tokenindex", DEFAULT_TOKENINDEX);
+        pblocktree->WriteFlag("tokenindex", fTokenIndex);
+
+        fOraclesIndex = GetBoolArg("-oraclesindex", DEFAULT_ORACLESINDEX);
+        pblocktree->WriteFlag("oraclesindex", fOraclesIndex);
+
+        fCCIndex = GetBoolArg("-ccindex", DEFAULT_CCINDEX);
+        pblocktree->WriteFlag("ccindex", fCCIndex);
         fprintf(stderr,"fAddressIndex.%d/%d fSpentIndex.%d/%d\n",fAddressIndex,DEFAULT_ADDRESSINDEX,fSpentIndex,DEFAULT_SPENTINDEX);
         LogPrintf("Initializing databases...\n");
     }
@@ -6788,6 +7508,12 @@ bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos *dbp)
     int64_t nStart = GetTimeMillis();
 
     int nLoaded = 0;
+#if defined(POSIX_FADV_WILLNEED)
+    // The file is read front to back while the blocks are validated, have the
+    // kernel read all of it ahead rather than waiting for the disk on every refill
+    posix_fadvise(fileno(fileIn), 0, 0, POSIX_FADV_SEQUENTIAL);
+    posix_fadvise(fileno(fileIn), 0, 0, POSIX_FADV_WILLNEED);
+#endif
     try {
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
         //CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SIZE, MAX_BLOCK_SIZE+8, SER_DISK, CLIENT_VERSION);
@@ -7224,6 +7950,14 @@ void static ProcessGetData(CNode* pfrom)
                         }
                     }
                 }
+                // A pruned node only promises the last MIN_BLOCKS_TO_KEEP blocks (NODE_NETWORK_LIMITED).
+                // Disconnect peers asking for more, rather than letting them find out how much we pruned.
+                if (send && fPruneMode && !pfrom->fWhitelisted &&
+                    mi->second->GetHeight() <= chainActive.Height() - (int)MIN_BLOCKS_TO_KEEP - 2) {
+                    LogPrint("net", "Ignore block request below pruning limit from peer=%d, disconnecting\n", pfrom->GetId());
+                    pfrom->fDisconnect = true;
+                    send = false;
+                }
                 // Pruned nodes may have deleted the block, so check whether
                 // it's available before trying to send.
                 if (send && (mi->second->nStatus & BLOCK_HAVE_DATA))
@@ -7329,6 +8063,56 @@ void static ProcessGetData(CNode* pfrom)
     }
 }
 
+/**
+ * Context free checks of a headers message before it is accepted under
+ * cs_main. The cheap ones come first: the headers must form one sequence.
+ * Then the equihash solutions, which AcceptBlockHeader does not check, of the
+ * headers that are not known yet and connect to the block index, on the
+ * header check threads.
+ */
+static bool PreCheckHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state)
+{
+    for (size_t i = 1; i < headers.size(); i++) {
+        if (headers[i].hashPrevBlock != headers[i - 1].GetHash())
+            return state.DoS(20, error("non-continuous headers sequence"));
+    }
+    if (ASSETCHAINS_ALGO != ASSETCHAINS_EQUIHASH || headers.empty())
+        return true;
+
+    std::vector<const CBlockHeader*> vUnknown;
+    {
+        LOCK(cs_main);
+        for (const CBlockHeader& header : headers) {
+            if (mapBlockIndex.count(header.GetHash()) == 0)
+                vUnknown.push_back(&header);
+        }
+        // Headers that don't connect are dropped by AcceptBlockHeader before any other check
+        if (vUnknown.empty() || mapBlockIndex.count(vUnknown[0]->hashPrevBlock) == 0)
+            return true;
+    }
+
+    const CChainParams& chainparams = Params();
+    std::vector<CBlockCheck> vChecks;
+    vChecks.reserve(vUnknown.size());
+    for (const CBlockHeader* pheader : vUnknown)
+        vChecks.emplace_back([pheader, &chainparams]() { return CheckEquihashSolution(pheader, chainparams); });
+
+    bool fValid = true;
+    if (nScriptCheckThreads) {
+        CCheckQueueControl<CBlockCheck> control(&headercheckqueue);
+        control.Add(vChecks);
+        fValid = control.Wait();
+    } else {
+        for (CBlockCheck& check : vChecks) {
+            if (!(fValid = check()))
+                break;
+        }
+    }
+    if (!fValid)
+        return state.DoS(100, error("%s: Equihash solution invalid", __func__), REJECT_INVALID, "invalid-solution");
+    return true;
+}
+
 #include "komodo_nSPV_defs.h"
 #include "komodo_nSPV.h"            // shared defines, structs, serdes, purge functions
 #include "komodo_nSPV_fullnode.h"   // nSPV fullnode handling of the getnSPV request messages
@@ -7655,6 +8439,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                         // Successful ping time measurement, replace previous
                         pfrom->nPingUsecTime = pingUsecTime;
                         pfrom->nMinPingUsecTime = std::min(pfrom->nMinPingUsecTime, pingUsecTime);
+                        MetricsHistogram("eskenas.net.ping.seconds", pingUsecTime * 0.000001);
                     } else {
                         // This should never happen
                         sProblem = "Timing mishap";
@@ -7836,6 +8621,15 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
                 LogPrint("net", "  getblocks stopping at %d %s\n", pindex->GetHeight(), pindex->GetBlockHash().ToString());
                 break;
             }
+            // If pruning, don't inv blocks unless we have them on disk and are likely to still have
+            // them for some reasonable time window (1 hour) that block relay might require.
+            // The hour is more than half of MIN_BLOCKS_TO_KEEP with -ac_blocktime under 25 seconds
+            const int nPrunedBlocksLikelyToHave = std::max((int)MIN_BLOCKS_TO_KEEP - 3600 / (int)Params().GetConsensus().nPowTargetSpacing, (int)MIN_BLOCKS_TO_KEEP / 2);
+            if (fPruneMode && (!(pindex->nStatus & BLOCK_HAVE_DATA) || pindex->GetHeight() <= chainActive.Height() - nPrunedBlocksLikelyToHave))
+            {
+                LogPrint("net", "  getblocks stopping, pruned or too old block at %d %s\n", pindex->GetHeight(), pindex->GetBlockHash().ToString());
+                break;
+            }
             pfrom->PushInventory(CInv(MSG_BLOCK, pindex->GetBlockHash()));
             if (--nLimit <= 0)
             {
@@ -7891,9 +8685,7 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             pfrom->lasthdrsreq = (int32_t)(pindex ? pindex->GetHeight() : -1);
             for (; pindex; pindex = chainActive.Next(pindex))
             {
-                CBlockHeader h = pindex->GetBlockHeader();
-                //printf("size.%i, solution size.%i\n", (int)sizeof(h), (int)h.nSolution.size());
-                //printf("hash.%s prevhash.%s nonce.%s\n", h.GetHash().ToString().c_str(), h.hashPrevBlock.ToString().c_str(), h.nNonce.ToString().c_str());
+                // read once, the solution of a trimmed entry comes from the block tree db
                 vHeaders.push_back(pindex->GetBlockHeader());
                 if (--nLimit <= 0 || pindex->GetBlockHash() == hashStop)
                     break;
@@ -8055,6 +8847,16 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             ReadCompactSize(vRecv); // ignore tx count; assume it is 0.
         }
 
+        {
+            CValidationState state;
+            if (!PreCheckHeaders(headers, state)) {
+                int nDoS;
+                if (state.IsInvalid(nDoS) && nDoS > 0)
+                    Misbehaving(pfrom->GetId(), nDoS);
+                return false;
+            }
+        }
+
         LOCK(cs_main);
 
         if (nCount == 0) {
@@ -8093,10 +8895,6 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
             //printf("hash.%s prevhash.%s nonce.%s\n", header.GetHash().ToString().c_str(), header.hashPrevBlock.ToString().c_str(), header.nNonce.ToString().c_str());
 
             CValidationState state;
-            if (pindexLast != NULL && header.hashPrevBlock != pindexLast->GetBlockHash()) {
-                Misbehaving(pfrom->GetId(), 20);
-                return error("non-continuous headers sequence");
-            }
             int32_t futureblock;
             if (!AcceptBlockHeader(&futureblock,header, state, &pindexLast)) {
                 int nDoS;
@@ -8322,6 +9120,20 @@ bool static ProcessMessage(CNode* pfrom, string strCommand, CDataStream& vRecv,
 }
 
 // requires LOCK(cs_vRecvMsg)
+/** Peers choose the command string, so only known commands are used as a metrics label. */
+static const char* MessageMetricsLabel(const std::string& strCommand)
+{
+    static const char* const knownCommands[] = {
+        "addr", "alert", "block", "events", "filteradd", "filterclear", "filterload",
+        "getaddr", "getblocks", "getdata", "getheaders", "getnSPV", "headers", "inv",
+        "mempool", "nSPV", "notfound", "ping", "pong", "reject", "tx", "verack", "version"
+    };
+    for (const char* pszCommand : knownCommands)
+        if (strCommand == pszCommand)
+            return pszCommand;
+    return "other";
+}
+
 bool ProcessMessages(CNode* pfrom)
 {
     //if (fDebug)
@@ -8398,7 +9210,9 @@ bool ProcessMessages(CNode* pfrom)
         bool fRet = false;
         try
         {
+            int64_t nTimeStart = GetTimeMicros();
             fRet = ProcessMessage(pfrom, strCommand, vRecv, msg.nTime);
+            MetricsHistogram("eskenas.net.message.seconds", (GetTimeMicros() - nTimeStart) * 0.000001, "command", MessageMetricsLabel(strCommand));
             boost::this_thread::interruption_point();
         }
         catch (const std::ios_base::failure& e)
@@ -41,11 +41,13 @@
 #include "spentindex.h"
 #include "sync.h"
 #include "tinyformat.h"
+#include "txcache.h"
 #include "txmempool.h"
 #include "uint256.h"
 
 #include <algorithm>
 #include <exception>
+#include <functional>
 #include <map>
 #include <set>
 #include <stdint.h>
@@ -59,6 +61,7 @@ class CBlockIndex;
 class CBlockTreeDB;
 class CBloomFilter;
 class CInv;
+class CBlockCheck;
 class CScriptCheck;
 class CValidationInterface;
 class CValidationState;
@@ -96,10 +99,21 @@ static const unsigned int MAX_TEMPFILE_SIZE = 0x1000000; // 16 MiB 0x8000000
 static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
 /** The pre-allocation chunk size for rev?????.dat files (since 0.8) */
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
+/**
+ * Notifications a listener may have pending before ActivateBestChain waits for it, each
+ * connected block raises a few and keeps a copy of the block alive until delivered
+ */
+static const size_t MAX_PENDING_VALIDATION_NOTIFICATIONS = 32;
 /** Maximum number of script-checking threads allowed */
-static const int MAX_SCRIPTCHECK_THREADS = 16;
+static const int MAX_SCRIPTCHECK_THREADS = 32;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** -prefetchblocks default (number of blocks read ahead of ConnectTip, 0 = disabled) */
+static const int DEFAULT_PREFETCH_BLOCKS = 64;
+/** -prefetchmem default (MiB of memory the blocks read ahead may use) */
+static const int DEFAULT_PREFETCH_MEMORY = 64;
+/** Number of threads reading blocks ahead, several reads in flight hide the latency of network volumes */
+static const int PREFETCH_THREADS = 4;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -132,6 +146,12 @@ static const bool DEFAULT_NSPV_PROCESSING = false;
 #define DEFAULT_ADDRESSINDEX (GetArg("-ac_cc",0) != 0 || GetArg("-ac_ccactivate",0) != 0)
 #define DEFAULT_SPENTINDEX (GetArg("-ac_cc",0) != 0 || GetArg("-ac_ccactivate",0) != 0)
 static const bool DEFAULT_TIMESTAMPINDEX = false;
+/** Default for -tokenindex, the per-token unspent output index used by the tokens CC */
+static const bool DEFAULT_TOKENINDEX = false;
+/** Default for -oraclesindex, the index of oracles data samples per feed */
+static const bool DEFAULT_ORACLESINDEX = false;
+/** Default for -ccindex, the index of CC transactions by evalcode, funcid and reference txid */
+static const bool DEFAULT_CCINDEX = false;
 static const unsigned int DEFAULT_DB_MAX_OPEN_FILES = 1000;
 static const bool DEFAULT_DB_COMPRESSION = true;
 
@@ -153,6 +173,8 @@ extern CScript COINBASE_FLAGS;
 extern CCriticalSection cs_main;
 extern CBlockPolicyEstimator feeEstimator;
 extern CTxMemPool mempool;
+/** Confirmed transactions recently read through the transaction index */
+extern CTxCache txCache;
 typedef boost::unordered_map<uint256, CBlockIndex*, BlockHasher> BlockMap;
 extern BlockMap mapBlockIndex;
 extern uint64_t nLastBlockTx;
@@ -164,8 +186,13 @@ extern bool fExperimentalMode;
 extern bool fImporting;
 extern bool fReindex;
 extern int nScriptCheckThreads;
+/** Number of blocks read ahead of ConnectTip when connecting blocks already on disk, 0 disables it */
+extern int nPrefetchBlocks;
 extern bool fTxIndex;
 extern bool fArchive;
+extern bool fTokenIndex;
+extern bool fOraclesIndex;
+extern bool fCCIndex;
 extern bool fIsBareMultisigStd;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
@@ -192,6 +219,12 @@ extern bool fPruneMode;
 extern uint64_t nPruneTarget;
 /** Block files containing a block-height within MIN_BLOCKS_TO_KEEP of chainActive.Tip() will not be pruned. */
 static const unsigned int MIN_BLOCKS_TO_KEEP = 288;
+/**
+ * Block files containing a block-height within NOTARISED_BLOCKS_TO_KEEP below the last notarised height
+ * will not be pruned either. Reorgs never go below the notarised height, the margin covers the
+ * notarised height itself being rolled back with the chain that notarised it.
+ */
+static const unsigned int NOTARISED_BLOCKS_TO_KEEP = 100;
 
 // Require that user allocate at least 550MB for block & undo files (blk???.dat and rev???.dat)
 // At 1MB per block, 288 blocks = 288MB.
@@ -248,6 +281,12 @@ bool ProcessMessages(CNode* pfrom);
 bool SendMessages(CNode* pto, bool fSendTrickle);
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the header checking thread */
+void ThreadHeaderCheck();
+/** Run an instance of the block read ahead thread */
+void ThreadBlockPrefetch();
+/** Limit the memory used by the blocks read ahead, in bytes */
+void SetBlockPrefetchMemory(size_t nMaxUsage);
 /** Try to detect Partition (network isolation) attacks against us */
 void PartitionCheck(bool (*initialDownloadCheck)(), CCriticalSection& cs, const CBlockIndex *const &bestHeader, int64_t nPowTargetSpacing);
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
@@ -273,7 +312,8 @@ CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams);
  * Pruning functions are called from FlushStateToDisk when the global fCheckForPruning flag has been set.
  * Block and undo files are deleted in lock-step (when blk00003.dat is deleted, so is rev00003.dat.)
  * Pruning cannot take place until the longest chain is at least a certain length (100000 on mainnet, 1000 on testnet, 10 on regtest).
- * Pruning will never delete a block within a defined distance (currently 288) from the active chain's tip.
+ * Pruning will never delete a block within a defined distance (currently 288) from the active chain's tip,
+ * nor within NOTARISED_BLOCKS_TO_KEEP below the last notarised height, and nothing before the chain is notarised.
  * The block index is updated by unsetting HAVE_DATA and HAVE_UNDO for any blocks that were stored in the deleted files.
  * A db flag records the fact that at least some block files have been pruned.
  *
@@ -507,6 +547,211 @@ struct  CAddressUnspentValue {
     }
 };
 
+/**
+ * Unspent token output, keyed by tokenid first so that all holders of a token,
+ * or the outputs of one holder, can be read with a single prefix scan.
+ */
+struct CTokenUnspentKey {
+    uint256 tokenid;
+    unsigned int type;
+    uint160 hashBytes;
+    uint256 txhash;
+    size_t index;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 89;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        tokenid.Serialize(s);
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        txhash.Serialize(s);
+        ser_writedata32(s, index);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        tokenid.Unserialize(s);
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        txhash.Unserialize(s);
+        index = ser_readdata32(s);
+    }
+
+    CTokenUnspentKey(uint256 tokenidIn, unsigned int addressType, uint160 addressHash, uint256 txid, size_t indexValue) {
+        tokenid = tokenidIn;
+        type = addressType;
+        hashBytes = addressHash;
+        txhash = txid;
+        index = indexValue;
+    }
+
+    CTokenUnspentKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        tokenid.SetNull();
+        type = 0;
+        hashBytes.SetNull();
+        txhash.SetNull();
+        index = 0;
+    }
+};
+
+struct CTokenIndexIteratorKey {
+    uint256 tokenid;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 32;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        tokenid.Serialize(s);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        tokenid.Unserialize(s);
+    }
+
+    CTokenIndexIteratorKey(uint256 tokenidIn) {
+        tokenid = tokenidIn;
+    }
+
+    CTokenIndexIteratorKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        tokenid.SetNull();
+    }
+};
+
+struct CTokenIndexIteratorAddressKey {
+    uint256 tokenid;
+    unsigned int type;
+    uint160 hashBytes;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 53;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        tokenid.Serialize(s);
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        tokenid.Unserialize(s);
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+    }
+
+    CTokenIndexIteratorAddressKey(uint256 tokenidIn, unsigned int addressType, uint160 addressHash) {
+        tokenid = tokenidIn;
+        type = addressType;
+        hashBytes = addressHash;
+    }
+
+    CTokenIndexIteratorAddressKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        tokenid.SetNull();
+        type = 0;
+        hashBytes.SetNull();
+    }
+};
+
+/**
+ * Oracles data sample, keyed by oracle and publisher baton address. Height and
+ * position in the block are stored inverted so that a forward scan returns the
+ * newest samples of a feed first.
+ */
+struct COracleSampleKey {
+    uint256 oracletxid;
+    uint160 batonHash;
+    int blockHeight;
+    unsigned int txindex;
+    uint256 txhash;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 92;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        oracletxid.Serialize(s);
+        batonHash.Serialize(s);
+        // Heights are stored big-endian for ordering
+        ser_writedata32be(s, ~(uint32_t)blockHeight);
+        ser_writedata32be(s, ~(uint32_t)txindex);
+        txhash.Serialize(s);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        oracletxid.Unserialize(s);
+        batonHash.Unserialize(s);
+        blockHeight = ~ser_readdata32be(s);
+        txindex = ~ser_readdata32be(s);
+        txhash.Unserialize(s);
+    }
+
+    COracleSampleKey(uint256 oracletxidIn, uint160 batonHashIn, int height, unsigned int blockindex, uint256 txid) {
+        oracletxid = oracletxidIn;
+        batonHash = batonHashIn;
+        blockHeight = height;
+        txindex = blockindex;
+        txhash = txid;
+    }
+
+    COracleSampleKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        oracletxid.SetNull();
+        batonHash.SetNull();
+        blockHeight = 0;
+        txindex = 0;
+        txhash.SetNull();
+    }
+};
+
+struct COracleSampleIteratorKey {
+    uint256 oracletxid;
+    uint160 batonHash;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 52;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        oracletxid.Serialize(s);
+        batonHash.Serialize(s);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        oracletxid.Unserialize(s);
+        batonHash.Unserialize(s);
+    }
+
+    COracleSampleIteratorKey(uint256 oracletxidIn, uint160 batonHashIn) {
+        oracletxid = oracletxidIn;
+        batonHash = batonHashIn;
+    }
+
+    COracleSampleIteratorKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        oracletxid.SetNull();
+        batonHash.SetNull();
+    }
+};
+
 struct CAddressIndexKey {
     unsigned int type;
     uint160 hashBytes;
@@ -714,9 +959,13 @@ bool ContextualCheckInputs(const CTransaction& tx, CValidationState &state, cons
                            const Consensus::Params& consensusParams, uint32_t consensusBranchId,
                            std::vector<CScriptCheck> *pvChecks = NULL);
 
-/** Check a transaction contextually against a set of consensus rules */
+/**
+ * Check a transaction contextually against a set of consensus rules. When
+ * pvChecks is set the Sapling proofs are appended to it instead of verified.
+ */
 bool ContextualCheckTransaction(int32_t slowflag,const CBlock *block, CBlockIndex * const pindexPrev,const CTransaction& tx, CValidationState &state, int nHeight, int dosLevel,
-                                bool (*isInitBlockDownload)() = IsInitialBlockDownload,int32_t validateprices=1);
+                                bool (*isInitBlockDownload)() = IsInitialBlockDownload,int32_t validateprices=1,
+                                std::vector<CBlockCheck> *pvChecks = NULL);
 
 /** Apply the effects of this transaction on the UTXO set represented by view */
 void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight);
@@ -804,6 +1053,31 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * A block level verification run on the script check queue: the script of
+ * one input, or a self-contained check such as the Sapling proofs of one
+ * transaction.
+ */
+class CBlockCheck
+{
+private:
+    CScriptCheck scriptCheck;
+    std::function<bool ()> func;
+
+public:
+    CBlockCheck() {}
+    //! Takes over the script check
+    explicit CBlockCheck(CScriptCheck& scriptCheckIn) { scriptCheck.swap(scriptCheckIn); }
+    explicit CBlockCheck(std::function<bool ()> funcIn) : func(std::move(funcIn)) {}
+
+    bool operator()() { return func ? func() : scriptCheck(); }
+
+    void swap(CBlockCheck &check) {
+        scriptCheck.swap(check.scriptCheck);
+        func.swap(check.func);
+    }
+};
+
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes);
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
 bool GetAddressIndex(uint160 addressHash, int type,
@@ -811,6 +1085,32 @@ bool GetAddressIndex(uint160 addressHash, int type,
                      int start = 0, int end = 0);
 bool GetAddressUnspent(uint160 addressHash, int type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+/**
+ * Paged address index reads for light clients. A page holds up to nLimit rows following the
+ * cursor in index order: from cursor.blockHeight on, after the row matching the cursor txhash,
+ * index and spending (its txindex is ignored). A null cursor txhash starts at the height.
+ */
+bool GetAddressIndexPage(uint160 addressHash, int type, const CAddressIndexKey &cursor, unsigned int nLimit,
+                         std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex);
+/** Up to nLimit unspent outputs following cursor in index (txid) order, from the first one if its txhash is null */
+bool GetAddressUnspentPage(uint160 addressHash, int type, const CAddressUnspentKey &cursor, unsigned int nLimit,
+                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+bool GetAddressUnspentValue(const CAddressUnspentKey &key, CAddressUnspentValue &value);
+/** Newest num (0 = all) confirmed data samples published to an oracle from a baton address */
+bool GetOracleSamples(uint256 oracletxid, uint160 batonHash, int32_t num,
+                      std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > > &samples);
+/** Keys under which a CC transaction is indexed in the CC index, empty for non CC transactions */
+void GetCCEvalIndexKeys(const CTransaction &tx, int height, unsigned int txindex, std::vector<CEvalIndexKey> &keys);
+/**
+ * Confirmed CC transactions with an evalcode, funcid (0 = any) and reference txid (null = any),
+ * in chain order. The mempool keeps its own overlay, see CTxMemPool::getEvalIndex
+ */
+bool GetCCEvalIndex(uint8_t evalcode, uint8_t funcid, uint256 reftxid, std::vector<CEvalIndexKey> &keys);
+/** Unspent outputs of a token, all holders or only those of one address */
+bool GetTokenUnspent(uint256 tokenid,
+                     std::vector<std::pair<CTokenUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+bool GetTokenUnspent(uint256 tokenid, uint160 addressHash, int type,
+                     std::vector<std::pair<CTokenUnspentKey, CAddressUnspentValue> > &unspentOutputs);
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
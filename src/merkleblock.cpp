@@ -110,6 +110,19 @@ void CPartialMerkleTree::TraverseAndBuild(int height, unsigned int pos, const st
     }
 }
 
+void CPartialMerkleTree::TraverseAndBuild(int height, unsigned int pos, const std::vector<std::vector<uint256> > &vLevels, unsigned int nMatch) {
+    // this node is a parent of the matched txid if the txid is within its range
+    bool fParentOfMatch = (nMatch >> height) == pos;
+    vBits.push_back(fParentOfMatch);
+    if (height==0 || !fParentOfMatch) {
+        vHash.push_back(vLevels[height][pos]);
+    } else {
+        TraverseAndBuild(height-1, pos*2, vLevels, nMatch);
+        if (pos*2+1 < CalcTreeWidth(height-1))
+            TraverseAndBuild(height-1, pos*2+1, vLevels, nMatch);
+    }
+}
+
 uint256 CPartialMerkleTree::TraverseAndExtract(int height, unsigned int pos, unsigned int &nBitsUsed, unsigned int &nHashUsed, std::vector<uint256> &vMatch) {
     if (nBitsUsed >= vBits.size()) {
         // overflowed the bits array - failure
@@ -160,8 +173,36 @@ CPartialMerkleTree::CPartialMerkleTree(const std::vector<uint256> &vTxid, const
     TraverseAndBuild(nHeight, 0, vTxid, vMatch);
 }
 
+CPartialMerkleTree::CPartialMerkleTree(const std::vector<std::vector<uint256> > &vLevels, unsigned int nMatch) : nTransactions(vLevels.empty() ? 0 : vLevels[0].size()), fBad(false) {
+    int nHeight = 0;
+    while (CalcTreeWidth(nHeight) > 1)
+        nHeight++;
+    assert(nMatch < nTransactions && vLevels.size() == (unsigned int)nHeight + 1);
+
+    TraverseAndBuild(nHeight, 0, vLevels, nMatch);
+}
+
 CPartialMerkleTree::CPartialMerkleTree() : nTransactions(0), fBad(true) {}
 
+std::vector<std::vector<uint256> > BuildMerkleLevels(const std::vector<uint256> &vTxid) {
+    std::vector<std::vector<uint256> > vLevels;
+    if (vTxid.empty())
+        return vLevels;
+    vLevels.push_back(vTxid);
+    while (vLevels.back().size() > 1) {
+        const std::vector<uint256> &below = vLevels.back();
+        std::vector<uint256> level;
+        level.reserve((below.size() + 1) / 2);
+        for (unsigned int i = 0; i < below.size(); i += 2) {
+            const uint256 &left = below[i];
+            const uint256 &right = i + 1 < below.size() ? below[i + 1] : below[i];
+            level.push_back(Hash(BEGIN(left), END(left), BEGIN(right), END(right)));
+        }
+        vLevels.push_back(level);
+    }
+    return vLevels;
+}
+
 uint256 CPartialMerkleTree::ExtractMatches(std::vector<uint256> &vMatch) {
     vMatch.clear();
     // An empty set will not work
@@ -88,6 +88,9 @@ protected:
     /** recursive function that traverses tree nodes, storing the data as bits and hashes */
     void TraverseAndBuild(int height, unsigned int pos, const std::vector<uint256> &vTxid, const std::vector<bool> &vMatch);
 
+    /** same as above for a single matched txid, taking the node hashes from the levels of the full tree */
+    void TraverseAndBuild(int height, unsigned int pos, const std::vector<std::vector<uint256> > &vLevels, unsigned int nMatch);
+
     /**
      * recursive function that traverses tree nodes, consuming the bits and hashes produced by TraverseAndBuild.
      * it returns the hash of the respective node.
@@ -122,6 +125,14 @@ public:
     /** Construct a partial merkle tree from a list of transaction ids, and a mask that selects a subset of them */
     CPartialMerkleTree(const std::vector<uint256> &vTxid, const std::vector<bool> &vMatch);
 
+    /**
+     * Construct a partial merkle tree matching only the txid at position nMatch, from the
+     * levels of the full tree returned by BuildMerkleLevels(). Proofs for many txids of the
+     * same block can then share one tree computation. The result is identical to matching
+     * that txid alone with the constructor above.
+     */
+    CPartialMerkleTree(const std::vector<std::vector<uint256> > &vLevels, unsigned int nMatch);
+
     CPartialMerkleTree();
 
     /**
@@ -157,6 +168,9 @@ public:
     // Create from a CBlock, matching the txids in the set
     CMerkleBlock(const CBlock& block, const std::set<uint256>& txids);
 
+    // Create from a header and an already built partial merkle tree
+    CMerkleBlock(const CBlockHeader& headerIn, const CPartialMerkleTree& txnIn) : header(headerIn), txn(txnIn) {}
+
     CMerkleBlock() {}
 
     ADD_SERIALIZE_METHODS;
@@ -168,4 +182,10 @@ public:
     }
 };
 
+/**
+ * Every level of the merkle tree over vTxid, leaves first and the root last, where
+ * an odd node is paired with itself like in CPartialMerkleTree::CalcHash.
+ */
+std::vector<std::vector<uint256> > BuildMerkleLevels(const std::vector<uint256> &vTxid);
+
 #endif // BITCOIN_MERKLEBLOCK_H
@@ -9,7 +9,7 @@
 class NotarisationDB : public CDBWrapper
 {
 public:
-    NotarisationDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    NotarisationDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, const CDBOptions& dbOptions = GetDBProfile("notarisations"));
 };
 
 
@@ -30,6 +30,96 @@
 // default hash algorithm for block
 uint256 (CBlockHeader::*CBlockHeader::hashFunction)() const = &CBlockHeader::GetSHA256DHash;
 
+std::atomic<uint64_t> CBlockHeader::nHashesComputed(0);
+static thread_local bool fNoHashMemo = false;
+
+CBlockHeader::CNoHashMemo::CNoHashMemo() : fPrevious(fNoHashMemo)
+{
+    fNoHashMemo = true;
+}
+
+CBlockHeader::CNoHashMemo::~CNoHashMemo()
+{
+    fNoHashMemo = fPrevious;
+}
+
+/**
+ * Cheap digest of the solution to key the memo on, instead of a copy of it.
+ * It only has to tell in place edits apart: headers read from the network
+ * start without a memo.
+ */
+static uint64_t SolutionDigest(const std::vector<unsigned char>& solution)
+{
+    uint64_t digest = 0x9e3779b97f4a7c15ULL ^ solution.size();
+    size_t i = 0;
+    for (; i + 8 <= solution.size(); i += 8) {
+        digest = (digest ^ ReadLE64(&solution[i])) * 0xff51afd7ed558ccdULL;
+        digest ^= digest >> 32;
+    }
+    for (; i < solution.size(); i++)
+        digest = (digest ^ solution[i]) * 0xc4ceb9fe1a85ec53ULL;
+    return digest;
+}
+
+struct CBlockHeader::CHashMemo
+{
+    uint256 (CBlockHeader::*hashFunction)() const;
+    int32_t nVersion;
+    uint256 hashPrevBlock;
+    uint256 hashMerkleRoot;
+    uint256 hashFinalSaplingRoot;
+    uint32_t nTime;
+    uint32_t nBits;
+    uint256 nNonce;
+    size_t nSolutionSize;
+    uint64_t nSolutionDigest;
+    uint256 hash;
+
+    bool Matches(const CBlockHeader& header) const
+    {
+        // the hash algorithm changes once the chain parameters are known
+        return hashFunction == CBlockHeader::hashFunction &&
+               nVersion == header.nVersion &&
+               nTime == header.nTime &&
+               nBits == header.nBits &&
+               hashPrevBlock == header.hashPrevBlock &&
+               hashMerkleRoot == header.hashMerkleRoot &&
+               hashFinalSaplingRoot == header.hashFinalSaplingRoot &&
+               nNonce == header.nNonce &&
+               nSolutionSize == header.nSolution.size() &&
+               nSolutionDigest == SolutionDigest(header.nSolution);
+    }
+};
+
+uint256 CBlockHeader::GetHash() const
+{
+    bool fMemoize = !fNoHashMemo;
+    if (fMemoize) {
+        std::shared_ptr<const CHashMemo> memo = std::atomic_load(&hashMemo);
+        if (memo && memo->Matches(*this))
+            return memo->hash;
+    }
+
+    auto memo = std::make_shared<CHashMemo>();
+    memo->hashFunction = hashFunction;
+    memo->hash = (this->*(memo->hashFunction))();
+    nHashesComputed++;
+    if (!fMemoize)
+        return memo->hash;
+
+    memo->nVersion = nVersion;
+    memo->hashPrevBlock = hashPrevBlock;
+    memo->hashMerkleRoot = hashMerkleRoot;
+    memo->hashFinalSaplingRoot = hashFinalSaplingRoot;
+    memo->nTime = nTime;
+    memo->nBits = nBits;
+    memo->nNonce = nNonce;
+    memo->nSolutionSize = nSolution.size();
+    memo->nSolutionDigest = SolutionDigest(nSolution);
+    std::atomic_store(&hashMemo, std::shared_ptr<const CHashMemo>(memo));
+    return memo->hash;
+}
+
 uint256 CBlockHeader::GetSHA256DHash() const
 {
     return SerializeHash(*this);
@@ -172,15 +262,19 @@ uint256 BuildMerkleTree(bool* fMutated, const std::vector<uint256> leaves,
     bool mutated = false;
     for (int nSize = leaves.size(); nSize > 1; nSize = (nSize + 1) / 2)
     {
-        for (int i = 0; i < nSize; i += 2)
-        {
-            int i2 = std::min(i+1, nSize-1);
-            if (i2 == i + 1 && i2 + 1 == nSize && vMerkleTree[j+i] == vMerkleTree[j+i2]) {
-                // Two identical hashes at the end of the list at a particular level.
-                mutated = true;
-            }
-            vMerkleTree.push_back(Hash(BEGIN(vMerkleTree[j+i]),  END(vMerkleTree[j+i]),
-                                       BEGIN(vMerkleTree[j+i2]), END(vMerkleTree[j+i2])));
+        if ((nSize & 1) == 0 && vMerkleTree[j+nSize-2] == vMerkleTree[j+nSize-1]) {
+            // Two identical hashes at the end of the list at a particular level.
+            mutated = true;
+        }
+        // Each pair of adjacent nodes is a contiguous 64-byte blob, so the
+        // whole level is hashed at once through the multi-lane SHA256D64.
+        int nPairs = nSize / 2;
+        vMerkleTree.resize(j + nSize + (nSize + 1) / 2);
+        SHA256D64(vMerkleTree[j+nSize].begin(), vMerkleTree[j].begin(), nPairs);
+        if (nSize & 1) {
+            // An odd node out at the end is paired with itself.
+            vMerkleTree[j+nSize+nPairs] = Hash(BEGIN(vMerkleTree[j+nSize-1]), END(vMerkleTree[j+nSize-1]),
+                                               BEGIN(vMerkleTree[j+nSize-1]), END(vMerkleTree[j+nSize-1]));
         }
         j += nSize;
     }
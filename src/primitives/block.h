@@ -27,6 +27,9 @@
 #include "uint256.h"
 #include "arith_uint256.h"
 
+#include <atomic>
+#include <memory>
+
 extern int32_t ASSETCHAINS_LWMAPOS;
 
 /** Nodes collect new transactions into a block, hash them into a hash tree,
@@ -38,6 +41,12 @@ extern int32_t ASSETCHAINS_LWMAPOS;
  */
 class CBlockHeader
 {
+private:
+    struct CHashMemo;
+
+    //! Last hash computed by GetHash(), with the fields it was computed from
+    mutable std::shared_ptr<const CHashMemo> hashMemo;
+
 public:
     // header
     static const size_t HEADER_SIZE=4+32+32+32+4+4+32; // excluding Equihash solution
@@ -54,15 +63,67 @@ public:
     CPOSNonce nNonce;
     std::vector<unsigned char> nSolution;
 
+    //! Number of header hashes GetHash() had to compute, for benchmarks
+    static std::atomic<uint64_t> nHashesComputed;
+
+    //! Makes GetHash() ignore the memo on the calling thread while in scope, for benchmarks
+    class CNoHashMemo
+    {
+    private:
+        bool fPrevious;
+
+    public:
+        CNoHashMemo();
+        ~CNoHashMemo();
+    };
+
     CBlockHeader()
     {
         SetNull();
     }
 
+    // The memo is swapped atomically by const GetHash() calls from other
+    // threads, so it has to be loaded atomically when copying as well
+    CBlockHeader(const CBlockHeader& other) :
+        hashMemo(std::atomic_load(&other.hashMemo)),
+        nVersion(other.nVersion),
+        hashPrevBlock(other.hashPrevBlock),
+        hashMerkleRoot(other.hashMerkleRoot),
+        hashFinalSaplingRoot(other.hashFinalSaplingRoot),
+        nTime(other.nTime),
+        nBits(other.nBits),
+        nNonce(other.nNonce),
+        nSolution(other.nSolution)
+    {
+    }
+
+    CBlockHeader& operator=(const CBlockHeader& other)
+    {
+        if (this != &other) {
+            std::atomic_store(&hashMemo, std::atomic_load(&other.hashMemo));
+            nVersion = other.nVersion;
+            hashPrevBlock = other.hashPrevBlock;
+            hashMerkleRoot = other.hashMerkleRoot;
+            hashFinalSaplingRoot = other.hashFinalSaplingRoot;
+            nTime = other.nTime;
+            nBits = other.nBits;
+            nNonce = other.nNonce;
+            nSolution = other.nSolution;
+        }
+        return *this;
+    }
+
+    // A header being moved from is not shared with other threads
+    CBlockHeader(CBlockHeader&& other) = default;
+    CBlockHeader& operator=(CBlockHeader&& other) = default;
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action) {
+        // the memo only tells in place edits apart, not a header read over another one
+        if (ser_action.ForRead())
+            std::atomic_store(&hashMemo, std::shared_ptr<const CHashMemo>());
         READWRITE(this->nVersion);
         READWRITE(hashPrevBlock);
         READWRITE(hashMerkleRoot);
@@ -83,6 +144,7 @@ public:
         nBits = 0;
         nNonce = uint256();
         nSolution.clear();
+        std::atomic_store(&hashMemo, std::shared_ptr<const CHashMemo>());
     }
 
     bool IsNull() const
@@ -90,10 +152,13 @@ public:
         return (nBits == 0);
     }
 
-    uint256 GetHash() const
-    {
-        return (this->*hashFunction)();
-    }
+    /**
+     * The header fields are public and modified in place all over the code,
+     * so instead of invalidating on every write the memo keeps a copy of the
+     * fixed fields it was computed from and a digest of the solution, and is
+     * only used while they still match.
+     */
+    uint256 GetHash() const;
 
     uint256 GetSHA256DHash() const;
     static void SetSHA256DHash();
@@ -90,6 +90,9 @@ enum {
     // Zcash nodes used to support this by default, without advertising this bit,
     // but no longer do as of protocol version 170004 (= NO_BLOOM_VERSION)
     NODE_BLOOM = (1 << 2),
+    // NODE_NETWORK_LIMITED means the same as NODE_NETWORK with the limitation of only
+    // serving the last MIN_BLOCKS_TO_KEEP blocks. It is set by pruned nodes (BIP 159).
+    NODE_NETWORK_LIMITED = (1 << 10),
 
     NODE_NSPV = (1 << 30),
     NODE_ADDRINDEX = (1 << 29),
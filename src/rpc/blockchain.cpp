@@ -25,6 +25,7 @@
 #include "crosschain.h"
 #include "base58.h"
 #include "consensus/validation.h"
+#include "dbwrapper.h"
 #include "cc/eval.h"
 #include "main.h"
 #include "primitives/transaction.h"
@@ -150,7 +151,7 @@ UniValue blockheaderToJSON(const CBlockIndex* blockindex)
     result.push_back(Pair("finalsaplingroot", blockindex->hashFinalSaplingRoot.GetHex()));
     result.push_back(Pair("time", (int64_t)blockindex->nTime));
     result.push_back(Pair("nonce", blockindex->nNonce.GetHex()));
-    result.push_back(Pair("solution", HexStr(blockindex->nSolution)));
+    result.push_back(Pair("solution", HexStr(blockindex->GetSolution())));
     result.push_back(Pair("bits", strprintf("%08x", blockindex->nBits)));
     result.push_back(Pair("difficulty", GetDifficulty(blockindex)));
     result.push_back(Pair("chainwork", blockindex->chainPower.chainWork.GetHex()));
@@ -961,6 +962,111 @@ UniValue gettxoutsetinfo(const UniValue& params, bool fHelp, const CPubKey& mypk
 }
 
 
+UniValue getdbstats(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (fHelp || params.size() != 0)
+        throw runtime_error(
+            "getdbstats\n"
+            "\nReturns the LevelDB options and statistics of the open databases.\n"
+            "\nResult:\n"
+            "[\n"
+            "  {\n"
+            "    \"name\": \"xxxx\",            (string) blockindex, chainstate or notarisations\n"
+            "    \"options\": {             (object) the options set by the database profile and -dboptions\n"
+            "      \"blocksize\": n,\n"
+            "      \"cacheshare\": n,\n"
+            "      \"writebuffershare\": n,\n"
+            "      \"compression\": true|false,\n"
+            "      \"bloombits\": n,\n"
+            "      \"checksums\": true|false,\n"
+            "      \"iteratorchecksums\": true|false,\n"
+            "      \"maxopenfiles\": n\n"
+            "    },\n"
+            "    \"files\": [ n, ... ],     (array) number of table files at each level\n"
+            "    \"approximatesize\": n,    (numeric) approximate size on disk in bytes\n"
+            "    \"stats\": \"xxxx\"            (string) the compaction statistics of LevelDB\n"
+            "  }, ...\n"
+            "]\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdbstats", "")
+            + HelpExampleRpc("getdbstats", "")
+        );
+
+    UniValue ret(UniValue::VARR);
+    ForEachDBWrapper([&ret](CDBWrapper& db) {
+        const CDBOptions& dbOptions = db.GetDBOptions();
+        if (dbOptions.strName.empty())
+            return;
+        UniValue options(UniValue::VOBJ);
+        options.push_back(Pair("blocksize", (uint64_t)dbOptions.nBlockSize));
+        options.push_back(Pair("cacheshare", dbOptions.nCacheShare));
+        options.push_back(Pair("writebuffershare", dbOptions.nWriteBufferShare));
+        options.push_back(Pair("compression", dbOptions.fCompression));
+        options.push_back(Pair("bloombits", dbOptions.nBloomBits));
+        options.push_back(Pair("checksums", dbOptions.fVerifyChecksums));
+        options.push_back(Pair("iteratorchecksums", dbOptions.fVerifyIteratorChecksums));
+        options.push_back(Pair("maxopenfiles", dbOptions.nMaxOpenFiles));
+
+        UniValue files(UniValue::VARR);
+        for (int nLevel = 0; nLevel < 7; nLevel++) {
+            std::string strValue;
+            if (!db.GetProperty(strprintf("leveldb.num-files-at-level%d", nLevel), strValue))
+                break;
+            files.push_back(atoi(strValue));
+        }
+        std::string strStats;
+        db.GetProperty("leveldb.stats", strStats);
+
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("name", dbOptions.strName));
+        entry.push_back(Pair("options", options));
+        entry.push_back(Pair("files", files));
+        entry.push_back(Pair("approximatesize", db.GetApproximateSize()));
+        entry.push_back(Pair("stats", strStats));
+        ret.push_back(entry);
+    });
+    return ret;
+}
+
+UniValue compactdb(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    if (fHelp || params.size() > 1)
+        throw runtime_error(
+            "compactdb ( \"name\" )\n"
+            "\nCompacts a database, or all of them, merging its table files down to the last level.\n"
+            "Note this call may take some time and slows down the other database users meanwhile.\n"
+            "\nArguments:\n"
+            "1. \"name\"    (string, optional) blockindex, chainstate or notarisations, all databases if omitted\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"name\": n,    (numeric) milliseconds spent compacting each database\n"
+            "  ...\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("compactdb", "\"chainstate\"")
+            + HelpExampleRpc("compactdb", "\"chainstate\"")
+        );
+
+    std::string strName;
+    if (params.size() > 0)
+        strName = params[0].get_str();
+
+    UniValue ret(UniValue::VOBJ);
+    ForEachDBWrapper([&ret, &strName](CDBWrapper& db) {
+        const std::string& strDBName = db.GetDBOptions().strName;
+        if (strDBName.empty() || (!strName.empty() && strDBName != strName))
+            return;
+        int64_t nStart = GetTimeMillis();
+        db.Compact();
+        int64_t nTime = GetTimeMillis() - nStart;
+        LogPrintf("Compacted the %s database in %dms\n", strDBName, nTime);
+        ret.push_back(Pair(strDBName, nTime));
+    });
+    if (!strName.empty() && ret.empty())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown database " + strName);
+    return ret;
+}
+
 UniValue kvsearch(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
     UniValue ret(UniValue::VOBJ); uint32_t flags; uint8_t value[IGUANA_MAXSCRIPTSIZE*8],key[IGUANA_MAXSCRIPTSIZE*8]; int32_t duration,j,height,valuesize,keylen; uint256 refpubkey; static uint256 zeroes;
@@ -2247,6 +2353,8 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
     { "blockchain",         "gettxout",               &gettxout,               true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
+    { "blockchain",         "getdbstats",             &getdbstats,             true  },
+    { "blockchain",         "compactdb",              &compactdb,              true  },
     { "blockchain",         "verifychain",            &verifychain,            true  },
 
     /* Not shown in help */
@@ -28,9 +28,11 @@
 #include "ui_interface.h"
 #include "util.h"
 #include "utilstrencodings.h"
+#include "validationinterface.h"
 #include "asyncrpcqueue.h"
 
 #include <memory>
+#include <set>
 
 #include <univalue.h>
 #include <unistd.h>
@@ -335,6 +337,8 @@ static const CRPCCommand vRPCCommands[] =
     { "blockchain",         "gettxoutproof",          &gettxoutproof,          true  },
     { "blockchain",         "verifytxoutproof",       &verifytxoutproof,       true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
+    { "blockchain",         "getdbstats",             &getdbstats,             true  },
+    { "blockchain",         "compactdb",              &compactdb,              true  },
     { "blockchain",         "verifychain",            &verifychain,            true  },
     { "blockchain",         "getspentinfo",           &getspentinfo,           false },
     //{ "blockchain",         "paxprice",               &paxprice,               true  },
@@ -550,6 +554,7 @@ static const CRPCCommand vRPCCommands[] =
     { "tokens",       "mytokenorders",    &mytokenorders,     true },
     { "tokens",       "tokenaddress",     &tokenaddress,      true },
     { "tokens",       "tokenbalance",     &tokenbalance,      true },
+    { "tokens",       "tokenholders",     &tokenholders,      true },
     { "tokens",       "tokencreate",      &tokencreate,       true },
     { "tokens",       "tokentransfer",    &tokentransfer,     true },
     { "tokens",       "tokenbid",         &tokenbid,          true },
@@ -901,6 +906,21 @@ UniValue get_async_result(std::string sOpID)
     return oResult;
 }
 
+/**
+ * Whether a call reads or spends from pwalletMain: the wallet categories, fundrawtransaction
+ * and the CC calls, which fund their transactions from the wallet through AddNormalinputs.
+ */
+static bool RPCUsesWallet(const CRPCCommand& cmd)
+{
+    static const std::set<std::string> setWalletCategories = {
+        "wallet", "disclosure", "consolidation", "eskenas Exclusive",
+        "CClib", "FSM", "auction", "channels", "dice", "faucet", "gateways", "heir",
+        "lotto", "oracles", "payments", "pegs", "prices", "rewards", "tokens"
+    };
+    return setWalletCategories.count(cmd.category) > 0 ||
+        cmd.name == "fundrawtransaction" || cmd.name == "resendwallettransactions";
+}
+
 UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params) const
 {
     const CRPCCommand *pcmd = tableRPC[strMethod];
@@ -933,6 +953,12 @@ UniValue CRPCTable::execute(const std::string &strMethod, const UniValue &params
     }
 
 
+    // Calls that reach the wallet see it caught up with the blocks connected so far
+#ifdef ENABLE_WALLET
+    if (pwalletMain && RPCUsesWallet(*pcmd))
+        SyncWithValidationInterfaceQueue();
+#endif
+
     g_rpcSignals.PreCommand(*pcmd);
 
     try
@@ -258,6 +258,7 @@ extern UniValue tokenlist(const UniValue& params, bool fHelp, const CPubKey& myp
 extern UniValue tokenorders(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue mytokenorders(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue tokenbalance(const UniValue& params, bool fHelp, const CPubKey& mypk);
+extern UniValue tokenholders(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue assetsaddress(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue tokenaddress(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue tokencreate(const UniValue& params, bool fHelp, const CPubKey& mypk);
@@ -452,6 +453,8 @@ extern UniValue getblockheader(const UniValue& params, bool fHelp, const CPubKey
 extern UniValue getlastsegidstakes(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue getblock(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue gettxoutsetinfo(const UniValue& params, bool fHelp, const CPubKey& mypk);
+extern UniValue getdbstats(const UniValue& params, bool fHelp, const CPubKey& mypk);
+extern UniValue compactdb(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue gettxout(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue verifychain(const UniValue& params, bool fHelp, const CPubKey& mypk);
 extern UniValue getchaintips(const UniValue& params, bool fHelp, const CPubKey& mypk);
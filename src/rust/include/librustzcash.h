@@ -154,6 +154,61 @@ extern "C" {
     /// `librustzcash_sapling_proving_ctx_init`.
     void librustzcash_sapling_proving_ctx_free(void *);
 
+    /// Creates a Sapling proving context for a share of the Spend and
+    /// Output descriptions of a transaction, so that they can be proven
+    /// on several threads. Please free this when you're done.
+    void * librustzcash_sapling_partial_proving_ctx_init();
+
+    /// As `librustzcash_sapling_spend_proof`, with a partial proving
+    /// context.
+    bool librustzcash_sapling_partial_spend_proof(
+        void *ctx,
+        const unsigned char *ak,
+        const unsigned char *nsk,
+        const unsigned char *diversifier,
+        const unsigned char *rcm,
+        const unsigned char *ar,
+        const uint64_t value,
+        const unsigned char *anchor,
+        const unsigned char *witness,
+        unsigned char *cv,
+        unsigned char *rk,
+        unsigned char *zkproof
+    );
+
+    /// As `librustzcash_sapling_output_proof`, with a partial proving
+    /// context.
+    bool librustzcash_sapling_partial_output_proof(
+        void *ctx,
+        const unsigned char *esk,
+        const unsigned char *payment_address,
+        const unsigned char *rcm,
+        const uint64_t value,
+        unsigned char *cv,
+        unsigned char *zkproof
+    );
+
+    /// Adds the descriptions proven with the partial proving context
+    /// `other` to `ctx`. `other` still has to be freed.
+    void librustzcash_sapling_partial_proving_ctx_merge(
+        void *ctx,
+        const void *other
+    );
+
+    /// As `librustzcash_sapling_binding_sig`, with the partial proving
+    /// context all the partial contexts of the transaction have been
+    /// merged into.
+    bool librustzcash_sapling_partial_binding_sig(
+        const void *ctx,
+        int64_t valueBalance,
+        const unsigned char *sighash,
+        unsigned char *result
+    );
+
+    /// Frees a Sapling proving context returned from
+    /// `librustzcash_sapling_partial_proving_ctx_init`.
+    void librustzcash_sapling_partial_proving_ctx_free(void *);
+
     /// Creates a Sapling verification context. Please free this
     /// when you're done.
     void * librustzcash_sapling_verification_ctx_init();
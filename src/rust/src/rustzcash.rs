@@ -53,7 +53,7 @@ use zcash_primitives::{
     note_encryption::sapling_ka_agree,
     primitives::{Diversifier, Note, PaymentAddress, ProofGenerationKey, Rseed, ViewingKey},
     redjubjub::{self, Signature},
-    sapling::{merkle_hash, spend_sig},
+    sapling::{merkle_hash, spend_sig, Node},
     transaction::components::Amount,
     zip32,
 };
@@ -66,9 +66,12 @@ use zcash_proofs::{
 
 use zcash_history::{Entry as MMREntry, NodeData as MMRNodeData, Tree as MMRTree};
 
+use crate::sapling_prover::SaplingPartialProvingContext;
+
 mod blake2b;
 mod ed25519;
 mod metrics_ffi;
+mod sapling_prover;
 mod tracing_ffi;
 
 #[cfg(test)]
@@ -761,6 +764,24 @@ pub extern "C" fn librustzcash_sprout_verify(
     )
 }
 
+/// Parses the witness of an Output proof.
+fn output_proof_inputs(
+    esk: *const [c_uchar; 32],
+    payment_address: *const [c_uchar; 43],
+    rcm: *const [c_uchar; 32],
+) -> Option<(jubjub::Scalar, PaymentAddress, jubjub::Scalar)> {
+    // Grab `esk`, which the caller should have constructed for the DH key exchange.
+    let esk = de_ct(jubjub::Scalar::from_bytes(unsafe { &*esk }))?;
+
+    // Grab the payment address from the caller
+    let payment_address = PaymentAddress::from_bytes(unsafe { &*payment_address })?;
+
+    // The caller provides the commitment randomness for the output note
+    let rcm = de_ct(jubjub::Scalar::from_bytes(unsafe { &*rcm }))?;
+
+    Some((esk, payment_address, rcm))
+}
+
 /// This function (using the proving context) constructs an Output proof given
 /// the necessary witness information. It outputs `cv` and the `zkproof`.
 #[no_mangle]
@@ -773,21 +794,8 @@ pub extern "C" fn librustzcash_sapling_output_proof(
     cv: *mut [c_uchar; 32],
     zkproof: *mut [c_uchar; GROTH_PROOF_SIZE],
 ) -> bool {
-    // Grab `esk`, which the caller should have constructed for the DH key exchange.
-    let esk = match de_ct(jubjub::Scalar::from_bytes(unsafe { &*esk })) {
-        Some(p) => p,
-        None => return false,
-    };
-
-    // Grab the payment address from the caller
-    let payment_address = match PaymentAddress::from_bytes(unsafe { &*payment_address }) {
-        Some(pa) => pa,
-        None => return false,
-    };
-
-    // The caller provides the commitment randomness for the output note
-    let rcm = match de_ct(jubjub::Scalar::from_bytes(unsafe { &*rcm })) {
-        Some(p) => p,
+    let (esk, payment_address, rcm) = match output_proof_inputs(esk, payment_address, rcm) {
+        Some(inputs) => inputs,
         None => return false,
     };
 
@@ -811,6 +819,43 @@ pub extern "C" fn librustzcash_sapling_output_proof(
     true
 }
 
+/// As [`librustzcash_sapling_output_proof`], with a partial proving context
+/// returned from [`librustzcash_sapling_partial_proving_ctx_init`].
+#[no_mangle]
+pub extern "C" fn librustzcash_sapling_partial_output_proof(
+    ctx: *mut SaplingPartialProvingContext,
+    esk: *const [c_uchar; 32],
+    payment_address: *const [c_uchar; 43],
+    rcm: *const [c_uchar; 32],
+    value: u64,
+    cv: *mut [c_uchar; 32],
+    zkproof: *mut [c_uchar; GROTH_PROOF_SIZE],
+) -> bool {
+    let (esk, payment_address, rcm) = match output_proof_inputs(esk, payment_address, rcm) {
+        Some(inputs) => inputs,
+        None => return false,
+    };
+
+    let (proof, value_commitment) = match unsafe { &mut *ctx }.output_proof(
+        esk,
+        payment_address,
+        rcm,
+        value,
+        unsafe { SAPLING_OUTPUT_PARAMS.as_ref() }.unwrap(),
+    ) {
+        Ok(res) => res,
+        Err(_) => return false,
+    };
+
+    proof
+        .write(&mut (unsafe { &mut *zkproof })[..])
+        .expect("should be able to serialize a proof");
+
+    *unsafe { &mut *cv } = value_commitment.to_bytes();
+
+    true
+}
+
 /// Computes the signature for each Spend description, given the key `ask`, the
 /// re-randomization `ar`, the 32-byte sighash `sighash`, and an output `result`
 /// buffer of 64-bytes for the signature.
@@ -877,41 +922,57 @@ pub extern "C" fn librustzcash_sapling_binding_sig(
     true
 }
 
-/// This function (using the proving context) constructs a Spend proof given the
-/// necessary witness information. It outputs `cv` (the value commitment) and
-/// `rk` (so that you don't have to compute it) along with the proof.
+/// As [`librustzcash_sapling_binding_sig`], with the partial proving context
+/// all the partial contexts of the transaction have been merged into.
 #[no_mangle]
-pub extern "C" fn librustzcash_sapling_spend_proof(
-    ctx: *mut SaplingProvingContext,
+pub extern "C" fn librustzcash_sapling_partial_binding_sig(
+    ctx: *const SaplingPartialProvingContext,
+    value_balance: i64,
+    sighash: *const [c_uchar; 32],
+    result: *mut [c_uchar; 64],
+) -> bool {
+    let value_balance = match Amount::from_i64(value_balance) {
+        Ok(vb) => vb,
+        Err(()) => return false,
+    };
+
+    let sig = match unsafe { &*ctx }.binding_sig(value_balance, unsafe { &*sighash }) {
+        Ok(s) => s,
+        Err(_) => return false,
+    };
+
+    sig.write(&mut (unsafe { &mut *result })[..])
+        .expect("result should be 64 bytes");
+
+    true
+}
+
+/// Parses the witness of a Spend proof.
+#[allow(clippy::type_complexity)]
+fn spend_proof_inputs(
     ak: *const [c_uchar; 32],
     nsk: *const [c_uchar; 32],
     diversifier: *const [c_uchar; 11],
     rcm: *const [c_uchar; 32],
     ar: *const [c_uchar; 32],
-    value: u64,
     anchor: *const [c_uchar; 32],
     merkle_path: *const [c_uchar; 1 + 33 * SAPLING_TREE_DEPTH + 8],
-    cv: *mut [c_uchar; 32],
-    rk_out: *mut [c_uchar; 32],
-    zkproof: *mut [c_uchar; GROTH_PROOF_SIZE],
-) -> bool {
+) -> Option<(
+    ProofGenerationKey,
+    Diversifier,
+    Rseed,
+    jubjub::Scalar,
+    bls12_381::Scalar,
+    MerklePath<Node>,
+)> {
     // Grab `ak` from the caller, which should be a point.
-    let ak = match de_ct(jubjub::ExtendedPoint::from_bytes(unsafe { &*ak })) {
-        Some(p) => p,
-        None => return false,
-    };
+    let ak = de_ct(jubjub::ExtendedPoint::from_bytes(unsafe { &*ak }))?;
 
     // `ak` should be prime order.
-    let ak = match de_ct(ak.into_subgroup()) {
-        Some(p) => p,
-        None => return false,
-    };
+    let ak = de_ct(ak.into_subgroup())?;
 
     // Grab `nsk` from the caller
-    let nsk = match de_ct(jubjub::Scalar::from_bytes(unsafe { &*nsk })) {
-        Some(p) => p,
-        None => return false,
-    };
+    let nsk = de_ct(jubjub::Scalar::from_bytes(unsafe { &*nsk }))?;
 
     // Construct the proof generation key
     let proof_generation_key = ProofGenerationKey {
@@ -925,28 +986,43 @@ pub extern "C" fn librustzcash_sapling_spend_proof(
     // The caller chooses the note randomness
     // If this is after ZIP 212, the caller has calculated rcm, and we don't need to call
     // Note::derive_esk, so we just pretend the note was using this rcm all along.
-    let rseed = match de_ct(jubjub::Scalar::from_bytes(unsafe { &*rcm })) {
-        Some(p) => Rseed::BeforeZip212(p),
-        None => return false,
-    };
+    let rseed = Rseed::BeforeZip212(de_ct(jubjub::Scalar::from_bytes(unsafe { &*rcm }))?);
 
     // The caller also chooses the re-randomization of ak
-    let ar = match de_ct(jubjub::Scalar::from_bytes(unsafe { &*ar })) {
-        Some(p) => p,
-        None => return false,
-    };
+    let ar = de_ct(jubjub::Scalar::from_bytes(unsafe { &*ar }))?;
 
     // We need to compute the anchor of the Spend.
-    let anchor = match de_ct(bls12_381::Scalar::from_bytes(unsafe { &*anchor })) {
-        Some(p) => p,
-        None => return false,
-    };
+    let anchor = de_ct(bls12_381::Scalar::from_bytes(unsafe { &*anchor }))?;
 
     // Parse the Merkle path from the caller
-    let merkle_path = match MerklePath::from_slice(unsafe { &(&*merkle_path)[..] }) {
-        Ok(w) => w,
-        Err(_) => return false,
-    };
+    let merkle_path = MerklePath::from_slice(unsafe { &(&*merkle_path)[..] }).ok()?;
+
+    Some((proof_generation_key, diversifier, rseed, ar, anchor, merkle_path))
+}
+
+/// This function (using the proving context) constructs a Spend proof given the
+/// necessary witness information. It outputs `cv` (the value commitment) and
+/// `rk` (so that you don't have to compute it) along with the proof.
+#[no_mangle]
+pub extern "C" fn librustzcash_sapling_spend_proof(
+    ctx: *mut SaplingProvingContext,
+    ak: *const [c_uchar; 32],
+    nsk: *const [c_uchar; 32],
+    diversifier: *const [c_uchar; 11],
+    rcm: *const [c_uchar; 32],
+    ar: *const [c_uchar; 32],
+    value: u64,
+    anchor: *const [c_uchar; 32],
+    merkle_path: *const [c_uchar; 1 + 33 * SAPLING_TREE_DEPTH + 8],
+    cv: *mut [c_uchar; 32],
+    rk_out: *mut [c_uchar; 32],
+    zkproof: *mut [c_uchar; GROTH_PROOF_SIZE],
+) -> bool {
+    let (proof_generation_key, diversifier, rseed, ar, anchor, merkle_path) =
+        match spend_proof_inputs(ak, nsk, diversifier, rcm, ar, anchor, merkle_path) {
+            Some(inputs) => inputs,
+            None => return false,
+        };
 
     // Create proof
     let (proof, value_commitment, rk) = unsafe { &mut *ctx }
@@ -978,6 +1054,56 @@ pub extern "C" fn librustzcash_sapling_spend_proof(
     true
 }
 
+/// As [`librustzcash_sapling_spend_proof`], with a partial proving context
+/// returned from [`librustzcash_sapling_partial_proving_ctx_init`].
+#[no_mangle]
+pub extern "C" fn librustzcash_sapling_partial_spend_proof(
+    ctx: *mut SaplingPartialProvingContext,
+    ak: *const [c_uchar; 32],
+    nsk: *const [c_uchar; 32],
+    diversifier: *const [c_uchar; 11],
+    rcm: *const [c_uchar; 32],
+    ar: *const [c_uchar; 32],
+    value: u64,
+    anchor: *const [c_uchar; 32],
+    merkle_path: *const [c_uchar; 1 + 33 * SAPLING_TREE_DEPTH + 8],
+    cv: *mut [c_uchar; 32],
+    rk_out: *mut [c_uchar; 32],
+    zkproof: *mut [c_uchar; GROTH_PROOF_SIZE],
+) -> bool {
+    let (proof_generation_key, diversifier, rseed, ar, anchor, merkle_path) =
+        match spend_proof_inputs(ak, nsk, diversifier, rcm, ar, anchor, merkle_path) {
+            Some(inputs) => inputs,
+            None => return false,
+        };
+
+    let (proof, value_commitment, rk) = match unsafe { &mut *ctx }.spend_proof(
+        proof_generation_key,
+        diversifier,
+        rseed,
+        ar,
+        value,
+        anchor,
+        merkle_path,
+        unsafe { SAPLING_SPEND_PARAMS.as_ref() }.unwrap(),
+        unsafe { SAPLING_SPEND_VK.as_ref() }.unwrap(),
+    ) {
+        Ok(res) => res,
+        Err(_) => return false,
+    };
+
+    *unsafe { &mut *cv } = value_commitment.to_bytes();
+
+    proof
+        .write(&mut (unsafe { &mut *zkproof })[..])
+        .expect("should be able to serialize a proof");
+
+    rk.write(&mut unsafe { &mut *rk_out }[..])
+        .expect("should be able to write to rk_out");
+
+    true
+}
+
 /// Creates a Sapling proving context. Please free this when you're done.
 #[no_mangle]
 pub extern "C" fn librustzcash_sapling_proving_ctx_init() -> *mut SaplingProvingContext {
@@ -993,6 +1119,32 @@ pub extern "C" fn librustzcash_sapling_proving_ctx_free(ctx: *mut SaplingProving
     drop(unsafe { Box::from_raw(ctx) });
 }
 
+/// Creates a Sapling proving context for a share of the Spend and Output
+/// descriptions of a transaction. Please free this when you're done.
+#[no_mangle]
+pub extern "C" fn librustzcash_sapling_partial_proving_ctx_init() -> *mut SaplingPartialProvingContext {
+    let ctx = Box::new(SaplingPartialProvingContext::new());
+
+    Box::into_raw(ctx)
+}
+
+/// Adds the descriptions proven with the partial proving context `other` to
+/// `ctx`. `other` still has to be freed.
+#[no_mangle]
+pub extern "C" fn librustzcash_sapling_partial_proving_ctx_merge(
+    ctx: *mut SaplingPartialProvingContext,
+    other: *const SaplingPartialProvingContext,
+) {
+    unsafe { &mut *ctx }.merge(unsafe { &*other });
+}
+
+/// Frees a Sapling proving context returned from
+/// [`librustzcash_sapling_partial_proving_ctx_init`].
+#[no_mangle]
+pub extern "C" fn librustzcash_sapling_partial_proving_ctx_free(ctx: *mut SaplingPartialProvingContext) {
+    drop(unsafe { Box::from_raw(ctx) });
+}
+
 /// Derive the master ExtendedSpendingKey from a seed.
 #[no_mangle]
 pub extern "C" fn librustzcash_zip32_xsk_master(
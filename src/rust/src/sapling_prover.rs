@@ -0,0 +1,240 @@
+// Copyright (c) 2021 The Zcash developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or https://www.opensource.org/licenses/mit-license.php .
+
+//! A Sapling proving context that can be split across threads.
+//!
+//! `zcash_proofs::sapling::SaplingProvingContext` accumulates the value
+//! commitment randomness and the value commitments of a transaction in private
+//! fields, so all of its Spend and Output proofs have to be made through one
+//! context, one after another. This context proves the same descriptions, but
+//! any number of them can be proven on separate contexts and the contexts
+//! merged afterwards for the binding signature.
+
+use bellman::{
+    gadgets::multipack,
+    groth16::{create_random_proof, verify_proof, Parameters, PreparedVerifyingKey, Proof},
+};
+use bls12_381::Bls12;
+use group::{ff::Field, GroupEncoding};
+use rand_core::OsRng;
+use std::ops::{AddAssign, Neg};
+use zcash_primitives::{
+    constants::{
+        SPENDING_KEY_GENERATOR, VALUE_COMMITMENT_RANDOMNESS_GENERATOR,
+        VALUE_COMMITMENT_VALUE_GENERATOR,
+    },
+    merkle_tree::MerklePath,
+    primitives::{Diversifier, Note, PaymentAddress, ProofGenerationKey, Rseed, ValueCommitment},
+    redjubjub::{PrivateKey, PublicKey, Signature},
+    sapling::Node,
+    transaction::components::Amount,
+};
+use zcash_proofs::circuit::sapling::{Output, Spend};
+
+/// The share of a transaction's Sapling descriptions proven with this context.
+pub struct SaplingPartialProvingContext {
+    /// Sum of the value commitment randomness, Spends minus Outputs
+    bsk: jubjub::Fr,
+    /// Sum of the value commitments, Spends minus Outputs
+    cv_sum: jubjub::ExtendedPoint,
+}
+
+impl Default for SaplingPartialProvingContext {
+    fn default() -> Self {
+        SaplingPartialProvingContext::new()
+    }
+}
+
+impl SaplingPartialProvingContext {
+    /// Construct a new context to be used with a share of the descriptions of a
+    /// single transaction.
+    pub fn new() -> Self {
+        SaplingPartialProvingContext {
+            bsk: jubjub::Fr::zero(),
+            cv_sum: jubjub::ExtendedPoint::identity(),
+        }
+    }
+
+    /// Adds the descriptions proven with `other` to this context.
+    pub fn merge(&mut self, other: &SaplingPartialProvingContext) {
+        self.bsk.add_assign(&other.bsk);
+        self.cv_sum += other.cv_sum;
+    }
+
+    /// Accumulates a value commitment, adding it for a Spend and subtracting
+    /// it for an Output, and returns it.
+    pub(crate) fn accumulate(
+        &mut self,
+        value_commitment: &ValueCommitment,
+        spend: bool,
+    ) -> jubjub::ExtendedPoint {
+        let cv: jubjub::ExtendedPoint = value_commitment.commitment().into();
+        if spend {
+            self.bsk.add_assign(&value_commitment.randomness);
+            self.cv_sum += cv;
+        } else {
+            self.bsk.add_assign(&value_commitment.randomness.neg());
+            self.cv_sum -= cv;
+        }
+        cv
+    }
+
+    /// Create the value commitment, re-randomized key, and proof for a Sapling
+    /// SpendDescription, while accumulating its value commitment randomness
+    /// inside the context for later use.
+    #[allow(clippy::too_many_arguments)]
+    pub fn spend_proof(
+        &mut self,
+        proof_generation_key: ProofGenerationKey,
+        diversifier: Diversifier,
+        rseed: Rseed,
+        ar: jubjub::Fr,
+        value: u64,
+        anchor: bls12_381::Scalar,
+        merkle_path: MerklePath<Node>,
+        proving_key: &Parameters<Bls12>,
+        verifying_key: &PreparedVerifyingKey<Bls12>,
+    ) -> Result<(Proof<Bls12>, jubjub::ExtendedPoint, PublicKey), ()> {
+        let mut rng = OsRng;
+
+        let value_commitment = ValueCommitment {
+            value,
+            randomness: jubjub::Fr::random(&mut rng),
+        };
+
+        let viewing_key = proof_generation_key.to_viewing_key();
+        let payment_address = viewing_key.to_payment_address(diversifier).ok_or(())?;
+
+        // This is the result of the re-randomization, we compute it for the caller
+        let rk = PublicKey(proof_generation_key.ak.clone().into())
+            .randomize(ar, SPENDING_KEY_GENERATOR);
+
+        let note = Note {
+            value,
+            g_d: diversifier.g_d().ok_or(())?,
+            pk_d: payment_address.pk_d().clone(),
+            rseed,
+        };
+        let nullifier = note.nf(&viewing_key, merkle_path.position);
+
+        let instance = Spend {
+            value_commitment: Some(value_commitment.clone()),
+            proof_generation_key: Some(proof_generation_key),
+            payment_address: Some(payment_address),
+            commitment_randomness: Some(note.rcm()),
+            ar: Some(ar),
+            auth_path: merkle_path
+                .auth_path
+                .iter()
+                .map(|(node, b)| Some(((*node).into(), *b)))
+                .collect(),
+            anchor: Some(anchor),
+        };
+
+        let proof = create_random_proof(instance, proving_key, &mut rng).map_err(|_| ())?;
+
+        // Check the proof against the public inputs a verifier will use
+        let mut public_input = [bls12_381::Scalar::zero(); 7];
+        {
+            let affine = jubjub::AffinePoint::from(rk.0);
+            public_input[0] = affine.get_u();
+            public_input[1] = affine.get_v();
+        }
+        {
+            let affine =
+                jubjub::AffinePoint::from(jubjub::ExtendedPoint::from(value_commitment.commitment()));
+            public_input[2] = affine.get_u();
+            public_input[3] = affine.get_v();
+        }
+        public_input[4] = anchor;
+        {
+            let nullifier = multipack::bytes_to_bits_le(&nullifier);
+            let nullifier = multipack::compute_multipacking(&nullifier);
+            assert_eq!(nullifier.len(), 2);
+            public_input[5] = nullifier[0];
+            public_input[6] = nullifier[1];
+        }
+        verify_proof(verifying_key, &proof, &public_input[..]).map_err(|_| ())?;
+
+        let cv = self.accumulate(&value_commitment, true);
+
+        Ok((proof, cv, rk))
+    }
+
+    /// Create the value commitment and proof for a Sapling OutputDescription,
+    /// while accumulating its value commitment randomness inside the context
+    /// for later use.
+    pub fn output_proof(
+        &mut self,
+        esk: jubjub::Fr,
+        payment_address: PaymentAddress,
+        rcm: jubjub::Fr,
+        value: u64,
+        proving_key: &Parameters<Bls12>,
+    ) -> Result<(Proof<Bls12>, jubjub::ExtendedPoint), ()> {
+        let mut rng = OsRng;
+
+        let value_commitment = ValueCommitment {
+            value,
+            randomness: jubjub::Fr::random(&mut rng),
+        };
+
+        let instance = Output {
+            value_commitment: Some(value_commitment.clone()),
+            payment_address: Some(payment_address),
+            commitment_randomness: Some(rcm),
+            esk: Some(esk),
+        };
+
+        let proof = create_random_proof(instance, proving_key, &mut rng).map_err(|_| ())?;
+
+        let cv = self.accumulate(&value_commitment, false);
+
+        Ok((proof, cv))
+    }
+
+    /// Create the bindingSig for a Sapling transaction, once the contexts of
+    /// all its Spend and Output descriptions have been merged into this one.
+    pub fn binding_sig(&self, value_balance: Amount, sighash: &[u8; 32]) -> Result<Signature, ()> {
+        let mut rng = OsRng;
+
+        let bsk = PrivateKey(self.bsk);
+        let bvk = PublicKey::from_private(&bsk, VALUE_COMMITMENT_RANDOMNESS_GENERATOR);
+
+        // The accumulated value commitments less the value balance, as the
+        // verifier computes bvk, must match unless valueBalance is wrong or a
+        // description was left out of the merge.
+        let final_bvk = self.cv_sum - compute_value_balance(value_balance).ok_or(())?;
+        if bvk.0 != final_bvk {
+            return Err(());
+        }
+
+        let mut data_to_be_signed = [0u8; 64];
+        data_to_be_signed[0..32].copy_from_slice(&bvk.0.to_bytes());
+        data_to_be_signed[32..64].copy_from_slice(&sighash[..]);
+
+        Ok(bsk.sign(
+            &data_to_be_signed,
+            &mut rng,
+            VALUE_COMMITMENT_RANDOMNESS_GENERATOR,
+        ))
+    }
+}
+
+/// The value balance as a point, valueBalance times the value commitment
+/// generator.
+pub(crate) fn compute_value_balance(value: Amount) -> Option<jubjub::ExtendedPoint> {
+    // Fails for -i64::MAX
+    let abs = match i64::from(value).checked_abs() {
+        Some(a) => a as u64,
+        None => return None,
+    };
+
+    let mut value_balance = VALUE_COMMITMENT_VALUE_GENERATOR * jubjub::Fr::from(abs);
+    if value.is_negative() {
+        value_balance = -value_balance;
+    }
+
+    Some(value_balance.into())
+}
@@ -9,6 +9,7 @@ mod key_agreement;
 mod key_components;
 mod mmr;
 mod notes;
+mod sapling_prover;
 mod signatures;
 
 #[test]
@@ -0,0 +1,64 @@
+use group::{ff::Field, GroupEncoding};
+use rand_core::OsRng;
+use zcash_primitives::{
+    constants::VALUE_COMMITMENT_RANDOMNESS_GENERATOR, primitives::ValueCommitment,
+    redjubjub::PublicKey, transaction::components::Amount,
+};
+
+use crate::sapling_prover::{compute_value_balance, SaplingPartialProvingContext};
+
+fn value_commitment(value: u64) -> ValueCommitment {
+    ValueCommitment {
+        value,
+        randomness: jubjub::Fr::random(&mut OsRng),
+    }
+}
+
+#[test]
+fn partial_proving_ctx_merge() {
+    let spends = [value_commitment(100), value_commitment(50)];
+    let outputs = [
+        value_commitment(70),
+        value_commitment(60),
+        value_commitment(15),
+    ];
+    let value_balance = Amount::from_i64(5).unwrap();
+    let sighash = [7u8; 32];
+
+    // The descriptions of one transaction proven on three contexts
+    let mut ctx = [
+        SaplingPartialProvingContext::new(),
+        SaplingPartialProvingContext::new(),
+        SaplingPartialProvingContext::new(),
+    ];
+    let mut cv_sum = jubjub::ExtendedPoint::identity();
+    cv_sum += ctx[0].accumulate(&spends[0], true);
+    cv_sum -= ctx[1].accumulate(&outputs[0], false);
+    cv_sum += ctx[2].accumulate(&spends[1], true);
+    cv_sum -= ctx[0].accumulate(&outputs[1], false);
+    cv_sum -= ctx[1].accumulate(&outputs[2], false);
+
+    // A share of the descriptions does not balance on its own
+    assert!(ctx[0].binding_sig(value_balance, &sighash).is_err());
+
+    let (merged, rest) = ctx.split_at_mut(1);
+    for other in rest.iter() {
+        merged[0].merge(other);
+    }
+    let sig = merged[0].binding_sig(value_balance, &sighash).unwrap();
+
+    // Verify it as a verifier does, from the value commitments of the descriptions
+    let bvk = PublicKey(cv_sum - compute_value_balance(value_balance).unwrap());
+    let mut data_to_be_signed = [0u8; 64];
+    data_to_be_signed[0..32].copy_from_slice(&bvk.0.to_bytes());
+    data_to_be_signed[32..64].copy_from_slice(&sighash[..]);
+    assert!(bvk.verify(
+        &data_to_be_signed,
+        &sig,
+        VALUE_COMMITMENT_RANDOMNESS_GENERATOR
+    ));
+
+    assert!(merged[0]
+        .binding_sig(Amount::from_i64(6).unwrap(), &sighash)
+        .is_err());
+}
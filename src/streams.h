@@ -37,6 +37,11 @@
 #include <utility>
 #include <vector>
 
+#ifndef WIN32
+#include <errno.h>
+#include <unistd.h>
+#endif
+
 template<typename Stream>
 class OverrideStream
 {
@@ -672,4 +677,83 @@ public:
     }
 };
 
+#ifndef WIN32
+/** Deserialize from a file descriptor starting at a given offset.
+ *
+ * Reads go through pread() into a small buffer, so any number of these can
+ * share one descriptor from different threads without seeking it. The
+ * descriptor is not owned and must outlive the stream.
+ */
+class CPreadFile
+{
+private:
+    // Disallow copies
+    CPreadFile(const CPreadFile&);
+    CPreadFile& operator=(const CPreadFile&);
+
+    const int nType;
+    const int nVersion;
+
+    int fd;
+    uint64_t nReadPos; // file offset of the next byte to read
+    uint64_t nBufPos;  // file offset of the first byte in vchBuf
+    size_t nBufLen;    // number of valid bytes in vchBuf
+    std::vector<char> vchBuf;
+
+    void Fill()
+    {
+        ssize_t nRead;
+        do {
+            nRead = ::pread(fd, &vchBuf[0], vchBuf.size(), nReadPos);
+        } while (nRead < 0 && errno == EINTR);
+        if (nRead < 0)
+            throw std::ios_base::failure("CPreadFile::read: pread failed");
+        if (nRead == 0)
+            throw std::ios_base::failure("CPreadFile::read: end of file");
+        nBufPos = nReadPos;
+        nBufLen = nRead;
+    }
+
+public:
+    CPreadFile(int fdIn, uint64_t nPosIn, size_t nBufSize, int nTypeIn, int nVersionIn) :
+        nType(nTypeIn), nVersion(nVersionIn), fd(fdIn), nReadPos(nPosIn), nBufPos(0), nBufLen(0), vchBuf(nBufSize, 0)
+    {
+    }
+
+    int GetType() const          { return nType; }
+    int GetVersion() const       { return nVersion; }
+
+    //! return the current file offset
+    uint64_t GetPos() const      { return nReadPos; }
+
+    void read(char* pch, size_t nSize)
+    {
+        while (nSize > 0) {
+            if (nReadPos < nBufPos || nReadPos >= nBufPos + nBufLen)
+                Fill();
+            size_t nOffset = nReadPos - nBufPos;
+            size_t nNow = std::min(nSize, nBufLen - nOffset);
+            memcpy(pch, &vchBuf[nOffset], nNow);
+            pch += nNow;
+            nSize -= nNow;
+            nReadPos += nNow;
+        }
+    }
+
+    //! skip nSize bytes, the next read past the buffer refills it at the new offset
+    void ignore(size_t nSize)
+    {
+        nReadPos += nSize;
+    }
+
+    template<typename T>
+    CPreadFile& operator>>(T& obj)
+    {
+        // Unserialize from this stream
+        ::Unserialize(*this, obj);
+        return (*this);
+    }
+};
+#endif
+
 #endif // BITCOIN_STREAMS_H
@@ -35,6 +35,13 @@ void PrintLockContention(const char* pszName, const char* pszFile, int nLine)
 }
 #endif /* DEBUG_LOCKCONTENTION */
 
+std::atomic<LockContentionHook> g_lock_contention_hook(nullptr);
+
+void SetLockContentionHook(LockContentionHook hook)
+{
+    g_lock_contention_hook.store(hook);
+}
+
 #ifdef DEBUG_LOCKORDER
 //
 // Early deadlock detection.
@@ -22,6 +22,10 @@
 #define BITCOIN_SYNC_H
 
 #include "threadsafety.h"
+#include "utiltime.h"
+
+#include <atomic>
+#include <stdint.h>
 
 #undef __cpuid
 #include <boost/thread/condition_variable.hpp>
@@ -115,6 +119,14 @@ void static inline AssertLockHeldInternal(const char* pszName, const char* pszFi
 void PrintLockContention(const char* pszName, const char* pszFile, int nLine);
 #endif
 
+/**
+ * Called with the time spent blocked on each contended lock, once installed
+ * with SetLockContentionHook(). pszName is the stringified lock expression.
+ */
+typedef void (*LockContentionHook)(const char* pszName, int64_t nWaitMicros);
+void SetLockContentionHook(LockContentionHook hook);
+extern std::atomic<LockContentionHook> g_lock_contention_hook;
+
 /** Wrapper around boost::unique_lock<Mutex> */
 template <typename Mutex>
 class SCOPED_LOCKABLE CMutexLock
@@ -125,14 +137,19 @@ private:
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, (void*)(lock.mutex()));
-#ifdef DEBUG_LOCKCONTENTION
         if (!lock.try_lock()) {
+#ifdef DEBUG_LOCKCONTENTION
             PrintLockContention(pszName, pszFile, nLine);
 #endif
-            lock.lock();
-#ifdef DEBUG_LOCKCONTENTION
+            LockContentionHook hook = g_lock_contention_hook.load(std::memory_order_relaxed);
+            if (hook == nullptr) {
+                lock.lock();
+            } else {
+                int64_t nWaitStart = GetTimeMicros();
+                lock.lock();
+                hook(pszName, GetTimeMicros() - nWaitStart);
+            }
         }
-#endif
     }
 
     bool TryEnter(const char* pszName, const char* pszFile, int nLine)
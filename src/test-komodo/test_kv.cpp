@@ -0,0 +1,76 @@
+#include <gtest/gtest.h>
+
+#include "komodo.h"
+#include "komodo_defs.h"
+#include "primitives/block.h"
+#include "script/script.h"
+
+namespace TestKV {
+
+static CTransaction OpRetTx(const std::vector<uint8_t> &opret)
+{
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].prevout = COutPoint(uint256S("01"), 0);
+    mtx.vout.resize(2);
+    mtx.vout[0].nValue = 10000;
+    mtx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    mtx.vout[1].nValue = 0;
+    mtx.vout[1].scriptPubKey = CScript() << OP_RETURN << opret;
+    return CTransaction(mtx);
+}
+
+static std::vector<uint8_t> KVOpRet(size_t len)
+{
+    std::vector<uint8_t> opret(len, 0x11);
+    opret[0] = 'K';
+    return opret;
+}
+
+TEST(TestKV, kvopretsFoundPastNotarisationOnNotaryPayChain)
+{
+    char symbol[KOMODO_ASSETCHAIN_MAXLEN]; uint64_t notarypay = ASSETCHAINS_NOTARY_PAY[0];
+    strcpy(symbol, ASSETCHAINS_SYMBOL);
+    strcpy(ASSETCHAINS_SYMBOL, "KVTEST");
+    // komodo_connectblock stops its notarisation scan at vtx[1] on these chains
+    ASSETCHAINS_NOTARY_PAY[0] = 1;
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vout.resize(1);
+    coinbase.vout[0].scriptPubKey = CScript() << OP_TRUE;
+
+    CBlock block;
+    block.vtx.push_back(CTransaction(coinbase));
+    block.vtx.push_back(OpRetTx(std::vector<uint8_t>(72, 0x22)));   // notarisation-like opret, not kv
+    block.vtx.push_back(OpRetTx(KVOpRet(100)));                     // OP_PUSHDATA1 framing
+    block.vtx.push_back(OpRetTx(KVOpRet(40)));                      // direct push framing
+
+    std::vector<std::pair<int32_t,int32_t> > kvoprets;
+    komodo_kvoprets(block, kvoprets);
+
+    strcpy(ASSETCHAINS_SYMBOL, symbol);
+    ASSETCHAINS_NOTARY_PAY[0] = notarypay;
+
+    ASSERT_EQ(2, kvoprets.size());
+    EXPECT_EQ(std::make_pair(2, 1), kvoprets[0]);
+    EXPECT_EQ(std::make_pair(3, 1), kvoprets[1]);
+}
+
+TEST(TestKV, kvopretsIgnoredOnKMD)
+{
+    char symbol[KOMODO_ASSETCHAIN_MAXLEN];
+    strcpy(symbol, ASSETCHAINS_SYMBOL);
+    ASSETCHAINS_SYMBOL[0] = 0;
+
+    CBlock block;
+    block.vtx.push_back(OpRetTx(KVOpRet(40)));
+    std::vector<std::pair<int32_t,int32_t> > kvoprets;
+    komodo_kvoprets(block, kvoprets);
+
+    strcpy(ASSETCHAINS_SYMBOL, symbol);
+    EXPECT_TRUE(kvoprets.empty());
+}
+
+}
@@ -0,0 +1,75 @@
+#include <gtest/gtest.h>
+
+#include "komodo.h"
+
+#include <random>
+
+extern uint64_t ASSETCHAINS_CBOPRET;
+
+namespace TestPrices {
+
+// the sliding windows of komodo_pricesupdate against the full day kernels they replaced, which
+// read the same rows back from the prices files for every block
+TEST(TestPrices, windowsMatchKernels)
+{
+    int32_t blocktime = ASSETCHAINS_BLOCKTIME; uint64_t cbopret = ASSETCHAINS_CBOPRET;
+    ASSETCHAINS_BLOCKTIME = 1440; // a day of 61 blocks
+    ASSETCHAINS_CBOPRET = 1;
+
+    const int32_t numprices = 2, ind = 1, window = PRICES_DAYWINDOW, maxheight = 40 * window;
+    std::vector<uint32_t> raw((maxheight + 1) * numprices, 0);
+    std::vector<int64_t> rows((maxheight + 1) * PRICES_MAXDATAPOINTS, 0);
+    std::vector<int64_t> tmpbuf(2 * window);
+    struct komodo_pricewindow w;
+    w.rawheight = w.correlatedheight = 0;
+    std::mt19937 rng(1);
+    uint32_t price = 500000000;
+    int32_t height = window + 1, checked = 0, smoothed = 0;
+
+    while ( height <= maxheight )
+    {
+        // mostly a random walk inside the correlation band, with jumps out of it and null prices
+        uint32_t r = rng() % 1000;
+        if ( r < 5 )
+            price = 0;
+        else
+        {
+            if ( price == 0 )
+                price = 500000000;
+            if ( r < 40 )
+                price = (uint32_t)((uint64_t)price * (r < 20 ? 110 : 90) / 100);
+            else price = (uint32_t)((uint64_t)price * (100000 + (int32_t)(rng() % 601) - 300) / 100000);
+        }
+        raw[height * numprices] = (uint32_t)height;
+        raw[height * numprices + ind] = price;
+
+        uint64_t seed = rng();
+        komodo_pricewindow_raw(&w, raw.data(), numprices, ind, height);
+        int64_t correlated = komodo_pricewindow_correlated(&w, seed, ind, height);
+        ASSERT_EQ(komodo_pricecorrelated(seed, ind, &raw[height * numprices + ind], -numprices, 0, PRICES_SMOOTHWIDTH), correlated) << "height " << height;
+        checked++;
+        if ( correlated > 0 )
+            rows[height * PRICES_MAXDATAPOINTS + 1] = correlated;
+        komodo_pricewindow_correlatedadd(&w, rows.data(), height);
+        if ( correlated > 0 && height > window * 2 )
+        {
+            ASSERT_EQ(komodo_priceave(tmpbuf.data(), &rows[height * PRICES_MAXDATAPOINTS + 1], -PRICES_MAXDATAPOINTS), komodo_pricewindow_smoothed(&w, height)) << "height " << height;
+            smoothed++;
+        }
+
+        // gaps and reorgs make the windows rebuild from the rows
+        r = rng() % 100;
+        if ( r == 0 )
+            height += 1 + rng() % window;
+        else if ( r == 1 && height > 3 * window )
+            height -= rng() % window;
+        else height++;
+    }
+
+    ASSETCHAINS_BLOCKTIME = blocktime;
+    ASSETCHAINS_CBOPRET = cbopret;
+    EXPECT_GT(checked, 1000);
+    EXPECT_GT(smoothed, 500);
+}
+
+}
@@ -0,0 +1,134 @@
+#include <gtest/gtest.h>
+
+#include "key.h"
+#include "random.h"
+#include "wallet/wallet.h"
+#include "wallet/rpcpiratewallet.h"
+
+#include <stdexcept>
+#include <vector>
+
+namespace TestRpcPirateWallet {
+
+static TxPositionMap MakeHistory(int nBlocks, int nPerBlock)
+{
+    TxPositionMap sortedArchive;
+    for (int nHeight = 1; nHeight <= nBlocks; nHeight++)
+        for (int nIndex = 0; nIndex < nPerBlock; nIndex++)
+            sortedArchive[std::make_pair(nHeight, nIndex)] = GetRandHash();
+    return sortedArchive;
+}
+
+/** The txids of a page of nCount, and the cursor of its oldest transaction as zs_listtransactions reports it */
+static std::vector<uint256> Page(TxPositionMap& sortedArchive, const std::string& strCursor, size_t nCount, std::string& strNext)
+{
+    std::vector<uint256> vPage;
+    for (TxPositionMap::reverse_iterator it = TxPageStart(sortedArchive, strCursor); it != sortedArchive.rend() && vPage.size() < nCount; ++it) {
+        vPage.push_back(it->second);
+        strNext = strprintf("%d:%d", it->first.first, it->first.second);
+    }
+    return vPage;
+}
+
+TEST(TestRpcPirateWallet, parseHeightCursor)
+{
+    TxPositionMap sortedArchive = MakeHistory(3, 2);
+    EXPECT_EQ(std::make_pair(2, 1), ParseTxCursor("2:1", sortedArchive));
+    // a position no longer in the wallet still orders the page
+    EXPECT_EQ(std::make_pair(100, 0), ParseTxCursor("100:0", sortedArchive));
+
+    EXPECT_THROW(ParseTxCursor("", sortedArchive), std::runtime_error);
+    EXPECT_THROW(ParseTxCursor("2", sortedArchive), std::runtime_error);
+    EXPECT_THROW(ParseTxCursor("2:", sortedArchive), std::runtime_error);
+    EXPECT_THROW(ParseTxCursor(":1", sortedArchive), std::runtime_error);
+    EXPECT_THROW(ParseTxCursor("a:1", sortedArchive), std::runtime_error);
+    EXPECT_THROW(ParseTxCursor("2:1:0", sortedArchive), std::runtime_error);
+    EXPECT_THROW(ParseTxCursor("99999999999:0", sortedArchive), std::runtime_error);
+}
+
+TEST(TestRpcPirateWallet, parseTxidCursor)
+{
+    TxPositionMap sortedArchive = MakeHistory(3, 2);
+    uint256 txid = sortedArchive[std::make_pair(2, 1)];
+    EXPECT_EQ(std::make_pair(2, 1), ParseTxCursor(txid.GetHex(), sortedArchive));
+
+    EXPECT_THROW(ParseTxCursor(GetRandHash().GetHex(), sortedArchive), std::runtime_error);
+    EXPECT_THROW(ParseTxCursor(txid.GetHex().substr(1), sortedArchive), std::runtime_error);
+}
+
+TEST(TestRpcPirateWallet, pagesStableAcrossCalls)
+{
+    TxPositionMap sortedArchive = MakeHistory(10, 3);
+    std::string strCursor, strNext;
+
+    std::vector<uint256> vFirst = Page(sortedArchive, "", 7, strCursor);
+    ASSERT_EQ(7u, vFirst.size());
+    EXPECT_EQ(sortedArchive[std::make_pair(10, 2)], vFirst[0]);
+    EXPECT_EQ("8:2", strCursor);
+    std::vector<uint256> vSecond = Page(sortedArchive, strCursor, 7, strNext);
+    ASSERT_EQ(7u, vSecond.size());
+    EXPECT_EQ(sortedArchive[std::make_pair(8, 1)], vSecond[0]);
+
+    // new blocks and unconfirmed transactions do not shift the pages below the cursor
+    sortedArchive[std::make_pair(11, 0)] = GetRandHash();
+    sortedArchive[std::make_pair(12, 0)] = GetRandHash();
+    sortedArchive[std::make_pair(12, 1)] = GetRandHash();
+    std::string strAgain;
+    EXPECT_EQ(vSecond, Page(sortedArchive, strCursor, 7, strAgain));
+    EXPECT_EQ(strNext, strAgain);
+
+    // the txid of the oldest transaction of a page is the same cursor
+    EXPECT_EQ(vSecond, Page(sortedArchive, vFirst.back().GetHex(), 7, strAgain));
+
+    // walking all the pages lists every transaction once
+    std::vector<uint256> vAll;
+    strCursor = "";
+    while (true) {
+        std::vector<uint256> vPage = Page(sortedArchive, strCursor, 4, strNext);
+        if (vPage.empty())
+            break;
+        vAll.insert(vAll.end(), vPage.begin(), vPage.end());
+        strCursor = strNext;
+    }
+    ASSERT_EQ(sortedArchive.size(), vAll.size());
+    TxPositionMap::reverse_iterator it = sortedArchive.rbegin();
+    for (const uint256& txid : vAll)
+        EXPECT_EQ((it++)->second, txid);
+}
+
+TEST(TestRpcPirateWallet, arcTxCacheInvalidatedByReorgAndKeyImport)
+{
+    CWallet wallet;
+    std::set<uint256> ivks = {GetRandHash()};
+    std::set<uint256> ovks = {GetRandHash()};
+    uint256 hashBlock = GetRandHash();
+
+    ArcTxCacheEntry entry;
+    entry.nKeyGeneration = wallet.nKeyGeneration;
+    entry.hashBlock = hashBlock;
+    entry.nIndex = 3;
+    entry.ivks = ivks;
+    entry.ovks = ovks;
+    EXPECT_TRUE(entry.IsCurrent(wallet.nKeyGeneration, hashBlock, 3, ivks, ovks));
+
+    // the transaction was reorganised into another block, or another position of its block
+    EXPECT_FALSE(entry.IsCurrent(wallet.nKeyGeneration, GetRandHash(), 3, ivks, ovks));
+    EXPECT_FALSE(entry.IsCurrent(wallet.nKeyGeneration, hashBlock, 4, ivks, ovks));
+
+    // viewing keys differ
+    std::set<uint256> ivksMore = ivks;
+    ivksMore.insert(GetRandHash());
+    EXPECT_FALSE(entry.IsCurrent(wallet.nKeyGeneration, hashBlock, 3, ivksMore, ovks));
+    EXPECT_FALSE(entry.IsCurrent(wallet.nKeyGeneration, hashBlock, 3, ivks, std::set<uint256>()));
+
+    // a key imported into the wallet may decrypt more of the transaction
+    CKey key;
+    key.MakeNewKey(true);
+    {
+        LOCK(wallet.cs_wallet);
+        wallet.AddKeyPubKey(key, key.GetPubKey());
+    }
+    EXPECT_FALSE(entry.IsCurrent(wallet.nKeyGeneration, hashBlock, 3, ivks, ovks));
+}
+
+}
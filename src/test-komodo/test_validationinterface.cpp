@@ -0,0 +1,165 @@
+#include <gtest/gtest.h>
+
+#include "chain.h"
+#include "primitives/block.h"
+#include "scheduler.h"
+#include "utiltime.h"
+#include "validationinterface.h"
+#include "wallet/wallet.h"
+
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+namespace TestValidationInterface {
+
+/** Records the heights of the tips it is notified of, taking nDelayMs for each */
+class CTipRecorder : public CValidationInterface
+{
+public:
+    std::mutex cs;
+    std::vector<int> vHeights;
+    std::vector<std::thread::id> vThreads;
+    int64_t nDelayMs;
+
+    CTipRecorder(int64_t nDelayMsIn = 0) : nDelayMs(nDelayMsIn) {}
+
+    std::vector<int> Heights()
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        return vHeights;
+    }
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex *pindex) override
+    {
+        if (nDelayMs)
+            MilliSleep(nDelayMs);
+        std::lock_guard<std::mutex> lock(cs);
+        vHeights.push_back(pindex->GetHeight());
+        vThreads.push_back(std::this_thread::get_id());
+    }
+};
+
+/** Runs a scheduler service thread for the lifetime of the object */
+class CSchedulerThread
+{
+public:
+    CScheduler scheduler;
+    boost::thread thread;
+
+    CSchedulerThread() : thread(boost::bind(&CScheduler::serviceQueue, &scheduler))
+    {
+        RegisterBackgroundSignalScheduler(scheduler);
+    }
+
+    ~CSchedulerThread()
+    {
+        UnregisterBackgroundSignalScheduler();
+        scheduler.stop(false);
+        thread.join();
+    }
+};
+
+static std::vector<CBlockIndex> MakeIndexes(int n)
+{
+    std::vector<CBlockIndex> vIndexes(n);
+    for (int i = 0; i < n; i++)
+        vIndexes[i].SetHeight(i);
+    return vIndexes;
+}
+
+TEST(TestValidationInterface, deliveredInlineWithoutScheduler)
+{
+    CTipRecorder listener;
+    RegisterValidationInterface(&listener);
+    std::vector<CBlockIndex> vIndexes = MakeIndexes(3);
+    for (const CBlockIndex& index : vIndexes)
+        GetMainSignals().UpdatedBlockTip(&index);
+
+    EXPECT_EQ(std::vector<int>({0, 1, 2}), listener.Heights());
+    EXPECT_EQ(0u, GetValidationInterfaceQueueSize());
+    for (const std::thread::id& id : listener.vThreads)
+        EXPECT_EQ(std::this_thread::get_id(), id);
+    UnregisterValidationInterface(&listener);
+}
+
+TEST(TestValidationInterface, perListenerOrder)
+{
+    const int N = 50;
+    std::vector<CBlockIndex> vIndexes = MakeIndexes(N);
+    std::vector<int> vExpected;
+    for (int i = 0; i < N; i++)
+        vExpected.push_back(i);
+
+    // a slow listener does not reorder, nor hold back, the notifications of a fast one
+    CTipRecorder slow(5), fast;
+    RegisterValidationInterface(&slow);
+    RegisterValidationInterface(&fast);
+    {
+        CSchedulerThread schedulerThread;
+        for (const CBlockIndex& index : vIndexes)
+            GetMainSignals().UpdatedBlockTip(&index);
+        SyncWithValidationInterfaceQueue();
+    }
+
+    EXPECT_EQ(vExpected, slow.Heights());
+    EXPECT_EQ(vExpected, fast.Heights());
+    for (const std::thread::id& id : slow.vThreads)
+        EXPECT_NE(std::this_thread::get_id(), id);
+    UnregisterValidationInterface(&fast);
+    UnregisterValidationInterface(&slow);
+}
+
+TEST(TestValidationInterface, syncWaitsForDelivery)
+{
+    const size_t N = 10;
+    std::vector<CBlockIndex> vIndexes = MakeIndexes(N);
+    CTipRecorder listener(20);
+    RegisterValidationInterface(&listener);
+    {
+        CSchedulerThread schedulerThread;
+        for (const CBlockIndex& index : vIndexes)
+            GetMainSignals().UpdatedBlockTip(&index);
+        // the first notification takes 20ms, the others are still queued behind it
+        EXPECT_GT(GetValidationInterfaceQueueSize(), 0u);
+        EXPECT_LT(listener.Heights().size(), N);
+
+        SyncWithValidationInterfaceQueue();
+        EXPECT_EQ(N, listener.Heights().size());
+        EXPECT_EQ(0u, GetValidationInterfaceQueueSize());
+
+        // notifications raised after the sync are delivered as well
+        GetMainSignals().UpdatedBlockTip(&vIndexes[0]);
+        SyncWithValidationInterfaceQueue();
+        EXPECT_EQ(N + 1, listener.Heights().size());
+    }
+    UnregisterValidationInterface(&listener);
+}
+
+TEST(TestValidationInterface, walletSkipsBlockDisconnectedBeforeProcessed)
+{
+    CWallet wallet;
+    CBlock block;
+    SproutMerkleTree sproutTree;
+    SaplingMerkleTree saplingTree;
+
+    // by the time the connection is delivered the block is no longer in the active chain
+    CBlockIndex index;
+    index.SetHeight(1000000);
+    uint256 hash = block.GetHash();
+    index.phashBlock = &hash;
+    ASSERT_FALSE(chainActive.Contains(&index));
+
+    wallet.ChainTip(&index, &block, sproutTree, saplingTree, true);
+    EXPECT_EQ(0, wallet.chainHeight);
+
+    // the disconnection queued behind it has no witnesses to roll back, the wallet stays where it was
+    wallet.ChainTip(&index, &block, sproutTree, saplingTree, false);
+    EXPECT_EQ(0, wallet.chainHeight);
+}
+
+}
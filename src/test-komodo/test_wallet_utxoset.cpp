@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+
+#include "chain.h"
+#include "consensus/consensus.h"
+#include "key.h"
+#include "main.h"
+#include "primitives/block.h"
+#include "script/standard.h"
+#include "wallet/wallet.h"
+
+#include <vector>
+
+namespace TestWalletUtxoSet {
+
+class TestWalletUtxoSet : public ::testing::Test
+{
+protected:
+    int nSavedMaturity;
+    CWallet wallet;
+    CKey key;
+    std::vector<CBlockIndex> vIndexes;
+
+    void SetUp() override
+    {
+        nSavedMaturity = COINBASE_MATURITY;
+        COINBASE_MATURITY = 10;
+        key.MakeNewKey(true);
+        // CWallet::AddKeyPubKey keeps keys of wallets without a file out of the keystore
+        wallet.CCryptoKeyStore::AddKeyPubKey(key, key.GetPubKey());
+        vIndexes.resize(30);
+        for (int i = 0; i < vIndexes.size(); i++) {
+            vIndexes[i].SetHeight(i);
+            vIndexes[i].nTime = 1000 + i;
+        }
+    }
+
+    void TearDown() override
+    {
+        COINBASE_MATURITY = nSavedMaturity;
+    }
+
+    CTransaction Coinbase(int nHeight, const CScript& scriptPubKey)
+    {
+        CMutableTransaction mtx;
+        mtx.vin.resize(1);
+        mtx.vin[0].prevout.SetNull();
+        mtx.vin[0].scriptSig = CScript() << nHeight << OP_0;
+        mtx.vout.resize(1);
+        mtx.vout[0].nValue = 10 * COIN;
+        mtx.vout[0].scriptPubKey = scriptPubKey;
+        return CTransaction(mtx);
+    }
+
+    CScript Mine()
+    {
+        return GetScriptForDestination(key.GetPubKey().GetID());
+    }
+
+    /** Connects a block holding vtx at nHeight, as the wallet's ChainTip does */
+    void Connect(int nHeight, const std::vector<CTransaction>& vtx = std::vector<CTransaction>())
+    {
+        CBlock block;
+        block.vtx = vtx;
+        LOCK2(cs_main, wallet.cs_wallet);
+        wallet.utxoSet.ChainTip(&vIndexes[nHeight], &block, true);
+    }
+
+    std::vector<CWalletUtxo> Utxos()
+    {
+        std::vector<CWalletUtxo> vUtxos;
+        wallet.utxoSet.ForEach([&](const CWalletUtxo& utxo) { vUtxos.push_back(utxo); });
+        return vUtxos;
+    }
+};
+
+TEST_F(TestWalletUtxoSet, coinbaseAddedWhenMature)
+{
+    CTransaction coinbase1 = Coinbase(1, Mine());
+    CTransaction coinbase3 = Coinbase(3, Mine());
+    CKey other;
+    other.MakeNewKey(true);
+
+    Connect(1, {coinbase1});
+    Connect(2, {Coinbase(2, GetScriptForDestination(other.GetPubKey().GetID()))});
+    Connect(3, {coinbase3});
+    for (int nHeight = 4; nHeight < 10; nHeight++) {
+        Connect(nHeight);
+        EXPECT_TRUE(Utxos().empty()) << "height " << nHeight;
+    }
+
+    // at a depth of COINBASE_MATURITY
+    Connect(10);
+    std::vector<CWalletUtxo> vUtxos = Utxos();
+    ASSERT_EQ(1u, vUtxos.size());
+    EXPECT_EQ(COutPoint(coinbase1.GetHash(), 0), vUtxos[0].outpoint);
+    EXPECT_EQ(1, vUtxos[0].nHeight);
+    EXPECT_EQ(vIndexes[1].nTime, vUtxos[0].nBlockTime);
+
+    // the coinbase paying someone else never shows up
+    Connect(11);
+    Connect(12);
+    vUtxos = Utxos();
+    ASSERT_EQ(2u, vUtxos.size());
+    std::vector<CWalletUtxo> vByTime;
+    wallet.utxoSet.GetByBlockTime(vByTime, vIndexes[3].nTime);
+    ASSERT_EQ(2u, vByTime.size());
+    EXPECT_EQ(COutPoint(coinbase1.GetHash(), 0), vByTime[0].outpoint);
+    EXPECT_EQ(COutPoint(coinbase3.GetHash(), 0), vByTime[1].outpoint);
+}
+
+TEST_F(TestWalletUtxoSet, matureCoinbaseSpent)
+{
+    CTransaction coinbase = Coinbase(1, Mine());
+    Connect(1, {coinbase});
+    Connect(10);
+    ASSERT_EQ(1u, Utxos().size());
+
+    // spent to ourselves, the change is added right away
+    CMutableTransaction mtx;
+    mtx.vin.resize(1);
+    mtx.vin[0].prevout = COutPoint(coinbase.GetHash(), 0);
+    mtx.vout.resize(1);
+    mtx.vout[0].nValue = 9 * COIN;
+    mtx.vout[0].scriptPubKey = Mine();
+    CTransaction spend(mtx);
+    Connect(11, {Coinbase(11, CScript() << OP_TRUE), spend});
+    std::vector<CWalletUtxo> vUtxos = Utxos();
+    ASSERT_EQ(1u, vUtxos.size());
+    EXPECT_EQ(COutPoint(spend.GetHash(), 0), vUtxos[0].outpoint);
+    EXPECT_EQ(11, vUtxos[0].nHeight);
+}
+
+}
@@ -231,4 +231,25 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
 
 
 
+BOOST_AUTO_TEST_CASE(dbwrapper_registry)
+{
+    path ph = temp_directory_path() / unique_path();
+    path ph2 = temp_directory_path() / unique_path();
+    CDBOptions scratchOptions;
+    scratchOptions.fScratch = true;
+    CDBWrapper dbw(ph, (1 << 20), true, false);
+    CDBWrapper scratch(ph2, (1 << 20), true, false, scratchOptions);
+
+    // The scratch database is left out, and a database can be opened and
+    // closed while another one is being visited
+    bool fFound = false, fScratchFound = false;
+    ForEachDBWrapper([&](CDBWrapper& db) {
+        fFound |= (&db == &dbw);
+        fScratchFound |= (&db == &scratch);
+        CDBWrapper other(temp_directory_path() / unique_path(), (1 << 20), true, false);
+    });
+    BOOST_CHECK(fFound);
+    BOOST_CHECK(!fScratchFound);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -108,6 +108,40 @@ BOOST_AUTO_TEST_CASE(pmt_test1)
     }
 }
 
+BOOST_AUTO_TEST_CASE(pmt_levels)
+{
+    seed_insecure_rand(false);
+    static const unsigned int nTxCounts[] = {1, 2, 3, 7, 17, 56, 127, 256, 313, 1000};
+
+    for (int n = 0; n < 10; n++) {
+        unsigned int nTx = nTxCounts[n];
+        std::vector<uint256> vTxid(nTx, uint256());
+        for (unsigned int j=0; j<nTx; j++)
+            vTxid[j] = GetRandHash();
+        std::vector<std::vector<uint256> > vLevels = BuildMerkleLevels(vTxid);
+
+        // the tree built from the cached levels must serialize exactly like the one built from the txids
+        for (int att = 0; att < 16; att++) {
+            unsigned int nMatch = att == 0 ? nTx - 1 : insecure_rand() % nTx;
+            std::vector<bool> vMatch(nTx, false);
+            vMatch[nMatch] = true;
+
+            CPartialMerkleTree pmt1(vTxid, vMatch);
+            CPartialMerkleTree pmt2(vLevels, nMatch);
+
+            CDataStream ss1(SER_NETWORK, PROTOCOL_VERSION);
+            CDataStream ss2(SER_NETWORK, PROTOCOL_VERSION);
+            ss1 << pmt1;
+            ss2 << pmt2;
+            BOOST_CHECK(ss1.str() == ss2.str());
+
+            std::vector<uint256> vMatchTxid;
+            BOOST_CHECK(pmt2.ExtractMatches(vMatchTxid) == vLevels.back()[0]);
+            BOOST_CHECK(vMatchTxid.size() == 1 && vMatchTxid[0] == vTxid[nMatch]);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(pmt_malleability)
 {
     std::vector<uint256> vTxid = boost::assign::list_of
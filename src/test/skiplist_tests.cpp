@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "main.h"
+#include "txdb.h"
 #include "random.h"
 #include "util.h"
 #include "test/test_bitcoin.h"
@@ -100,4 +101,47 @@ BOOST_AUTO_TEST_CASE(getlocator_test)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(trimsolution_test, TestingSetup)
+{
+    // More entries than the solution cache holds, so that some are read back from the db
+    std::vector<uint256> vHash(1500);
+    std::vector<CBlockIndex> vBlocks(vHash.size());
+    std::vector<std::vector<unsigned char> > vSolutions(vHash.size());
+    std::vector<const CBlockIndex*> vWrite;
+    for (unsigned int i=0; i<vBlocks.size(); i++) {
+        vHash[i] = GetRandHash();
+        vSolutions[i].resize(1344);
+        GetRandBytes(vSolutions[i].data(), vSolutions[i].size());
+        vBlocks[i].SetHeight(i);
+        vBlocks[i].pprev = i ? &vBlocks[i - 1] : NULL;
+        vBlocks[i].phashBlock = &vHash[i];
+        vBlocks[i].nSolution = vSolutions[i];
+        vWrite.push_back(&vBlocks[i]);
+    }
+    BOOST_CHECK(pblocktree->WriteBatchSync(std::vector<std::pair<int, const CBlockFileInfo*> >(), 0, vWrite));
+
+    for (unsigned int i=0; i<vBlocks.size(); i++) {
+        vBlocks[i].TrimSolution();
+        BOOST_CHECK(vBlocks[i].nSolution.empty());
+    }
+
+    // Twice, the second pass partly served from the cache
+    for (int n=0; n<2; n++) {
+        for (unsigned int i=0; i<vBlocks.size(); i++) {
+            BOOST_CHECK(vBlocks[i].GetSolution() == vSolutions[i]);
+        }
+    }
+
+    // Headers and entries written again carry the solution
+    for (int n=0; n<100; n++) {
+        int i = insecure_rand() % vBlocks.size();
+        CBlockHeader header = vBlocks[i].GetBlockHeader();
+        BOOST_CHECK(header.nSolution == vSolutions[i]);
+        BOOST_CHECK(header.hashPrevBlock == (i ? vHash[i - 1] : uint256()));
+        CDiskBlockIndex diskindex(&vBlocks[i]);
+        BOOST_CHECK(diskindex.nSolution == vSolutions[i]);
+        BOOST_CHECK(!diskindex.fSolutionTrimmed);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
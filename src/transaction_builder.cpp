@@ -13,6 +13,9 @@
 #include "key_io.h"
 #include "core_io.h" //for EncodeHexTx
 
+#include <atomic>
+#include <thread>
+
 #include <boost/variant.hpp>
 #include <librustzcash.h>
 
@@ -48,7 +51,7 @@ boost::optional<OutputDescription> OutputDescriptionInfo::Build(void* ctx) {
 
     OutputDescription odesc;
     uint256 rcm = this->note.rcm();
-    if (!librustzcash_sapling_output_proof(
+    if (!librustzcash_sapling_partial_output_proof(
             ctx,
             encryptor.get_esk().begin(),
             addressBytes.data(),
@@ -401,6 +404,11 @@ void TransactionBuilder::SetMinConfirmations(int iMinConf)
   this->iMinConf=iMinConf;
 }
 
+void TransactionBuilder::SetProofThreads(int nThreads)
+{
+    this->nProofThreads = nThreads;
+}
+
 void TransactionBuilder::SetHeight(const Consensus::Params& consensusParams, int nHeight)
 {
     this->nHeight = nHeight;
@@ -745,85 +753,113 @@ TransactionBuilderResult TransactionBuilder::Build()
     // Sapling spends and outputs
     //
 
-    auto ctx = librustzcash_sapling_proving_ctx_init();
+    // Check these up front as well to provide better logging.
+    std::vector<uint256> vNullifiers;
+    for (size_t i = 0; i < spends.size(); i++) {
+        auto cmu = spends[i].note.cmu();
+        auto nf = spends[i].note.nullifier(spends[i].expsk.full_viewing_key(), alWitnessPosition[i]);
+        if (!(cmu && nf)) {
+            return TransactionBuilderResult("Spend is invalid");
+        }
+        vNullifiers.push_back(*nf);
+    }
+    for (auto& output : outputs) {
+        if (!output.note.cmu()) {
+            return TransactionBuilderResult("Output is invalid");
+        }
+    }
 
-    // Create Sapling SpendDescriptions
-    //for (auto spend : spends)
-    for (size_t i = 0; i < spends.size(); i++)
-    {
-        auto spend = spends[i];
-        uint64_t      lWitnessPosition = alWitnessPosition[i];
-        myCharArray_s sWitness         = asWitness[i];
+    // Each spend and output is proved on its own, so they are shared out
+    // among the proof threads. Every thread accumulates the value commitments
+    // of its share in its own partial proving context, and the contexts are
+    // merged into the first one for the binding signature.
+    size_t nProofs = spends.size() + outputs.size();
+    int nThreads = nProofThreads;
+    if (nThreads <= 0)
+        nThreads = GetNumCores();
+    nThreads = std::max(1, std::min(nThreads, (int)nProofs));
 
-        // libzcash::diversifier_t d     = spend.note.d;
-        // uint256       pk_d            = spend.note.pk_d;
-        // uint256       rcm             = spend.note.rcm;
-        // uint64_t      value           = spend.note.value();
-        // libzcash::SaplingNote myNote (d, pk_d, value, r);
-
-        //printf("transaction_builder.cpp process spends-for()\n");
-        //auto cm = spend.note.cm();
-        //auto nf = spend.note.nullifier(spend.expsk.full_viewing_key(), lWitnessPosition);
-        auto cmu = spend.note.cmu();
-        auto nf = spend.note.nullifier(spend.expsk.full_viewing_key(), lWitnessPosition);
-        if (!(cmu && nf))
-        {
-            //printf("transaction_builder.cpp cm && nf error\n");
-            librustzcash_sapling_proving_ctx_free(ctx);
-            return TransactionBuilderResult("Spend is invalid");
+    std::vector<void*> vCtx;
+    for (int i = 0; i < nThreads; i++) {
+        vCtx.push_back(librustzcash_sapling_partial_proving_ctx_init());
+    }
+    auto freeContexts = [&]() {
+        for (void* ctx : vCtx) {
+            librustzcash_sapling_partial_proving_ctx_free(ctx);
         }
+    };
+
+    std::vector<SpendDescription> vSpendDescs(spends.size());
+    std::vector<boost::optional<OutputDescription>> vOutputDescs(outputs.size());
+    // char rather than bool, so that threads can set their own entries
+    std::vector<char> vProven(nProofs, false);
+    std::atomic<size_t> nNext(0);
+    auto prove = [&](void* ctx) {
+        for (size_t i = nNext++; i < nProofs; i = nNext++) {
+            try {
+                if (i < spends.size()) {
+                    auto& spend = spends[i];
+                    std::vector<unsigned char> witness(&asWitness[i].cArray[0], &asWitness[i].cArray[0] + sizeof(myCharArray_s));
+                    uint256 rcm = spend.note.rcm();
+                    vProven[i] = librustzcash_sapling_partial_spend_proof(
+                        ctx,
+                        spend.expsk.full_viewing_key().ak.begin(),
+                        spend.expsk.nsk.begin(),
+                        spend.note.d.data(),
+                        rcm.begin(),
+                        spend.alpha.begin(),
+                        spend.note.value(),
+                        spend.anchor.begin(),
+                        witness.data(),
+                        vSpendDescs[i].cv.begin(),
+                        vSpendDescs[i].rk.begin(),
+                        vSpendDescs[i].zkproof.data());
+                } else {
+                    size_t j = i - spends.size();
+                    vOutputDescs[j] = outputs[j].Build(ctx);
+                    vProven[i] = (bool)vOutputDescs[j];
+                }
+            } catch (const std::exception& e) {
+                LogPrintf("%s: proof %d failed: %s\n", __func__, i, e.what());
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < nThreads; i++) {
+        threads.emplace_back(prove, vCtx[i]);
+    }
+    prove(vCtx[0]);
+    for (auto& thread : threads) {
+        thread.join();
+    }
 
-/*
-        //printf("transaction_builder.cpp passed (cm&&nf)\n");
-        CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-        //printf("transaction_builder.cpp 1\n");
-        ss << spend.witness.path();
-        //printf("transaction_builder.cpp 2\n");
-        std::vector<unsigned char> witness(ss.begin(), ss.end());
-        //printf("transaction_builder.cpp 3\n");
-*/
-        std::vector<unsigned char> witness ( &sWitness.cArray[0], &sWitness.cArray[0] +  sizeof(myCharArray_s) );
-
-        SpendDescription sdesc;
-        uint256 rcm = spend.note.rcm();
-        if (!librustzcash_sapling_spend_proof(
-                ctx,
-                spend.expsk.full_viewing_key().ak.begin(),
-                spend.expsk.nsk.begin(),
-                spend.note.d.data(),
-                rcm.begin(),
-                spend.alpha.begin(),
-                spend.note.value(),
-                spend.anchor.begin(),
-                witness.data(),
-                sdesc.cv.begin(),
-                sdesc.rk.begin(),
-                sdesc.zkproof.data())) {
-            librustzcash_sapling_proving_ctx_free(ctx);
+    // Create Sapling SpendDescriptions
+    for (size_t i = 0; i < spends.size(); i++) {
+        if (!vProven[i]) {
+            freeContexts();
             return TransactionBuilderResult("Spend proof failed");
         }
-        //printf("transaction_builder.cpp librustzcash_sapling_spend_proof() passed!\n");
-        sdesc.anchor = spend.anchor;
-        sdesc.nullifier = *nf;
-        mtx.vShieldedSpend.push_back(sdesc);
+        vSpendDescs[i].anchor = spends[i].anchor;
+        vSpendDescs[i].nullifier = vNullifiers[i];
+        mtx.vShieldedSpend.push_back(vSpendDescs[i]);
     }
 
     // Create Sapling OutputDescriptions
-    for (auto output : outputs) {
-        // Check this out here as well to provide better logging.
-        if (!output.note.cmu()) {
-            librustzcash_sapling_proving_ctx_free(ctx);
-            return TransactionBuilderResult("Output is invalid");
-        }
-
-        auto odesc = output.Build(ctx);
-        if (!odesc) {
-            librustzcash_sapling_proving_ctx_free(ctx);
+    for (size_t j = 0; j < outputs.size(); j++) {
+        if (!vProven[spends.size() + j]) {
+            freeContexts();
             return TransactionBuilderResult("Failed to create output description");
         }
+        mtx.vShieldedOutput.push_back(vOutputDescs[j].get());
+    }
 
-        mtx.vShieldedOutput.push_back(odesc.get());
+    for (int i = 1; i < nThreads; i++) {
+        librustzcash_sapling_partial_proving_ctx_merge(vCtx[0], vCtx[i]);
+        librustzcash_sapling_partial_proving_ctx_free(vCtx[i]);
     }
+    auto ctx = vCtx[0];
+    vCtx.resize(1);
 
     // add op_return if there is one to add
     AddOpRetLast();
@@ -836,7 +872,7 @@ TransactionBuilderResult TransactionBuilder::Build()
     try {
         dataToBeSigned = SignatureHash(scriptCode, mtx, NOT_AN_INPUT, SIGHASH_ALL, 0, consensusBranchId);
     } catch (std::logic_error ex) {
-        librustzcash_sapling_proving_ctx_free(ctx);
+        librustzcash_sapling_partial_proving_ctx_free(ctx);
         return TransactionBuilderResult("Could not construct signature hash: " + std::string(ex.what()));
     }
 
@@ -848,13 +884,17 @@ TransactionBuilderResult TransactionBuilder::Build()
             dataToBeSigned.begin(),
             mtx.vShieldedSpend[i].spendAuthSig.data());
     }
-    librustzcash_sapling_binding_sig(
+    bool fBindingSig = librustzcash_sapling_partial_binding_sig(
         ctx,
         mtx.valueBalance,
         dataToBeSigned.begin(),
         mtx.bindingSig.data());
 
-    librustzcash_sapling_proving_ctx_free(ctx);
+    librustzcash_sapling_partial_proving_ctx_free(ctx);
+
+    if (!fBindingSig) {
+        return TransactionBuilderResult("Failed to create binding signature");
+    }
 
     // Transparent signatures
     CTransaction txNewConst(mtx);
@@ -881,3 +921,44 @@ TransactionBuilderResult TransactionBuilder::Build()
     //printf("transaction_builder.cpp Done\n");fflush(stdout);
     return CTransaction(mtx);
 }
+
+std::vector<TransactionBuilderResult> BuildTransactions(std::vector<TransactionBuilder>& builders, int nThreads, std::function<bool()> fCancelled)
+{
+    if (nThreads <= 0)
+        nThreads = GetNumCores();
+    int nProofThreads = std::max(1, nThreads / std::max(1, (int)builders.size()));
+    nThreads = std::max(1, std::min(nThreads, (int)builders.size()));
+
+    std::vector<boost::optional<TransactionBuilderResult>> results(builders.size());
+    std::atomic<size_t> nNext(0);
+    auto worker = [&]() {
+        for (size_t i = nNext++; i < builders.size(); i = nNext++) {
+            if (fCancelled && fCancelled()) {
+                results[i] = TransactionBuilderResult(std::string("Cancelled"));
+                continue;
+            }
+            try {
+                builders[i].SetProofThreads(nProofThreads);
+                results[i] = builders[i].Build();
+            } catch (const std::exception& e) {
+                results[i] = TransactionBuilderResult(std::string(e.what()));
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < nThreads; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::vector<TransactionBuilderResult> ret;
+    ret.reserve(results.size());
+    for (auto& result : results) {
+        ret.push_back(result.get());
+    }
+    return ret;
+}
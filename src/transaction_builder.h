@@ -20,6 +20,9 @@
 
 #include <boost/optional.hpp>
 
+#include <functional>
+#include <vector>
+
 struct SpendDescriptionInfo {
     libzcash::SaplingExpandedSpendingKey expsk;
     libzcash::SaplingNote note;
@@ -145,6 +148,7 @@ private:
     CMutableTransaction mtx;
     CAmount fee = 10000;
     int iMinConf = 1;
+    int nProofThreads = 1;
     uint32_t consensusBranchId;
 
     std::string fromAddress_;
@@ -195,6 +199,9 @@ public:
 
     void SetFee(CAmount fee);
     void SetMinConfirmations(int iMinConf);
+    // Number of threads Build() proves the Sapling spends and outputs on,
+    // 0 = one per core.
+    void SetProofThreads(int nThreads);
 
     void SetHeight(const Consensus::Params& consensusParams, int nHeight);
     void SetExpiryHeight(int expHeight);
@@ -270,4 +277,21 @@ public:
     std::string Build_offline_transaction();
 };
 
+/** Default for -saplingbuildthreads, 0 = one per core */
+static const int DEFAULT_SAPLING_BUILD_THREADS = 0;
+
+/**
+ * Builds independent transactions concurrently on up to nThreads worker
+ * threads (0 = one per core). Results are returned in the same order as the
+ * builders.
+ *
+ * Threads left over when there are fewer builders than threads are shared
+ * out among the builders to prove the spends and outputs of each transaction
+ * in parallel.
+ *
+ * If fCancelled is set it is polled before each build, and builders that have
+ * not started once it returns true fail with an error instead of being proved.
+ */
+std::vector<TransactionBuilderResult> BuildTransactions(std::vector<TransactionBuilder>& builders, int nThreads, std::function<bool()> fCancelled = nullptr);
+
 #endif /* TRANSACTION_BUILDER_H */
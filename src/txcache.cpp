@@ -0,0 +1,130 @@
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txcache.h"
+
+#include "core_memusage.h"
+#include "memusage.h"
+
+static size_t EntryUsage(const CTransaction& tx)
+{
+    // The transaction itself, its list node and its map node
+    return memusage::MallocUsage(sizeof(CTransaction)) +
+           memusage::MallocUsage(sizeof(uint256) + 4 * sizeof(void*) + sizeof(uint256) + sizeof(size_t)) +
+           memusage::MallocUsage(sizeof(uint256) + 3 * sizeof(void*)) +
+           RecursiveDynamicUsage(tx) +
+           memusage::DynamicUsage(tx.vjoinsplit) +
+           memusage::DynamicUsage(tx.vShieldedSpend) +
+           memusage::DynamicUsage(tx.vShieldedOutput);
+}
+
+CTxCache::CTxCache(size_t nMaxUsage) : nMaxShardUsage(nMaxUsage / NUM_SHARDS)
+{
+}
+
+CTxCache::CShard& CTxCache::GetShard(const uint256& txid)
+{
+    // GetCheapHash() picks the map bucket, so shard on different bytes
+    return shards[*(txid.end() - 1) % NUM_SHARDS];
+}
+
+void CTxCache::Trim(CShard& shard, size_t nMaxUsage)
+{
+    AssertLockHeld(shard.cs);
+    while (shard.nUsage > nMaxUsage && !shard.lru.empty()) {
+        shard.nUsage -= shard.lru.back().second.nUsage;
+        shard.mapEntries.erase(shard.lru.back().first);
+        shard.lru.pop_back();
+    }
+}
+
+void CTxCache::SetMaxUsage(size_t nMaxUsage)
+{
+    nMaxShardUsage = nMaxUsage / NUM_SHARDS;
+    for (CShard& shard : shards) {
+        LOCK(shard.cs);
+        Trim(shard, nMaxShardUsage);
+    }
+}
+
+size_t CTxCache::GetMaxUsage() const
+{
+    return nMaxShardUsage * NUM_SHARDS;
+}
+
+bool CTxCache::Get(const uint256& txid, CTransaction& txOut, uint256& hashBlock)
+{
+    std::shared_ptr<const CTransaction> tx;
+    CShard& shard = GetShard(txid);
+    {
+        LOCK(shard.cs);
+        auto it = shard.mapEntries.find(txid);
+        if (it == shard.mapEntries.end())
+            return false;
+        shard.lru.splice(shard.lru.begin(), shard.lru, it->second);
+        tx = it->second->second.tx;
+        hashBlock = it->second->second.hashBlock;
+    }
+    // Copy outside the lock, the entry may be evicted meanwhile
+    txOut = *tx;
+    return true;
+}
+
+void CTxCache::Add(const CTransaction& tx, const uint256& hashBlock)
+{
+    size_t nMaxUsage = nMaxShardUsage;
+    size_t nUsage = EntryUsage(tx);
+    if (nUsage > nMaxUsage)
+        return;
+
+    const uint256& txid = tx.GetHash();
+    CEntry entry;
+    entry.tx = std::make_shared<const CTransaction>(tx);
+    entry.hashBlock = hashBlock;
+    entry.nUsage = nUsage;
+
+    CShard& shard = GetShard(txid);
+    LOCK(shard.cs);
+    auto it = shard.mapEntries.find(txid);
+    if (it != shard.mapEntries.end()) {
+        shard.nUsage -= it->second->second.nUsage;
+        shard.lru.erase(it->second);
+        shard.mapEntries.erase(it);
+    }
+    shard.lru.emplace_front(txid, entry);
+    shard.mapEntries[txid] = shard.lru.begin();
+    shard.nUsage += nUsage;
+    Trim(shard, nMaxUsage);
+}
+
+void CTxCache::Erase(const uint256& txid)
+{
+    CShard& shard = GetShard(txid);
+    LOCK(shard.cs);
+    auto it = shard.mapEntries.find(txid);
+    if (it == shard.mapEntries.end())
+        return;
+    shard.nUsage -= it->second->second.nUsage;
+    shard.lru.erase(it->second);
+    shard.mapEntries.erase(it);
+}
+
+void CTxCache::Clear()
+{
+    for (CShard& shard : shards) {
+        LOCK(shard.cs);
+        shard.lru.clear();
+        shard.mapEntries.clear();
+        shard.nUsage = 0;
+    }
+}
+
+size_t CTxCache::DynamicMemoryUsage()
+{
+    size_t nUsage = 0;
+    for (CShard& shard : shards) {
+        LOCK(shard.cs);
+        nUsage += shard.nUsage;
+    }
+    return nUsage;
+}
@@ -0,0 +1,78 @@
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_TXCACHE_H
+#define BITCOIN_TXCACHE_H
+
+#include "primitives/transaction.h"
+#include "sync.h"
+#include "uint256.h"
+
+#include <atomic>
+#include <list>
+#include <memory>
+
+#include <boost/unordered_map.hpp>
+
+/** Default for -txcache, the size in MiB of the confirmed transaction cache */
+static const unsigned int DEFAULT_TXCACHE_SIZE = 32;
+
+/**
+ * Memory bounded LRU cache of confirmed transactions read through the
+ * transaction index, together with the hash of the block containing them.
+ *
+ * CC validation, token and oracle RPCs and the notary code look up the same
+ * few transactions over and over, each lookup costing a block file read and
+ * a deserialization. The cache is split into shards with their own locks so
+ * that concurrent lookups rarely contend. Entries are erased whenever a
+ * block containing them is connected or disconnected, so a hit always
+ * agrees with what the transaction index would return.
+ */
+class CTxCache
+{
+private:
+    struct CEntry {
+        std::shared_ptr<const CTransaction> tx;
+        uint256 hashBlock;
+        size_t nUsage;
+    };
+
+    struct TxidHasher
+    {
+        size_t operator()(const uint256& hash) const { return hash.GetCheapHash(); }
+    };
+
+    typedef std::list<std::pair<uint256, CEntry>> EntryList;
+
+    struct CShard {
+        CCriticalSection cs;
+        //! Most recently used first
+        EntryList lru;
+        boost::unordered_map<uint256, EntryList::iterator, TxidHasher> mapEntries;
+        size_t nUsage = 0;
+    };
+
+    static const size_t NUM_SHARDS = 16;
+
+    CShard shards[NUM_SHARDS];
+    std::atomic<size_t> nMaxShardUsage;
+
+    CShard& GetShard(const uint256& txid);
+    void Trim(CShard& shard, size_t nMaxUsage);
+
+public:
+    CTxCache(size_t nMaxUsage);
+
+    /** Set the total memory limit in bytes, 0 disables the cache */
+    void SetMaxUsage(size_t nMaxUsage);
+    size_t GetMaxUsage() const;
+
+    bool Get(const uint256& txid, CTransaction& txOut, uint256& hashBlock);
+    void Add(const CTransaction& tx, const uint256& hashBlock);
+    void Erase(const uint256& txid);
+    void Clear();
+
+    size_t DynamicMemoryUsage();
+};
+
+#endif // BITCOIN_TXCACHE_H
@@ -32,6 +32,11 @@
 
 #include <stdint.h>
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 #include <boost/thread.hpp>
 
 using namespace std;
@@ -51,6 +56,13 @@ static const char DB_TIMESTAMPINDEX = 'S';
 static const char DB_BLOCKHASHINDEX = 'z';
 static const char DB_SPENTINDEX = 'p';
 static const char DB_BLOCK_INDEX = 'b';
+static const char DB_TOKENUNSPENTINDEX = 'k';
+static const char DB_TOKENOUTPUTINDEX = 'o';
+static const char DB_ORACLESAMPLEINDEX = 'O';
+static const char DB_EVALINDEX = 'e';
+static const char DB_KVINDEX = 'K';
+static const char DB_KVEXPIRY = 'E';
+static const char DB_KVUNDO = 'v';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_BEST_SPROUT_ANCHOR = 'a';
@@ -58,12 +70,14 @@ static const char DB_BEST_SAPLING_ANCHOR = 'z';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_BLOCK_INDEX_COUNT = 'I';
+static const char DB_KV_BEST = 'V';
 
 
-CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe) {
+CCoinsViewDB::CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory, bool fWipe, const CDBOptions& dbOptions) : db(GetDataDir() / dbName, nCacheSize, fMemory, fWipe, dbOptions) {
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe)
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe, const CDBOptions& dbOptions) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, dbOptions)
 {
 }
 
@@ -217,7 +231,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins,
     return db.WriteBatch(batch);
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, bool compression, int maxOpenFiles) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, compression, maxOpenFiles) {
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, const CDBOptions& dbOptions) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe, dbOptions) {
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -298,6 +312,10 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     return WriteBatch(batch, true);
 }
 
+bool CBlockTreeDB::ReadDiskBlockIndex(const uint256 &hash, CDiskBlockIndex &diskindex) {
+    return Read(make_pair(DB_BLOCK_INDEX, hash), diskindex);
+}
+
 bool CBlockTreeDB::EraseBatchSync(const std::vector<const CBlockIndex*>& blockinfo) {
     CDBBatch batch(*this);
     for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
@@ -380,6 +398,305 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
     return true;
 }
 
+bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type, const CAddressUnspentKey &cursor, unsigned int nLimit,
+                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    if (cursor.txhash.IsNull())
+        pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    else
+        pcursor->Seek(make_pair(DB_ADDRESSUNSPENTINDEX, CAddressUnspentKey(type, addressHash, cursor.txhash, cursor.index)));
+
+    while (pcursor->Valid() && unspentOutputs.size() < nLimit) {
+        boost::this_thread::interruption_point();
+        try {
+            pair<char, CAddressUnspentKey> keyObj;
+            pcursor->GetKey(keyObj);
+            char chType = keyObj.first;
+            CAddressUnspentKey indexKey = keyObj.second;
+
+            if (chType != DB_ADDRESSUNSPENTINDEX || indexKey.hashBytes != addressHash)
+                break;
+            // the cursor itself was returned by the previous page
+            if (indexKey.txhash != cursor.txhash || indexKey.index != cursor.index) {
+                CAddressUnspentValue nValue;
+                if (!pcursor->GetValue(nValue))
+                    return error("failed to get address unspent value");
+                unspentOutputs.push_back(make_pair(indexKey, nValue));
+            }
+            pcursor->Next();
+        } catch (const std::exception& e) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool CBlockTreeDB::ReadAddressUnspentValue(const CAddressUnspentKey &key, CAddressUnspentValue &value) {
+    return Read(make_pair(DB_ADDRESSUNSPENTINDEX, key), value);
+}
+
+bool CBlockTreeDB::UpdateTokenIndex(const std::vector<std::pair<CTokenUnspentKey, CAddressUnspentValue> > &unspentVect,
+                                    const std::vector<std::pair<COutPoint, uint256> > &outputVect) {
+    CDBBatch batch(*this);
+    for (std::vector<std::pair<CTokenUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentVect.begin(); it!=unspentVect.end(); it++) {
+        if (it->second.IsNull()) {
+            batch.Erase(make_pair(DB_TOKENUNSPENTINDEX, it->first));
+        } else {
+            batch.Write(make_pair(DB_TOKENUNSPENTINDEX, it->first), it->second);
+        }
+    }
+    // the outpoint -> tokenid records outlive the spend so that a disconnect can restore the unspent entry
+    for (std::vector<std::pair<COutPoint, uint256> >::const_iterator it=outputVect.begin(); it!=outputVect.end(); it++) {
+        if (it->second.IsNull()) {
+            batch.Erase(make_pair(DB_TOKENOUTPUTINDEX, it->first));
+        } else {
+            batch.Write(make_pair(DB_TOKENOUTPUTINDEX, it->first), it->second);
+        }
+    }
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadTokenOutputIndex(const COutPoint &outpoint, uint256 &tokenid) {
+    return Read(make_pair(DB_TOKENOUTPUTINDEX, outpoint), tokenid);
+}
+
+template <typename IteratorKey>
+static bool ReadTokenUnspentRange(CBlockTreeDB &db, const IteratorKey &start, uint256 tokenid, const uint160 *addressHash, int type,
+                                  std::vector<std::pair<CTokenUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
+
+    boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+
+    pcursor->Seek(make_pair(DB_TOKENUNSPENTINDEX, start));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            pair<char, CTokenUnspentKey> keyObj;
+            pcursor->GetKey(keyObj);
+            char chType = keyObj.first;
+            CTokenUnspentKey indexKey = keyObj.second;
+
+            if (chType == DB_TOKENUNSPENTINDEX && indexKey.tokenid == tokenid &&
+                (addressHash == NULL || (indexKey.type == type && indexKey.hashBytes == *addressHash))) {
+                try {
+                    CAddressUnspentValue nValue;
+                    pcursor->GetValue(nValue);
+                    unspentOutputs.push_back(make_pair(indexKey, nValue));
+                    pcursor->Next();
+                } catch (const std::exception& e) {
+                    return error("failed to get token unspent value");
+                }
+            } else {
+                break;
+            }
+        } catch (const std::exception& e) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool CBlockTreeDB::ReadTokenUnspentIndex(uint256 tokenid,
+                                         std::vector<std::pair<CTokenUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
+    return ReadTokenUnspentRange(*this, CTokenIndexIteratorKey(tokenid), tokenid, NULL, 0, unspentOutputs);
+}
+
+bool CBlockTreeDB::ReadTokenUnspentIndex(uint256 tokenid, uint160 addressHash, int type,
+                                         std::vector<std::pair<CTokenUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
+    return ReadTokenUnspentRange(*this, CTokenIndexIteratorAddressKey(tokenid, type, addressHash), tokenid, &addressHash, type, unspentOutputs);
+}
+
+bool CBlockTreeDB::WriteOracleSampleIndex(const std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > > &vect) {
+    CDBBatch batch(*this);
+    for (std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+        batch.Write(make_pair(DB_ORACLESAMPLEINDEX, it->first), it->second);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::EraseOracleSampleIndex(const std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > > &vect) {
+    CDBBatch batch(*this);
+    for (std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > >::const_iterator it=vect.begin(); it!=vect.end(); it++)
+        batch.Erase(make_pair(DB_ORACLESAMPLEINDEX, it->first));
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadOracleSampleIndex(uint256 oracletxid, uint160 batonHash, int32_t num,
+                                         std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > > &samples) {
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(make_pair(DB_ORACLESAMPLEINDEX, COracleSampleIteratorKey(oracletxid, batonHash)));
+
+    // newest first, see COracleSampleKey
+    while (pcursor->Valid() && (num == 0 || (int32_t)samples.size() < num)) {
+        boost::this_thread::interruption_point();
+        try {
+            pair<char, COracleSampleKey> keyObj;
+            pcursor->GetKey(keyObj);
+            char chType = keyObj.first;
+            COracleSampleKey indexKey = keyObj.second;
+
+            if (chType == DB_ORACLESAMPLEINDEX && indexKey.oracletxid == oracletxid && indexKey.batonHash == batonHash) {
+                try {
+                    std::vector<uint8_t> data;
+                    pcursor->GetValue(data);
+                    samples.push_back(make_pair(indexKey, data));
+                    pcursor->Next();
+                } catch (const std::exception& e) {
+                    return error("failed to get oracle sample data");
+                }
+            } else {
+                break;
+            }
+        } catch (const std::exception& e) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool CBlockTreeDB::WriteEvalIndex(const std::vector<CEvalIndexKey> &vect) {
+    CDBBatch batch(*this);
+    for (std::vector<CEvalIndexKey>::const_iterator it=vect.begin(); it!=vect.end(); it++)
+        batch.Write(make_pair(DB_EVALINDEX, *it), 0);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::EraseEvalIndex(const std::vector<CEvalIndexKey> &vect) {
+    CDBBatch batch(*this);
+    for (std::vector<CEvalIndexKey>::const_iterator it=vect.begin(); it!=vect.end(); it++)
+        batch.Erase(make_pair(DB_EVALINDEX, *it));
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadEvalIndex(uint8_t evalcode, uint8_t funcid, uint256 reftxid, std::vector<CEvalIndexKey> &vect) {
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(make_pair(DB_EVALINDEX, CEvalIndexIteratorKey(evalcode, funcid, reftxid)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            pair<char, CEvalIndexKey> keyObj;
+            pcursor->GetKey(keyObj);
+            char chType = keyObj.first;
+            CEvalIndexKey indexKey = keyObj.second;
+
+            if (chType != DB_EVALINDEX || indexKey.evalcode != evalcode || (funcid != 0 && indexKey.funcid != funcid))
+                break;
+            if (!reftxid.IsNull() && indexKey.reftxid != reftxid) {
+                // without a funcid the reftxid can only be filtered
+                if (funcid != 0)
+                    break;
+            } else {
+                vect.push_back(indexKey);
+            }
+            pcursor->Next();
+        } catch (const std::exception& e) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool CBlockTreeDB::ReadKVIndex(const std::vector<uint8_t> &key, CKVEntry &entry) {
+    return Read(make_pair(DB_KVINDEX, key), entry);
+}
+
+bool CBlockTreeDB::ReadKVExpired(int nMaxHeight, std::vector<CKVExpiryKey> &vect) {
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(make_pair(DB_KVEXPIRY, CKVExpiryKey()));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        try {
+            pair<char, CKVExpiryKey> keyObj;
+            pcursor->GetKey(keyObj);
+            if (keyObj.first != DB_KVEXPIRY || keyObj.second.expiryHeight > nMaxHeight)
+                break;
+            vect.push_back(keyObj.second);
+            pcursor->Next();
+        } catch (const std::exception& e) {
+            break;
+        }
+    }
+    return true;
+}
+
+bool CBlockTreeDB::ReadKVUndo(int nHeight, CKVUndo &undo) {
+    return Read(make_pair(DB_KVUNDO, nHeight), undo);
+}
+
+bool CBlockTreeDB::ReadKVBestBlock(int &nHeight, uint256 &hashBlock) {
+    std::pair<int, uint256> best;
+    if (!Read(DB_KV_BEST, best))
+        return false;
+    nHeight = best.first;
+    hashBlock = best.second;
+    return true;
+}
+
+bool CBlockTreeDB::WriteKVBatch(const CKVBatch &kvbatch) {
+    CDBBatch batch(*this);
+    for (std::vector<std::pair<std::vector<uint8_t>, CKVEntry> >::const_iterator it=kvbatch.vEntries.begin(); it!=kvbatch.vEntries.end(); it++) {
+        if (it->second.IsNull())
+            batch.Erase(make_pair(DB_KVINDEX, it->first));
+        else
+            batch.Write(make_pair(DB_KVINDEX, it->first), it->second);
+    }
+    for (std::vector<CKVExpiryKey>::const_iterator it=kvbatch.vExpiryErase.begin(); it!=kvbatch.vExpiryErase.end(); it++)
+        batch.Erase(make_pair(DB_KVEXPIRY, *it));
+    for (std::vector<CKVExpiryKey>::const_iterator it=kvbatch.vExpiryWrite.begin(); it!=kvbatch.vExpiryWrite.end(); it++)
+        batch.Write(make_pair(DB_KVEXPIRY, *it), '1');
+    for (std::map<int, CKVUndo>::const_iterator it=kvbatch.mapUndo.begin(); it!=kvbatch.mapUndo.end(); it++) {
+        if (it->second.empty())
+            batch.Erase(make_pair(DB_KVUNDO, it->first));
+        else
+            batch.Write(make_pair(DB_KVUNDO, it->first), it->second);
+    }
+    batch.Write(DB_KV_BEST, std::make_pair(kvbatch.nBestHeight, kvbatch.hashBestBlock));
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::WipeKVIndex() {
+    CDBBatch batch(*this);
+    {
+        boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+        pcursor->Seek(make_pair(DB_KVINDEX, std::vector<uint8_t>()));
+        while (pcursor->Valid()) {
+            boost::this_thread::interruption_point();
+            pair<char, std::vector<uint8_t> > keyObj;
+            if (!pcursor->GetKey(keyObj) || keyObj.first != DB_KVINDEX)
+                break;
+            batch.Erase(keyObj);
+            pcursor->Next();
+        }
+    }
+    {
+        boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+        pcursor->Seek(make_pair(DB_KVUNDO, 0));
+        while (pcursor->Valid()) {
+            boost::this_thread::interruption_point();
+            pair<char, int> keyObj;
+            if (!pcursor->GetKey(keyObj) || keyObj.first != DB_KVUNDO)
+                break;
+            batch.Erase(keyObj);
+            pcursor->Next();
+        }
+    }
+    std::vector<CKVExpiryKey> expiry;
+    ReadKVExpired(std::numeric_limits<int>::max(), expiry);
+    for (std::vector<CKVExpiryKey>::const_iterator it=expiry.begin(); it!=expiry.end(); it++)
+        batch.Erase(make_pair(DB_KVEXPIRY, *it));
+    batch.Erase(DB_KV_BEST);
+    return WriteBatch(batch);
+}
+
 bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
     CDBBatch batch(*this);
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
@@ -438,6 +755,56 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
     return true;
 }
 
+bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type, const CAddressIndexKey &cursor, unsigned int nLimit,
+                                    std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex) {
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    // the position of the cursor tx in its block is not known to light clients, rows at the cursor
+    // height are returned only once the cursor row itself has been passed
+    bool fPastCursor = cursor.txhash.IsNull();
+    std::vector<std::pair<CAddressIndexKey, CAmount> > atCursorHeight;
+
+    pcursor->Seek(make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, cursor.blockHeight)));
+
+    while (pcursor->Valid() && addressIndex.size() < nLimit) {
+        boost::this_thread::interruption_point();
+        try {
+            pair<char, CAddressIndexKey> keyObj;
+            pcursor->GetKey(keyObj);
+            char chType = keyObj.first;
+            CAddressIndexKey indexKey = keyObj.second;
+
+            if (chType != DB_ADDRESSINDEX || indexKey.hashBytes != addressHash)
+                break;
+            CAmount nValue;
+            if (!pcursor->GetValue(nValue))
+                return error("failed to get address index value");
+            if (fPastCursor) {
+                addressIndex.push_back(make_pair(indexKey, nValue));
+            } else if (indexKey.blockHeight != cursor.blockHeight) {
+                // the cursor row is gone after a reorg, resume with its whole height
+                fPastCursor = true;
+                addressIndex.insert(addressIndex.end(), atCursorHeight.begin(), atCursorHeight.end());
+                if (addressIndex.size() > nLimit)
+                    addressIndex.resize(nLimit);
+                continue;
+            } else if (indexKey.txhash == cursor.txhash && indexKey.index == cursor.index && indexKey.spending == cursor.spending) {
+                fPastCursor = true;
+            } else {
+                atCursorHeight.push_back(make_pair(indexKey, nValue));
+            }
+            pcursor->Next();
+        } catch (const std::exception& e) {
+            break;
+        }
+    }
+    if (!fPastCursor)
+        addressIndex.insert(addressIndex.end(), atCursorHeight.begin(), atCursorHeight.end());
+    if (addressIndex.size() > nLimit)
+        addressIndex.resize(nLimit);
+    return true;
+}
+
 bool getAddressFromIndex(const int &type, const uint160 &hash, std::string &address);
 uint32_t komodo_segid32(char *coinaddr);
 
@@ -688,9 +1055,104 @@ bool CBlockTreeDB::blockOnchainActive(const uint256 &hash) {
     return true;
 }
 
+/**
+ * Checks on worker threads that the loaded block index entries hash to their
+ * keys, and then trims their solutions, while the thread reading the cursor
+ * keeps going. Entries are handed
+ * over in chunks and are not touched by the reader once handed over.
+ */
+class CBlockIndexHashCheck
+{
+private:
+    std::mutex cs;
+    std::condition_variable cond;
+    std::deque<std::vector<CBlockIndex*> > queue;
+    std::vector<std::thread> threads;
+    bool fDone;
+    CBlockIndex* pindexFailed;
+
+    void Worker()
+    {
+        std::vector<CBlockIndex*> chunk;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(cs);
+                cond.wait(lock, [this]() { return fDone || !queue.empty(); });
+                if (queue.empty() || pindexFailed != NULL)
+                    return;
+                chunk.swap(queue.front());
+                queue.pop_front();
+            }
+            for (CBlockIndex* pindex : chunk) {
+                if (pindex->GetBlockHeader().GetHash() != pindex->GetBlockHash()) {
+                    std::lock_guard<std::mutex> lock(cs);
+                    if (pindexFailed == NULL)
+                        pindexFailed = pindex;
+                    break;
+                }
+                // The entry is in the db, which is where the solution is read back from
+                pindex->TrimSolution();
+            }
+            chunk.clear();
+        }
+    }
+
+public:
+    static const size_t CHUNK_SIZE = 4096;
+
+    CBlockIndexHashCheck(int nThreads) : fDone(false), pindexFailed(NULL)
+    {
+        for (int i = 0; i < nThreads; i++)
+            threads.emplace_back(&CBlockIndexHashCheck::Worker, this);
+    }
+
+    ~CBlockIndexHashCheck()
+    {
+        {
+            std::lock_guard<std::mutex> lock(cs);
+            queue.clear();
+        }
+        Wait();
+    }
+
+    void Add(std::vector<CBlockIndex*>& chunk)
+    {
+        {
+            std::lock_guard<std::mutex> lock(cs);
+            queue.push_back(std::vector<CBlockIndex*>());
+            queue.back().swap(chunk);
+        }
+        cond.notify_one();
+    }
+
+    /** Waits for the queued entries to be checked, returns the first inconsistent one found */
+    CBlockIndex* Wait()
+    {
+        {
+            std::lock_guard<std::mutex> lock(cs);
+            fDone = true;
+        }
+        cond.notify_all();
+        for (auto& thread : threads)
+            thread.join();
+        threads.clear();
+        return pindexFailed;
+    }
+};
+
 bool CBlockTreeDB::LoadBlockIndexGuts()
 {
     boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    int64_t nStart = GetTimeMillis();
+
+    // Entries from the last startup, so that the map is not rehashed all along
+    uint64_t nStoredCount = 0;
+    if (Read(DB_BLOCK_INDEX_COUNT, nStoredCount))
+        mapBlockIndex.reserve(nStoredCount);
+
+    CBlockIndexHashCheck hashcheck(std::max(1, GetNumCores()));
+    std::vector<CBlockIndex*> vChunk;
+    vChunk.reserve(CBlockIndexHashCheck::CHUNK_SIZE);
 
     pcursor->Seek(make_pair(DB_BLOCK_INDEX, uint256()));
     int64_t count = 0; int reportDone = 0;
@@ -741,16 +1203,15 @@ bool CBlockTreeDB::LoadBlockIndexGuts()
                 pindexNew->segid          = diskindex.segid;
                 pindexNew->nNotaryPay     = diskindex.nNotaryPay;
 //fprintf(stderr,"loadguts ht.%d\n",pindexNew->GetHeight());
-                // Consistency checks
-                auto header = pindexNew->GetBlockHeader();
-                if (header.GetHash() != pindexNew->GetBlockHash())
-                    return error("LoadBlockIndex(): block header inconsistency detected: on-disk = %s, in-memory = %s",
-                                 diskindex.ToString(),  pindexNew->ToString());
+                // Consistency checks, the header hashes are checked by hashcheck
+                vChunk.push_back(pindexNew);
+                if (vChunk.size() >= CBlockIndexHashCheck::CHUNK_SIZE)
+                    hashcheck.Add(vChunk);
                 if ( 0 ) // POW will be checked before any block is connected
                 {
                     uint8_t pubkey33[33];
                     komodo_index2pubkey33(pubkey33,pindexNew,pindexNew->GetHeight());
-                    if (!CheckProofOfWork(header,pubkey33,pindexNew->GetHeight(),Params().GetConsensus()))
+                    if (!CheckProofOfWork(pindexNew->GetBlockHeader(),pubkey33,pindexNew->GetHeight(),Params().GetConsensus()))
                         return error("LoadBlockIndex(): CheckProofOfWork failed: %s", pindexNew->ToString());
                 }
                 pcursor->Next();
@@ -761,9 +1222,21 @@ bool CBlockTreeDB::LoadBlockIndexGuts()
             break;
         }
     }
+    int64_t nRead = GetTimeMillis();
+
+    if (!vChunk.empty())
+        hashcheck.Add(vChunk);
+    CBlockIndex* pindexFailed = hashcheck.Wait();
+    if (pindexFailed != NULL)
+        return error("LoadBlockIndex(): block header inconsistency detected: on-disk = %s, header hash = %s",
+                     pindexFailed->ToString(), pindexFailed->GetBlockHeader().GetHash().ToString());
 
     uiInterface.ShowProgress("", 100, false);
     LogPrintf("[%s].\n", ShutdownRequested() ? "CANCELLED" : "DONE");
+    LogPrintf("%s: read %d entries in %dms, header hashes checked %dms later\n", __func__, count, nRead - nStart, GetTimeMillis() - nRead);
+
+    if (count != (int64_t)nStoredCount)
+        Write(DB_BLOCK_INDEX_COUNT, (uint64_t)count);
 
     return true;
 }
@@ -32,10 +32,17 @@
 
 class CBlockFileInfo;
 class CBlockIndex;
+class CDiskBlockIndex;
 struct CDiskTxPos;
 struct CAddressUnspentKey;
 struct CAddressUnspentValue;
 struct CAddressIndexKey;
+struct CTokenUnspentKey;
+struct COracleSampleKey;
+struct CEvalIndexKey;
+struct CKVEntry;
+struct CKVExpiryKey;
+struct CKVBatch;
 struct CAddressIndexIteratorKey;
 struct CAddressIndexIteratorHeightKey;
 struct CTimestampIndexKey;
@@ -44,6 +51,7 @@ struct CTimestampBlockIndexKey;
 struct CTimestampBlockIndexValue;
 struct CSpentIndexKey;
 struct CSpentIndexValue;
+class COutPoint;
 class uint256;
 
 //! -dbcache default (MiB)
@@ -58,9 +66,9 @@ class CCoinsViewDB : public CCoinsView
 {
 protected:
     CDBWrapper db;
-    CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CCoinsViewDB(std::string dbName, size_t nCacheSize, bool fMemory = false, bool fWipe = false, const CDBOptions& dbOptions = GetDBProfile("chainstate"));
 public:
-    CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, const CDBOptions& dbOptions = GetDBProfile("chainstate"));
 
     bool GetSproutAnchorAt(const uint256 &rt, SproutMerkleTree &tree) const;
     bool GetSaplingAnchorAt(const uint256 &rt, SaplingMerkleTree &tree) const;
@@ -84,7 +92,7 @@ public:
 class CBlockTreeDB : public CDBWrapper
 {
 public:
-    CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool compression = true, int maxOpenFiles = 1000);
+    CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, const CDBOptions& dbOptions = GetDBProfile("blockindex"));
 private:
     CBlockTreeDB(const CBlockTreeDB&);
     void operator=(const CBlockTreeDB&);
@@ -93,6 +101,7 @@ public:
     bool EraseBatchSync(const std::vector<const CBlockIndex*>& blockinfo);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo &fileinfo);
     bool ReadLastBlockFile(int &nFile);
+    bool ReadDiskBlockIndex(const uint256 &hash, CDiskBlockIndex &diskindex);
     bool WriteReindexing(bool fReindex);
     bool ReadReindexing(bool &fReindex);
     bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos);
@@ -102,11 +111,36 @@ public:
     bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
     bool ReadAddressUnspentIndex(uint160 addressHash, int type,
                                  std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
+    bool ReadAddressUnspentIndex(uint160 addressHash, int type, const CAddressUnspentKey &cursor, unsigned int nLimit,
+                                 std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
+    bool ReadAddressUnspentValue(const CAddressUnspentKey &key, CAddressUnspentValue &value);
+    bool UpdateTokenIndex(const std::vector<std::pair<CTokenUnspentKey, CAddressUnspentValue> > &unspentVect,
+                          const std::vector<std::pair<COutPoint, uint256> > &outputVect);
+    bool ReadTokenOutputIndex(const COutPoint &outpoint, uint256 &tokenid);
+    bool ReadTokenUnspentIndex(uint256 tokenid,
+                               std::vector<std::pair<CTokenUnspentKey, CAddressUnspentValue> > &vect);
+    bool ReadTokenUnspentIndex(uint256 tokenid, uint160 addressHash, int type,
+                               std::vector<std::pair<CTokenUnspentKey, CAddressUnspentValue> > &vect);
+    bool WriteOracleSampleIndex(const std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > > &vect);
+    bool EraseOracleSampleIndex(const std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > > &vect);
+    bool ReadOracleSampleIndex(uint256 oracletxid, uint160 batonHash, int32_t num,
+                               std::vector<std::pair<COracleSampleKey, std::vector<uint8_t> > > &vect);
+    bool WriteEvalIndex(const std::vector<CEvalIndexKey> &vect);
+    bool EraseEvalIndex(const std::vector<CEvalIndexKey> &vect);
+    bool ReadEvalIndex(uint8_t evalcode, uint8_t funcid, uint256 reftxid, std::vector<CEvalIndexKey> &vect);
+    bool ReadKVIndex(const std::vector<uint8_t> &key, CKVEntry &entry);
+    bool ReadKVExpired(int nMaxHeight, std::vector<CKVExpiryKey> &vect);
+    bool ReadKVUndo(int nHeight, std::vector<std::pair<std::vector<uint8_t>, CKVEntry> > &undo);
+    bool ReadKVBestBlock(int &nHeight, uint256 &hashBlock);
+    bool WriteKVBatch(const CKVBatch &kvbatch);
+    bool WipeKVIndex();
     bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
     bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
     bool ReadAddressIndex(uint160 addressHash, int type,
                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
                           int start = 0, int end = 0);
+    bool ReadAddressIndex(uint160 addressHash, int type, const CAddressIndexKey &cursor, unsigned int nLimit,
+                          std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex);
     bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
     bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect);
     bool WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts);
@@ -25,6 +25,7 @@
 #include "consensus/validation.h"
 #include "main.h"
 #include "policy/fees.h"
+#include "rust/metrics.h"
 #include "streams.h"
 #include "timedata.h"
 #include "util.h"
@@ -141,6 +142,8 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     totalTxSize += entry.GetTxSize();
     cachedInnerUsage += entry.DynamicMemoryUsage();
     minerPolicyEstimator->processTransaction(entry, fCurrentEstimate);
+    MetricsGauge("eskenas.mempool.size.transactions", mapTx.size());
+    MetricsGauge("eskenas.mempool.size.bytes", totalTxSize);
 
     return true;
 }
@@ -250,6 +253,104 @@ bool CTxMemPool::removeAddressIndex(const uint256 txhash)
     return true;
 }
 
+void CTxMemPool::addEvalIndex(const CTxMemPoolEntry &entry)
+{
+    LOCK(cs);
+    const CTransaction& tx = entry.GetTx();
+    std::vector<CEvalIndexKey> inserted;
+
+    // mempool keys have no height, see GetCCEvalIndex
+    GetCCEvalIndexKeys(tx, 0, 0, inserted);
+    if (inserted.empty())
+        return;
+    for (std::vector<CEvalIndexKey>::iterator it = inserted.begin(); it != inserted.end(); it++)
+        setEval.insert(*it);
+
+    mapEvalInserted.insert(make_pair(tx.GetHash(), inserted));
+}
+
+bool CTxMemPool::getEvalIndex(uint8_t evalcode, uint8_t funcid, uint256 reftxid, std::vector<CEvalIndexKey> &results)
+{
+    LOCK(cs);
+    evalIndexSet::iterator it = setEval.lower_bound(CEvalIndexKey(evalcode, funcid, funcid != 0 ? reftxid : uint256(), 0, 0, uint256()));
+    while (it != setEval.end() && (*it).evalcode == evalcode) {
+        if (funcid != 0 && (*it).funcid != funcid)
+            break;
+        if (!reftxid.IsNull() && (*it).reftxid != reftxid) {
+            if (funcid != 0)
+                break;
+        } else {
+            results.push_back(*it);
+        }
+        it++;
+    }
+    return true;
+}
+
+bool CTxMemPool::removeEvalIndex(const uint256 txhash)
+{
+    LOCK(cs);
+    evalIndexInserted::iterator it = mapEvalInserted.find(txhash);
+
+    if (it != mapEvalInserted.end()) {
+        std::vector<CEvalIndexKey> keys = (*it).second;
+        for (std::vector<CEvalIndexKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
+            setEval.erase(*mit);
+        }
+        mapEvalInserted.erase(it);
+    }
+
+    return true;
+}
+
+void CTxMemPool::addKVIndex(const CTxMemPoolEntry &entry)
+{
+    LOCK(cs);
+    const CTransaction& tx = entry.GetTx();
+    const uint256 txhash = tx.GetHash();
+    std::vector<std::pair<std::vector<uint8_t>, CKVEntry> > updates;
+
+    GetKVIndexEntries(tx, updates);
+    if (updates.empty())
+        return;
+    std::vector<std::vector<uint8_t> > inserted;
+    for (std::vector<std::pair<std::vector<uint8_t>, CKVEntry> >::iterator it = updates.begin(); it != updates.end(); it++) {
+        mapKV[it->first] = make_pair(txhash, it->second);
+        inserted.push_back(it->first);
+    }
+
+    mapKVInserted.insert(make_pair(txhash, inserted));
+}
+
+bool CTxMemPool::getKVIndex(const std::vector<uint8_t> &key, CKVEntry &value)
+{
+    LOCK(cs);
+    kvIndexMap::iterator it = mapKV.find(key);
+    if (it == mapKV.end())
+        return false;
+    value = it->second.second;
+    return true;
+}
+
+bool CTxMemPool::removeKVIndex(const uint256 txhash)
+{
+    LOCK(cs);
+    kvIndexInserted::iterator it = mapKVInserted.find(txhash);
+
+    if (it != mapKVInserted.end()) {
+        std::vector<std::vector<uint8_t> > keys = (*it).second;
+        for (std::vector<std::vector<uint8_t> >::iterator mit = keys.begin(); mit != keys.end(); mit++) {
+            // a later transaction may have replaced the update meanwhile
+            kvIndexMap::iterator kit = mapKV.find(*mit);
+            if (kit != mapKV.end() && kit->second.first == txhash)
+                mapKV.erase(kit);
+        }
+        mapKVInserted.erase(it);
+    }
+
+    return true;
+}
+
 void CTxMemPool::addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view)
 {
     LOCK(cs);
@@ -386,8 +487,12 @@ void CTxMemPool::remove(const CTransaction &origTx, std::list<CTransaction>& rem
             nTransactionsUpdated++;
             minerPolicyEstimator->removeTx(hash);
             removeAddressIndex(hash);
+            removeEvalIndex(hash);
+            removeKVIndex(hash);
             removeSpentIndex(hash);
         }
+        MetricsGauge("eskenas.mempool.size.transactions", mapTx.size());
+        MetricsGauge("eskenas.mempool.size.bytes", totalTxSize);
     }
 }
 
@@ -594,6 +699,8 @@ void CTxMemPool::clear()
     totalTxSize = 0;
     cachedInnerUsage = 0;
     ++nTransactionsUpdated;
+    MetricsGauge("eskenas.mempool.size.transactions", mapTx.size());
+    MetricsGauge("eskenas.mempool.size.bytes", totalTxSize);
 }
 
 void CTxMemPool::check(const CCoinsViewCache *pcoins) const
@@ -875,9 +982,11 @@ void CTxMemPool::NotifyRecentlyAdded()
         }
     }
 
-    // Update the notified sequence number. We only need this in regtest mode,
-    // and should not lock on cs after calling SyncWithWallets otherwise.
+    // Update the notified sequence number once the wallets have processed the
+    // transactions. We only need this in regtest mode, and should not lock on
+    // cs after calling SyncWithWallets otherwise.
     if (Params().NetworkIDString() == "regtest") {
+        SyncWithValidationInterfaceQueue();
         LOCK(cs);
         nNotifiedSequence = recentlyAddedSequence;
     }
@@ -22,8 +22,11 @@
 #define BITCOIN_TXMEMPOOL_H
 
 #include <list>
+#include <set>
 
 #include "addressindex.h"
+#include "evalindex.h"
+#include "kvindex.h"
 #include "spentindex.h"
 #include "amount.h"
 #include "coins.h"
@@ -181,6 +184,19 @@ private:
     typedef std::map<uint256, std::vector<CMempoolAddressDeltaKey> > addressDeltaMapInserted;
     addressDeltaMapInserted mapAddressInserted;
 
+    typedef std::set<CEvalIndexKey, CEvalIndexKeyCompare> evalIndexSet;
+    evalIndexSet setEval;
+
+    typedef std::map<uint256, std::vector<CEvalIndexKey> > evalIndexInserted;
+    evalIndexInserted mapEvalInserted;
+
+    //! Unconfirmed kv updates by key, the most recent mempool transaction wins
+    typedef std::map<std::vector<uint8_t>, std::pair<uint256, CKVEntry> > kvIndexMap;
+    kvIndexMap mapKV;
+
+    typedef std::map<uint256, std::vector<std::vector<uint8_t> > > kvIndexInserted;
+    kvIndexInserted mapKVInserted;
+
     typedef std::map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyCompare> mapSpentIndex;
     mapSpentIndex mapSpent;
 
@@ -209,6 +225,14 @@ public:
                          std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results);
     bool removeAddressIndex(const uint256 txhash);
 
+    void addEvalIndex(const CTxMemPoolEntry &entry);
+    bool getEvalIndex(uint8_t evalcode, uint8_t funcid, uint256 reftxid, std::vector<CEvalIndexKey> &results);
+    bool removeEvalIndex(const uint256 txhash);
+
+    void addKVIndex(const CTxMemPoolEntry &entry);
+    bool getKVIndex(const std::vector<uint8_t> &key, CKVEntry &value);
+    bool removeKVIndex(const uint256 txhash);
+
     void addSpentIndex(const CTxMemPoolEntry &entry, const CCoinsViewCache &view);
     bool getSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
     bool removeSpentIndex(const uint256 txhash);
@@ -5,6 +5,18 @@
 
 #include "validationinterface.h"
 
+#include "primitives/block.h"
+#include "scheduler.h"
+#include "util.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include <boost/bind.hpp>
+
 static CMainSignals g_signals;
 
 CMainSignals& GetMainSignals()
@@ -12,13 +24,230 @@ CMainSignals& GetMainSignals()
     return g_signals;
 }
 
+namespace {
+
+/**
+ * Notifications for one listener, delivered one at a time in the order they
+ * were raised. Every listener has its own queue so that a slow one, like a
+ * large wallet, does not hold back the others.
+ */
+class CNotificationQueue : public std::enable_shared_from_this<CNotificationQueue>
+{
+private:
+    std::mutex cs;
+    std::condition_variable cond;
+    std::deque<std::function<void ()>> queue;
+    //! Notifications added and delivered (or dropped) so far
+    uint64_t nAdded = 0;
+    uint64_t nDone = 0;
+    //! A task processing the queue is pending on the scheduler
+    bool fScheduled = false;
+    //! A notification is being delivered
+    bool fRunning = false;
+    //! The listener was unregistered, notifications raised meanwhile are dropped
+    bool fClosed = false;
+
+    void Schedule(CScheduler* scheduler)
+    {
+        scheduler->schedule(std::bind(&CNotificationQueue::Process, shared_from_this(), scheduler),
+                            boost::chrono::system_clock::now());
+    }
+
+    void Process(CScheduler* scheduler)
+    {
+        std::function<void ()> func;
+        {
+            std::lock_guard<std::mutex> lock(cs);
+            if (queue.empty()) {
+                fScheduled = false;
+                return;
+            }
+            func.swap(queue.front());
+            queue.pop_front();
+            fRunning = true;
+        }
+        try {
+            func();
+        } catch (const boost::thread_interrupted&) {
+            std::lock_guard<std::mutex> lock(cs);
+            fRunning = false;
+            nDone++;
+            cond.notify_all();
+            throw;
+        } catch (const std::exception& e) {
+            PrintExceptionContinue(&e, "CNotificationQueue::Process()");
+        } catch (...) {
+            PrintExceptionContinue(NULL, "CNotificationQueue::Process()");
+        }
+
+        std::lock_guard<std::mutex> lock(cs);
+        fRunning = false;
+        nDone++;
+        cond.notify_all();
+        // One notification per task, so that the other listeners get their turn
+        if (queue.empty())
+            fScheduled = false;
+        else
+            Schedule(scheduler);
+    }
+
+public:
+    void Add(std::function<void ()> func, CScheduler* scheduler)
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        if (fClosed)
+            return;
+        queue.push_back(std::move(func));
+        nAdded++;
+        if (!fScheduled) {
+            fScheduled = true;
+            Schedule(scheduler);
+        }
+    }
+
+    /** Wait until the notifications added so far have been delivered */
+    void Wait()
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        uint64_t nTarget = nAdded;
+        cond.wait(lock, [this, nTarget]() { return nDone >= nTarget; });
+    }
+
+    /** Number of notifications added and not delivered yet */
+    uint64_t Pending()
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        return nAdded - nDone;
+    }
+
+    /**
+     * Drop the pending notifications. When the listener is unregistered
+     * (fClose) wait for the one being delivered as well.
+     */
+    void Clear(bool fClose)
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        nDone += queue.size();
+        queue.clear();
+        cond.notify_all();
+        if (fClose) {
+            fClosed = true;
+            cond.wait(lock, [this]() { return !fRunning; });
+        }
+    }
+};
+
+typedef std::pair<CValidationInterface*, std::shared_ptr<CNotificationQueue>> CSubscriber;
+
+//! Protects vSubscribers and g_scheduler
+std::mutex cs_subscribers;
+std::vector<CSubscriber> vSubscribers;
+CScheduler* g_scheduler = NULL;
+
+void QueueForAll(const std::function<void (CValidationInterface*)>& func)
+{
+    CScheduler* scheduler;
+    std::vector<CSubscriber> subscribers;
+    {
+        std::lock_guard<std::mutex> lock(cs_subscribers);
+        scheduler = g_scheduler;
+        subscribers = vSubscribers;
+    }
+    for (const CSubscriber& subscriber : subscribers) {
+        if (scheduler)
+            subscriber.second->Add(std::bind(func, subscriber.first), scheduler);
+        else
+            func(subscriber.first);
+    }
+}
+
+}
+
+void CMainSignals::UpdatedBlockTip(const CBlockIndex *pindex) {
+    QueueForAll([pindex](CValidationInterface* pinterface) {
+        pinterface->UpdatedBlockTip(pindex);
+    });
+}
+
+void CMainSignals::SyncTransaction(const std::shared_ptr<const CTransaction> &ptx, const std::shared_ptr<const CBlock> &pblock, const int nHeight) {
+    QueueForAll([ptx, pblock, nHeight](CValidationInterface* pinterface) {
+        pinterface->SyncTransaction(*ptx, pblock.get(), nHeight);
+    });
+}
+
+void CMainSignals::SyncBlockTransactions(const std::shared_ptr<const CBlock> &pblock, const int nHeight) {
+    QueueForAll([pblock, nHeight](CValidationInterface* pinterface) {
+        for (const CTransaction& tx : pblock->vtx)
+            pinterface->SyncTransaction(tx, pblock.get(), nHeight);
+    });
+}
+
+void CMainSignals::EraseTransaction(const uint256 &hash) {
+    QueueForAll([hash](CValidationInterface* pinterface) {
+        pinterface->EraseFromWallet(hash);
+    });
+}
+
+void CMainSignals::UpdatedTransaction(const uint256 &hash) {
+    QueueForAll([hash](CValidationInterface* pinterface) {
+        pinterface->UpdatedTransaction(hash);
+    });
+}
+
+void CMainSignals::ChainTip(const CBlockIndex *pindex, const std::shared_ptr<const CBlock> &pblock, const std::shared_ptr<const SproutMerkleTree> &sproutTree, const std::shared_ptr<const SaplingMerkleTree> &saplingTree, bool added) {
+    QueueForAll([pindex, pblock, sproutTree, saplingTree, added](CValidationInterface* pinterface) {
+        pinterface->ChainTip(pindex, pblock.get(), *sproutTree, *saplingTree, added);
+    });
+}
+
+void RegisterBackgroundSignalScheduler(CScheduler& scheduler) {
+    std::lock_guard<std::mutex> lock(cs_subscribers);
+    g_scheduler = &scheduler;
+}
+
+void UnregisterBackgroundSignalScheduler() {
+    std::vector<CSubscriber> subscribers;
+    {
+        std::lock_guard<std::mutex> lock(cs_subscribers);
+        g_scheduler = NULL;
+        subscribers = vSubscribers;
+    }
+    for (const CSubscriber& subscriber : subscribers)
+        subscriber.second->Clear(false);
+}
+
+void SyncWithValidationInterfaceQueue() {
+    std::vector<CSubscriber> subscribers;
+    {
+        std::lock_guard<std::mutex> lock(cs_subscribers);
+        if (!g_scheduler)
+            return;
+        subscribers = vSubscribers;
+    }
+    for (const CSubscriber& subscriber : subscribers)
+        subscriber.second->Wait();
+}
+
+size_t GetValidationInterfaceQueueSize() {
+    std::vector<CSubscriber> subscribers;
+    {
+        std::lock_guard<std::mutex> lock(cs_subscribers);
+        if (!g_scheduler)
+            return 0;
+        subscribers = vSubscribers;
+    }
+    uint64_t nPending = 0;
+    for (const CSubscriber& subscriber : subscribers)
+        nPending = std::max(nPending, subscriber.second->Pending());
+    return nPending;
+}
+
 void RegisterValidationInterface(CValidationInterface* pwalletIn) {
-    g_signals.UpdatedBlockTip.connect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1));
-    g_signals.SyncTransaction.connect(boost::bind(&CValidationInterface::SyncTransaction, pwalletIn, _1, _2, _3));
-    g_signals.EraseTransaction.connect(boost::bind(&CValidationInterface::EraseFromWallet, pwalletIn, _1));
-    g_signals.UpdatedTransaction.connect(boost::bind(&CValidationInterface::UpdatedTransaction, pwalletIn, _1));
+    {
+        std::lock_guard<std::mutex> lock(cs_subscribers);
+        vSubscribers.emplace_back(pwalletIn, std::make_shared<CNotificationQueue>());
+    }
     g_signals.RescanWallet.connect(boost::bind(&CValidationInterface::RescanWallet, pwalletIn));
-    g_signals.ChainTip.connect(boost::bind(&CValidationInterface::ChainTip, pwalletIn, _1, _2, _3, _4, _5));
     g_signals.Inventory.connect(boost::bind(&CValidationInterface::Inventory, pwalletIn, _1));
     g_signals.Broadcast.connect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1));
     g_signals.BlockChecked.connect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
@@ -28,28 +257,45 @@ void UnregisterValidationInterface(CValidationInterface* pwalletIn) {
     g_signals.BlockChecked.disconnect(boost::bind(&CValidationInterface::BlockChecked, pwalletIn, _1, _2));
     g_signals.Broadcast.disconnect(boost::bind(&CValidationInterface::ResendWalletTransactions, pwalletIn, _1));
     g_signals.Inventory.disconnect(boost::bind(&CValidationInterface::Inventory, pwalletIn, _1));
-    g_signals.ChainTip.disconnect(boost::bind(&CValidationInterface::ChainTip, pwalletIn, _1, _2, _3, _4, _5));
-    g_signals.UpdatedTransaction.disconnect(boost::bind(&CValidationInterface::UpdatedTransaction, pwalletIn, _1));
-    g_signals.EraseTransaction.disconnect(boost::bind(&CValidationInterface::EraseFromWallet, pwalletIn, _1));
-    g_signals.SyncTransaction.disconnect(boost::bind(&CValidationInterface::SyncTransaction, pwalletIn, _1, _2, _3));
     g_signals.RescanWallet.disconnect(boost::bind(&CValidationInterface::RescanWallet, pwalletIn));
-    g_signals.UpdatedBlockTip.disconnect(boost::bind(&CValidationInterface::UpdatedBlockTip, pwalletIn, _1));
+    std::shared_ptr<CNotificationQueue> queue;
+    {
+        std::lock_guard<std::mutex> lock(cs_subscribers);
+        for (auto it = vSubscribers.begin(); it != vSubscribers.end(); ++it) {
+            if (it->first == pwalletIn) {
+                queue = it->second;
+                vSubscribers.erase(it);
+                break;
+            }
+        }
+    }
+    // The listener may be deleted once this returns
+    if (queue)
+        queue->Clear(true);
 }
 
 void UnregisterAllValidationInterfaces() {
     g_signals.BlockChecked.disconnect_all_slots();
     g_signals.Broadcast.disconnect_all_slots();
     g_signals.Inventory.disconnect_all_slots();
-    g_signals.ChainTip.disconnect_all_slots();
-    g_signals.UpdatedTransaction.disconnect_all_slots();
-    g_signals.EraseTransaction.disconnect_all_slots();
-    g_signals.SyncTransaction.disconnect_all_slots();
     g_signals.RescanWallet.disconnect_all_slots();
-    g_signals.UpdatedBlockTip.disconnect_all_slots();
+    std::vector<CSubscriber> subscribers;
+    {
+        std::lock_guard<std::mutex> lock(cs_subscribers);
+        subscribers.swap(vSubscribers);
+    }
+    for (const CSubscriber& subscriber : subscribers)
+        subscriber.second->Clear(true);
 }
 
 void SyncWithWallets(const CTransaction &tx, const CBlock *pblock, const int nHeight) {
-    g_signals.SyncTransaction(tx, pblock, nHeight);
+    g_signals.SyncTransaction(std::make_shared<const CTransaction>(tx),
+                              pblock ? std::make_shared<const CBlock>(*pblock) : std::shared_ptr<const CBlock>(),
+                              nHeight);
+}
+
+void SyncBlockWithWallets(const std::shared_ptr<const CBlock> &pblock, const int nHeight) {
+    g_signals.SyncBlockTransactions(pblock, nHeight);
 }
 
 void EraseFromWallets(const uint256 &hash) {
@@ -58,4 +304,4 @@ void EraseFromWallets(const uint256 &hash) {
 
 void RescanWallets() {
     g_signals.RescanWallet();
-}
\ No newline at end of file
+}
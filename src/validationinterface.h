@@ -8,11 +8,14 @@
 
 #include <boost/signals2/signal.hpp>
 
+#include <memory>
+
 #include "zcash/IncrementalMerkleTree.hpp"
 
 class CBlock;
 class CBlockIndex;
 struct CBlockLocator;
+class CScheduler;
 class CTransaction;
 class CValidationInterface;
 class CValidationState;
@@ -22,24 +25,43 @@ class uint256;
 
 /** Register a wallet to receive updates from core */
 void RegisterValidationInterface(CValidationInterface* pwalletIn);
-/** Unregister a wallet from core */
+/** Unregister a wallet from core, waits for a notification it is running */
 void UnregisterValidationInterface(CValidationInterface* pwalletIn);
 /** Unregister all wallets from core */
 void UnregisterAllValidationInterfaces();
 /** Push an updated transaction to all registered wallets */
 void SyncWithWallets(const CTransaction& tx, const CBlock* pblock, const int nHeight);
+/** Push the transactions of a connected block to all registered wallets */
+void SyncBlockWithWallets(const std::shared_ptr<const CBlock>& pblock, const int nHeight);
 /** Erase a transaction from all registered wallets */
 void EraseFromWallets(const uint256 &hash);
 /** Rescan all registered wallets */
 void RescanWallets();
 
+/**
+ * Deliver the queued notifications on the scheduler thread. Until this is
+ * called, and after UnregisterBackgroundSignalScheduler(), they are delivered
+ * by the thread raising them.
+ */
+void RegisterBackgroundSignalScheduler(CScheduler& scheduler);
+/** Stop delivering queued notifications, dropping the pending ones */
+void UnregisterBackgroundSignalScheduler();
+/**
+ * Wait until the notifications raised so far have been delivered, for callers
+ * that need the wallets to have caught up with the chain. Must not be called
+ * with cs_main held, nor from a notification.
+ */
+void SyncWithValidationInterfaceQueue();
+/** Number of notifications the listener furthest behind has yet to be delivered */
+size_t GetValidationInterfaceQueueSize();
+
 class CValidationInterface {
 protected:
     virtual void UpdatedBlockTip(const CBlockIndex *pindex) {}
     virtual void SyncTransaction(const CTransaction &tx, const CBlock *pblock, const int nHeight) {}
     virtual bool EraseFromWallet(const uint256 &hash) { return true; }
     virtual void RescanWallet() {}
-    virtual void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, SproutMerkleTree sproutTree, SaplingMerkleTree saplingTree, bool added) {}
+    virtual void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, const SproutMerkleTree &sproutTree, const SaplingMerkleTree &saplingTree, bool added) {}
     virtual void UpdatedTransaction(const uint256 &hash) {}
     virtual void Inventory(const uint256 &hash) {}
     virtual void ResendWalletTransactions(int64_t nBestBlockTime) {}
@@ -47,21 +69,31 @@ protected:
     friend void ::RegisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
+    friend struct CMainSignals;
 };
 
+/**
+ * UpdatedBlockTip, SyncTransaction, EraseTransaction, UpdatedTransaction and
+ * ChainTip are queued for each listener and delivered in order, off the
+ * thread raising them and so outside of cs_main. Blocks, transactions and
+ * trees are shared by all the queued notifications rather than copied.
+ * The other signals are delivered synchronously.
+ */
 struct CMainSignals {
     /** Notifies listeners of updated block chain tip */
-    boost::signals2::signal<void (const CBlockIndex *)> UpdatedBlockTip;
+    void UpdatedBlockTip(const CBlockIndex *pindex);
     /** Notifies listeners of updated transaction data (transaction, and optionally the block it is found in. */
-    boost::signals2::signal<void (const CTransaction &, const CBlock *, const int nHeight)> SyncTransaction;
-    /** Notifies listeners of an erased transaction (currently disabled, requires transaction replacement). */
-    boost::signals2::signal<void (const uint256 &)> EraseTransaction;
-    /** Notifies listeners of the need to rescan the wallet. */
-    boost::signals2::signal<void ()> RescanWallet;
+    void SyncTransaction(const std::shared_ptr<const CTransaction> &ptx, const std::shared_ptr<const CBlock> &pblock, const int nHeight);
+    /** Notifies listeners of the transactions of a connected block, as SyncTransaction for each of them */
+    void SyncBlockTransactions(const std::shared_ptr<const CBlock> &pblock, const int nHeight);
+    /** Notifies listeners of an erased transaction. */
+    void EraseTransaction(const uint256 &hash);
     /** Notifies listeners of an updated transaction without new data (for now: a coinbase potentially becoming visible). */
-    boost::signals2::signal<void (const uint256 &)> UpdatedTransaction;
+    void UpdatedTransaction(const uint256 &hash);
     /** Notifies listeners of a change to the tip of the active block chain. */
-    boost::signals2::signal<void (const CBlockIndex *, const CBlock *, SproutMerkleTree, SaplingMerkleTree, bool)> ChainTip;
+    void ChainTip(const CBlockIndex *pindex, const std::shared_ptr<const CBlock> &pblock, const std::shared_ptr<const SproutMerkleTree> &sproutTree, const std::shared_ptr<const SaplingMerkleTree> &saplingTree, bool added);
+    /** Notifies listeners of the need to rescan the wallet. */
+    boost::signals2::signal<void ()> RescanWallet;
     /** Notifies listeners about an inventory item being seen on the network. */
     boost::signals2::signal<void (const uint256 &)> Inventory;
     /** Tells listeners to broadcast their data. */
@@ -120,6 +120,8 @@ bool AsyncRPCOperation_saplingconsolidation::main_impl() {
     std::vector<std::string> consolidationTxIds;
     CAmount amountConsolidated = 0;
     CCoinsViewCache coinsView(pcoinsTip);
+    std::vector<TransactionBuilder> builders;
+    std::vector<CAmount> vAmountSent;
     bool consolidationComplete = true;
 
     for (std::map<libzcash::SaplingPaymentAddress, std::vector<SaplingNoteEntry>>::iterator it = mapAddresses.begin(); it != mapAddresses.end(); it++) {
@@ -217,19 +219,26 @@ bool AsyncRPCOperation_saplingconsolidation::main_impl() {
             builder.SetFee(fee);
             builder.AddSaplingOutput(extsk.expsk.ovk, addr, amountToSend - fee);
 
-            auto tx = builder.Build().GetTxOrThrow();
+            builders.push_back(builder);
+            vAmountSent.push_back(amountToSend - fee);
+        }
+    }
 
-            if (isCancelled()) {
-                LogPrint("zrpcunsafe", "%s: Canceled. Stopping.\n", getId());
-                break;
-            }
+    // The transactions are independent of each other, so prove them concurrently
+    std::vector<TransactionBuilderResult> results = BuildTransactions(builders, GetArg("-saplingbuildthreads", DEFAULT_SAPLING_BUILD_THREADS),
+                                                                      [this]() { return isCancelled(); });
+    for (size_t i = 0; i < results.size(); i++) {
+        if (isCancelled()) {
+            LogPrint("zrpcunsafe", "%s: Canceled. Stopping.\n", getId());
+            break;
+        }
 
-            pwalletMain->CommitAutomatedTx(tx);
-            LogPrint("zrpcunsafe", "%s: Committed consolidation transaction with txid=%s\n", getId(), tx.GetHash().ToString());
-            amountConsolidated += amountToSend - fee;
-            consolidationTxIds.push_back(tx.GetHash().ToString());
+        auto tx = results[i].GetTxOrThrow();
 
-        }
+        pwalletMain->CommitAutomatedTx(tx);
+        LogPrint("zrpcunsafe", "%s: Committed consolidation transaction with txid=%s\n", getId(), tx.GetHash().ToString());
+        amountConsolidated += vAmountSent[i];
+        consolidationTxIds.push_back(tx.GetHash().ToString());
     }
 
     if (consolidationComplete) {
@@ -132,6 +132,8 @@ bool AsyncRPCOperation_sweeptoaddress::main_impl() {
     std::vector<std::string> sweepTxIds;
     CAmount amountSwept = 0;
     CCoinsViewCache coinsView(pcoinsTip);
+    std::vector<TransactionBuilder> builders;
+    std::vector<CAmount> vAmountSent;
     bool sweepComplete = true;
 
     for (std::map<libzcash::SaplingPaymentAddress, std::vector<SaplingNoteEntry>>::iterator it = mapAddresses.begin(); it != mapAddresses.end(); it++) {
@@ -226,19 +228,26 @@ bool AsyncRPCOperation_sweeptoaddress::main_impl() {
             builder.SetFee(fee);
             builder.AddSaplingOutput(extsk.expsk.ovk, sweepAddress, amountToSend - fee);
 
-            auto tx = builder.Build().GetTxOrThrow();
+            builders.push_back(builder);
+            vAmountSent.push_back(amountToSend - fee);
+        }
+    }
 
-            if (isCancelled()) {
-                LogPrint("zrpcunsafe", "%s: Canceled. Stopping.\n", getId());
-                break;
-            }
+    // The transactions are independent of each other, so prove them concurrently
+    std::vector<TransactionBuilderResult> results = BuildTransactions(builders, GetArg("-saplingbuildthreads", DEFAULT_SAPLING_BUILD_THREADS),
+                                                                      [this]() { return isCancelled(); });
+    for (size_t i = 0; i < results.size(); i++) {
+        if (isCancelled()) {
+            LogPrint("zrpcunsafe", "%s: Canceled. Stopping.\n", getId());
+            break;
+        }
 
-            pwalletMain->CommitAutomatedTx(tx);
-            LogPrint("zrpcunsafe", "%s: Committed sweep transaction with txid=%s\n", getId(), tx.GetHash().ToString());
-            amountSwept += amountToSend - fee;
-            sweepTxIds.push_back(tx.GetHash().ToString());
+        auto tx = results[i].GetTxOrThrow();
 
-        }
+        pwalletMain->CommitAutomatedTx(tx);
+        LogPrint("zrpcunsafe", "%s: Committed sweep transaction with txid=%s\n", getId(), tx.GetHash().ToString());
+        amountSwept += vAmountSent[i];
+        sweepTxIds.push_back(tx.GetHash().ToString());
     }
 
     if (sweepComplete) {
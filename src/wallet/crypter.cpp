@@ -565,17 +565,22 @@ bool CCryptoKeyStore::DecryptSerializedSecret(
      const uint256 chash,
      CKeyingMaterial &vchSecret)
 {
-    LOCK(cs_KeyStore);
-    if (!IsCrypted()) {
-        return false;
-    }
+    // Decrypt with a copy of the master key so that concurrent callers, such
+    // as the LoadWallet workers, don't serialize on cs_KeyStore
+    CKeyingMaterial vMasterKeyCopy;
+    {
+        LOCK(cs_KeyStore);
+        if (!IsCrypted()) {
+            return false;
+        }
 
-    if (IsLocked()) {
-        return false;
+        if (IsLocked()) {
+            return false;
+        }
+        vMasterKeyCopy = vMasterKey;
     }
 
-    return DecryptSecret(vMasterKey, vchCryptedSecret, chash, vchSecret);
-
+    return DecryptSecret(vMasterKeyCopy, vchCryptedSecret, chash, vchSecret);
 }
 
 bool CCryptoKeyStore::AddCryptedSaplingSpendingKey(
@@ -11,6 +11,7 @@
 #include "utilmoneystr.h"
 
 #include "komodo_defs.h"
+#include "memusage.h"
 
 #include <utf8.h>
 
@@ -498,6 +499,68 @@ void getRpcArcTxSaplingKeys(const CWalletTx &tx, int txHeight, RpcArcTransaction
     }
 }
 
+typedef std::pair<uint256, bool> ArcTxCacheKey;
+typedef std::list<std::pair<ArcTxCacheKey, ArcTxCacheEntry> > ArcTxCacheList;
+
+/** Memory bound of the archived transaction cache, least recently used entries are evicted first */
+static const size_t MAX_ARCTX_CACHE_USAGE = 32 << 20;
+//Most recently used entries first, guarded by cs_wallet
+static ArcTxCacheList listArcTxCache;
+static std::map<ArcTxCacheKey, ArcTxCacheList::iterator> mapArcTxCache;
+static size_t nArcTxCacheUsage = 0;
+
+static size_t StringUsage(const std::string& str)
+{
+    //Short strings are stored inline
+    return str.capacity() > 15 ? memusage::MallocUsage(str.capacity() + 1) : 0;
+}
+
+static size_t StringUsage(const std::set<std::string>& strs)
+{
+    size_t nUsage = memusage::DynamicUsage(strs);
+    for (const std::string& str : strs)
+        nUsage += StringUsage(str);
+    return nUsage;
+}
+
+static size_t StringUsage(const TransactionSpendT& t) { return StringUsage(t.encodedAddress) + StringUsage(t.encodedScriptPubKey) + StringUsage(t.spendTxid); }
+static size_t StringUsage(const TransactionSendT& t) { return StringUsage(t.encodedAddress) + StringUsage(t.encodedScriptPubKey); }
+static size_t StringUsage(const TransactionReceivedT& t) { return StringUsage(t.encodedAddress) + StringUsage(t.encodedScriptPubKey); }
+static size_t StringUsage(const TransactionSpendZC& t) { return StringUsage(t.encodedAddress) + StringUsage(t.spendTxid); }
+static size_t StringUsage(const TransactionReceivedZC& t) { return StringUsage(t.encodedAddress) + StringUsage(t.memo) + StringUsage(t.memoStr); }
+static size_t StringUsage(const TransactionSpendZS& t) { return StringUsage(t.encodedAddress) + StringUsage(t.spendTxid); }
+static size_t StringUsage(const TransactionSendZS& t) { return StringUsage(t.encodedAddress) + StringUsage(t.memo) + StringUsage(t.memoStr); }
+static size_t StringUsage(const TransactionReceivedZS& t) { return StringUsage(t.encodedAddress) + StringUsage(t.memo) + StringUsage(t.memoStr); }
+
+template<typename T>
+static size_t StringUsage(const std::vector<T>& v)
+{
+    size_t nUsage = memusage::DynamicUsage(v);
+    for (const T& t : v)
+        nUsage += StringUsage(t);
+    return nUsage;
+}
+
+static size_t ArcTxCacheEntryUsage(const ArcTxCacheEntry& entry)
+{
+    const RpcArcTransaction& arcTx = entry.arcTx;
+    return memusage::MallocUsage(sizeof(ArcTxCacheList::value_type) + 2 * sizeof(void*)) +
+        memusage::MallocUsage(sizeof(std::pair<const ArcTxCacheKey, ArcTxCacheList::iterator>) + 4 * sizeof(void*)) +
+        memusage::DynamicUsage(entry.ivks) + memusage::DynamicUsage(entry.ovks) +
+        memusage::DynamicUsage(arcTx.ivks) + memusage::DynamicUsage(arcTx.ovks) +
+        StringUsage(arcTx.category) + StringUsage(arcTx.spentFrom) + StringUsage(arcTx.addresses) +
+        StringUsage(arcTx.vTSpend) + StringUsage(arcTx.vZcSpend) + StringUsage(arcTx.vZsSpend) +
+        StringUsage(arcTx.vTSend) + StringUsage(arcTx.vZsSend) +
+        StringUsage(arcTx.vTReceived) + StringUsage(arcTx.vZcReceived) + StringUsage(arcTx.vZsReceived);
+}
+
+static void EraseArcTxCacheEntry(std::map<ArcTxCacheKey, ArcTxCacheList::iterator>::iterator mi)
+{
+    nArcTxCacheUsage -= mi->second->second.nUsage;
+    listArcTxCache.erase(mi->second);
+    mapArcTxCache.erase(mi);
+}
+
 void getRpcArcTx(uint256 &txid, RpcArcTransaction &arcTx, bool fIncludeWatchonly, bool rescan) {
 
     AssertLockHeld(cs_main);
@@ -521,6 +584,7 @@ void getRpcArcTx(uint256 &txid, RpcArcTransaction &arcTx, bool fIncludeWatchonly
     ArchiveTxPoint arcTxPt;
     std::set<uint256> ivks;
     std::set<uint256> ovks;
+    uint64_t nKeyGeneration = pwalletMain->nKeyGeneration;
 
     //try to find the transaction to pull the hashblock
     std::map<uint256, ArchiveTxPoint>::iterator it = pwalletMain->mapArcTxs.find(txid);
@@ -549,6 +613,21 @@ void getRpcArcTx(uint256 &txid, RpcArcTransaction &arcTx, bool fIncludeWatchonly
             return;
         }
 
+        //Reuse the previous decryption of this transaction if nothing it depends on has changed
+        std::map<ArcTxCacheKey, ArcTxCacheList::iterator>::iterator ci = mapArcTxCache.find(std::make_pair(txid, fIncludeWatchonly));
+        if (ci != mapArcTxCache.end()) {
+            const ArcTxCacheEntry& entry = ci->second->second;
+            if (!rescan && entry.IsCurrent(nKeyGeneration, hashBlock, nIndex, ivks, ovks)) {
+                listArcTxCache.splice(listArcTxCache.begin(), listArcTxCache, ci->second);
+                arcTx = entry.arcTx;
+                int nHeight = chainActive.Tip()->GetHeight();
+                arcTx.rawconfirmations = nHeight - arcTx.blockHeight + 1;
+                arcTx.confirmations = komodo_dpowconfs(arcTx.blockHeight, arcTx.rawconfirmations);
+                return;
+            }
+            EraseArcTxCacheEntry(ci);
+        }
+
         //Get Tx from block
         CBlock block;
         ReadBlockFromDisk(block, pindex, 1);
@@ -643,6 +722,26 @@ void getRpcArcTx(uint256 &txid, RpcArcTransaction &arcTx, bool fIncludeWatchonly
         arcTx.addresses.insert(arcTx.vZsReceived[i].encodedAddress);
     }
 
+    ArcTxCacheKey key = std::make_pair(txid, fIncludeWatchonly);
+    std::map<ArcTxCacheKey, ArcTxCacheList::iterator>::iterator ci = mapArcTxCache.find(key);
+    if (ci != mapArcTxCache.end())
+        EraseArcTxCacheEntry(ci);
+
+    listArcTxCache.push_front(std::make_pair(key, ArcTxCacheEntry()));
+    ArcTxCacheEntry& entry = listArcTxCache.front().second;
+    entry.nKeyGeneration = nKeyGeneration;
+    entry.hashBlock = hashBlock;
+    entry.nIndex = nIndex;
+    entry.ivks = ivks;
+    entry.ovks = ovks;
+    entry.arcTx = arcTx;
+    entry.nUsage = ArcTxCacheEntryUsage(entry);
+    mapArcTxCache[key] = listArcTxCache.begin();
+    nArcTxCacheUsage += entry.nUsage;
+
+    //Evict the least recently used entries, always keeping the one just added
+    while (nArcTxCacheUsage > MAX_ARCTX_CACHE_USAGE && listArcTxCache.size() > 1)
+        EraseArcTxCacheEntry(mapArcTxCache.find(listArcTxCache.back().first));
 }
 
 void getRpcArcTx(CWalletTx &tx, RpcArcTransaction &arcTx, bool fIncludeWatchonly, bool rescan) {
@@ -947,12 +1046,38 @@ void getRpcArcTxJSONReceives(RpcArcTransaction &arcTx, UniValue& ArcTxJSON, bool
     }
 }
 
+std::pair<int,int> ParseTxCursor(const std::string& strCursor, const TxPositionMap& sortedArchive)
+{
+    if (strCursor.size() == 64 && IsHex(strCursor)) {
+        uint256 txid = uint256S(strCursor);
+        for (TxPositionMap::const_iterator it = sortedArchive.begin(); it != sortedArchive.end(); ++it)
+            if (it->second == txid)
+                return it->first;
+        throw runtime_error("Cursor transaction not found in the wallet.");
+    }
+
+    size_t nSep = strCursor.find(':');
+    int nHeight, nIndex;
+    if (nSep == std::string::npos ||
+        !ParseInt32(strCursor.substr(0, nSep), &nHeight) ||
+        !ParseInt32(strCursor.substr(nSep + 1), &nIndex))
+        throw runtime_error("Cursor must be of the form \"height:index\" or a txid.");
+    return make_pair(nHeight, nIndex);
+}
+
+TxPositionMap::reverse_iterator TxPageStart(TxPositionMap& sortedArchive, const std::string& strCursor)
+{
+    if (strCursor.empty())
+        return sortedArchive.rbegin();
+    return TxPositionMap::reverse_iterator(sortedArchive.lower_bound(ParseTxCursor(strCursor, sortedArchive)));
+}
+
 UniValue zs_listtransactions(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
   if (!EnsureWalletIsAvailable(fHelp))
       return NullUniValue;
 
-  if (fHelp || params.size() > 5 || params.size() == 2)
+  if (fHelp || params.size() > 6 || params.size() == 2)
       throw runtime_error(
         "zs_listtransactions\n"
         "\nReturns an array of decrypted Eskenas transactions.\n"
@@ -979,12 +1104,17 @@ UniValue zs_listtransactions(const UniValue& params, bool fHelp, const CPubKey&
         "\n"
         "5. \"Include Watch Only\"   (bool, optional, Default = false) \n"
         "\n"
+        "6. \"Cursor:\"                (string, optional, default=\"\") \n"
+        "                               Only return transactions older than this cursor. Pass the \"cursor\" of the oldest\n"
+        "                               transaction of the previous call, or its txid, to page through the wallet history.\n"
+        "\n"
         "Default Parameters:\n"
         "1. 0 - O confimations required\n"
         "2. 0 - Returns all transactions\n"
         "3. 0 - Ignored\n"
         "4. 100000 - Return the last 100,000 transactions.\n"
         "5. false - exclude watch only\n"
+        "6. \"\" - Start from the newest transaction\n"
         "\n"
         "\nResult:\n"
         "[{\n                                     An Array of Transactions\n"
@@ -998,6 +1128,7 @@ UniValue zs_listtransactions(const UniValue& params, bool fHelp, const CPubKey&
         "   \"confirmations\": n,                 (numeric) The number of confirmations for the transaction\n"
         "   \"time\": xxx,                        (numeric) The transaction time in seconds of the transaction\n"
         "   \"size\": xxx,                        (numeric) The transaction size\n"
+        "   \"cursor\": \"height:index\",        (string)  Position of the transaction, for use as the Cursor argument\n"
         "   \"spends\": {                       A list of the spends used as inputs in the transaction\n"
         "      \"type\": \"address type\",          (string)  transparent, sprout, sapling\n"
         "      \"spend\": n,                      (numeric) spend index\n"
@@ -1065,12 +1196,12 @@ UniValue zs_listtransactions(const UniValue& params, bool fHelp, const CPubKey&
       nFilter = params[2].get_int64();
     }
 
-    if (params.size() == 4) {
+    if (params.size() >= 4) {
       nCount = params[3].get_int64();
     }
 
     bool fIncludeWatchonly = false;
-    if (params.size() == 5) {
+    if (params.size() >= 5) {
         fIncludeWatchonly = params[4].get_bool();
     }
 
@@ -1083,6 +1214,10 @@ UniValue zs_listtransactions(const UniValue& params, bool fHelp, const CPubKey&
     if (nFilter < 0)
         throw runtime_error("Filter must be equal or greater than 0.");
 
+    std::string strCursor;
+    if (params.size() >= 6)
+        strCursor = params[5].get_str();
+
     //get Sorted Archived Transactions
     std::map<std::pair<int,int>, uint256> sortedArchive;
     for (map<uint256, ArchiveTxPoint>::iterator it = pwalletMain->mapArcTxs.begin(); it != pwalletMain->mapArcTxs.end(); ++it)
@@ -1120,8 +1255,9 @@ UniValue zs_listtransactions(const UniValue& params, bool fHelp, const CPubKey&
 
     uint64_t t = GetTime();
     int chainHeight = chainActive.Tip()->GetHeight();
-    //Reverse Iterate thru transactions
-    for (map<std::pair<int,int>, uint256>::reverse_iterator it = sortedArchive.rbegin(); it != sortedArchive.rend(); ++it)
+    //Reverse Iterate thru transactions, starting just below the cursor if one was given
+    map<std::pair<int,int>, uint256>::reverse_iterator itStart = TxPageStart(sortedArchive, strCursor);
+    for (map<std::pair<int,int>, uint256>::reverse_iterator it = itStart; it != sortedArchive.rend(); ++it)
     {
         uint256 txid = (*it).second;
         RpcArcTransaction arcTx;
@@ -1186,6 +1322,7 @@ UniValue zs_listtransactions(const UniValue& params, bool fHelp, const CPubKey&
 
         UniValue txObj(UniValue::VOBJ);
         getRpcArcTxJSONHeader(arcTx, txObj);
+        txObj.push_back(Pair("cursor", strprintf("%d:%d", (*it).first.first, (*it).first.second)));
 
         UniValue spends(UniValue::VARR);
         getRpcArcTxJSONSpends(arcTx, spends);
@@ -1329,7 +1466,7 @@ UniValue zs_listspentbyaddress(const UniValue& params, bool fHelp, const CPubKey
   if (!EnsureWalletIsAvailable(fHelp))
       return NullUniValue;
 
-  if (fHelp || params.size() > 5 || params.size() == 3 || params.size() < 1)
+  if (fHelp || params.size() > 6 || params.size() == 3 || params.size() < 1)
       throw runtime_error(
         "zs_listspentbyaddress\n"
         "\nReturns decrypted Eskenas spent inputs for a single address.\n"
@@ -1356,6 +1493,10 @@ UniValue zs_listspentbyaddress(const UniValue& params, bool fHelp, const CPubKey
         "5. \"Count:\"                 (numeric, optional, default=100000) \n"
         "                               Last n number of transactions returned\n"
         "\n"
+        "6. \"Cursor:\"                (string, optional, default=\"\") \n"
+        "                               Only return transactions older than this cursor. Pass the \"cursor\" of the oldest\n"
+        "                               transaction of the previous call, or its txid, to page through the wallet history.\n"
+        "\n"
         "Default Parameters:\n"
         "1. Eskenas Address\n"
         "2. 0 - O confimations required\n"
@@ -1375,6 +1516,7 @@ UniValue zs_listspentbyaddress(const UniValue& params, bool fHelp, const CPubKey
         "   \"time\": xxx,                        (numeric) The transaction time in seconds of the transaction\n"
         "   \"expiryHeight\": n,                  (numeric) The expiry height of the transaction\n"
         "   \"size\": xxx,                        (numeric) The transaction size\n"
+        "   \"cursor\": \"height:index\",        (string)  Position of the transaction, for use as the Cursor argument\n"
         "   \"fee\": n,                           (numeric) Transaction fee in Zatoshis\n"
         "   \"spends\": {                       A list of the spends used as inputs in the transaction\n"
         "      \"type\": \"address type\",          (string)  transparent, sprout, sapling\n"
@@ -1411,7 +1553,7 @@ UniValue zs_listspentbyaddress(const UniValue& params, bool fHelp, const CPubKey
       nFilter = params[3].get_int64();
     }
 
-    if (params.size() == 5) {
+    if (params.size() >= 5) {
       nCount = params[4].get_int64();
     }
 
@@ -1426,6 +1568,10 @@ UniValue zs_listspentbyaddress(const UniValue& params, bool fHelp, const CPubKey
     if (nFilter < 0)
         throw runtime_error("Filter must be equal or greater than 0.");
 
+    std::string strCursor;
+    if (params.size() >= 6)
+        strCursor = params[5].get_str();
+
     //Check address
     bool isTAddress = false;
     bool isZsAddress = false;
@@ -1514,8 +1660,9 @@ UniValue zs_listspentbyaddress(const UniValue& params, bool fHelp, const CPubKey
 
     uint64_t t = GetTime();
     int chainHeight = chainActive.Tip()->GetHeight();
-    //Reverse Iterate thru transactions
-    for (map<std::pair<int,int>, uint256>::reverse_iterator it = sortedArchive.rbegin(); it != sortedArchive.rend(); ++it)
+    //Reverse Iterate thru transactions, starting just below the cursor if one was given
+    map<std::pair<int,int>, uint256>::reverse_iterator itStart = TxPageStart(sortedArchive, strCursor);
+    for (map<std::pair<int,int>, uint256>::reverse_iterator it = itStart; it != sortedArchive.rend(); ++it)
     {
         uint256 txid = (*it).second;
         RpcArcTransaction arcTx;
@@ -1581,6 +1728,7 @@ UniValue zs_listspentbyaddress(const UniValue& params, bool fHelp, const CPubKey
         bool containsAddress = false;
         UniValue txObj(UniValue::VOBJ);
         getRpcArcTxJSONHeader(arcTx, txObj);
+        txObj.push_back(Pair("cursor", strprintf("%d:%d", (*it).first.first, (*it).first.second)));
         UniValue spends(UniValue::VARR);
         if (isTAddress) {
             for (int i = 0; i < arcTx.vTSpend.size(); i++) {
@@ -1622,7 +1770,7 @@ UniValue zs_listreceivedbyaddress(const UniValue& params, bool fHelp, const CPub
   if (!EnsureWalletIsAvailable(fHelp))
       return NullUniValue;
 
-  if (fHelp || params.size() > 5 || params.size() == 3 || params.size() < 1)
+  if (fHelp || params.size() > 6 || params.size() == 3 || params.size() < 1)
       throw runtime_error(
         "zs_listreceivedbyaddress\n"
         "\nReturns decrypted Eskenas received outputs for a single address.\n"
@@ -1649,6 +1797,10 @@ UniValue zs_listreceivedbyaddress(const UniValue& params, bool fHelp, const CPub
         "5. \"Count:\"                 (numeric, optional, default=100000) \n"
         "                               Last n number of transactions returned\n"
         "\n"
+        "6. \"Cursor:\"                (string, optional, default=\"\") \n"
+        "                               Only return transactions older than this cursor. Pass the \"cursor\" of the oldest\n"
+        "                               transaction of the previous call, or its txid, to page through the wallet history.\n"
+        "\n"
         "Default Parameters:\n"
         "2. 0 - O confimations required\n"
         "3. 0 - Returns all transactions\n"
@@ -1667,6 +1819,7 @@ UniValue zs_listreceivedbyaddress(const UniValue& params, bool fHelp, const CPub
         "   \"time\": xxx,                        (numeric) The transaction time in seconds of the transaction\n"
         "   \"expiryHeight\": n,                  (numeric) The expiry height of the transaction\n"
         "   \"size\": xxx,                        (numeric) The transaction size\n"
+        "   \"cursor\": \"height:index\",        (string)  Position of the transaction, for use as the Cursor argument\n"
         "   \"fee\": n,                           (numeric) Transaction fee in Zatoshis\n"
         "   \"recieved\": {                     A list of receives from the transaction\n"
         "      \"type\": \"address type\",          (string)  transparent, sprout, sapling\n"
@@ -1705,7 +1858,7 @@ UniValue zs_listreceivedbyaddress(const UniValue& params, bool fHelp, const CPub
       nFilter = params[3].get_int64();
     }
 
-    if (params.size() == 5) {
+    if (params.size() >= 5) {
       nCount = params[4].get_int64();
     }
 
@@ -1720,6 +1873,10 @@ UniValue zs_listreceivedbyaddress(const UniValue& params, bool fHelp, const CPub
     if (nFilter < 0)
         throw runtime_error("Filter must be equal or greater than 0.");
 
+    std::string strCursor;
+    if (params.size() >= 6)
+        strCursor = params[5].get_str();
+
     //Check address
     bool isTAddress = false;
     bool isZsAddress = false;
@@ -1807,8 +1964,9 @@ UniValue zs_listreceivedbyaddress(const UniValue& params, bool fHelp, const CPub
 
     uint64_t t = GetTime();
     int chainHeight = chainActive.Tip()->GetHeight();
-    //Reverse Iterate thru transactions
-    for (map<std::pair<int,int>, uint256>::reverse_iterator it = sortedArchive.rbegin(); it != sortedArchive.rend(); ++it)
+    //Reverse Iterate thru transactions, starting just below the cursor if one was given
+    map<std::pair<int,int>, uint256>::reverse_iterator itStart = TxPageStart(sortedArchive, strCursor);
+    for (map<std::pair<int,int>, uint256>::reverse_iterator it = itStart; it != sortedArchive.rend(); ++it)
     {
         uint256 txid = (*it).second;
         RpcArcTransaction arcTx;
@@ -1874,6 +2032,7 @@ UniValue zs_listreceivedbyaddress(const UniValue& params, bool fHelp, const CPub
         bool containsAddress = false;
         UniValue txObj(UniValue::VOBJ);
         getRpcArcTxJSONHeader(arcTx, txObj);
+        txObj.push_back(Pair("cursor", strprintf("%d:%d", (*it).first.first, (*it).first.second)));
         UniValue received(UniValue::VARR);
         if (isTAddress) {
             for (int i = 0; i < arcTx.vTReceived.size(); i++) {
@@ -1915,7 +2074,7 @@ UniValue zs_listsentbyaddress(const UniValue& params, bool fHelp, const CPubKey&
   if (!EnsureWalletIsAvailable(fHelp))
       return NullUniValue;
 
-  if (fHelp || params.size() > 5 || params.size() == 3 || params.size() < 1)
+  if (fHelp || params.size() > 6 || params.size() == 3 || params.size() < 1)
       throw runtime_error(
         "zs_listsentbyaddress\n"
         "\nReturns decrypted Eskenas outputs sent to a single address.\n"
@@ -1942,6 +2101,10 @@ UniValue zs_listsentbyaddress(const UniValue& params, bool fHelp, const CPubKey&
         "5. \"Count:\"                 (numeric, optional, default=100000) \n"
         "                               Last n number of transactions returned\n"
         "\n"
+        "6. \"Cursor:\"                (string, optional, default=\"\") \n"
+        "                               Only return transactions older than this cursor. Pass the \"cursor\" of the oldest\n"
+        "                               transaction of the previous call, or its txid, to page through the wallet history.\n"
+        "\n"
         "Default Parameters:\n"
         "2. 0 - O confimations required\n"
         "3. 0 - Returns all transactions\n"
@@ -1960,6 +2123,7 @@ UniValue zs_listsentbyaddress(const UniValue& params, bool fHelp, const CPubKey&
         "   \"time\": xxx,                        (numeric) The transaction time in seconds of the transaction\n"
         "   \"expiryHeight\": n,                  (numeric) The expiry height of the transaction\n"
         "   \"size\": xxx,                        (numeric) The transaction size\n"
+        "   \"cursor\": \"height:index\",        (string)  Position of the transaction, for use as the Cursor argument\n"
         "   \"fee\": n,                           (numeric) Transaction fee in Zatoshis\n"
         "   \"sent\": {                        A list of outputs of where funds were sent to in the transaction,\n"
         "      \"type\": \"address type\",          (string)  transparent, sprout, sapling\n"
@@ -1997,7 +2161,7 @@ UniValue zs_listsentbyaddress(const UniValue& params, bool fHelp, const CPubKey&
       nFilter = params[3].get_int64();
     }
 
-    if (params.size() == 5) {
+    if (params.size() >= 5) {
       nCount = params[4].get_int64();
     }
 
@@ -2012,6 +2176,10 @@ UniValue zs_listsentbyaddress(const UniValue& params, bool fHelp, const CPubKey&
     if (nFilter < 0)
         throw runtime_error("Filter must be equal or greater than 0.");
 
+    std::string strCursor;
+    if (params.size() >= 6)
+        strCursor = params[5].get_str();
+
 
 
     //Check address
@@ -2102,8 +2270,9 @@ UniValue zs_listsentbyaddress(const UniValue& params, bool fHelp, const CPubKey&
 
     uint64_t t = GetTime();
     int chainHeight = chainActive.Tip()->GetHeight();
-    //Reverse Iterate thru transactions
-    for (map<std::pair<int,int>, uint256>::reverse_iterator it = sortedArchive.rbegin(); it != sortedArchive.rend(); ++it)
+    //Reverse Iterate thru transactions, starting just below the cursor if one was given
+    map<std::pair<int,int>, uint256>::reverse_iterator itStart = TxPageStart(sortedArchive, strCursor);
+    for (map<std::pair<int,int>, uint256>::reverse_iterator it = itStart; it != sortedArchive.rend(); ++it)
     {
         uint256 txid = (*it).second;
         RpcArcTransaction arcTx;
@@ -2171,6 +2340,7 @@ UniValue zs_listsentbyaddress(const UniValue& params, bool fHelp, const CPubKey&
             bool containsAddress = false;
             UniValue txObj(UniValue::VOBJ);
             getRpcArcTxJSONHeader(arcTx, txObj);
+            txObj.push_back(Pair("cursor", strprintf("%d:%d", (*it).first.first, (*it).first.second)));
             UniValue sends(UniValue::VARR);
             if (isTAddress) {
                 for (int i = 0; i < arcTx.vTSend.size(); i++) {
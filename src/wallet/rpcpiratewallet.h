@@ -155,6 +155,43 @@ public:
 
 void getRpcArcTransactions(RpcArcTransactions &arcTxs);
 
+/**
+ * Decoded archived transactions, keyed by txid and the watch-only flag.
+ * Archived transactions are immutable, so an entry stays valid as long as the
+ * transaction is still in the same active-chain block, was decrypted with the
+ * same viewing keys, and no keys have been added to the wallet since.
+ * Only the confirmation counts depend on the tip and are refreshed on use.
+ */
+class ArcTxCacheEntry
+{
+public:
+    uint64_t nKeyGeneration;
+    uint256 hashBlock;
+    int nIndex;
+    std::set<uint256> ivks;
+    std::set<uint256> ovks;
+    RpcArcTransaction arcTx;
+    size_t nUsage;
+
+    bool IsCurrent(uint64_t nKeyGenerationIn, const uint256& hashBlockIn, int nIndexIn,
+                   const std::set<uint256>& ivksIn, const std::set<uint256>& ovksIn) const
+    {
+        return nKeyGeneration == nKeyGenerationIn && hashBlock == hashBlockIn && nIndex == nIndexIn &&
+            ivks == ivksIn && ovks == ovksIn;
+    }
+};
+
+/** Wallet transactions by block height and index, unconfirmed ones after the tip, in the order the zs_list* calls page through them */
+typedef std::map<std::pair<int,int>, uint256> TxPositionMap;
+
+/**
+ * Parses a zs_list* cursor, either the "height:index" returned in the "cursor"
+ * field of the results or the txid of a listed transaction.
+ */
+std::pair<int,int> ParseTxCursor(const std::string& strCursor, const TxPositionMap& sortedArchive);
+/** Where a page starts, just below the cursor, or at the newest transaction without one */
+TxPositionMap::reverse_iterator TxPageStart(TxPositionMap& sortedArchive, const std::string& strCursor);
+
 template<typename RpcTx>
 void getTransparentSends(RpcTx &tx, vector<TransactionSendT> &vSend, CAmount &transparentValue);
 
@@ -62,6 +62,7 @@
 #include <numeric>
 
 #include "komodo_defs.h"
+#include "komodo_interest.h"
 #include "hex.h"
 #include <string.h>
 #include <regex>
@@ -604,7 +605,7 @@ UniValue kvupdate(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
     static uint256 zeroes;
     CWalletTx wtx; UniValue ret(UniValue::VOBJ);
-    uint8_t keyvalue[IGUANA_MAXSCRIPTSIZE*8],opretbuf[IGUANA_MAXSCRIPTSIZE*8]; int32_t i,coresize,haveprivkey,duration,opretlen,height; uint16_t keylen=0,valuesize=0,refvaluesize=0; uint8_t *key,*value=0; uint32_t flags,tmpflags,n; struct komodo_kv *ptr; uint64_t fee; uint256 privkey,pubkey,refpubkey,sig;
+    uint8_t keyvalue[IGUANA_MAXSCRIPTSIZE*8],opretbuf[IGUANA_MAXSCRIPTSIZE*8]; int32_t i,coresize,haveprivkey,duration,opretlen,height; uint16_t keylen=0,valuesize=0,refvaluesize=0; uint8_t *key,*value=0; uint32_t flags,tmpflags,n; uint64_t fee; uint256 privkey,pubkey,refpubkey,sig;
     if (fHelp || params.size() < 3 )
         throw runtime_error(
             "kvupdate key \"value\" days passphrase\n"
@@ -3006,25 +3007,17 @@ uint64_t komodo_interestsum()
 #ifdef ENABLE_WALLET
     if ( ASSETCHAINS_SYMBOL[0] == 0 && GetBoolArg("-disablewallet", false) == 0 && KOMODO_NSPV_FULLNODE )
     {
-        uint64_t interest,sum = 0; int32_t txheight; uint32_t locktime;
-        vector<COutput> vecOutputs;
+        uint64_t sum = 0; CBlockIndex *tipindex;
         assert(pwalletMain != NULL);
-        LOCK2(cs_main, pwalletMain->cs_wallet);
-        pwalletMain->AvailableCoins(vecOutputs, false, NULL, true);
-        BOOST_FOREACH(const COutput& out,vecOutputs)
+        pwalletMain->utxoSet.Sync();
+        if ( (tipindex= chainActive.LastTip()) != 0 )
         {
-            CAmount nValue = out.tx->vout[out.i].nValue;
-            if ( out.tx->nLockTime != 0 && out.fSpendable != 0 )
-            {
-                BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
-                CBlockIndex *tipindex,*pindex = it->second;
-                if ( pindex != 0 && (tipindex= chainActive.LastTip()) != 0 )
-                {
-                    interest = komodo_accrued_interest(&txheight,&locktime,out.tx->GetHash(),out.i,0,nValue,(int32_t)tipindex->GetHeight());
-                    //interest = komodo_interest(pindex->GetHeight(),nValue,out.tx->nLockTime,tipindex->nTime);
-                    sum += interest;
-                }
-            }
+            uint32_t tiptime = (uint32_t)tipindex->nTime;
+            pwalletMain->utxoSet.ForEach([&](const CWalletUtxo &utxo) {
+                // only these can accrue interest, see komodo_interest
+                if ( utxo.nLockTime >= LOCKTIME_THRESHOLD && utxo.nValue >= 10*COIN && utxo.nHeight < KOMODO_ENDOFERA )
+                    sum += komodo_interest(utxo.nHeight,utxo.nValue,utxo.nLockTime,tiptime);
+            });
         }
         KOMODO_INTERESTSUM = sum;
         KOMODO_WALLETBALANCE = pwalletMain->GetBalance();
@@ -3323,6 +3316,9 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp, const CPubKey& mypk)
             "Runs a benchmark of the selected type samplecount times,\n"
             "returning the running times of each sample.\n"
             "\n"
+            "The arguments after samplecount are JSON values, string ones like the\n"
+            "loadwallet passphrase are quoted on the command line: '\"passphrase\"'.\n"
+            "\n"
             "Output: [\n"
             "  {\n"
             "    \"runningtime\": runningtime\n"
@@ -3400,6 +3396,20 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp, const CPubKey& mypk)
                 throw JSONRPCError(RPC_TYPE_ERROR, "Benchmark must be run in regtest mode");
             }
             sample_times.push_back(benchmark_connectblock_slow());
+        } else if (benchmarktype == "gettransaction") {
+            // Number of recent blocks to replay, and whether to use the transaction cache
+            int nBlocks = 100;
+            bool fCache = true;
+            if (params.size() >= 3) {
+                nBlocks = params[2].get_int();
+            }
+            if (params.size() >= 4) {
+                fCache = params[3].get_bool();
+            }
+            if (nBlocks <= 0) {
+                throw JSONRPCError(RPC_TYPE_ERROR, "Invalid number of blocks");
+            }
+            sample_times.push_back(benchmark_gettransaction(nBlocks, fCache));
         } else if (benchmarktype == "sendtoaddress") {
             if (Params().NetworkIDString() != "regtest") {
                 throw JSONRPCError(RPC_TYPE_ERROR, "Benchmark must be run in regtest mode");
@@ -3410,17 +3420,105 @@ UniValue zc_benchmark(const UniValue& params, bool fHelp, const CPubKey& mypk)
             if (Params().NetworkIDString() != "regtest") {
                 throw JSONRPCError(RPC_TYPE_ERROR, "Benchmark must be run in regtest mode");
             }
-            sample_times.push_back(benchmark_loadwallet());
+            // Encrypted wallets need their passphrase to be opened
+            SecureString strWalletPassphrase;
+            if (params.size() >= 3) {
+                strWalletPassphrase = params[2].get_str().c_str();
+            }
+            sample_times.push_back(benchmark_loadwallet(strWalletPassphrase));
         } else if (benchmarktype == "listunspent") {
             sample_times.push_back(benchmark_listunspent());
         } else if (benchmarktype == "createsaplingspend") {
             sample_times.push_back(benchmark_create_sapling_spend());
         } else if (benchmarktype == "createsaplingoutput") {
             sample_times.push_back(benchmark_create_sapling_output());
+        } else if (benchmarktype == "createsaplingtx") {
+            // Shape of the simulated transactions, by default one consolidation-sized 50x50,
+            // and the threads building them. Threads beyond the number of transactions prove
+            // the spends and outputs of each one in parallel, so 1 thread against 0 (one per
+            // core) compares proving a single transaction serially and in parallel.
+            int nSpends = 50;
+            int nOutputs = 50;
+            int nTxs = 1;
+            int nThreads = DEFAULT_SAPLING_BUILD_THREADS;
+            if (params.size() >= 3) {
+                nSpends = params[2].get_int();
+            }
+            if (params.size() >= 4) {
+                nOutputs = params[3].get_int();
+            }
+            if (params.size() >= 5) {
+                nTxs = params[4].get_int();
+            }
+            if (params.size() >= 6) {
+                nThreads = params[5].get_int();
+            }
+            if (nSpends <= 0 || nOutputs <= 0 || nTxs <= 0 || nThreads < 0) {
+                throw JSONRPCError(RPC_TYPE_ERROR, "Invalid transaction shape");
+            }
+            sample_times.push_back(benchmark_create_sapling_transactions(nSpends, nOutputs, nTxs, nThreads));
         } else if (benchmarktype == "verifysaplingspend") {
             sample_times.push_back(benchmark_verify_sapling_spend());
         } else if (benchmarktype == "verifysaplingoutput") {
             sample_times.push_back(benchmark_verify_sapling_output());
+        } else if (benchmarktype == "merkleroot") {
+            // Number of leaves (transactions) in the simulated block
+            int nLeaves = 10000;
+            if (params.size() >= 3) {
+                nLeaves = params[2].get_int();
+            }
+            if (nLeaves <= 0) {
+                throw JSONRPCError(RPC_TYPE_ERROR, "Invalid number of leaves");
+            }
+            sample_times.push_back(benchmark_merkle_root(nLeaves));
+        } else if (benchmarktype == "blockhashes") {
+            // Number of recent blocks to replay, and whether header hashes are memoized
+            int nBlocks = 100;
+            bool fMemoize = true;
+            if (params.size() >= 3) {
+                nBlocks = params[2].get_int();
+            }
+            if (params.size() >= 4) {
+                fMemoize = params[3].get_bool();
+            }
+            if (nBlocks <= 0) {
+                throw JSONRPCError(RPC_TYPE_ERROR, "Invalid number of blocks");
+            }
+            sample_times.push_back(benchmark_block_hashes(nBlocks, fMemoize));
+        } else if (benchmarktype == "checkqueue") {
+            // Number of verifying threads, the calling one included, and of verifications
+            int nThreads = 1;
+            int nChecks = 100000;
+            if (params.size() >= 3) {
+                nThreads = params[2].get_int();
+            }
+            if (params.size() >= 4) {
+                nChecks = params[3].get_int();
+            }
+            if (nThreads < 1 || nThreads > MAX_SCRIPTCHECK_THREADS) {
+                throw JSONRPCError(RPC_TYPE_ERROR, "Invalid number of threads");
+            }
+            if (nChecks <= 0) {
+                throw JSONRPCError(RPC_TYPE_ERROR, "Invalid number of checks");
+            }
+            sample_times.push_back(benchmark_checkqueue(nThreads, nChecks));
+        } else if (benchmarktype == "dbprofile") {
+            // Database profile, with any -dboptions of it applied, and number of records
+            std::string strProfile = "chainstate";
+            int nKeys = 100000;
+            if (params.size() >= 3) {
+                strProfile = params[2].get_str();
+            }
+            if (params.size() >= 4) {
+                nKeys = params[3].get_int();
+            }
+            if (strProfile != "blockindex" && strProfile != "chainstate" && strProfile != "notarisations") {
+                throw JSONRPCError(RPC_TYPE_ERROR, "Invalid database profile");
+            }
+            if (nKeys < 1) {
+                throw JSONRPCError(RPC_TYPE_ERROR, "Invalid number of records");
+            }
+            sample_times.push_back(benchmark_dbprofile(strProfile, nKeys));
         } else {
             throw JSONRPCError(RPC_TYPE_ERROR, "Invalid benchmarktype");
         }
@@ -8760,6 +8858,47 @@ UniValue tokenbalance(const UniValue& params, bool fHelp, const CPubKey& mypk)
     return(result);
 }
 
+bool getAddressFromIndex(const int &type, const uint160 &hash, std::string &address);
+
+UniValue tokenholders(const UniValue& params, bool fHelp, const CPubKey& mypk)
+{
+    UniValue result(UniValue::VOBJ), holders(UniValue::VOBJ); uint256 tokenid; int64_t total = 0;
+    std::vector<std::pair<CTokenUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    std::map<std::string, int64_t> balances;
+
+    if ( fHelp || params.size() != 1 )
+        throw runtime_error("tokenholders tokenid\n"
+                            "returns the confirmed token balance of every cc address holding tokenid, requires -tokenindex\n");
+    if ( ensure_CCrequirements(EVAL_TOKENS) < 0 )
+        throw runtime_error(CC_REQUIREMENTS_MSG);
+    if ( !fTokenIndex )
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Token index not enabled, restart with -tokenindex");
+
+    LOCK(cs_main);
+
+    tokenid = Parseuint256((char *)params[0].get_str().c_str());
+    if ( !GetTokenUnspent(tokenid, unspentOutputs) )
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read token index");
+
+    for (std::vector<std::pair<CTokenUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++)
+    {
+        std::string address;
+        if ( !getAddressFromIndex(it->first.type, it->first.hashBytes, address) )
+            continue;
+        balances[address] += it->second.satoshis;
+        total += it->second.satoshis;
+    }
+    for (std::map<std::string, int64_t>::const_iterator it=balances.begin(); it!=balances.end(); it++)
+        holders.push_back(Pair(it->first, it->second));
+
+    result.push_back(Pair("result", "success"));
+    result.push_back(Pair("tokenid", params[0].get_str()));
+    result.push_back(Pair("holders", holders));
+    result.push_back(Pair("utxos", (int64_t)unspentOutputs.size()));
+    result.push_back(Pair("total", total));
+    return(result);
+}
+
 UniValue tokencreate(const UniValue& params, bool fHelp, const CPubKey& mypk)
 {
     UniValue result(UniValue::VOBJ);
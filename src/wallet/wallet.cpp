@@ -32,6 +32,7 @@
 #include "net.h"
 #include "rpc/protocol.h"
 #include "rpc/server.h"
+#include "rust/metrics.h"
 #include "script/script.h"
 #include "script/sign.h"
 #include "timedata.h"
@@ -39,6 +40,7 @@
 #include "zcash/Note.hpp"
 #include "crypter.h"
 #include "coins.h"
+#include "crypto/sha256.h"
 #include "wallet/asyncrpcoperation_saplingconsolidation.h"
 #include "wallet/asyncrpcoperation_sweeptoaddress.h"
 #include "zcash/address/zip32.h"
@@ -380,6 +382,7 @@ bool CWallet::AddSaplingZKey(
     const libzcash::SaplingExtendedSpendingKey &extsk)
 {
     AssertLockHeld(cs_wallet); // mapSaplingZKeyMetadata
+    ++nKeyGeneration;
 
 
     if (IsCrypted() && IsLocked()) {
@@ -446,6 +449,7 @@ bool CWallet::AddSaplingIncomingViewingKey(
     const libzcash::SaplingPaymentAddress &addr)
 {
     AssertLockHeld(cs_wallet); // mapSaplingZKeyMetadata
+    ++nKeyGeneration;
 
     if (IsCrypted() && IsLocked()) {
         return false;
@@ -482,6 +486,7 @@ bool CWallet::AddSaplingIncomingViewingKey(
 bool CWallet::AddSaplingExtendedFullViewingKey(const libzcash::SaplingExtendedFullViewingKey &extfvk)
 {
     AssertLockHeld(cs_wallet);
+    ++nKeyGeneration;
 
     if (IsCrypted() && IsLocked()) {
         return false;
@@ -593,6 +598,7 @@ bool CWallet::AddLastDiversifierUsed(
 bool CWallet::AddSproutZKey(const libzcash::SproutSpendingKey &key)
 {
     AssertLockHeld(cs_wallet); // mapSproutZKeyMetadata
+    ++nKeyGeneration;
     auto addr = key.address();
 
     if (!CCryptoKeyStore::AddSproutSpendingKey(key))
@@ -642,6 +648,7 @@ CPubKey CWallet::GenerateNewKey()
 bool CWallet::AddKeyPubKey(const CKey& secret, const CPubKey &pubkey)
 {
     AssertLockHeld(cs_wallet); // mapKeyMetadata
+    ++nKeyGeneration;
 
     if (IsCrypted() && IsLocked()) {
         return false;
@@ -1003,6 +1010,7 @@ bool CWallet::LoadZKey(const libzcash::SproutSpendingKey &key)
 
 bool CWallet::AddSproutViewingKey(const libzcash::SproutViewingKey &vk)
 {
+    ++nKeyGeneration;
     if (!CCryptoKeyStore::AddSproutViewingKey(vk)) {
         return false;
     }
@@ -1016,6 +1024,7 @@ bool CWallet::AddSproutViewingKey(const libzcash::SproutViewingKey &vk)
 bool CWallet::RemoveSproutViewingKey(const libzcash::SproutViewingKey &vk)
 {
     AssertLockHeld(cs_wallet);
+    ++nKeyGeneration;
     if (!CCryptoKeyStore::RemoveSproutViewingKey(vk)) {
         return false;
     }
@@ -1035,6 +1044,7 @@ bool CWallet::LoadSproutViewingKey(const libzcash::SproutViewingKey &vk)
 
 bool CWallet::AddCScript(const CScript& redeemScript)
 {
+    ++nKeyGeneration;
     if (IsCrypted() && IsLocked()) {
         return false;
     }
@@ -1107,6 +1117,7 @@ bool CWallet::LoadCryptedCScript(const uint256 &chash, std::vector<unsigned char
 
 bool CWallet::AddWatchOnly(const CScript &dest)
 {
+    ++nKeyGeneration;
     if (IsCrypted() && IsLocked()) {
         return false;
     }
@@ -1145,6 +1156,7 @@ bool CWallet::AddWatchOnly(const CScript &dest)
 bool CWallet::RemoveWatchOnly(const CScript &dest)
 {
     AssertLockHeld(cs_wallet);
+    ++nKeyGeneration;
     if (!CCryptoKeyStore::RemoveWatchOnly(dest))
         return false;
     if (!HaveWatchOnly())
@@ -1279,14 +1291,167 @@ bool CWallet::ChangeWalletPassphrase(const SecureString& strOldWalletPassphrase,
     return false;
 }
 
+bool CWalletUtxoSet::MakeUtxo(const CTransaction& tx, int i, int nHeight, uint32_t nBlockTime, CWalletUtxo& utxo) const
+{
+    const CTxOut& out = tx.vout[i];
+    if (out.nValue <= 0 || (pwallet->IsMine(out) & ISMINE_SPENDABLE) == 0)
+        return false;
+    utxo.outpoint = COutPoint(tx.GetHash(), i);
+    utxo.nValue = out.nValue;
+    utxo.scriptPubKey = out.scriptPubKey;
+    utxo.nHeight = nHeight;
+    utxo.nBlockTime = nBlockTime;
+    utxo.nLockTime = tx.nLockTime;
+    CTxDestination address;
+    if (ExtractDestination(out.scriptPubKey, address)) {
+        std::string strAddress = CBitcoinAddress(address).ToString();
+        CSHA256().Write((const unsigned char*)strAddress.data(), strAddress.size()).Finalize(utxo.addrhash.begin());
+    }
+    return true;
+}
+
+void CWalletUtxoSet::Add(const CTransaction& tx, int i, int nHeight, uint32_t nBlockTime)
+{
+    CWalletUtxo utxo;
+    if (MakeUtxo(tx, i, nHeight, nBlockTime, utxo))
+        Insert(utxo);
+}
+
+void CWalletUtxoSet::Insert(const CWalletUtxo& utxo)
+{
+    if (mapUtxos.insert(std::make_pair(utxo.outpoint, utxo)).second)
+        setByTime.insert(std::make_pair(utxo.nBlockTime, utxo.outpoint));
+}
+
+void CWalletUtxoSet::AddCoinbase(const CTransaction& tx, int nHeight, uint32_t nBlockTime)
+{
+    // as CMerkleTx::GetBlocksToMaturity, spendable at the depth of COINBASE_MATURITY and from the unlock height on
+    int nMaturity = std::max(nHeight + COINBASE_MATURITY - 1, (int)tx.UnlockTime(0));
+    for (int i = 0; i < tx.vout.size(); i++) {
+        CWalletUtxo utxo;
+        if (MakeUtxo(tx, i, nHeight, nBlockTime, utxo))
+            mapPendingCoinbase.insert(std::make_pair(nMaturity, utxo));
+    }
+}
+
+void CWalletUtxoSet::Erase(const COutPoint& outpoint)
+{
+    std::map<COutPoint, CWalletUtxo>::iterator it = mapUtxos.find(outpoint);
+    if (it == mapUtxos.end())
+        return;
+    setByTime.erase(std::make_pair(it->second.nBlockTime, outpoint));
+    mapUtxos.erase(it);
+}
+
+void CWalletUtxoSet::SyncTransaction(const CTransaction& tx, const CBlock* pblock)
+{
+    // spent in the mempool, confirmed spends are handled in ChainTip
+    if (pblock || tx.IsCoinBase())
+        return;
+    LOCK(cs);
+    for (const CTxIn& txin : tx.vin)
+        Erase(txin.prevout);
+}
+
+void CWalletUtxoSet::ChainTip(const CBlockIndex* pindex, const CBlock* pblock, bool added)
+{
+    LOCK(cs);
+    if (!added) {
+        fDirty = true;
+        return;
+    }
+    for (const CTransaction& tx : pblock->vtx) {
+        if (tx.IsCoinBase()) {
+            AddCoinbase(tx, pindex->GetHeight(), pindex->nTime);
+            continue;
+        }
+        for (const CTxIn& txin : tx.vin)
+            Erase(txin.prevout);
+        for (int i = 0; i < tx.vout.size(); i++)
+            Add(tx, i, pindex->GetHeight(), pindex->nTime);
+    }
+    // the coinbases maturing with this block
+    while (!mapPendingCoinbase.empty() && mapPendingCoinbase.begin()->first <= pindex->GetHeight()) {
+        Insert(mapPendingCoinbase.begin()->second);
+        mapPendingCoinbase.erase(mapPendingCoinbase.begin());
+    }
+}
+
+bool CWalletUtxoSet::Sync(int nHeight)
+{
+    std::vector<COutput> vecOutputs;
+    int64_t nNow = GetTime();
+    {
+        LOCK(cs);
+        if (!fDirty && nNow <= nLastSync + 3600)
+            return true;
+    }
+    LOCK2(cs_main, pwallet->cs_wallet);
+    if (nHeight > 0 && (chainActive.Tip() == NULL || chainActive.Height() + 1 > nHeight))
+        return false;
+    pwallet->AvailableCoins(vecOutputs, false, NULL, true);
+    LOCK(cs);
+    mapUtxos.clear();
+    setByTime.clear();
+    mapPendingCoinbase.clear();
+    for (const COutput& out : vecOutputs) {
+        if (out.nDepth < 1 || !out.fSpendable)
+            continue;
+        BlockMap::iterator mi = mapBlockIndex.find(out.tx->hashBlock);
+        if (mi != mapBlockIndex.end() && mi->second != NULL)
+            Add(*out.tx, out.i, mi->second->GetHeight(), mi->second->nTime);
+    }
+    // AvailableCoins leaves out the immature coinbases, they are added as they mature
+    for (const std::pair<const uint256, CWalletTx>& item : pwallet->mapWallet) {
+        const CWalletTx& wtx = item.second;
+        if (!wtx.IsCoinBase() || wtx.GetDepthInMainChain() < 1 || wtx.GetBlocksToMaturity() == 0)
+            continue;
+        BlockMap::iterator mi = mapBlockIndex.find(wtx.hashBlock);
+        if (mi != mapBlockIndex.end() && mi->second != NULL)
+            AddCoinbase(wtx, mi->second->GetHeight(), mi->second->nTime);
+    }
+    fDirty = false;
+    nLastSync = nNow;
+    return true;
+}
+
+void CWalletUtxoSet::GetByBlockTime(std::vector<CWalletUtxo>& vUtxos, uint32_t nMaxBlockTime) const
+{
+    LOCK(cs);
+    for (std::set<std::pair<uint32_t, COutPoint> >::const_iterator it = setByTime.begin(); it != setByTime.end() && it->first <= nMaxBlockTime; it++)
+        vUtxos.push_back(mapUtxos.find(it->second)->second);
+}
+
+void CWalletUtxoSet::ForEach(const std::function<void(const CWalletUtxo&)>& func) const
+{
+    LOCK(cs);
+    for (std::map<COutPoint, CWalletUtxo>::const_iterator it = mapUtxos.begin(); it != mapUtxos.end(); it++)
+        func(it->second);
+}
+
 void CWallet::ChainTip(const CBlockIndex *pindex,
                        const CBlock *pblock,
-                       SproutMerkleTree sproutTree,
-                       SaplingMerkleTree saplingTree,
+                       const SproutMerkleTree &sproutTree,
+                       const SaplingMerkleTree &saplingTree,
                        bool added)
 {
     LOCK2(cs_main, cs_wallet);
 
+    utxoSet.ChainTip(pindex, pblock, added);
+
+    // Notifications are delivered after the fact, a block may have been
+    // disconnected again before its connection is seen here. Its disconnection
+    // is queued behind, and there are no witnesses to roll back for it.
+    if (added && !chainActive.Contains(pindex)) {
+        LogPrint("wallet", "%s: block %s left the active chain before it was processed\n", __func__, pindex->GetBlockHash().ToString());
+        setChainTipSkipped.insert(pindex);
+        return;
+    }
+    if (!added && setChainTipSkipped.erase(pindex)) {
+        UpdateNullifierNoteMapForBlock(pblock);
+        return;
+    }
+
     if (added) {
         // Prevent witness cache building && consolidation transactions
         // from being created when node is syncing after launch,
@@ -3308,16 +3473,29 @@ bool CWallet::AddToWalletIfInvolvingMe(const CTransaction& tx, const CBlock* pbl
 
 void CWallet::SyncTransaction(const CTransaction& tx, const CBlock* pblock, const int nHeight)
 {
-    LOCK(cs_wallet);
-    std::set<SaplingPaymentAddress> addressesFound;
-    if (!AddToWalletIfInvolvingMe(tx, pblock, nHeight, true, addressesFound, false))
-        return; // Not one of ours
+    utxoSet.SyncTransaction(tx, pblock);
 
-    for (std::set<SaplingPaymentAddress>::iterator it = addressesFound.begin(); it != addressesFound.end(); it++) {
-        SetZAddressBook(*it, "z-sapling", "", true);
-    }
+    auto sync = [&]() {
+        std::set<SaplingPaymentAddress> addressesFound;
+        if (!AddToWalletIfInvolvingMe(tx, pblock, nHeight, true, addressesFound, false))
+            return; // Not one of ours
+
+        for (std::set<SaplingPaymentAddress>::iterator it = addressesFound.begin(); it != addressesFound.end(); it++) {
+            SetZAddressBook(*it, "z-sapling", "", true);
+        }
+
+        MarkAffectedTransactionsDirty(tx);
+    };
 
-    MarkAffectedTransactionsDirty(tx);
+    // The transactions of a block are no longer delivered under cs_main, which
+    // adding them to the wallet relies on. Mempool ones never were.
+    if (pblock) {
+        LOCK2(cs_main, cs_wallet);
+        sync();
+    } else {
+        LOCK(cs_wallet);
+        sync();
+    }
 }
 
 void CWallet::MarkAffectedTransactionsDirty(const CTransaction& tx)
@@ -4996,6 +5174,8 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate, b
             {
                 scanperc = (int)((Checkpoints::GuessVerificationProgress(chainParams.Checkpoints(), pindex, false) - dProgressStart) / (dProgressTip - dProgressStart) * 100);
                 uiInterface.ShowProgress(_(("Rescanning - Currently on block " + std::to_string(pindex->GetHeight()) + "...").c_str()), std::max(1, std::min(99, scanperc)), false);
+                MetricsGauge("eskenas.wallet.rescan.progress", std::max(0, std::min(100, scanperc)) * 0.01);
+                MetricsGauge("eskenas.wallet.rescan.height", pindex->GetHeight());
             }
 
             bool blockInvolvesMe = false;
@@ -5037,6 +5217,7 @@ int CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool fUpdate, b
         }
 
         uiInterface.ShowProgress(_("Rescanning..."), 100, false); // hide progress dialog in GUI
+        MetricsGauge("eskenas.wallet.rescan.progress", 1.0);
 
         //Write all transactions ant block loacator to the wallet
         currentBlock = chainActive.GetLocator();
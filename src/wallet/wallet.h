@@ -43,6 +43,8 @@
 #include "base58.h"
 
 #include <algorithm>
+#include <atomic>
+#include <functional>
 #include <map>
 #include <set>
 #include <stdexcept>
@@ -121,6 +123,7 @@ class COutput;
 class CReserveKey;
 class CScript;
 class CTxMemPool;
+class CWallet;
 class CWalletTx;
 
 /** (client) version numbers for particular wallet features */
@@ -802,6 +805,60 @@ private:
 };
 
 
+/** A confirmed spendable transparent output of the wallet, see CWalletUtxoSet */
+struct CWalletUtxo
+{
+    COutPoint outpoint;
+    CAmount nValue;
+    CScript scriptPubKey;
+    int nHeight;
+    uint32_t nBlockTime;
+    uint32_t nLockTime;
+    //! sha256 of the address string, null if the script has no address, see komodo_stakehash
+    uint256 addrhash;
+};
+
+/**
+ * The confirmed spendable transparent outputs of a wallet, kept up to date from the wallet's own chain
+ * tip and transaction notifications, for the staking and KMD interest loops that used to rebuild them
+ * from AvailableCoins every round. Ordered by block time, so outputs that cannot have reached the
+ * minimum stake age are never visited. Coinbases of ours are held back until they mature. A full resync
+ * from AvailableCoins is only needed after a reorg, and once an hour to pick up changes like imported
+ * keys or spends that left the mempool.
+ */
+class CWalletUtxoSet
+{
+private:
+    CWallet* pwallet;
+    mutable CCriticalSection cs;
+    std::map<COutPoint, CWalletUtxo> mapUtxos;
+    std::set<std::pair<uint32_t, COutPoint> > setByTime;
+    //! Immature coinbase outputs by the height they can be spent from
+    std::multimap<int, CWalletUtxo> mapPendingCoinbase;
+    bool fDirty = true;
+    int64_t nLastSync = 0;
+
+    bool MakeUtxo(const CTransaction& tx, int i, int nHeight, uint32_t nBlockTime, CWalletUtxo& utxo) const;
+    void Add(const CTransaction& tx, int i, int nHeight, uint32_t nBlockTime);
+    void AddCoinbase(const CTransaction& tx, int nHeight, uint32_t nBlockTime);
+    void Insert(const CWalletUtxo& utxo);
+    void Erase(const COutPoint& outpoint);
+
+public:
+    CWalletUtxoSet(CWallet* pwalletIn) : pwallet(pwalletIn) {}
+
+    /** Called from the wallet's notifications, with cs_main and cs_wallet held for ChainTip */
+    void SyncTransaction(const CTransaction& tx, const CBlock* pblock);
+    void ChainTip(const CBlockIndex* pindex, const CBlock* pblock, bool added);
+
+    /** Rebuilds the set from AvailableCoins when needed, false if the tip moved past nHeight (0 = any) meanwhile */
+    bool Sync(int nHeight = 0);
+    /** Outputs with a block time up to nMaxBlockTime, oldest first */
+    void GetByBlockTime(std::vector<CWalletUtxo>& vUtxos, uint32_t nMaxBlockTime) const;
+    /** Calls func for every output, under the set's lock */
+    void ForEach(const std::function<void(const CWalletUtxo&)>& func) const;
+};
+
 /**
  * A CWallet is an extension of a keystore, which also maintains a set of transactions and balances,
  * and provides the ability to create new transactions.
@@ -827,6 +884,8 @@ private:
     int64_t nLastResend;
     int64_t nLastSetChain;
     int nSetChainUpdates;
+    //! Connected blocks ChainTip skipped as they had been disconnected again, see ChainTip
+    std::set<const CBlockIndex*> setChainTipSkipped;
     bool fBroadcastTransactions;
 
     template <class T>
@@ -862,6 +921,9 @@ private:
     void RemoveFromSpends(const uint256& wtxid);
 
 public:
+    //! Confirmed spendable transparent outputs, for staking and KMD interest
+    CWalletUtxoSet utxoSet{this};
+
     //Height for Lockmessage in GUI
     int chainHeight = 0;
     int walletHeight = 0;
@@ -893,6 +955,9 @@ public:
 
     std::map<std::string, std::set<uint256>> mapAddressTxids;
     std::map<uint256, ArchiveTxPoint> mapArcTxs;
+
+    //! Bumped whenever keys are added or removed, so cached decryption results can be discarded
+    std::atomic<uint64_t> nKeyGeneration{0};
     void LoadArcTxs(const uint256& wtxid, const ArchiveTxPoint& arcTxPt);
     void AddToArcTxs(const uint256& wtxid, ArchiveTxPoint& arcTxPt);
     void AddToArcTxs(const CWalletTx& wtx, int txHeight, ArchiveTxPoint& arcTxPt);
@@ -1591,7 +1656,7 @@ public:
     CAmount GetCredit(const CTransaction& tx, int32_t voutNum, const isminefilter& filter) const;
     CAmount GetCredit(const CTransaction& tx, const isminefilter& filter) const;
     CAmount GetChange(const CTransaction& tx) const;
-    void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, SproutMerkleTree sproutTree, SaplingMerkleTree saplingTree, bool added);
+    void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, const SproutMerkleTree &sproutTree, const SaplingMerkleTree &saplingTree, bool added);
     void RunSaplingSweep(int blockHeight);
     void RunSaplingConsolidation(int blockHeight);
     void CommitAutomatedTx(const CTransaction& tx);
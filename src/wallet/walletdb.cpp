@@ -38,9 +38,14 @@
 #include <boost/scoped_ptr.hpp>
 #include <boost/thread.hpp>
 
+#include <atomic>
+#include <thread>
+
 using namespace std;
 
 static uint64_t nAccountingEntryNumber = 0;
+/** Number of transaction records LoadWallet decodes in parallel at a time */
+static const size_t WALLET_LOAD_TX_BATCH_SIZE = 10000;
 static list<uint256> deadTxns;
 extern CBlockIndex *komodo_blockindex(uint256 hash);
 
@@ -783,6 +788,160 @@ public:
     }
 };
 
+/**
+ * A transaction record read from the wallet cursor. Decoding one only
+ * deserializes and decrypts it without touching wallet state, so
+ * LoadWallet decodes them on worker threads and loads the results
+ * afterwards in cursor order.
+ */
+class CWalletTxRecord {
+public:
+    string strType;
+    CDataStream ssKey;
+    CDataStream ssValue;
+    bool fDecoded;
+    string strErr;
+    uint256 hash;
+    CWalletTx wtx;
+    ArchiveTxPoint arcTxPt;
+
+    CWalletTxRecord(const string& strTypeIn, const CDataStream& ssKeyIn, const CDataStream& ssValueIn) :
+        strType(strTypeIn), ssKey(ssKeyIn), ssValue(ssValueIn), fDecoded(false) {}
+};
+
+static bool IsTxRecordType(const string& strType)
+{
+    return (strType == "tx" || strType == "ctx" ||          //ctx is encrypted tx
+            strType == "arctx" || strType == "carctx");     //carctx is encrypted arctx
+}
+
+static void DecodeTxRecord(CWallet* pwallet, CWalletTxRecord& rec)
+{
+    try {
+        if (rec.strType == "tx") {
+            rec.ssKey >> rec.hash;
+            rec.ssValue >> rec.wtx;
+        } else if (rec.strType == "arctx") {
+            rec.ssKey >> rec.hash;
+            rec.ssValue >> rec.arcTxPt;
+        } else {
+            uint256 chash;
+            rec.ssKey >> chash;
+            vector<unsigned char> vchCryptedSecret;
+            rec.ssValue >> vchCryptedSecret;
+
+            if (rec.strType == "ctx") {
+                if (!pwallet->DecryptWalletTransaction(chash, vchCryptedSecret, rec.hash, rec.wtx))
+                {
+                    rec.strErr = "Error reading wallet database: DecryptWalletTransaction failed";
+                    return;
+                }
+            } else {
+                if (!pwallet->DecryptWalletArchiveTransaction(chash, vchCryptedSecret, rec.hash, rec.arcTxPt))
+                {
+                    rec.strErr = "Error reading wallet database: DecryptWalletArchiveTransaction failed";
+                    return;
+                }
+            }
+        }
+        rec.fDecoded = true;
+    } catch (...) {}
+}
+
+static void DecodeTxRecords(CWallet* pwallet, vector<CWalletTxRecord>& vRecords)
+{
+    int nThreads = std::max(1, std::min(GetNumCores(), (int)vRecords.size()));
+    std::atomic<size_t> nNext(0);
+    auto worker = [&]() {
+        for (size_t i = nNext++; i < vRecords.size(); i = nNext++) {
+            DecodeTxRecord(pwallet, vRecords[i]);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < nThreads; i++) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+static bool LoadTxRecord(CWallet* pwallet, CWalletTxRecord& rec, CWalletScanState &wss, string& strErr)
+{
+    try {
+        if (rec.strType == "arctx" || rec.strType == "carctx")
+        {
+            //The ArchiveTxPoint structure was changed. An older version will fail
+            //to deserialize and not be added to the mapArcTx, triggering a full
+            //ZapWalletTxes and Rescan.
+            if (!rec.fDecoded)
+            {
+                strErr = rec.strErr;
+                return strErr.empty();
+            }
+
+            wss.nArcTx++;
+            pwallet->LoadArcTxs(rec.hash, rec.arcTxPt);
+            return true;
+        }
+
+        if (!rec.fDecoded)
+        {
+            strErr = rec.strErr;
+            return false;
+        }
+
+        uint256& hash = rec.hash;
+        CWalletTx& wtx = rec.wtx;
+        CDataStream& ssValue = rec.ssValue;
+
+        CValidationState state;
+        auto verifier = libzcash::ProofVerifier::Strict();
+        // ac_public chains set at height like KMD and ZEX, will force a rescan if we dont ignore this error: bad-txns-acpublic-chain
+        // there cannot be any ztx in the wallet on ac_public chains that started from block 1, so this wont affect those.
+        // PIRATE and ESKENAS fails this check for notary nodes, need exception. Triggers full rescan without it.
+        if ( !(CheckTransaction(0,wtx, state, verifier, 0, 0) && (wtx.GetHash() == hash) && state.IsValid()) && (state.GetRejectReason() != "bad-txns-acpublic-chain" && state.GetRejectReason() != "bad-txns-acprivacy-chain" && state.GetRejectReason() != "bad-txns-stakingtx") )
+        {
+            //fprintf(stderr, "tx failed: %s rejectreason.%s\n", wtx.GetHash().GetHex().c_str(), state.GetRejectReason().c_str());
+            // vin-empty on staking chains is error relating to a failed staking tx, that for some unknown reason did not fully erase. save them here to erase and re-add later on.
+            if ( ASSETCHAINS_STAKED != 0 && state.GetRejectReason() == "bad-txns-vin-empty" )
+                deadTxns.push_back(hash);
+            return false;
+        }
+        // Undo serialize changes in 31600
+        if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703)
+        {
+            if (!ssValue.empty())
+            {
+                char fTmp;
+                char fUnused;
+                ssValue >> fTmp >> fUnused >> wtx.strFromAccount;
+                strErr = strprintf("LoadWallet() upgrading tx ver=%d %d '%s' %s",
+                                   wtx.fTimeReceivedIsTxTime, fTmp, wtx.strFromAccount, hash.ToString());
+                wtx.fTimeReceivedIsTxTime = fTmp;
+            }
+            else
+            {
+                strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
+                wtx.fTimeReceivedIsTxTime = 0;
+            }
+            wss.vWalletUpgrade.push_back(hash);
+        }
+
+        if (wtx.nOrderPos == -1)
+            wss.fAnyUnordered = true;
+
+        wss.nWalletTx++;
+        pwallet->AddToWallet(wtx, true, NULL, 0);
+    } catch (...)
+    {
+        return false;
+    }
+    return true;
+}
+
 bool
 ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
              CWalletScanState &wss, string& strType, string& strErr)
@@ -834,97 +993,11 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
             ssValue >> pwallet->nOrderPosNext;
         }
 
-        else if (strType == "tx" || strType == "ctx") //ctx is encrypted tx
+        else if (IsTxRecordType(strType))
         {
-
-            uint256 hash;
-            CWalletTx wtx;
-
-            if (strType == "tx") {
-                ssKey >> hash;
-                ssValue >> wtx;
-            } else {
-                uint256 chash;
-                ssKey >> chash;
-                vector<unsigned char> vchCryptedSecret;
-                ssValue >> vchCryptedSecret;
-
-                if (!pwallet->DecryptWalletTransaction(chash, vchCryptedSecret, hash, wtx))
-                {
-                    strErr = "Error reading wallet database: DecryptWalletTransaction failed";
-                    return false;
-                }
-            }
-
-            CValidationState state;
-            auto verifier = libzcash::ProofVerifier::Strict();
-            // ac_public chains set at height like KMD and ZEX, will force a rescan if we dont ignore this error: bad-txns-acpublic-chain
-            // there cannot be any ztx in the wallet on ac_public chains that started from block 1, so this wont affect those.
-            // PIRATE and ESKENAS fails this check for notary nodes, need exception. Triggers full rescan without it.
-            if ( !(CheckTransaction(0,wtx, state, verifier, 0, 0) && (wtx.GetHash() == hash) && state.IsValid()) && (state.GetRejectReason() != "bad-txns-acpublic-chain" && state.GetRejectReason() != "bad-txns-acprivacy-chain" && state.GetRejectReason() != "bad-txns-stakingtx") )
-            {
-                //fprintf(stderr, "tx failed: %s rejectreason.%s\n", wtx.GetHash().GetHex().c_str(), state.GetRejectReason().c_str());
-                // vin-empty on staking chains is error relating to a failed staking tx, that for some unknown reason did not fully erase. save them here to erase and re-add later on.
-                if ( ASSETCHAINS_STAKED != 0 && state.GetRejectReason() == "bad-txns-vin-empty" )
-                    deadTxns.push_back(hash);
-                return false;
-            }
-            // Undo serialize changes in 31600
-            if (31404 <= wtx.fTimeReceivedIsTxTime && wtx.fTimeReceivedIsTxTime <= 31703)
-            {
-                if (!ssValue.empty())
-                {
-                    char fTmp;
-                    char fUnused;
-                    ssValue >> fTmp >> fUnused >> wtx.strFromAccount;
-                    strErr = strprintf("LoadWallet() upgrading tx ver=%d %d '%s' %s",
-                                       wtx.fTimeReceivedIsTxTime, fTmp, wtx.strFromAccount, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = fTmp;
-                }
-                else
-                {
-                    strErr = strprintf("LoadWallet() repairing tx ver=%d %s", wtx.fTimeReceivedIsTxTime, hash.ToString());
-                    wtx.fTimeReceivedIsTxTime = 0;
-                }
-                wss.vWalletUpgrade.push_back(hash);
-            }
-
-            if (wtx.nOrderPos == -1)
-                wss.fAnyUnordered = true;
-
-            wss.nWalletTx++;
-            pwallet->AddToWallet(wtx, true, NULL, 0);
-        }
-        else if (strType == "arctx" || strType == "carctx") //carctx is encrypted arctx
-        {
-            //The ArchiveTxPoint structure was changed. An older version will fail
-            //to deserialize and not be added to the mapArcTx, triggering a full
-            //ZapWalletTxes and Rescan.
-            try
-            {
-                uint256 txid;
-                ArchiveTxPoint arcTxPt;
-                if (strType == "arctx") {
-                    ssKey >> txid;
-                    ssValue >> arcTxPt;
-                } else {
-                    uint256 chash;
-                    ssKey >> chash;
-                    vector<unsigned char> vchCryptedSecret;
-                    ssValue >> vchCryptedSecret;
-
-                    if (!pwallet->DecryptWalletArchiveTransaction(chash, vchCryptedSecret, txid, arcTxPt))
-                    {
-                        strErr = "Error reading wallet database: DecryptWalletArchiveTransaction failed";
-                        return false;
-                    }
-                }
-
-                wss.nArcTx++;
-                pwallet->LoadArcTxs(txid, arcTxPt);
-            }
-            catch (...) {}
-
+            CWalletTxRecord rec(strType, ssKey, ssValue);
+            DecodeTxRecord(pwallet, rec);
+            return LoadTxRecord(pwallet, rec, wss, strErr);
         }
         else if (strType == "arczsop" || strType == "carczsop") //carczsop is encrypted arczsop
         {
@@ -1621,23 +1694,9 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
             return DB_CORRUPT;
         }
 
-        while (true)
-        {
-            // Read next record
-            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-            int ret = ReadAtCursor(pcursor, ssKey, ssValue);
-            if (ret == DB_NOTFOUND)
-                break;
-            else if (ret != 0)
-            {
-                LogPrintf("Error reading next record from wallet database\n");
-                return DB_CORRUPT;
-            }
-
+        auto fnRecordLoaded = [&](bool fReadOK, const string& strType, const string& strErr) {
             // Try to be tolerant of single corrupt records:
-            string strType, strErr;
-            if (!ReadKeyValue(pwallet, ssKey, ssValue, wss, strType, strErr))
+            if (!fReadOK)
             {
                 // losing keys is considered a catastrophic error, anything else
                 // we assume the user can live with:
@@ -1654,7 +1713,56 @@ DBErrors CWalletDB::LoadWallet(CWallet* pwallet)
             }
             if (!strErr.empty())
                 LogPrintf("%s\n", strErr);
+        };
+
+        // Transaction records make up the bulk of a large wallet. Decrypt and
+        // deserialize them in parallel, then load each batch in cursor order.
+        vector<CWalletTxRecord> vTxRecords;
+        auto fnLoadTxRecords = [&]() {
+            DecodeTxRecords(pwallet, vTxRecords);
+            for (CWalletTxRecord& rec : vTxRecords)
+            {
+                string strErr;
+                bool fReadOK = LoadTxRecord(pwallet, rec, wss, strErr);
+                fnRecordLoaded(fReadOK, rec.strType, strErr);
+            }
+            vTxRecords.clear();
+        };
+
+        while (true)
+        {
+            // Read next record
+            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+            int ret = ReadAtCursor(pcursor, ssKey, ssValue);
+            if (ret == DB_NOTFOUND)
+                break;
+            else if (ret != 0)
+            {
+                LogPrintf("Error reading next record from wallet database\n");
+                return DB_CORRUPT;
+            }
+
+            string strType, strErr;
+            {
+                CDataStream ssType(ssKey);
+                try {
+                    ssType >> strType;
+                } catch (...) {}
+            }
+            if (IsTxRecordType(strType))
+            {
+                ssKey >> strType;
+                vTxRecords.emplace_back(strType, ssKey, ssValue);
+                if (vTxRecords.size() >= WALLET_LOAD_TX_BATCH_SIZE)
+                    fnLoadTxRecords();
+                continue;
+            }
+
+            bool fReadOK = ReadKeyValue(pwallet, ssKey, ssValue, wss, strType, strErr);
+            fnRecordLoaded(fReadOK, strType, strErr);
         }
+        fnLoadTxRecords();
         pcursor->close();
     }
     catch (const boost::thread_interrupted&) {
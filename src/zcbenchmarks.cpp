@@ -4,7 +4,9 @@
 #include <thread>
 #include <unistd.h>
 #include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
 
+#include "arith_uint256.h"
 #include "coins.h"
 #include "util.h"
 #include "init.h"
@@ -13,15 +15,20 @@
 #include "crypto/equihash.h"
 #include "chain.h"
 #include "chainparams.h"
+#include "checkqueue.h"
 #include "consensus/upgrades.h"
 #include "consensus/validation.h"
+#include "dbwrapper.h"
+#include "hash.h"
 #include "main.h"
 #include "miner.h"
 #include "pow.h"
+#include "random.h"
 #include "rpc/server.h"
 #include "script/sign.h"
 #include "sodium.h"
 #include "streams.h"
+#include "transaction_builder.h"
 #include "txdb.h"
 #include "utiltest.h"
 #include "wallet/wallet.h"
@@ -434,6 +441,259 @@ double benchmark_connectblock_slow()
     return duration;
 }
 
+extern bool myGetTransaction(const uint256 &hash, CTransaction &txOut, uint256 &hashBlock); // in main.cpp
+
+// Replays the input lookups that CC validation makes for the last nBlocks
+// blocks: once on mempool acceptance and again when the block is connected.
+double benchmark_gettransaction(int nBlocks, bool fCache)
+{
+    if (!fTxIndex) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Benchmark requires the transaction index");
+    }
+
+    std::vector<uint256> vTxids;
+    {
+        LOCK(cs_main);
+        for (CBlockIndex* pindex = chainActive.Tip(); pindex && nBlocks > 0; pindex = pindex->pprev, nBlocks--) {
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pindex, 1)) {
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Failed to read block from disk");
+            }
+            for (const CTransaction& tx : block.vtx) {
+                if (tx.IsCoinBase())
+                    continue;
+                for (const CTxIn& txin : tx.vin) {
+                    vTxids.push_back(txin.prevout.hash);
+                }
+            }
+        }
+    }
+
+    size_t nMaxUsage = txCache.GetMaxUsage();
+    txCache.Clear();
+    if (!fCache) {
+        txCache.SetMaxUsage(0);
+    }
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    for (int nPass = 0; nPass < 2; nPass++) {
+        for (const uint256& txid : vTxids) {
+            CTransaction tx;
+            uint256 hashBlock;
+            myGetTransaction(txid, tx, hashBlock);
+        }
+    }
+    double t = timer_stop(tv_start);
+
+    txCache.SetMaxUsage(nMaxUsage);
+    return t;
+}
+
+int32_t komodo_checkPOW(int64_t stakeTxValue,int32_t slowflag,CBlock *pblock,int32_t height); // in komodo_bitcoind.cpp
+
+// Replays the header checks that accepting and connecting each of the last
+// nBlocks blocks goes through, and logs how many header hashes they computed.
+double benchmark_block_hashes(int nBlocks, bool fMemoize)
+{
+    std::vector<std::pair<CBlockIndex*, CBlock>> vBlocks;
+    {
+        LOCK(cs_main);
+        for (CBlockIndex* pindex = chainActive.Tip(); pindex && pindex->pprev && nBlocks > 0; pindex = pindex->pprev, nBlocks--) {
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pindex, 0)) {
+                throw JSONRPCError(RPC_INTERNAL_ERROR, "Failed to read block from disk");
+            }
+            // Copy the header fields only, as in a block just received from
+            // the network nothing is memoized yet
+            vBlocks.emplace_back(pindex, CBlock(block.GetBlockHeader()));
+            vBlocks.back().second.vtx.swap(block.vtx);
+        }
+    }
+
+    // only this thread ignores the memo, validation elsewhere keeps using it
+    std::unique_ptr<CBlockHeader::CNoHashMemo> noMemo;
+    if (!fMemoize)
+        noMemo.reset(new CBlockHeader::CNoHashMemo());
+    uint64_t nHashesStart = CBlockHeader::nHashesComputed;
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    {
+        LOCK(cs_main);
+        for (auto& entry : vBlocks) {
+            CBlock& block = entry.second;
+            int32_t futureblock;
+            CValidationState state;
+            CheckBlockHeader(&futureblock, entry.first->GetHeight(), entry.first, block, state, true);
+            ContextualCheckBlockHeader(block, state, entry.first->pprev);
+            block.GetHash();
+            komodo_checkPOW(0, 1, &block, entry.first->GetHeight());
+            block.GetHash();
+        }
+    }
+    double t = timer_stop(tv_start);
+
+    uint64_t nHashes = CBlockHeader::nHashesComputed - nHashesStart;
+    LogPrintf("benchmark_block_hashes: %u blocks, %.2f header hashes computed per block (memoize=%d)\n",
+        vBlocks.size(), vBlocks.empty() ? 0.0 : (double)nHashes / vBlocks.size(), fMemoize);
+    return t;
+}
+
+// A verification about as cheap as the queue overhead it is meant to expose
+class CBenchmarkCheck
+{
+private:
+    uint256 hash;
+
+public:
+    CBenchmarkCheck() {}
+    CBenchmarkCheck(const uint256& hashIn) : hash(hashIn) {}
+
+    bool operator()() {
+        for (int i = 0; i < 16; i++)
+            hash = Hash(hash.begin(), hash.end());
+        return !hash.IsNull();
+    }
+
+    void swap(CBenchmarkCheck& check) {
+        std::swap(hash, check.hash);
+    }
+};
+
+// Pushes nChecks verifications through a check queue with nThreads threads
+// (the master included), two at a time as a block of small transactions does.
+double benchmark_checkqueue(int nThreads, int nChecks)
+{
+    CCheckQueue<CBenchmarkCheck> queue(128);
+    boost::thread_group threadGroup;
+    for (int i = 1; i < nThreads; i++)
+        threadGroup.create_thread(boost::bind(&CCheckQueue<CBenchmarkCheck>::Thread, boost::ref(queue)));
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    bool fOk;
+    {
+        CCheckQueueControl<CBenchmarkCheck> control(&queue);
+        for (int i = 0; i < nChecks; i += 2) {
+            std::vector<CBenchmarkCheck> vChecks;
+            vChecks.emplace_back(ArithToUint256(arith_uint256(i + 1)));
+            if (i + 1 < nChecks)
+                vChecks.emplace_back(ArithToUint256(arith_uint256(i + 2)));
+            control.Add(vChecks);
+        }
+        fOk = control.Wait();
+    }
+    double t = timer_stop(tv_start);
+
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+
+    assert(fOk);
+    LogPrintf("benchmark_checkqueue: %d threads, %.0f checks per second\n", nThreads, t > 0 ? nChecks / t : 0.0);
+    return t;
+}
+
+// Address index like key: the address, then the height big-endian so that
+// the entries of an address are read in chain order by a range scan
+struct CBenchmarkAddressKey
+{
+    char type;
+    uint160 hashBytes;
+    int blockHeight;
+    unsigned int index;
+
+    size_t GetSerializeSize(int nType, int nVersion) const {
+        return 29;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        ser_writedata32be(s, blockHeight);
+        ser_writedata32be(s, index);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        blockHeight = ser_readdata32be(s);
+        index = ser_readdata32be(s);
+    }
+};
+
+// Writes nKeys coin like records and as many address index like records to a
+// scratch database tuned with the given profile, then times random coin
+// lookups (half of them missing, as for new outputs) and address scans.
+double benchmark_dbprofile(const std::string& strProfile, int nKeys)
+{
+    CDBOptions dbOptions = GetDBProfile(strProfile);
+    std::string strError;
+    if (!ParseDBOptions(dbOptions, strError))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strError);
+    // not the profile's database, keep it out of getdbstats and compactdb
+    dbOptions.fScratch = true;
+
+    const int nAddresses = std::max(1, nKeys / 100);
+    boost::filesystem::path path = GetDataDir() / "benchmark-db";
+    double tLookups, tScans;
+    int nFound = 0, nScanned = 0;
+    {
+        CDBWrapper db(path, 8 << 20, false, true, dbOptions);
+        std::vector<unsigned char> vValue(40, 0x5a);
+        CDBBatch batch(db);
+        for (int i = 0; i < nKeys; i++) {
+            batch.Write(std::make_pair('c', Hash(BEGIN(i), END(i))), vValue);
+            CBenchmarkAddressKey key;
+            int nAddress = i % nAddresses;
+            key.type = 'a';
+            key.hashBytes = Hash160(BEGIN(nAddress), END(nAddress));
+            key.blockHeight = i / nAddresses;
+            key.index = 0;
+            batch.Write(key, (CAmount)i);
+            if ((i + 1) % 1000 == 0) {
+                db.WriteBatch(batch);
+                batch.Clear();
+            }
+        }
+        db.WriteBatch(batch);
+        // Read from table files, as a node does once the data is out of the write buffer
+        db.Compact();
+
+        struct timeval tv_start;
+        timer_start(tv_start);
+        for (int i = 0; i < nKeys; i++) {
+            int n = GetRand(2 * nKeys);
+            if (db.Exists(std::make_pair('c', Hash(BEGIN(n), END(n)))))
+                nFound++;
+        }
+        tLookups = timer_stop(tv_start);
+
+        const int nScans = std::min(nAddresses, 1000);
+        timer_start(tv_start);
+        for (int i = 0; i < nScans; i++) {
+            int nAddress = GetRand(nAddresses);
+            uint160 hashBytes = Hash160(BEGIN(nAddress), END(nAddress));
+            boost::scoped_ptr<CDBIterator> pcursor(db.NewIterator());
+            pcursor->Seek(std::make_pair('a', hashBytes));
+            for (; pcursor->Valid(); pcursor->Next()) {
+                CBenchmarkAddressKey key;
+                CAmount nValue;
+                if (!pcursor->GetKey(key) || key.type != 'a' || key.hashBytes != hashBytes)
+                    break;
+                if (pcursor->GetValue(nValue))
+                    nScanned++;
+            }
+        }
+        tScans = timer_stop(tv_start);
+    }
+    boost::filesystem::remove_all(path);
+
+    LogPrintf("benchmark_dbprofile: %s profile, %d lookups (%d found) in %.3fs, %d address scans (%d entries) in %.3fs\n",
+        strProfile, nKeys, nFound, tLookups, std::min(nAddresses, 1000), nScanned, tScans);
+    return tLookups + tScans;
+}
+
 extern UniValue getnewaddress(const UniValue& params, bool fHelp, const CPubKey& mypk); // in rpcwallet.cpp
 extern UniValue sendtoaddress(const UniValue& params, bool fHelp, const CPubKey& mypk);
 
@@ -451,13 +711,30 @@ double benchmark_sendtoaddress(CAmount amount)
     return timer_stop(tv_start);
 }
 
-double benchmark_loadwallet()
+double benchmark_loadwallet(const SecureString& strWalletPassphrase)
 {
     pre_wallet_load();
     struct timeval tv_start;
     bool fFirstRunRet=true;
-    timer_start(tv_start);
     pwalletMain = new CWallet("wallet.dat");
+
+    // Encrypted wallets are opened the same way AppInit2 does it. The
+    // passphrase key derivation is deliberately slow, so it is not timed.
+    if (pwalletMain->InitalizeCryptedLoad() == DB_LOAD_CRYPTED) {
+        pwalletMain->SetDBCrypted();
+        if (pwalletMain->LoadCryptedSeedFromDB() != DB_LOAD_OK || !pwalletMain->OpenWallet(strWalletPassphrase)) {
+            post_wallet_load();
+            throw JSONRPCError(RPC_WALLET_PASSPHRASE_INCORRECT, "Error: Could not open the encrypted wallet");
+        }
+        HDSeed seed;
+        if (!pwalletMain->GetHDSeed(seed)) {
+            post_wallet_load();
+            throw JSONRPCError(RPC_WALLET_ERROR, "Error: HD seed not found");
+        }
+        pwalletMain->seedEncyptionFP = seed.EncryptionFingerprint();
+    }
+
+    timer_start(tv_start);
     DBErrors nLoadWalletRet = pwalletMain->LoadWallet(fFirstRunRet);
     auto res = timer_stop(tv_start);
     post_wallet_load();
@@ -527,6 +804,68 @@ double benchmark_create_sapling_spend()
     return t;
 }
 
+double benchmark_create_sapling_transactions(size_t nSpends, size_t nOutputs, size_t nTxs, int nThreads)
+{
+    auto sk = libzcash::SaplingSpendingKey::random();
+    auto expsk = sk.expanded_spending_key();
+    auto fvk = expsk.full_viewing_key();
+    auto address = sk.default_address();
+    CAmount noteValue = 100000;
+    CAmount fee = 10000;
+    CAmount outputValue = (noteValue * nSpends - fee) / nOutputs;
+
+    // Witness each note as it is appended and update the earlier witnesses with
+    // the later commitments, so every spend proves its own note against one anchor
+    SaplingMerkleTree tree;
+    std::vector<SaplingNote> notes;
+    std::vector<SaplingWitness> witnesses;
+    for (size_t i = 0; i < nSpends * nTxs; i++) {
+        SaplingNote note(address, noteValue, libzcash::Zip212Enabled::BeforeZip212);
+        auto maybe_cm = note.cmu();
+        if (!maybe_cm) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Could not create note commitment");
+        }
+        tree.append(maybe_cm.get());
+        for (auto& witness : witnesses) {
+            witness.append(maybe_cm.get());
+        }
+        witnesses.push_back(tree.witness());
+        notes.push_back(note);
+    }
+    auto anchor = tree.root();
+
+    int nHeight;
+    {
+        LOCK(cs_main);
+        nHeight = chainActive.Height() + 1;
+    }
+
+    std::vector<TransactionBuilder> builders;
+    for (size_t t = 0; t < nTxs; t++) {
+        TransactionBuilder builder(Params().GetConsensus(), nHeight, nullptr);
+        builder.SetFee(fee);
+        for (size_t i = 0; i < nSpends; i++) {
+            builder.AddSaplingSpend(expsk, notes[t * nSpends + i], anchor, witnesses[t * nSpends + i]);
+        }
+        for (size_t i = 0; i < nOutputs; i++) {
+            builder.AddSaplingOutput(fvk.ovk, address, outputValue);
+        }
+        builders.push_back(builder);
+    }
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    std::vector<TransactionBuilderResult> results = BuildTransactions(builders, nThreads);
+    double t = timer_stop(tv_start);
+
+    for (auto& result : results) {
+        if (!result.IsTx()) {
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Failed to build transaction: " + result.GetError());
+        }
+    }
+    return t;
+}
+
 double benchmark_create_sapling_output()
 {
     auto sk = libzcash::SaplingSpendingKey::random();
@@ -635,3 +974,22 @@ double benchmark_verify_sapling_output()
     }
     return timer_stop(tv_start);
 }
+
+double benchmark_merkle_root(size_t nLeaves)
+{
+    std::vector<uint256> leaves(nLeaves);
+    for (size_t i = 0; i < nLeaves; i++) {
+        leaves[i] = GetRandHash();
+    }
+    std::vector<uint256> vMerkleTree;
+    bool mutated = false;
+
+    struct timeval tv_start;
+    timer_start(tv_start);
+    uint256 root = BuildMerkleTree(&mutated, leaves, vMerkleTree);
+    double ret = timer_stop(tv_start);
+
+    assert(!root.IsNull());
+    assert(!mutated);
+    return ret;
+}
@@ -16,12 +16,18 @@ extern double benchmark_large_tx(size_t nInputs);
 extern double benchmark_try_decrypt_notes(size_t nAddrs);
 extern double benchmark_increment_note_witnesses(size_t nTxs);
 extern double benchmark_connectblock_slow();
+extern double benchmark_gettransaction(int nBlocks, bool fCache);
 extern double benchmark_sendtoaddress(CAmount amount);
-extern double benchmark_loadwallet();
+extern double benchmark_loadwallet(const SecureString& strWalletPassphrase);
 extern double benchmark_listunspent();
 extern double benchmark_create_sapling_spend();
 extern double benchmark_create_sapling_output();
+extern double benchmark_create_sapling_transactions(size_t nSpends, size_t nOutputs, size_t nTxs, int nThreads);
 extern double benchmark_verify_sapling_spend();
 extern double benchmark_verify_sapling_output();
+extern double benchmark_merkle_root(size_t nLeaves);
+extern double benchmark_block_hashes(int nBlocks, bool fMemoize);
+extern double benchmark_checkqueue(int nThreads, int nChecks);
+extern double benchmark_dbprofile(const std::string& strProfile, int nKeys);
 
 #endif
@@ -11,17 +11,27 @@ CZMQAbstractNotifier::~CZMQAbstractNotifier()
     assert(!psocket);
 }
 
-bool CZMQAbstractNotifier::NotifyBlock(const CBlockIndex * /*CBlockIndex*/)
+bool CZMQAbstractNotifier::NotifyBlock(const CBlockIndex * /*CBlockIndex*/, const CZMQRawData &/*raw*/)
 {
     return true;
 }
 
-bool CZMQAbstractNotifier::NotifyBlock(const CBlock &)
+bool CZMQAbstractNotifier::NotifyBlock(const CBlock &, const CZMQRawData &/*raw*/)
 {
     return true;
 }
 
-bool CZMQAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/)
+bool CZMQAbstractNotifier::NotifyTransaction(const CTransaction &/*transaction*/, const CZMQRawData &/*raw*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyBlockConnected(const CBlockIndex * /*CBlockIndex*/)
+{
+    return true;
+}
+
+bool CZMQAbstractNotifier::NotifyBlockDisconnected(const CBlockIndex * /*CBlockIndex*/)
 {
     return true;
 }
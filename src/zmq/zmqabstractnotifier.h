@@ -6,10 +6,32 @@
 #define BITCOIN_ZMQ_ZMQABSTRACTNOTIFIER_H
 
 #include "zmqconfig.h"
+#include "support/allocators/zeroafterfree.h"
+
+#include <memory>
 
 class CBlockIndex;
 class CZMQAbstractNotifier;
 
+/**
+ * Serialized block or transaction handed to the notifiers. A block is
+ * serialized once and its transactions refer to their span of the block
+ * bytes, so that every notifier and the publisher thread share one buffer.
+ */
+struct CZMQRawData
+{
+    std::shared_ptr<const CSerializeData> data;
+    size_t offset;
+    size_t size;
+
+    CZMQRawData() : offset(0), size(0) { }
+    CZMQRawData(const std::shared_ptr<const CSerializeData> &dataIn, size_t offsetIn, size_t sizeIn) :
+        data(dataIn), offset(offsetIn), size(sizeIn) { }
+
+    bool IsNull() const { return !data; }
+    const char *begin() const { return data->data() + offset; }
+};
+
 typedef CZMQAbstractNotifier* (*CZMQNotifierFactory)();
 
 class CZMQAbstractNotifier
@@ -32,9 +54,17 @@ public:
     virtual bool Initialize(void *pcontext) = 0;
     virtual void Shutdown() = 0;
 
-    virtual bool NotifyBlock(const CBlockIndex *pindex);
-    virtual bool NotifyBlock(const CBlock& pblock);
-    virtual bool NotifyTransaction(const CTransaction &transaction);
+    //! The raw data arguments are only filled for notifiers that want them
+    virtual bool WantsRawData() const { return false; }
+    //! Checked blocks are only passed to the notifiers publishing them
+    virtual bool WantsCheckedBlock() const { return false; }
+
+    virtual bool NotifyBlock(const CBlockIndex *pindex, const CZMQRawData &raw);
+    virtual bool NotifyBlock(const CBlock& pblock, const CZMQRawData &raw);
+    virtual bool NotifyTransaction(const CTransaction &transaction, const CZMQRawData &raw);
+    //! A block was connected to or disconnected from the active chain
+    virtual bool NotifyBlockConnected(const CBlockIndex *pindex);
+    virtual bool NotifyBlockDisconnected(const CBlockIndex *pindex);
 
 protected:
     void *psocket;
@@ -15,7 +15,7 @@ void zmqError(const char *str)
     LogPrint("zmq", "zmq: Error: %s, errno=%s\n", str, zmq_strerror(errno));
 }
 
-CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(NULL)
+CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(NULL), nMaxQueue(DEFAULT_ZMQ_QUEUE_SIZE), fWantsRawData(false)
 {
 }
 
@@ -40,6 +40,7 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
     factories["pubcheckedblock"] = CZMQAbstractNotifier::Create<CZMQPublishCheckedBlockNotifier>;
+    factories["pubsequence"] = CZMQAbstractNotifier::Create<CZMQPublishSequenceNotifier>;
 
     for (std::map<std::string, CZMQNotifierFactory>::const_iterator i=factories.begin(); i!=factories.end(); ++i)
     {
@@ -60,6 +61,10 @@ CZMQNotificationInterface* CZMQNotificationInterface::CreateWithArguments(const
         notificationInterface = new CZMQNotificationInterface();
         notificationInterface->notifiers = notifiers;
 
+        std::map<std::string, std::string>::const_iterator j = args.find("-zmqqueuesize");
+        if (j!=args.end())
+            notificationInterface->nMaxQueue = std::max(1, atoi(j->second));
+
         if (!notificationInterface->Initialize())
         {
             delete notificationInterface;
@@ -104,6 +109,11 @@ bool CZMQNotificationInterface::Initialize()
         return false;
     }
 
+    for (i=notifiers.begin(); i!=notifiers.end(); ++i)
+        fWantsRawData |= (*i)->WantsRawData();
+
+    StartZMQPublisher(nMaxQueue);
+
     return true;
 }
 
@@ -113,6 +123,9 @@ void CZMQNotificationInterface::Shutdown()
     LogPrint("zmq", "zmq: Shutdown notification interface\n");
     if (pcontext)
     {
+        // Publish what is still queued before the sockets are closed
+        StopZMQPublisher();
+
         for (std::list<CZMQAbstractNotifier*>::iterator i=notifiers.begin(); i!=notifiers.end(); ++i)
         {
             CZMQAbstractNotifier *notifier = *i;
@@ -125,33 +138,61 @@ void CZMQNotificationInterface::Shutdown()
     }
 }
 
-void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
+std::shared_ptr<const CZMQNotificationInterface::CRawBlock> CZMQNotificationInterface::GetRawBlock(const CBlock &block)
 {
-    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
+    uint256 hash = block.GetHash();
     {
-        CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyBlock(pindex))
-        {
-            i++;
-        }
-        else
-        {
-            notifier->Shutdown();
-            i = notifiers.erase(i);
-        }
+        std::lock_guard<std::mutex> lock(cs_rawblock);
+        if (lastRawBlock && lastRawBlock->hash == hash)
+            return lastRawBlock;
     }
+
+    // Same bytes as ss << block, recording where each transaction starts
+    std::shared_ptr<CRawBlock> rawBlock = std::make_shared<CRawBlock>();
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << static_cast<const CBlockHeader&>(block);
+    WriteCompactSize(ss, block.vtx.size());
+    rawBlock->vTxSpans.reserve(block.vtx.size());
+    for (const CTransaction &tx : block.vtx)
+    {
+        size_t nStart = ss.size();
+        ss << tx;
+        rawBlock->vTxSpans.push_back(std::make_pair(nStart, ss.size() - nStart));
+    }
+    std::shared_ptr<CSerializeData> data = std::make_shared<CSerializeData>();
+    ss.GetAndClear(*data);
+    rawBlock->hash = hash;
+    rawBlock->raw = CZMQRawData(data, 0, data->size());
+
+    std::lock_guard<std::mutex> lock(cs_rawblock);
+    lastRawBlock = rawBlock;
+    return rawBlock;
 }
 
-void CZMQNotificationInterface::BlockChecked(const CBlock& block, const CValidationState& state)
+CZMQRawData CZMQNotificationInterface::GetRawTransaction(const CTransaction &tx, const CBlock *pblock)
 {
-    if (state.IsInvalid()) {
-        return;
+    // Block transactions are notified by reference into the block
+    if (pblock && !pblock->vtx.empty() && &tx >= &pblock->vtx.front() && &tx <= &pblock->vtx.back())
+    {
+        std::shared_ptr<const CRawBlock> rawBlock = GetRawBlock(*pblock);
+        const std::pair<size_t, size_t> &span = rawBlock->vTxSpans[&tx - &pblock->vtx.front()];
+        return CZMQRawData(rawBlock->raw.data, span.first, span.second);
     }
 
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << tx;
+    std::shared_ptr<CSerializeData> data = std::make_shared<CSerializeData>();
+    ss.GetAndClear(*data);
+    return CZMQRawData(data, 0, data->size());
+}
+
+void CZMQNotificationInterface::NotifyAll(const std::function<bool (CZMQAbstractNotifier*)> &func)
+{
+    std::lock_guard<std::mutex> lock(cs_notifiers);
     for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
     {
         CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyBlock(block))
+        if (func(notifier))
         {
             i++;
         }
@@ -163,19 +204,66 @@ void CZMQNotificationInterface::BlockChecked(const CBlock& block, const CValidat
     }
 }
 
-void CZMQNotificationInterface::SyncTransaction(const CTransaction &tx, const CBlock *pblock, const int nHeight)
+void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindex)
 {
-    for (std::list<CZMQAbstractNotifier*>::iterator i = notifiers.begin(); i!=notifiers.end(); )
+    CZMQRawData raw;
+    if (fWantsRawData)
     {
-        CZMQAbstractNotifier *notifier = *i;
-        if (notifier->NotifyTransaction(tx))
         {
-            i++;
+            std::lock_guard<std::mutex> lock(cs_rawblock);
+            if (lastRawBlock && lastRawBlock->hash == pindex->GetBlockHash())
+                raw = lastRawBlock->raw;
         }
-        else
+        // Only read back when no transaction of the block was published
+        if (raw.IsNull())
         {
-            notifier->Shutdown();
-            i = notifiers.erase(i);
+            CBlock block;
+            bool fRead;
+            {
+                LOCK(cs_main);
+                fRead = ReadBlockFromDisk(block, pindex, 1);
+            }
+            if (fRead)
+                raw = GetRawBlock(block)->raw;
         }
     }
+
+    NotifyAll([pindex, &raw](CZMQAbstractNotifier *notifier) {
+        return notifier->NotifyBlock(pindex, raw);
+    });
+}
+
+void CZMQNotificationInterface::ChainTip(const CBlockIndex *pindex, const CBlock *pblock, const SproutMerkleTree &sproutTree, const SaplingMerkleTree &saplingTree, bool added)
+{
+    NotifyAll([pindex, added](CZMQAbstractNotifier *notifier) {
+        return added ? notifier->NotifyBlockConnected(pindex) : notifier->NotifyBlockDisconnected(pindex);
+    });
+}
+
+void CZMQNotificationInterface::BlockChecked(const CBlock& block, const CValidationState& state)
+{
+    if (state.IsInvalid()) {
+        return;
+    }
+
+    // Raised on the validation thread, serialize only for the checkedblock notifiers
+    CZMQRawData raw;
+    NotifyAll([this, &block, &raw](CZMQAbstractNotifier *notifier) {
+        if (!notifier->WantsCheckedBlock())
+            return true;
+        if (raw.IsNull())
+            raw = GetRawBlock(block)->raw;
+        return notifier->NotifyBlock(block, raw);
+    });
+}
+
+void CZMQNotificationInterface::SyncTransaction(const CTransaction &tx, const CBlock *pblock, const int nHeight)
+{
+    CZMQRawData raw;
+    if (fWantsRawData)
+        raw = GetRawTransaction(tx, pblock);
+
+    NotifyAll([&tx, &raw](CZMQAbstractNotifier *notifier) {
+        return notifier->NotifyTransaction(tx, raw);
+    });
 }
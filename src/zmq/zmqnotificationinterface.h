@@ -7,11 +7,14 @@
 
 #include "validationinterface.h"
 #include "consensus/validation.h"
+#include "zmqabstractnotifier.h"
+#include <functional>
+#include <list>
 #include <string>
 #include <map>
+#include <mutex>
 
 class CBlockIndex;
-class CZMQAbstractNotifier;
 
 class CZMQNotificationInterface : public CValidationInterface
 {
@@ -27,13 +30,35 @@ protected:
     // CValidationInterface
     void SyncTransaction(const CTransaction &tx, const CBlock *pblock, const int nHeight);
     void UpdatedBlockTip(const CBlockIndex *pindex);
+    void ChainTip(const CBlockIndex *pindex, const CBlock *pblock, const SproutMerkleTree &sproutTree, const SaplingMerkleTree &saplingTree, bool added);
     void BlockChecked(const CBlock& block, const CValidationState& state);
 
 private:
     CZMQNotificationInterface();
 
+    /** A block serialized for the notifiers, with the span of each of its transactions */
+    struct CRawBlock
+    {
+        uint256 hash;
+        CZMQRawData raw;
+        std::vector<std::pair<size_t, size_t>> vTxSpans;
+    };
+
+    std::shared_ptr<const CRawBlock> GetRawBlock(const CBlock &block);
+    CZMQRawData GetRawTransaction(const CTransaction &tx, const CBlock *pblock);
+    /** Run func on the notifiers, shutting down the ones that fail */
+    void NotifyAll(const std::function<bool (CZMQAbstractNotifier*)> &func);
+
     void *pcontext;
+    size_t nMaxQueue;
+    //! Protects notifiers, BlockChecked is raised on the validation thread
+    std::mutex cs_notifiers;
     std::list<CZMQAbstractNotifier*> notifiers;
+    bool fWantsRawData;
+
+    //! The last block serialized, shared by the block and transaction notifiers
+    std::mutex cs_rawblock;
+    std::shared_ptr<const CRawBlock> lastRawBlock;
 };
 
 #endif // BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
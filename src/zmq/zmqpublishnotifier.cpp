@@ -5,6 +5,12 @@
 #include "zmqpublishnotifier.h"
 #include "main.h"
 #include "util.h"
+#include "rust/metrics.h"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
 
@@ -14,47 +20,193 @@ static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
 static const char *MSG_CHECKEDBLOCK = "checkedblock";
 
+static const char *MSG_SEQUENCE = "sequence";
+
+namespace {
+
+/** A message waiting for the publisher thread */
+struct CZMQMessage
+{
+    void *psocket;
+    const char *command;
+    CZMQRawData data;
+    uint32_t nSequence;
+};
+
+static void zmq_free_raw_data(void * /*data*/, void *hint)
+{
+    delete static_cast<std::shared_ptr<const CSerializeData>*>(hint);
+}
+
+// Internal function to send one part of a multipart message, the raw data is
+// handed to ZMQ without copying and released once it has been sent
+static int zmq_send_part(void *sock, const CZMQRawData &raw, bool fMore)
+{
+    zmq_msg_t msg;
+
+    std::shared_ptr<const CSerializeData> *hint = new std::shared_ptr<const CSerializeData>(raw.data);
+    int rc = zmq_msg_init_data(&msg, const_cast<char*>(raw.begin()), raw.size, zmq_free_raw_data, hint);
+    if (rc != 0)
+    {
+        zmqError("Unable to initialize ZMQ msg");
+        delete hint;
+        return -1;
+    }
+
+    rc = zmq_msg_send(&msg, sock, ZMQ_DONTWAIT | (fMore ? ZMQ_SNDMORE : 0));
+    if (rc == -1)
+    {
+        if (errno != EAGAIN)
+            zmqError("Unable to send ZMQ msg");
+        zmq_msg_close(&msg);
+        return -1;
+    }
+
+    zmq_msg_close(&msg);
+    return 0;
+}
+
+static CZMQRawData MakeRawData(const void *data, size_t size)
+{
+    const char *begin = static_cast<const char*>(data);
+    return CZMQRawData(std::make_shared<const CSerializeData>(begin, begin + size), 0, size);
+}
+
 // Internal function to send multipart message
-static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
+static bool zmq_send_multipart(const CZMQMessage &message)
 {
-    va_list args;
-    va_start(args, size);
+    /* send three parts, command & data & a LE 4byte sequence number */
+    unsigned char msgseq[sizeof(uint32_t)];
+    WriteLE32(&msgseq[0], message.nSequence);
 
-    while (1)
+    if (zmq_send_part(message.psocket, MakeRawData(message.command, strlen(message.command)), true) == -1)
+        return false;
+    // Once the first part is out the others are queued by ZMQ as well
+    if (zmq_send_part(message.psocket, message.data, true) == -1)
+        return false;
+    return zmq_send_part(message.psocket, MakeRawData(msgseq, sizeof(msgseq)), false) == 0;
+}
+
+/**
+ * Messages are published by a dedicated thread so that a slow subscriber or
+ * a large block never holds back validation. The queue is bounded, when it
+ * is full new messages are dropped; they still use up a sequence number so
+ * that the subscribers can tell that they missed something.
+ */
+class CZMQPublisher
+{
+private:
+    std::mutex cs;
+    //! Signaled when a message is queued or the thread must stop
+    std::condition_variable condQueued;
+    //! Signaled when the queue is empty and nothing is being sent
+    std::condition_variable condIdle;
+    std::deque<CZMQMessage> queue;
+    size_t nMaxQueue = DEFAULT_ZMQ_QUEUE_SIZE;
+    size_t nHighWater = 0;
+    bool fRunning = false;
+    bool fSending = false;
+    bool fStop = false;
+    std::thread thread;
+
+    void ThreadPublish()
     {
-        zmq_msg_t msg;
+        RenameThread("komodo-zmq");
+        std::unique_lock<std::mutex> lock(cs);
+        while (true) {
+            condQueued.wait(lock, [this]() { return fStop || !queue.empty(); });
+            // Everything queued before the stop request is still published
+            if (queue.empty())
+                break;
+            CZMQMessage message = std::move(queue.front());
+            queue.pop_front();
+            fSending = true;
+            MetricsGauge("eskenas.zmq.queue.messages", queue.size());
+            lock.unlock();
+
+            if (!zmq_send_multipart(message))
+                MetricsIncrementCounter("eskenas.zmq.messages.dropped", "topic", message.command);
+
+            lock.lock();
+            fSending = false;
+            if (queue.empty())
+                condIdle.notify_all();
+        }
+    }
 
-        int rc = zmq_msg_init_size(&msg, size);
-        if (rc != 0)
+public:
+    void Start(size_t nMaxQueueIn)
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        if (fRunning)
+            return;
+        nMaxQueue = nMaxQueueIn;
+        fStop = false;
+        fRunning = true;
+        thread = std::thread(&CZMQPublisher::ThreadPublish, this);
+    }
+
+    void Stop()
+    {
         {
-            zmqError("Unable to initialize ZMQ msg");
-            va_end(args);
-            return -1;
+            std::lock_guard<std::mutex> lock(cs);
+            if (!fRunning)
+                return;
+            fStop = true;
+            condQueued.notify_all();
         }
+        thread.join();
+        std::lock_guard<std::mutex> lock(cs);
+        fRunning = false;
+        condIdle.notify_all();
+    }
 
-        void *buf = zmq_msg_data(&msg);
-        memcpy(buf, data, size);
-
-        data = va_arg(args, const void*);
+    /** Wait until the queued messages have been published */
+    void Flush()
+    {
+        std::unique_lock<std::mutex> lock(cs);
+        condIdle.wait(lock, [this]() { return !fRunning || (queue.empty() && !fSending); });
+    }
 
-        rc = zmq_msg_send(&msg, sock, data ? ZMQ_SNDMORE : 0);
-        if (rc == -1)
+    void Push(CZMQMessage &&message)
+    {
         {
-            zmqError("Unable to send ZMQ msg");
-            zmq_msg_close(&msg);
-            va_end(args);
-            return -1;
+            std::lock_guard<std::mutex> lock(cs);
+            if (fRunning) {
+                if (queue.size() >= nMaxQueue) {
+                    LogPrint("zmq", "zmq: Queue full, dropping %s message %u\n", message.command, message.nSequence);
+                    MetricsIncrementCounter("eskenas.zmq.messages.dropped", "topic", message.command);
+                    return;
+                }
+                queue.push_back(std::move(message));
+                if (queue.size() > nHighWater) {
+                    nHighWater = queue.size();
+                    MetricsGauge("eskenas.zmq.queue.highwater", nHighWater);
+                }
+                MetricsGauge("eskenas.zmq.queue.messages", queue.size());
+                condQueued.notify_one();
+                return;
+            }
         }
+        // Not started, publish from the calling thread
+        if (!zmq_send_multipart(message))
+            MetricsIncrementCounter("eskenas.zmq.messages.dropped", "topic", message.command);
+    }
+};
 
-        zmq_msg_close(&msg);
+CZMQPublisher publisher;
 
-        if (!data)
-            break;
+}
 
-        size = va_arg(args, size_t);
-    }
-    va_end(args);
-    return 0;
+void StartZMQPublisher(size_t nMaxQueue)
+{
+    LogPrint("zmq", "zmq: Start publisher thread, queue size %u\n", nMaxQueue);
+    publisher.Start(nMaxQueue);
+}
+
+void StopZMQPublisher()
+{
+    publisher.Stop();
 }
 
 bool CZMQAbstractPublishNotifier::Initialize(void *pcontext)
@@ -100,6 +252,9 @@ void CZMQAbstractPublishNotifier::Shutdown()
 {
     assert(psocket);
 
+    // The queued messages refer to the socket
+    publisher.Flush();
+
     int count = mapPublishNotifiers.count(address);
 
     // remove this notifier from the list of publishers using this address
@@ -128,22 +283,26 @@ void CZMQAbstractPublishNotifier::Shutdown()
 
 bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const void* data, size_t size)
 {
-    assert(psocket);
+    return SendMessage(command, MakeRawData(data, size));
+}
 
-    /* send three parts, command & data & a LE 4byte sequence number */
-    unsigned char msgseq[sizeof(uint32_t)];
-    WriteLE32(&msgseq[0], nSequence);
-    int rc = zmq_send_multipart(psocket, command, strlen(command), data, size, msgseq, (size_t)sizeof(uint32_t), (void*)0);
-    if (rc == -1)
-        return false;
+bool CZMQAbstractPublishNotifier::SendMessage(const char *command, const CZMQRawData &raw)
+{
+    assert(psocket);
+    assert(!raw.IsNull());
 
-    /* increment memory only sequence number after sending */
-    nSequence++;
+    CZMQMessage message;
+    message.psocket = psocket;
+    message.command = command;
+    message.data = raw;
+    /* memory only sequence number, also counts the messages dropped later on */
+    message.nSequence = nSequence++;
+    publisher.Push(std::move(message));
 
     return true;
 }
 
-bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex, const CZMQRawData &/*raw*/)
 {
     uint256 hash = pindex->GetBlockHash();
     LogPrint("zmq", "zmq: Publish hashblock %s\n", hash.GetHex());
@@ -153,7 +312,7 @@ bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
     return SendMessage(MSG_HASHBLOCK, data, 32);
 }
 
-bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
+bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &transaction, const CZMQRawData &/*raw*/)
 {
     uint256 hash = transaction.GetHash();
     LogPrint("zmq", "zmq: Publish hashtx %s\n", hash.GetHex());
@@ -163,44 +322,46 @@ bool CZMQPublishHashTransactionNotifier::NotifyTransaction(const CTransaction &t
     return SendMessage(MSG_HASHTX, data, 32);
 }
 
-bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
+bool CZMQPublishRawBlockNotifier::NotifyBlock(const CBlockIndex *pindex, const CZMQRawData &raw)
 {
     LogPrint("zmq", "zmq: Publish rawblock %s\n", pindex->GetBlockHash().GetHex());
-
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    if (raw.IsNull())
     {
-        LOCK(cs_main);
-        CBlock block;
-        if(!ReadBlockFromDisk(block, pindex,1))
-        {
-            zmqError("Can't read block from disk");
-            return false;
-        }
-
-        ss << block;
+        zmqError("Can't read block from disk");
+        return false;
     }
-
-    return SendMessage(MSG_RAWBLOCK, &(*ss.begin()), ss.size());
+    return SendMessage(MSG_RAWBLOCK, raw);
 }
 
-bool CZMQPublishCheckedBlockNotifier::NotifyBlock(const CBlock& block)
+bool CZMQPublishCheckedBlockNotifier::NotifyBlock(const CBlock& block, const CZMQRawData &raw)
 {
     LogPrint("zmq", "zmq: Publish checkedblock %s\n", block.GetHash().GetHex());
-
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    {
-        LOCK(cs_main);
-        ss << block;
-    }
-
-    return SendMessage(MSG_CHECKEDBLOCK, &(*ss.begin()), ss.size());
+    return SendMessage(MSG_CHECKEDBLOCK, raw);
 }
 
-bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction)
+bool CZMQPublishRawTransactionNotifier::NotifyTransaction(const CTransaction &transaction, const CZMQRawData &raw)
 {
     uint256 hash = transaction.GetHash();
     LogPrint("zmq", "zmq: Publish rawtx %s\n", hash.GetHex());
-    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
-    ss << transaction;
-    return SendMessage(MSG_RAWTX, &(*ss.begin()), ss.size());
+    return SendMessage(MSG_RAWTX, raw);
+}
+
+bool CZMQPublishSequenceNotifier::SendSequenceMessage(const uint256 &hash, char label)
+{
+    LogPrint("zmq", "zmq: Publish sequence %s %c\n", hash.GetHex(), label);
+    char data[33];
+    for (unsigned int i = 0; i < 32; i++)
+        data[31 - i] = hash.begin()[i];
+    data[32] = label;
+    return SendMessage(MSG_SEQUENCE, data, sizeof(data));
+}
+
+bool CZMQPublishSequenceNotifier::NotifyBlockConnected(const CBlockIndex *pindex)
+{
+    return SendSequenceMessage(pindex->GetBlockHash(), 'C');
+}
+
+bool CZMQPublishSequenceNotifier::NotifyBlockDisconnected(const CBlockIndex *pindex)
+{
+    return SendSequenceMessage(pindex->GetBlockHash(), 'D');
 }
@@ -7,22 +7,38 @@
 
 #include "zmqabstractnotifier.h"
 
+#include <atomic>
+
 class CBlockIndex;
 
+/** Default for -zmqqueuesize, the number of messages waiting to be published */
+static const unsigned int DEFAULT_ZMQ_QUEUE_SIZE = 1000;
+
+/**
+ * Start the thread publishing the notifications. Validation only queues the
+ * messages, when more than nMaxQueue are waiting new ones are dropped.
+ */
+void StartZMQPublisher(size_t nMaxQueue);
+/** Publish the queued messages and stop the thread */
+void StopZMQPublisher();
+
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
 {
 private:
-    uint32_t nSequence; //! upcounting per message sequence number
+    //! upcounting per message sequence number, dropped messages use one too
+    std::atomic<uint32_t> nSequence;
 
 public:
+    CZMQAbstractPublishNotifier() : nSequence(0) { }
 
-    /* send zmq multipart message
+    /* queue zmq multipart message
        parts:
           * command
           * data
           * message sequence number
     */
     bool SendMessage(const char *command, const void* data, size_t size);
+    bool SendMessage(const char *command, const CZMQRawData &raw);
 
     bool Initialize(void *pcontext);
     void Shutdown();
@@ -31,31 +47,46 @@ public:
 class CZMQPublishHashBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex);
+    bool NotifyBlock(const CBlockIndex *pindex, const CZMQRawData &raw);
 };
 
 class CZMQPublishHashTransactionNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyTransaction(const CTransaction &transaction);
+    bool NotifyTransaction(const CTransaction &transaction, const CZMQRawData &raw);
 };
 
 class CZMQPublishRawBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlockIndex *pindex);
+    bool WantsRawData() const { return true; }
+    bool NotifyBlock(const CBlockIndex *pindex, const CZMQRawData &raw);
 };
 
 class CZMQPublishRawTransactionNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyTransaction(const CTransaction &transaction);
+    bool WantsRawData() const { return true; }
+    bool NotifyTransaction(const CTransaction &transaction, const CZMQRawData &raw);
 };
 
 class CZMQPublishCheckedBlockNotifier : public CZMQAbstractPublishNotifier
 {
 public:
-    bool NotifyBlock(const CBlock &block);
+    bool WantsRawData() const { return true; }
+    bool WantsCheckedBlock() const { return true; }
+    bool NotifyBlock(const CBlock &block, const CZMQRawData &raw);
+};
+
+/** Hash of every block connected to (C) or disconnected from (D) the active chain */
+class CZMQPublishSequenceNotifier : public CZMQAbstractPublishNotifier
+{
+private:
+    bool SendSequenceMessage(const uint256 &hash, char label);
+
+public:
+    bool NotifyBlockConnected(const CBlockIndex *pindex);
+    bool NotifyBlockDisconnected(const CBlockIndex *pindex);
 };
 
 #endif // BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H